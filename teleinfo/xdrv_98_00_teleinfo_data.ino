@@ -5,6 +5,17 @@
 
   Version history :
     10/07/2025 v1.0 - Refactoring based on Tasmota 15
+    16/10/2026 v1.1 - Add MQTT store-and-forward queue
+    16/10/2026 v1.2 - Time HTTPS connexion apart from request
+                      Keep MQTT ring header in memory (RTC on ESP32)
+                      Separate HTTPS connexion timeout, LAN endpoint flag
+                      Add MQTT publication scheduler (token bucket)
+                      Add per field deadband report-by-exception (delta policy)
+                      Sparse delta messages published on their own DELTA topic
+                      Add contract switch latency and counter
+                      Add speed auto-detection thru framing statistics
+                      Cosphi average per power page kept by running sum (int16 sample array)
+                      MQTT queue records batched in memory, SENSOR stored as binary record
 
   Integration flags are stored in Settings :
 
@@ -65,11 +76,14 @@ TasmotaSerial *teleinfo_serial = nullptr;
 #ifdef ESP32
   #define TIC_LINE_QTY              74        // maximum number of lines handled in a TIC message
   #define TIC_DONNEE_SIZE           112       // maximum size of a TIC donnee
+  #define TIC_MESSAGE_ARENA         1536      // size of packed lines storage of a TIC message
   #define TIC_RX_BUFFER             1024
 #else
   #define TIC_LINE_QTY              54        // maximum number of lines handled in a TIC message
   #define TIC_DONNEE_SIZE           36        // maximum size of a TIC donnee
+  #define TIC_MESSAGE_ARENA         768       // size of packed lines storage of a TIC message
   #define TIC_RX_BUFFER             256
+  #define TIC_SERIAL_BUFFER         1024      // UART reception buffer (about 1s at 9600 bps)
 #endif    // ESP32
 
 // teleinfo constant
@@ -110,6 +124,7 @@ TasmotaSerial *teleinfo_serial = nullptr;
 // data file
 #define TIC_DATA_VERSION            1         // saved data version
 const char PSTR_DRIVER_DATA_FILE[]  PROGMEM = "/teleinfo-contract.dat";
+const char PSTR_MQTT_QUEUE_FILE[]   PROGMEM = "/teleinfo-mqtt.dat";
 
 // commands : MQTT
 #define CMND_TIC_RATE               "rate"
@@ -128,6 +143,7 @@ const char PSTR_DRIVER_DATA_FILE[]  PROGMEM = "/teleinfo-contract.dat";
 #define CMND_TIC_HOMIE              "homie"
 #define CMND_TIC_THINGSBOARD        "things"
 #define CMND_TIC_INFLUXDB           "influx"
+#define CMND_TIC_QUEUE              "queue"
 
 #define CMND_TIC_CONTRACT_INDEX     "index"
 #define CMND_TIC_CONTRACT_NAME      "name"
@@ -147,8 +163,8 @@ const char PSTR_DRIVER_DATA_FILE[]  PROGMEM = "/teleinfo-contract.dat";
 #define TIC_BRIGHT_DEFAULT          50        // default LED brightness
 
 // EnergyConfig commands
-const char kTeleinfoEnergyCommands[] PROGMEM =    "historique"   "|"   "standard"   "|"   "speed"   "|"   "detect"   "|"   "noraw"   "|"   "full"   "|"   "period"   "|"   "live"   "|"   "skip"   "|"   "bright"   "|"   "percent"   "|"   "stats"   "|"   "error"   "|"   "reset"   "|"    "calraz"   "|"   "calhexa"   "|"   "prod"   "|"   "trigger"   "|"    "display"   "|" CMND_TIC_POLICY "|" CMND_TIC_METER "|" CMND_TIC_CALENDAR "|" CMND_TIC_RELAY;
-enum TeleinfoEnergyCommand                   { TIC_CMND_HISTORIQUE, TIC_CMND_STANDARD, TIC_CMND_SPEED, TIC_CMND_DETECT, TIC_CMND_NORAW, TIC_CMND_FULL, TIC_CMND_PERIOD, TIC_CMND_LIVE, TIC_CMND_SKIP, TIC_CMND_BRIGHT, TIC_CMND_PERCENT, TIC_CMND_STATS, TIC_CMND_ERROR, TIC_CMND_RESET,  TIC_CMND_CALRAZ, TIC_CMND_CALHEXA, TIC_CMND_PROD, TIC_CMND_TRIGGER,  TIC_CMND_DISPLAY,  TIC_CMND_POLICY  ,  TIC_CMND_METER  ,  TIC_CMND_CALENDAR  ,  TIC_CMND_RELAY};
+const char kTeleinfoEnergyCommands[] PROGMEM =    "historique"   "|"   "standard"   "|"   "speed"   "|"   "detect"   "|"   "noraw"   "|"   "full"   "|"   "period"   "|"   "live"   "|"   "skip"   "|"   "bright"   "|"   "percent"   "|"   "stats"   "|"   "error"   "|"   "reset"   "|"    "calraz"   "|"   "calhexa"   "|"   "prod"   "|"   "trigger"   "|"    "display"   "|" CMND_TIC_POLICY "|" CMND_TIC_METER "|" CMND_TIC_CALENDAR "|" CMND_TIC_RELAY "|" CMND_TIC_QUEUE;
+enum TeleinfoEnergyCommand                   { TIC_CMND_HISTORIQUE, TIC_CMND_STANDARD, TIC_CMND_SPEED, TIC_CMND_DETECT, TIC_CMND_NORAW, TIC_CMND_FULL, TIC_CMND_PERIOD, TIC_CMND_LIVE, TIC_CMND_SKIP, TIC_CMND_BRIGHT, TIC_CMND_PERCENT, TIC_CMND_STATS, TIC_CMND_ERROR, TIC_CMND_RESET,  TIC_CMND_CALRAZ, TIC_CMND_CALHEXA, TIC_CMND_PROD, TIC_CMND_TRIGGER,  TIC_CMND_DISPLAY,  TIC_CMND_POLICY  ,  TIC_CMND_METER  ,  TIC_CMND_CALENDAR  ,  TIC_CMND_RELAY  ,  TIC_CMND_QUEUE};
 
 // Data publication commands
 static const char kTeleinfoDriverCommands[]  PROGMEM =          "|tic";
@@ -284,6 +300,23 @@ const char *const arr_kTicEtiquette[] PROGMEM = { kTicEtiquetteUnknown,     // c
                                                   kTicEtiquetteEmeraude,    // Emeraude
                                                   kTicEtiquetteJaune };     // Jaune
 
+// etiquette perfect hash (built from etiquette list of current meter mode)
+#define TIC_HASH_ENTRY_MAX        48                    // maximum number of etiquettes in a list
+#define TIC_HASH_BUCKET_BITS      4                     // 16 displacement buckets
+#define TIC_HASH_SLOT_BITS        6                     // 64 slots
+#define TIC_HASH_BUCKET           (1 << TIC_HASH_BUCKET_BITS)
+#define TIC_HASH_SLOT             (1 << TIC_HASH_SLOT_BITS)
+#define TIC_HASH_EMPTY            UINT8_MAX
+
+struct {                                                // 226 bytes
+  uint8_t  mode = TIC_MODE_MAX;                         // meter mode of current hash table
+  bool     ready = false;                               // hash table is usable (else linear search)
+  uint8_t  arr_seed[TIC_HASH_BUCKET];                   // displacement seed per bucket
+  uint8_t  arr_slot[TIC_HASH_SLOT];                     // etiquette index per slot
+  uint8_t  arr_size[TIC_HASH_ENTRY_MAX];                // etiquette length
+  uint16_t arr_offset[TIC_HASH_ENTRY_MAX];              // etiquette offset in PROGMEM list
+} teleinfo_hash;
+
 // Manufacturers
 // -------------<
 
@@ -464,10 +497,29 @@ tic_cal_day teleinfo_calendar[TIC_DAY_MAX];             // today, tomorrow and d
 // teleinfo : message
 // ------------------
 
-struct tic_line {                 // esp8266 37 bytes, esp32 125 bytes
-  char str_etiquette[TIC_ETIQUETTE_SIZE];               // line etiquette
-  char str_donnee[TIC_DONNEE_SIZE];                     // line donnee
-  char checksum;                                        // line checksum
+// packed line : checksum, etiquette index, donnee type, donnee size, [etiquette size and text if unknown or case differs], donnee
+//   donnee made only of digits is stored as a 4 or 8 bytes number (size is number of digits)
+enum TeleinfoValueType { TIC_VALUE_TEXT, TIC_VALUE_UINT32, TIC_VALUE_UINT64 };
+#define TIC_VALUE_TYPE_MASK         0x7F      // donnee type bits
+#define TIC_VALUE_RAW_ETIQUETTE     0x80      // received etiquette text is stored (case differs from lists)
+#define TIC_ETIQUETTE_NONE          UINT8_MAX // etiquette not in lists, stored as text
+
+struct tic_msg {                  // esp8266 880 bytes, esp32 1688 bytes
+  uint8_t  nb_line;                                     // number of lines in message
+  uint16_t size;                                        // number of bytes used in arena
+  uint16_t arr_offset[TIC_LINE_QTY];                    // offset of each line in arena
+  uint8_t  arr_data[TIC_MESSAGE_ARENA];                 // packed lines
+};
+
+struct tic_token {                // 9 bytes
+  bool    space;                                // last received character was a separator
+  uint8_t checksum;                             // running sum of received characters
+  uint8_t last;                                 // last received character
+  uint8_t prev;                                 // character received before last one
+  uint8_t size_raw;                             // number of received characters
+  uint8_t size;                                 // size of normalised line
+  uint8_t sep_first;                            // position of first separator (end of etiquette)
+  uint8_t sep_last;                             // position of last separator (before checksum)
 };
 
 struct tic_pointe {               // 8 bytes
@@ -475,22 +527,21 @@ struct tic_pointe {               // 8 bytes
   uint32_t stop;                                // stop date with slot
 };
 
-struct {                   // esp8266 4469 bytes, esp32 18825 bytes
+struct {                   // esp8266 2077 bytes, esp32 3693 bytes
   uint8_t     injection      = 0;                     // flag to detect injection part of message (Emeraude 4 quadrand)
   uint8_t     error          = 0;                     // error during current message reception
   uint8_t     period         = UINT8_MAX;             // period index in current message
+  uint8_t     last           = 0;                     // index of last received message in arr_msg (other one is current message)
   uint32_t    timestamp_last = UINT32_MAX;            // timestamp of last message (ms)
-  int         index_line     = 0;                     // index of current received message line
-  int         index_last     = 0;                     // number of lines in last message
   int         index_max      = 0;                     // max number of lines in a message
   long        duration       = 1000;                  // average duration of between 2 message (ms)
   char        str_total[12];                          // meter total index 
   char        str_contract[TIC_CONTRACT_CODE_SIZE];   // contract name in current message
   char        str_period[TIC_PERIOD_CODE_SIZE];       // period name in current message
-  char        str_line[TIC_LINE_SIZE];                // reception buffer for current line
+  char        str_line[TIC_LINE_SIZE];                // reception buffer for current line (normalised)
+  tic_token   token;                                  // tokenizer state of current line
   tic_pointe  arr_pointe[TIC_POINTE_MAX];             // array of pointe dates, 24 bytes
-  tic_line    arr_line[TIC_LINE_QTY];                 // array of lines in current message, esp8266 2072 bytes, esp32 9250 bytes
-  tic_line    arr_last[TIC_LINE_QTY];                 // array of lines in last message received, esp8266 2072 bytes, esp32 9250 bytes
+  tic_msg     arr_msg[2];                             // current and last message (swapped at message stop), esp8266 1760 bytes, esp32 3376 bytes
   tic_cal_day cal_default;                            // default daily profile
   tic_cal_day cal_pointe;                             // pointe daily profile
 } teleinfo_message;
@@ -499,14 +550,17 @@ struct {                   // esp8266 4469 bytes, esp32 18825 bytes
 // -------------------
 
 struct { 
-  bool    changed    = false;                   // flag to indicate that contract has changed
-  uint8_t unit       = TIC_UNIT_NONE;           // default contract unit
-  uint8_t mode       = TIC_MODE_UNKNOWN;        // meter mode (historic, standard)
-  uint8_t period     = UINT8_MAX;               // current period index
-  uint8_t phase      = 1;                       // number of phases
-  long    isousc     = 0;                       // contract max current per phase
-  long    ssousc     = 0;                       // contract max power per phase
-  char    str_period[TIC_PERIOD_CODE_SIZE];     // code of current period
+  bool     changed     = false;                 // flag to indicate that contract has changed
+  uint8_t  unit        = TIC_UNIT_NONE;         // default contract unit
+  uint8_t  mode        = TIC_MODE_UNKNOWN;      // meter mode (historic, standard)
+  uint8_t  period      = UINT8_MAX;             // current period index
+  uint8_t  phase       = 1;                     // number of phases
+  long     isousc      = 0;                     // contract max current per phase
+  long     ssousc      = 0;                     // contract max power per phase
+  uint32_t time_change = 0;                     // timestamp of first message with a different contract (ms)
+  uint32_t nb_switch   = 0;                     // number of contract switches on the fly
+  uint32_t switch_ms   = 0;                     // last contract change detection latency (ms)
+  char     str_period[TIC_PERIOD_CODE_SIZE];    // code of current period
 } teleinfo_contract;
 
 struct tic_period {               // 39 bytes
@@ -541,10 +595,11 @@ struct tic_alert {                // 10 bytes
   char     str_source[TIC_ALERT_SRC_SIZE];      // source of current alert
 };
 
-struct tic_json {                   // 3 bytes
+struct tic_json {                   // 4 bytes
   bool data;                                    // flag to publish ALERT, METER, RELAY, CONTRACT or CAL
   bool tic;                                     // flag to publish TIC
   bool live;                                    // flag to publish LIVE
+  bool delta;                                   // flag to publish sparse METER, CONTRACT and RELAY (delta policy)
 };
 
 struct {                     // 71 bytes
@@ -572,6 +627,401 @@ struct {                     // 71 bytes
   tic_alert arr_alert[TIC_ALERT_MAX];           // array of alerts
 } teleinfo_meter;
 
+// teleinfo : reception statistics
+// -------------------------------
+
+enum TeleinfoStatStage                   { TIC_STAGE_RX, TIC_STAGE_CHECKSUM, TIC_STAGE_LINE, TIC_STAGE_MESSAGE, TIC_STAGE_LATENCY, TIC_STAGE_MAX };
+const char kTeleinfoStatStage[] PROGMEM =       "rx"    "|"    "checksum"    "|"    "line"    "|"    "message"    "|"    "latency";
+
+struct tic_stage {                  // 16 bytes
+  uint32_t count;                               // number of measures
+  uint32_t peak;                                // longest duration (µs)
+  uint64_t total;                               // cumulated duration (µs)
+};
+
+struct {                     // 112 bytes
+  uint32_t  time_start = 0;                     // timestamp of statistics start (ms)
+  uint32_t  nb_byte    = 0;                     // number of received bytes since statistics start
+  uint32_t  nb_overrun = 0;                     // number of UART overruns since statistics start (ESP8266)
+  long      nb_message = 0;                     // messages counter at statistics start
+  long      nb_reset   = 0;                     // reset counter at statistics start
+  long long nb_line    = 0;                     // lines counter at statistics start
+  long long nb_error   = 0;                     // errors counter at statistics start
+  tic_stage arr_stage[TIC_STAGE_MAX];           // processing time per reception stage
+} teleinfo_stats;
+
+// teleinfo : reception ring (serial reader task -> parser, ESP32 only)
+// --------------------------------------------------------------------
+
+#ifdef ESP32
+
+#define TIC_RING_SIZE               4096      // ring size (power of 2, about 3s at 9600 bps)
+#define TIC_RING_STOP               16        // message stop timestamps queue size (power of 2)
+#define TIC_RING_TASK_STACK         2048      // reader task stack size
+#define TIC_RING_TASK_DELAY         10        // reader task polling period (ms)
+
+struct tic_ring_stop {            // 8 bytes
+  uint16_t position;                            // ring position of message stop character
+  uint32_t time;                                // reception timestamp (µs)
+};
+
+struct {                          // 4264 bytes
+  uint16_t head       = 0;                      // write index (reader side only)
+  uint16_t tail       = 0;                      // read index (parser side only)
+  uint16_t high       = 0;                      // high water mark since statistics reset (reader side only)
+  uint32_t nb_overrun = 0;                      // number of bytes lost because ring was full (reader side only)
+  uint8_t  stop_head  = 0;                      // message stop write index (reader side only)
+  uint8_t  stop_tail  = 0;                      // message stop read index (parser side only)
+  tic_ring_stop arr_stop[TIC_RING_STOP];        // message stop timestamps
+  char     arr_data[TIC_RING_SIZE];             // ring data
+  TaskHandle_t task   = nullptr;                // reader task
+  volatile bool reset  = false;                 // statistics reset asked to reader
+  volatile bool pause  = false;                 // reader task asked to pause (serial speed change)
+  volatile bool paused = false;                 // reader task is paused
+  uint32_t baudrate   = 0;                      // speed change waiting for reader task pause (0 if none)
+} teleinfo_ring;
+
+#endif    // ESP32
+
+// teleinfo : speed auto-detection (framing statistics on received characters)
+// ---------------------------------------------------------------------------
+//   a speed is rejected after TIC_DETECT_INVALID characters out of TIC charset
+//   or after TIC_DETECT_SAMPLE bytes without valid line, it is confirmed
+//   after TIC_DETECT_LINE lines with a valid checksum (historique or standard)
+
+#define TIC_DETECT_INVALID          8         // invalid characters to reject a speed
+#define TIC_DETECT_SAMPLE           256       // received bytes to reject a speed without valid line
+#define TIC_DETECT_LINE             2         // valid lines to confirm a speed
+#define TIC_DETECT_ROUND            4         // rounds thru all speeds before giving up
+
+const uint16_t arrTeleinfoDetectSpeed[] = { 1200, 9600, 19200, 4800, 2400 };       // speeds tested, most common first
+#define TIC_DETECT_SPEED_MAX        (sizeof (arrTeleinfoDetectSpeed) / sizeof (uint16_t))
+
+static struct {                     // 24 bytes
+  bool     active     = false;                  // detection running
+  bool     next       = false;                  // current speed rejected, next one should be tested
+  bool     in_line    = false;                  // line reception started
+  uint8_t  index      = 0;                      // index of speed under test
+  uint8_t  nb_try     = 0;                      // number of speeds tested
+  uint8_t  nb_invalid = 0;                      // number of invalid characters at current speed
+  uint8_t  nb_line    = 0;                      // number of valid lines at current speed
+  uint8_t  length     = 0;                      // current line length
+  char     prev[2];                             // last 2 characters of current line
+  uint16_t nb_byte    = 0;                      // number of bytes received at current speed
+  uint16_t sum        = 0;                      // running sum of current line characters
+  uint32_t time_start = 0;                      // timestamp of detection start (ms)
+  uint32_t duration   = 0;                      // duration of last detection (ms)
+} teleinfo_detect;
+
+// teleinfo : MQTT store-and-forward queue
+// ---------------------------------------
+
+#ifdef ESP32
+  #define TIC_MQTT_QUEUE_SIZE       131072    // ring file data area (about 2 days of SENSOR at 5 mn telemetry)
+#else
+  #define TIC_MQTT_QUEUE_SIZE       32768     // ring file data area
+#endif    // ESP32
+#ifdef ESP32
+  #define TIC_MQTT_BATCH_SIZE       1024      // records batch in RTC memory (survives restart and deepsleep)
+  #define TIC_MQTT_BATCH_FLUSH      900       // records batch written to ring file every 15 mn, or when full
+#else
+  #define TIC_MQTT_BATCH_SIZE       512       // records batch in RAM
+  #define TIC_MQTT_BATCH_FLUSH      300       // records batch written to ring file every 5 mn, or when full
+#endif    // ESP32
+#define TIC_MQTT_QUEUE_VERSION      2         // ring file header version
+#define TIC_MQTT_QUEUE_PAYLOAD      4096      // maximum queued payload size
+#define TIC_MQTT_SENSOR_SIZE        320       // maximum size of a binary SENSOR record
+#define TIC_MQTT_QUEUE_RATE         2         // records replayed every 250 ms
+#define TIC_MQTT_QUEUE_SETTLE       3000      // delay after broker connexion before replay (ms)
+#define TIC_MQTT_QUEUE_FLUSH        60        // ring header kept in memory, written to file every 60 sec. when changed
+#define TIC_MQTT_QUEUE_MAGIC        0x54494351  // check of ring header copy in RTC memory
+
+enum TeleinfoMqttTopic                  { TIC_MQTT_SENSOR, TIC_MQTT_LIVE, TIC_MQTT_TIC, TIC_MQTT_DELTA, TIC_MQTT_MAX };
+const char kTeleinfoMqttTopic[] PROGMEM =   D_RSLT_SENSOR  "|"  "LIVE"   "|"  "TIC"    "|"  "DELTA";
+const bool arrTeleinfoMqttCoalesce[]    = {     false     ,     true    ,     true      ,     false      };      // only last value matters
+
+struct tic_mqtt_header {            // 16 bytes (ring file header)
+  uint8_t  version;                             // header version
+  uint8_t  reserved;
+  uint16_t count;                               // number of queued records
+  uint32_t head;                                // write offset in data area
+  uint32_t tail;                                // read offset in data area
+  uint32_t used;                                // bytes used in data area
+};
+
+#define TIC_MQTT_FLAG_RETAIN        0x01      // record is published with retain flag
+#define TIC_MQTT_FLAG_SENSOR        0x02      // record payload is a binary SENSOR record (else JSON text)
+
+struct tic_mqtt_record {            // 8 bytes (record header, followed by payload)
+  uint32_t time;                                // UTC timestamp of publication
+  uint8_t  topic;                               // topic index
+  uint8_t  flag;                                // retain and payload format flags
+  uint16_t size;                                // payload size
+};
+
+struct tic_mqtt_batch {             // records waiting in memory before being written to ring file
+  uint32_t check;                               // batch check (invalid after power loss)
+  uint16_t count;                               // number of records
+  uint16_t used;                                // bytes used
+  uint8_t  arr_data[TIC_MQTT_BATCH_SIZE];       // records (header and payload)
+};
+
+static struct {                     // 84 bytes
+  bool     stored     = false;                  // ring file holds records
+  bool     replay     = false;                  // replay in progress
+  bool     dirty      = false;                  // ring header changed since last file write
+  uint32_t time_flush   = 0;                    // timestamp of last ring header write (ms)
+  uint32_t time_batch   = 0;                    // timestamp of last records batch write (ms)
+  uint32_t time_connect = 0;                    // timestamp of broker connexion (ms)
+  uint32_t time_oldest  = 0;                    // UTC timestamp of oldest queued record
+  uint32_t time_replay  = 0;                    // timestamp of replay start (ms)
+  uint32_t nb_queued    = 0;                    // number of records written to ring file
+  uint32_t nb_coalesced = 0;                    // number of values replaced by a newer one
+  uint32_t nb_dropped   = 0;                    // number of records lost (ring full, too big or no filesystem)
+  uint32_t nb_replayed  = 0;                    // number of records replayed
+  uint32_t last_count   = 0;                    // number of records of last replay
+  uint32_t last_ms      = 0;                    // duration of last replay (ms)
+  tic_mqtt_header header;                       // ring file header
+  char    *arr_last[TIC_MQTT_MAX];              // last value of coalesced topics
+} teleinfo_mqtt;
+
+#ifdef ESP32
+RTC_DATA_ATTR struct {            // 20 bytes data in NVRAM to survive restart and deepsleep
+  uint32_t check;                               // header check (invalid after power loss)
+  tic_mqtt_header header;                       // current ring header
+} teleinfo_mqtt_rtc;
+
+RTC_DATA_ATTR tic_mqtt_batch teleinfo_mqtt_batch;     // records batch in NVRAM to survive restart and deepsleep
+#else
+static tic_mqtt_batch teleinfo_mqtt_batch;            // records batch
+#endif    // ESP32
+
+// teleinfo : MQTT publication scheduler (token bucket shared by producers, own budget for paced producers)
+// --------------------------------------
+
+#define TIC_PUB_RATE_MSG            4         // messages per second
+#define TIC_PUB_BURST_MSG           2         // maximum messages in a burst
+#define TIC_PUB_RATE_BYTE           4096      // bytes per second
+#define TIC_PUB_BURST_BYTE          4096      // maximum bytes in a burst
+
+enum TeleinfoPubPriority   { TIC_PRIO_LIVE, TIC_PRIO_TOTAL, TIC_PRIO_DISCOVERY, TIC_PRIO_MAX };                                          // live data > totals > discovery
+enum TeleinfoPubProducer   { TIC_PRODUCER_DRIVER, TIC_PRODUCER_HOMIE, TIC_PRODUCER_DOMOTICZ, TIC_PRODUCER_HASS, TIC_PRODUCER_THINGSBOARD, TIC_PRODUCER_RTE, TIC_PRODUCER_MAX };
+const char kTeleinfoPubProducer[] PROGMEM = "tic|homie|domo|hass|things|rte";
+const uint8_t arrTeleinfoPubRate[TIC_PRODUCER_MAX] = { 0, 1, 0, 0, 0, 0 };        // own budget of producer (messages per second, 0 : shared bucket)
+
+typedef uint8_t (*TeleinfoPubPending) (uint16_t &backlog);        // return priority of next message (TIC_PRIO_MAX if nothing), set number of waiting messages
+typedef bool    (*TeleinfoPubPublish) ();                         // publish next message, return true if a message has been published
+
+struct tic_producer {               // 40 bytes
+  TeleinfoPubPending pending = nullptr;         // pending messages callback
+  TeleinfoPubPublish publish = nullptr;         // publication callback
+  uint16_t backlog      = 0;                    // waiting messages
+  int32_t  token        = 1000;                 // own budget message tokens (x1000)
+  uint32_t time_pending = 0;                    // timestamp of first waiting message (ms)
+  uint32_t nb_message   = 0;                    // number of published messages
+  uint32_t nb_byte      = 0;                    // number of published bytes
+  uint32_t latency_last = 0;                    // last publication latency (ms)
+  uint32_t latency_peak = 0;                    // peak publication latency (ms)
+  uint32_t latency_total = 0;                   // total publication latency (ms)
+};
+
+static struct {                     // 264 bytes
+  uint8_t  next       = 0;                      // round-robin index of next producer to be served
+  uint32_t size       = 0;                      // size of current message, measured before rules processing
+  int32_t  token_msg  = TIC_PUB_BURST_MSG  * 1000;   // message tokens (x1000)
+  int32_t  token_byte = TIC_PUB_BURST_BYTE;     // byte tokens (may be negative after a big message)
+  uint32_t time_refill = 0;                     // timestamp of last refill (ms)
+  uint32_t nb_deferred = 0;                     // number of ticks with messages waiting for tokens
+  tic_producer arr_producer[TIC_PRODUCER_MAX];  // registered producers
+} teleinfo_scheduler;
+
+// teleinfo : report-by-exception engine (delta policy)
+// -----------------------------------------------------
+//   a field is published when it moves out of its deadband, max (absolute, relative % of last published value),
+//   and its minimum interval is elapsed, or when its maximum interval is elapsed (0 = no heartbeat)
+//   power absolute deadband is given by energy_power_delta setting
+
+#define TIC_DELTA_POWER             -1        // absolute deadband taken from power delta setting
+
+enum TeleinfoDeltaFormat  { TIC_DELTA_FMT_INT, TIC_DELTA_FMT_MILLI, TIC_DELTA_FMT_PERIOD, TIC_DELTA_FMT_RELAY };
+enum TeleinfoDeltaField   { TIC_DELTA_U1, TIC_DELTA_U2, TIC_DELTA_U3, TIC_DELTA_I1, TIC_DELTA_I2, TIC_DELTA_I3, TIC_DELTA_P1, TIC_DELTA_P2, TIC_DELTA_P3, TIC_DELTA_W1, TIC_DELTA_W2, TIC_DELTA_W3,
+                            TIC_DELTA_U, TIC_DELTA_I, TIC_DELTA_P, TIC_DELTA_W, TIC_DELTA_C, TIC_DELTA_YDAY, TIC_DELTA_TDAY,
+                            TIC_DELTA_PP, TIC_DELTA_PW, TIC_DELTA_PC, TIC_DELTA_PAVG, TIC_DELTA_PYDAY, TIC_DELTA_PTDAY,
+                            TIC_DELTA_PERIOD, TIC_DELTA_CONSO, TIC_DELTA_PROD, TIC_DELTA_RELAY, TIC_DELTA_MAX };
+const char kTeleinfoDeltaKey[] PROGMEM = "U1|U2|U3|I1|I2|I3|P1|P2|P3|W1|W2|W3|U|I|P|W|C|YDAY|TDAY|PP|PW|PC|PAVG|PYDAY|PTDAY|period|CONSO|PROD|RELAY";
+
+struct tic_delta_rule {             // 12 bytes
+  long     abs;                                 // absolute deadband (unit of value)
+  uint8_t  rel;                                 // relative deadband (% of last published value)
+  uint8_t  format;                              // value format (TeleinfoDeltaFormat)
+  uint16_t min;                                 // minimum interval between publications (s)
+  uint16_t max;                                 // maximum interval between publications (s, 0 = none)
+};
+
+const tic_delta_rule arrTeleinfoDeltaRule[TIC_DELTA_MAX] = {
+//  absolute          rel  format                min   max
+  { 2               ,   0, TIC_DELTA_FMT_INT   ,  10,  300 },   // U1
+  { 2               ,   0, TIC_DELTA_FMT_INT   ,  10,  300 },   // U2
+  { 2               ,   0, TIC_DELTA_FMT_INT   ,  10,  300 },   // U3
+  { 500             ,  10, TIC_DELTA_FMT_MILLI ,   2,  300 },   // I1
+  { 500             ,  10, TIC_DELTA_FMT_MILLI ,   2,  300 },   // I2
+  { 500             ,  10, TIC_DELTA_FMT_MILLI ,   2,  300 },   // I3
+  { TIC_DELTA_POWER ,   5, TIC_DELTA_FMT_INT   ,   2,  300 },   // P1
+  { TIC_DELTA_POWER ,   5, TIC_DELTA_FMT_INT   ,   2,  300 },   // P2
+  { TIC_DELTA_POWER ,   5, TIC_DELTA_FMT_INT   ,   2,  300 },   // P3
+  { TIC_DELTA_POWER ,   5, TIC_DELTA_FMT_INT   ,   2,  300 },   // W1
+  { TIC_DELTA_POWER ,   5, TIC_DELTA_FMT_INT   ,   2,  300 },   // W2
+  { TIC_DELTA_POWER ,   5, TIC_DELTA_FMT_INT   ,   2,  300 },   // W3
+  { 2               ,   0, TIC_DELTA_FMT_INT   ,  10,  300 },   // U
+  { 500             ,  10, TIC_DELTA_FMT_MILLI ,   2,  300 },   // I
+  { TIC_DELTA_POWER ,   5, TIC_DELTA_FMT_INT   ,   2,  300 },   // P
+  { TIC_DELTA_POWER ,   5, TIC_DELTA_FMT_INT   ,   2,  300 },   // W
+  { 50              ,   0, TIC_DELTA_FMT_MILLI ,  10,  300 },   // C
+  { 1               ,   0, TIC_DELTA_FMT_INT   ,   0,  900 },   // YDAY
+  { 100             ,   0, TIC_DELTA_FMT_INT   ,  60,  900 },   // TDAY
+  { TIC_DELTA_POWER ,   5, TIC_DELTA_FMT_INT   ,   2,  300 },   // PP
+  { TIC_DELTA_POWER ,   5, TIC_DELTA_FMT_INT   ,   2,  300 },   // PW
+  { 50              ,   0, TIC_DELTA_FMT_MILLI ,  10,  300 },   // PC
+  { TIC_DELTA_POWER ,   5, TIC_DELTA_FMT_INT   ,  10,  300 },   // PAVG
+  { 1               ,   0, TIC_DELTA_FMT_INT   ,   0,  900 },   // PYDAY
+  { 100             ,   0, TIC_DELTA_FMT_INT   ,  60,  900 },   // PTDAY
+  { 1               ,   0, TIC_DELTA_FMT_PERIOD,   0,    0 },   // period
+  { 100             ,   0, TIC_DELTA_FMT_INT   ,  60,  900 },   // CONSO
+  { 100             ,   0, TIC_DELTA_FMT_INT   ,  60,  900 },   // PROD
+  { 1               ,   0, TIC_DELTA_FMT_RELAY ,   0,    0 }    // RELAY
+};
+
+struct tic_delta_field {            // 8 bytes
+  long     value;                               // last published value
+  uint32_t time;                                // last publication (uptime in s)
+};
+
+static struct {                     // 248 bytes
+  uint32_t mask      = 0;                       // fields waiting for publication
+  uint32_t nb_sparse = 0;                       // number of sparse publications
+  uint32_t nb_field  = 0;                       // number of fields published in sparse publications
+  uint32_t nb_full   = 0;                       // number of full publications
+  tic_delta_field arr_field[TIC_DELTA_MAX];     // last published fields
+} teleinfo_delta;
+
+// binary SENSOR record of MQTT queue : list of field index (1 byte) followed by its value
+//   (int64 for energy counters, int32 for others), fields below TIC_DELTA_MAX are report-by-exception ones
+enum TeleinfoSensorField { TIC_SENSOR_PH = TIC_DELTA_MAX, TIC_SENSOR_ISUB, TIC_SENSOR_PSUB, TIC_SENSOR_PMAX, TIC_SENSOR_INDEX, TIC_SENSOR_MAX = TIC_SENSOR_INDEX + TIC_PERIOD_MAX };
+enum TeleinfoSensorSection { TIC_SENSOR_SECTION_METER, TIC_SENSOR_SECTION_CONTRACT, TIC_SENSOR_SECTION_RELAY, TIC_SENSOR_SECTION_MAX };
+const char kTeleinfoSensorSection[] PROGMEM = "METER|CONTRACT|RELAY";
+const char kTeleinfoSensorKey[]     PROGMEM = "PH|ISUB|PSUB|PMAX";
+
+// teleinfo : JSON stream parser (SAX, no allocation)
+// ---------------------------------------------------
+
+#define TIC_JSON_DEPTH              8         // maximum handled nesting depth
+#define TIC_JSON_KEY_SIZE           24        // maximum key size (longer keys are truncated)
+#define TIC_JSON_VALUE_SIZE         136       // maximum value size (longer values are truncated)
+#define TIC_JSON_PATH_SIZE          64        // maximum path pattern size
+
+enum TeleinfoJsonState { TIC_JSON_STATE_VALUE, TIC_JSON_STATE_KEY, TIC_JSON_STATE_COLON, TIC_JSON_STATE_NEXT, TIC_JSON_STATE_STRING, TIC_JSON_STATE_ESCAPE, TIC_JSON_STATE_UNICODE, TIC_JSON_STATE_LITERAL, TIC_JSON_STATE_ERROR };
+
+struct tic_json_parser;
+typedef void (*TeleinfoJsonCallback) (tic_json_parser &parser, const char *pstr_value);
+
+struct tic_json_parser {            // 376 bytes
+  uint8_t  state;                               // lexer state
+  uint8_t  level;                               // number of open containers
+  uint8_t  length;                              // current token length
+  uint8_t  skip;                                // number of unicode digits to skip
+  bool     is_key;                              // current string is an object key
+  bool     is_string;                           // current value is a string
+  uint16_t arr_index[TIC_JSON_DEPTH];           // current index of open arrays
+  char     arr_type[TIC_JSON_DEPTH];            // type of open containers ('{' or '[')
+  char     arr_key[TIC_JSON_DEPTH][TIC_JSON_KEY_SIZE];  // current key of open objects
+  char     str_token[TIC_JSON_VALUE_SIZE];      // current token
+  uint32_t nb_value;                            // number of parsed values
+  TeleinfoJsonCallback callback;                // called for each scalar value
+};
+
+// teleinfo : HTTPS requests (ESP32 only, run by a worker task)
+// --------------------------------------------------------------
+
+#ifdef ESP32
+  #define TIC_HTTPS_QUEUE           4         // maximum number of queued requests
+  #define TIC_HTTPS_TASK_STACK      8192      // worker task stack size (TLS handshake)
+  #define TIC_HTTPS_URL_SIZE        256       // maximum URL size
+  #define TIC_HTTPS_AUTH_SIZE       160       // maximum authorization header size
+  #define TIC_HTTPS_VALIDATOR_SIZE  48        // maximum ETag and Last-Modified size
+  #define TIC_HTTPS_BACKOFF_MAX     4         // maximum backoff level (retry delay x16)
+
+  enum TeleinfoHttpsState  { TIC_HTTPS_IDLE, TIC_HTTPS_QUEUED, TIC_HTTPS_RUNNING, TIC_HTTPS_DONE };
+  // request stages (TCP connexion and TLS handshake are done in a single call by the light SSL client, so they share a stage)
+  enum TeleinfoHttpsStage  { TIC_HTTPS_STAGE_DNS, TIC_HTTPS_STAGE_CONNECT, TIC_HTTPS_STAGE_REQUEST, TIC_HTTPS_STAGE_BODY, TIC_HTTPS_STAGE_MAX };
+  const char kTeleinfoHttpsStage[] PROGMEM = "dns|connect_tls|request|body";
+
+  // endpoint flags
+  #define TIC_HTTPS_FLAG_KEEPALIVE  0x01      // connexion is kept alive between requests
+  #define TIC_HTTPS_FLAG_TEXT       0x02      // POST body is plain text, else JSON
+  #define TIC_HTTPS_FLAG_LAN        0x04      // LAN host, run before queued internet requests
+
+  // outbound endpoints
+  enum TeleinfoHttpsEndpoint                { TIC_HTTPS_EP_TOKEN, TIC_HTTPS_EP_TEMPO, TIC_HTTPS_EP_ECOWATT, TIC_HTTPS_EP_POINTE, TIC_HTTPS_EP_OPENDPE, TIC_HTTPS_EP_TEMPOLIGHT, TIC_HTTPS_EP_FORECAST, TIC_HTTPS_EP_AWTRIX, TIC_HTTPS_EP_INFLUXDB, TIC_HTTPS_EP_MAX };
+  const char kTeleinfoHttpsEndpoint[] PROGMEM = "token|tempo|ecowatt|pointe|opendpe|tempolight|forecast|awtrix|influxdb";
+  const uint8_t  arrTeleinfoHttpsWebType[] = {   TIC_WEB_HTTPS  ,   TIC_WEB_HTTPS   ,    TIC_WEB_HTTPS    ,    TIC_WEB_HTTPS   ,    TIC_WEB_HTTPS    ,      TIC_WEB_HTTPS     ,     TIC_WEB_HTTP     ,    TIC_WEB_HTTP    ,      TIC_WEB_HTTPS    };
+  const uint16_t arrTeleinfoHttpsConnect[] = {       3000       ,        3000       ,         3000        ,         3000       ,         3000        ,           3000         ,         3000         ,         250        ,          3000         };
+  const uint16_t arrTeleinfoHttpsTimeout[] = {       3000       ,        3000       ,         3000        ,         3000       ,         3000        ,           3000         ,         3000         ,        1000        ,          3000         };
+  const uint8_t  arrTeleinfoHttpsFlag[]    = {        0         ,         0         ,          0          ,          0         ,          0          ,            0           ,           0          , TIC_HTTPS_FLAG_LAN , TIC_HTTPS_FLAG_KEEPALIVE | TIC_HTTPS_FLAG_TEXT };
+
+  // HTTP client giving access to connexion stage, so it can be timed apart from request
+  class TeleinfoHttpClient : public HTTPClientLight
+  {
+  public:
+    bool Connect () { return connect (); }
+  };
+
+  struct tic_https_request;
+  typedef void (*TeleinfoHttpsCallback) (tic_https_request &request);
+
+  struct tic_https_request {                  // 564 bytes
+    uint8_t  state;                             // request state (written by owner of current state only)
+    uint8_t  endpoint;                          // target endpoint
+    bool     post;                              // POST request, else GET
+    bool     valid;                             // body received and fully parsed (or answer 304)
+    int      http_code;                         // HTTP result code (negative for connexion errors)
+    uint32_t size;                              // received body size
+    uint32_t time_queued;                       // timestamp of request queueing
+    uint32_t url_hash;                          // hash of URL, validators owner
+    uint32_t arr_stage[TIC_HTTPS_STAGE_MAX];    // duration of each stage (ms)
+    char    *pstr_body;                         // POST body (heap copy, can be nullptr)
+    TeleinfoJsonCallback  parser;               // JSON value callback, called from worker task (can be nullptr)
+    TeleinfoHttpsCallback callback;             // completion callback, called from main loop (can be nullptr)
+    char     str_url[TIC_HTTPS_URL_SIZE];       // request URL
+    char     str_auth[TIC_HTTPS_AUTH_SIZE];     // authorization header value (empty if none)
+    char     str_etag[TIC_HTTPS_VALIDATOR_SIZE];      // ETag sent and received
+    char     str_modified[TIC_HTTPS_VALIDATOR_SIZE];  // Last-Modified sent and received
+  };
+
+  struct tic_https_endpoint {                 // 132 bytes
+    uint8_t  failure;                           // consecutive failures (backoff level)
+    uint16_t quota_left;                        // remaining quota announced by server
+    uint16_t quota_total;                       // total quota announced by server
+    uint32_t nb_request;                        // number of completed requests
+    uint32_t nb_error;                          // number of failed requests
+    uint32_t nb_unchanged;                      // number of 304 answers
+    uint32_t latency_last;                      // last request duration (ms)
+    uint32_t latency_peak;                      // maximum request duration (ms)
+    uint32_t latency_total;                     // cumulated request duration (ms)
+    uint32_t url_hash;                          // hash of URL validators belong to
+    char     str_etag[TIC_HTTPS_VALIDATOR_SIZE];      // last received ETag
+    char     str_modified[TIC_HTTPS_VALIDATOR_SIZE];  // last received Last-Modified
+  };
+
+  static struct {
+    uint32_t arr_max[TIC_HTTPS_STAGE_MAX];      // maximum duration of each stage (ms)
+    TaskHandle_t task   = nullptr;              // worker task
+    tic_json_parser    json;                    // body parser (worker task only)
+    TeleinfoHttpClient *arr_client[TIC_HTTPS_EP_MAX]; // kept-alive connexions (worker task only)
+    tic_https_endpoint arr_endpoint[TIC_HTTPS_EP_MAX];
+    tic_https_request  arr_request[TIC_HTTPS_QUEUE];
+  } teleinfo_https;
+#endif    // ESP32
+
 // teleinfo : LED management
 // -------------------------
 
@@ -587,14 +1037,16 @@ struct {                     // 11 bytes
 // teleinfo : conso mode
 // ---------------------
 
-struct tic_cosphi {                 // 142 bytes
-  uint8_t index;                                // index of cosphy array current value
+struct tic_cosphi {                 // 84 bytes
+  uint8_t index;                                // index of cosphi array next value
   uint8_t page;                                 // index of current power page
-  long value;                                   // current value of cosphi
-  long quantity;                                // number of measure done 
-  long nb_message;                              // number of messages with last cosphi calculation 
-  long arr_value[TIC_COSPHI_SAMPLE];            // array of cosphi values
-  long arr_page[TIC_COSPHI_PAGE];               // array of average cosphi for power pages 
+  uint8_t nb_sample;                            // number of samples in running sum (max TIC_COSPHI_SAMPLE)
+  long    value;                                // current value of cosphi
+  long    quantity;                             // number of measure done 
+  long    nb_message;                           // number of messages with last cosphi calculation 
+  long    sum;                                  // running sum of cosphi array values
+  int16_t arr_value[TIC_COSPHI_SAMPLE];         // array of last cosphi values of current page
+  int16_t arr_page[TIC_COSPHI_PAGE];            // array of average cosphi for power pages 
 }; 
 
 struct tic_phase {                  // 34 bytes
@@ -605,11 +1057,10 @@ struct tic_phase {                  // 34 bytes
   long  sinsts;                                 // instant apparent power (VA)
   long  pact;                                   // instant active power (W)
   long  preact;                                 // instant reactive power (VAr)
-  long  pact_last;                              // last published active power (VA)
   long  cosphi;                                 // current cos phi (x1000)
 };
 
-struct {                     // 441 bytes
+struct {                     // 359 bytes
   bool    enabled    = false;                   // flag of conso status
   uint8_t relay      = 0;                       // linky virtual relays status
 
@@ -658,7 +1109,6 @@ struct {
   float pact_avg        = 0;                   // average produced active power
   long  papp            = 0;                   // production instant apparent power 
   long  pact            = 0;                   // production instant active power
-  long  pact_last       = 0;                   // last published active power
   long  delta_mwh       = 0;                   // active conso delta since last total (milli Wh)
   long  delta_mvah      = 0;                   // apparent power counter increment (milli VAh)
 
@@ -11,6 +11,10 @@
     10/07/2025 v3.0 - Refactoring based on Tasmota 15
     22/08/2025 v3.1 - Add solar production active power
     17/03/2026 v3.2 - Display production excess for CACSI contract
+    16/10/2026 v3.3 - Streaming curve encoder with relative path commands
+                      Raw curve data endpoint with client side rendering
+                      Rescale recorded power on contract power change (history kept)
+                      Guard raw curve rendering against null max power
 
   RAM : esp8266 2239 bytes
         esp32   19283 bytes
@@ -42,6 +46,8 @@
 #define GRAPH_RIGHT                   12              // right position of the curve
 #define GRAPH_WIDTH                   1320            // graph width
 #define GRAPH_HEIGHT                  600             // default graph height
+#define GRAPH_PATH_BUFFER             512             // curve path chunk buffer
+#define GRAPH_PATH_MARGIN             32              // curve path buffer margin before flush
 
 // graph default and boundaries
 #define GRAPH_INC_VOLTAGE             5
@@ -63,7 +69,11 @@
 // web URL
 const char PSTR_GRAPH_PAGE[]          PROGMEM = "/graph";
 const char PSTR_GRAPH_PAGE_DATA[]     PROGMEM = "/data.upd";
-const char PSTR_GRAPH_PAGE_CURVE[]    PROGMEM = "/curve.upd";
+const char PSTR_GRAPH_PAGE_CURVE[]    PROGMEM = "/curve.upd";     // server rendered SVG paths, kept for clients without JS renderer
+const char PSTR_GRAPH_PAGE_RAW[]      PROGMEM = "/curve.dat";
+
+// base64 alphabet for raw curve data
+const char kTeleinfoGraphBase64[]     PROGMEM = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
 
 // data file
 #define GRAPH_VERSION                 2               // saved data version
@@ -92,6 +102,7 @@ static struct {
   uint8_t  display   = UINT8_MAX;               // mask of data to display
   long     max_volt  = GRAPH_DEF_VOLTAGE;       // maximum voltage on graph
   long     max_power = GRAPH_DEF_POWER;         // maximum power on graph
+  long     ssousc    = 0;                       // contract power used to scale recorded slots
 } graph_status;
 
 // data collection structure, 138 bytes
@@ -133,6 +144,23 @@ struct tic_slot {
 }; 
 static tic_slot tic_graph_slot[GRAPH_PERIOD_MAX][GRAPH_SAMPLE];     // live graph data, esp8266 6.9kB, ESP32 20.7kB
 
+// curve path encoder, 528 bytes
+struct tic_path {
+  uint16_t length;                              // length of data in buffer
+  bool     pending;                             // a segment is waiting to be written
+  bool     relative;                            // relative lineto command already written
+  long     pos_x, pos_y;                        // position at end of pending segment
+  long     delta_x, delta_y;                    // pending segment
+  char     str_buffer[GRAPH_PATH_BUFFER];       // chunk buffer
+};
+
+// curve encoding statistics, 12 bytes
+static struct {
+  uint32_t time;                                // encoding time (in us)
+  uint32_t nb_point;                            // number of points
+  uint32_t nb_byte;                             // number of bytes sent
+} graph_curve;
+
 /*********************************************\
  *                 Recording
 \*********************************************/
@@ -278,6 +306,47 @@ void TeleinfoGraphRecordingUpdate (const uint8_t period)
   }
 }
 
+// rescale a recorded power value (UINT8_MAX is undefined)
+uint8_t TeleinfoGraphRescaleValue (const uint8_t value, const long ssousc_old, const long ssousc_new)
+{
+  long result;
+
+  if (value == UINT8_MAX) return UINT8_MAX;
+  result = (long)value * ssousc_old / ssousc_new;
+  if (result >= UINT8_MAX) result = UINT8_MAX - 1;
+
+  return (uint8_t)result;
+}
+
+// rescale all recorded power slots after a contract power change
+void TeleinfoGraphRescale (const long ssousc_old, const long ssousc_new)
+{
+  uint8_t  period, phase;
+  uint16_t slot;
+
+  // check parameters
+  if ((ssousc_old <= 0) || (ssousc_new <= 0) || (ssousc_old == ssousc_new)) return;
+
+  // loop thru periods and slots
+  for (period = 0; period < GRAPH_PERIOD_MAX; period ++)
+    for (slot = 0; slot < GRAPH_SAMPLE; slot ++)
+    {
+      for (phase = 0; phase < TIC_PHASE_MAX; phase ++)
+      {
+        tic_graph_slot[period][slot].arr_papp_max[phase] = TeleinfoGraphRescaleValue (tic_graph_slot[period][slot].arr_papp_max[phase], ssousc_old, ssousc_new);
+        tic_graph_slot[period][slot].arr_papp[phase]     = TeleinfoGraphRescaleValue (tic_graph_slot[period][slot].arr_papp[phase],     ssousc_old, ssousc_new);
+        tic_graph_slot[period][slot].arr_pact[phase]     = TeleinfoGraphRescaleValue (tic_graph_slot[period][slot].arr_pact[phase],     ssousc_old, ssousc_new);
+      }
+      tic_graph_slot[period][slot].prod_papp  = TeleinfoGraphRescaleValue (tic_graph_slot[period][slot].prod_papp,  ssousc_old, ssousc_new);
+      tic_graph_slot[period][slot].prod_pact  = TeleinfoGraphRescaleValue (tic_graph_slot[period][slot].prod_pact,  ssousc_old, ssousc_new);
+      tic_graph_slot[period][slot].solar_pact = TeleinfoGraphRescaleValue (tic_graph_slot[period][slot].solar_pact, ssousc_old, ssousc_new);
+      tic_graph_slot[period][slot].fcast_pact = TeleinfoGraphRescaleValue (tic_graph_slot[period][slot].fcast_pact, ssousc_old, ssousc_new);
+    }
+
+  // log
+  AddLog (LOG_LEVEL_INFO, PSTR ("TIC: Courbes adaptées à la nouvelle puissance souscrite (%d -> %d VA)"), ssousc_old, ssousc_new);
+}
+
 void TeleinfoGraphRecording2Slot (const uint8_t period, const uint16_t slot)
 {
   uint8_t phase;
@@ -290,6 +359,13 @@ void TeleinfoGraphRecording2Slot (const uint8_t period, const uint16_t slot)
   if (teleinfo_contract.ssousc == 0) return;
   if (teleinfo_record[period].sample == 0) return;
 
+  // if contract power has changed, rescale recorded slots
+  if (graph_status.ssousc != teleinfo_contract.ssousc)
+  {
+    TeleinfoGraphRescale (graph_status.ssousc, teleinfo_contract.ssousc);
+    graph_status.ssousc = teleinfo_contract.ssousc;
+  }
+
   // save solar forecast data
   tic_graph_slot[period][slot].fcast_pact = (uint8_t)(teleinfo_record[period].fcast_pact_sum * 200 / teleinfo_record[period].sample / teleinfo_contract.ssousc);
 
@@ -558,152 +634,287 @@ void TeleinfoGraphDisplayLevel ()
   for (index = 1; index < 4; index ++) WSContentSend_P (PSTR ("<line class='dash' x1=%u y1=%u x2=%u y2=%u />\n"), GRAPH_LEFT, index * GRAPH_HEIGHT / 4, GRAPH_LEFT + GRAPH_WIDE, index * GRAPH_HEIGHT / 4);
 }
 
-// Display data curve
+// send path chunk buffer
+void TeleinfoGraphPathFlush (tic_path &path)
+{
+  if (path.length == 0) return;
+  WSContentSend (path.str_buffer, path.length);
+  graph_curve.nb_byte += path.length;
+  path.length = 0;
+}
+
+// append formatted text to path chunk buffer
+void TeleinfoGraphPathAppend (tic_path &path, const char* pstr_format, ...)
+{
+  va_list arg;
+
+  // if buffer is almost full, flush it
+  if (path.length + GRAPH_PATH_MARGIN > GRAPH_PATH_BUFFER) TeleinfoGraphPathFlush (path);
+
+  va_start (arg, pstr_format);
+  path.length += vsnprintf_P (path.str_buffer + path.length, GRAPH_PATH_BUFFER - path.length, pstr_format, arg);
+  va_end (arg);
+}
+
+// write pending segment as relative lineto (implicit command after first one, no separator before negative values)
+void TeleinfoGraphPathWriteSegment (tic_path &path)
+{
+  if (!path.pending) return;
+  if (!path.relative) TeleinfoGraphPathAppend (path, PSTR ("l%d"), path.delta_x);
+    else TeleinfoGraphPathAppend (path, (path.delta_x < 0) ? PSTR ("%d") : PSTR (" %d"), path.delta_x);
+  TeleinfoGraphPathAppend (path, (path.delta_y < 0) ? PSTR ("%d") : PSTR (" %d"), path.delta_y);
+  path.relative = true;
+  path.pending  = false;
+}
+
+// start path at absolute position
+void TeleinfoGraphPathMove (tic_path &path, const long pos_x, const long pos_y)
+{
+  TeleinfoGraphPathWriteSegment (path);
+  TeleinfoGraphPathAppend (path, PSTR ("M%d %d"), pos_x, pos_y);
+  path.relative = false;
+  path.pos_x    = pos_x;
+  path.pos_y    = pos_y;
+}
+
+// add line to next point, merging collinear segments
+void TeleinfoGraphPathLine (tic_path &path, const long pos_x, const long pos_y)
+{
+  long delta_x, delta_y;
+
+  // calculate segment
+  delta_x = pos_x - path.pos_x;
+  delta_y = pos_y - path.pos_y;
+  path.pos_x = pos_x;
+  path.pos_y = pos_y;
+  graph_curve.nb_point++;
+
+  // if segment continues pending one in same direction, merge it
+  if (path.pending && (path.delta_x * delta_y == path.delta_y * delta_x) && (path.delta_x * delta_x >= 0) && (path.delta_y * delta_y >= 0))
+  {
+    path.delta_x += delta_x;
+    path.delta_y += delta_y;
+  }
+
+  // else write pending segment and keep new one
+  else
+  {
+    TeleinfoGraphPathWriteSegment (path);
+    path.delta_x = delta_x;
+    path.delta_y = delta_y;
+    path.pending = true;
+  }
+}
+
+// get raw 8 bits value of a graph slot (UINT8_MAX if undefined)
+uint8_t TeleinfoGraphGetSlotRaw (const uint8_t data, const uint8_t period, const uint8_t phase, const uint16_t slot)
+{
+  uint8_t value = UINT8_MAX;
+
+  // solar forecast and solar production data
+  if ((phase == TIC_PHASE_FORECAST) && (data == TELEINFO_UNIT_W)) value = tic_graph_slot[period][slot].fcast_pact;
+  else if ((phase == TIC_PHASE_SOLAR) && (data == TELEINFO_UNIT_W)) value = tic_graph_slot[period][slot].solar_pact;
+
+  // meter production data
+  else if (phase == TIC_PHASE_PROD) switch (data)
+  {
+    case TELEINFO_UNIT_VA:  value = tic_graph_slot[period][slot].prod_papp; break;
+    case TELEINFO_UNIT_W:   value = tic_graph_slot[period][slot].prod_pact; break;
+    case TELEINFO_UNIT_COS: value = tic_graph_slot[period][slot].prod_cphi; break;
+  }
+
+  // conso data
+  else if (phase < TIC_PHASE_MAX) switch (data)
+  {
+    case TELEINFO_UNIT_VA:    value = tic_graph_slot[period][slot].arr_papp[phase];     break;
+    case TELEINFO_UNIT_VAMAX: value = tic_graph_slot[period][slot].arr_papp_max[phase]; break;
+    case TELEINFO_UNIT_W:     value = tic_graph_slot[period][slot].arr_pact[phase];     break;
+    case TELEINFO_UNIT_V:     value = tic_graph_slot[period][slot].arr_volt_min[phase]; break;
+    case TELEINFO_UNIT_VMAX:  value = tic_graph_slot[period][slot].arr_volt_max[phase]; break;
+    case TELEINFO_UNIT_COS:   value = tic_graph_slot[period][slot].arr_cphi[phase];     break;
+  }
+
+  return value;
+}
+
+// get curve value of a graph slot (LONG_MAX if undefined)
+long TeleinfoGraphGetSlotValue (const uint8_t data, const uint8_t period, const uint8_t phase, const uint16_t slot)
+{
+  uint8_t raw;
+  long    value;
+
+  // get raw value
+  raw = TeleinfoGraphGetSlotRaw (data, period, phase, slot);
+  if (raw == UINT8_MAX) return LONG_MAX;
+
+  // convert according to data
+  switch (data)
+  {
+    case TELEINFO_UNIT_V:
+    case TELEINFO_UNIT_VMAX:  value = (long)TIC_VOLTAGE_DEFAULT - 128 + raw; break;
+    case TELEINFO_UNIT_COS:   value = (long)raw; break;
+    default:                  value = (long)raw * teleinfo_contract.ssousc / 200; break;
+  }
+
+  return value;
+}
+
+// check if data can be displayed for a phase
+bool TeleinfoGraphIsCurveValid (const uint8_t data, const uint8_t phase)
+{
+  if (data >= TELEINFO_UNIT_MAX) return false;
+  if (phase >= TIC_PHASE_END) return false;
+  if ((phase == TIC_PHASE_PROD) && (data == TELEINFO_UNIT_V)) return false;
+  if ((phase == TIC_PHASE_PROD) && (data != TELEINFO_UNIT_VA) && (!teleinfo_prod.enabled && !teleinfo_prod.cacsi)) return false;
+  if ((phase == TIC_PHASE_SOLAR) && !teleinfo_solar.enabled) return false;
+  if ((phase == TIC_PHASE_SOLAR) && (data != TELEINFO_UNIT_W)) return false;
+  if ((phase == TIC_PHASE_FORECAST) && !teleinfo_forecast.enabled) return false;
+  if ((phase == TIC_PHASE_FORECAST) && (data != TELEINFO_UNIT_W)) return false;
+
+  return true;
+}
+
+// get data of main or peak curve to display for a phase (TELEINFO_UNIT_MAX if none)
+uint8_t TeleinfoGraphGetDisplayedCurve (const uint8_t phase, const bool peak)
+{
+  bool display = false;
+
+  // peak curve of conso phase (VA max or V max)
+  if (peak)
+  {
+    display = (teleinfo_conso.enabled && (graph_status.display & (0x01 << (phase + 3))));
+    if (display && (graph_status.data == TELEINFO_UNIT_VA)) return TELEINFO_UNIT_VAMAX;
+    if (display && (graph_status.data == TELEINFO_UNIT_V))  return TELEINFO_UNIT_VMAX;
+    return TELEINFO_UNIT_MAX;
+  }
+
+  // main curve
+  if (phase < TIC_PHASE_PROD)           display = ((graph_status.display & (0x01 << (phase + 3))) && teleinfo_conso.enabled);
+  else if (phase == TIC_PHASE_PROD)     display = ((graph_status.display & (0x01 << 2))           && (teleinfo_prod.enabled || teleinfo_prod.cacsi));
+  else if (phase == TIC_PHASE_SOLAR)    display = ((graph_status.display & (0x01 << 1))           && teleinfo_solar.enabled);
+  else if (phase == TIC_PHASE_FORECAST) display = ((graph_status.display & (0x01 << 0))           && teleinfo_forecast.enabled);
+
+  return display ? graph_status.data : TELEINFO_UNIT_MAX;
+}
+
+// send raw curve data, from oldest to newest slot, as base64
+void TeleinfoGraphSendCurveRaw (tic_path &path, const uint8_t data, const uint8_t period, const uint8_t phase)
+{
+  uint8_t  count;
+  uint16_t index, start_slot;
+  uint32_t group;
+
+  // check parameters
+  if (!TeleinfoGraphIsCurveValid (data, phase)) return;
+
+  // loop thru slots, encoding groups of 3 bytes
+  start_slot = teleinfo_record[period].slot;
+  group = 0;
+  count = 0;
+  for (index = 0; index < GRAPH_SAMPLE; index++)
+  {
+    group = (group << 8) | TeleinfoGraphGetSlotRaw (data, period, phase, (start_slot + index) % GRAPH_SAMPLE);
+    count++;
+    if ((count < 3) && (index < GRAPH_SAMPLE - 1)) continue;
+
+    // pad last group
+    if (count < 3) group <<= 8 * (3 - count);
+
+    // write group
+    if (path.length + GRAPH_PATH_MARGIN > GRAPH_PATH_BUFFER) TeleinfoGraphPathFlush (path);
+    path.str_buffer[path.length++] = pgm_read_byte (kTeleinfoGraphBase64 + ((group >> 18) & 0x3F));
+    path.str_buffer[path.length++] = pgm_read_byte (kTeleinfoGraphBase64 + ((group >> 12) & 0x3F));
+    path.str_buffer[path.length++] = (count > 1) ? pgm_read_byte (kTeleinfoGraphBase64 + ((group >> 6) & 0x3F)) : '=';
+    path.str_buffer[path.length++] = (count > 2) ? pgm_read_byte (kTeleinfoGraphBase64 + (group & 0x3F)) : '=';
+    graph_curve.nb_point += count;
+    group = 0;
+    count = 0;
+  }
+}
+
+// Display data curve as a streamed path (filled area for VA, W and V, line for peaks and cosphi)
 void TeleinfoGraphDisplayCurve (const uint8_t data, const uint8_t period, const uint8_t phase)
 {
-  uint16_t index, index_array, start_slot;
+  bool     started, filled;
+  uint16_t index, start_slot;
+  uint32_t time_start;
   long     value, graph_x, graph_y, graph_range, graph_delta;
-  long     prev_value, prev_x, prev_y; 
-  long     arr_value[GRAPH_SAMPLE];
+  tic_path path;
 
   // check parameters
   if (!RtcTime.valid) return;
   if (graph_status.max_power == 0) return;
-  if (data >= TELEINFO_UNIT_MAX) return;
-  if (phase >= TIC_PHASE_END) return;
-  if ((phase == TIC_PHASE_PROD) && (data == TELEINFO_UNIT_V)) return;
-  if ((phase == TIC_PHASE_PROD) && (data != TELEINFO_UNIT_VA) && (!teleinfo_prod.enabled && !teleinfo_prod.cacsi)) return;
-  if ((phase == TIC_PHASE_SOLAR) && !teleinfo_solar.enabled) return;
-  if ((phase == TIC_PHASE_SOLAR) && (data != TELEINFO_UNIT_W)) return;
-  if ((phase == TIC_PHASE_FORECAST) && !teleinfo_forecast.enabled) return;
-  if ((phase == TIC_PHASE_FORECAST) && (data != TELEINFO_UNIT_W)) return;
+  if (!TeleinfoGraphIsCurveValid (data, phase)) return;
 
-  // init array of values
-  for (index = 0; index < GRAPH_SAMPLE; index ++) arr_value[index] = LONG_MAX;
+  // init encoder
+  time_start   = micros ();
+  path.length  = 0;
+  path.pending = false;
+  filled  = ((data == TELEINFO_UNIT_VA) || (data == TELEINFO_UNIT_W) || (data == TELEINFO_UNIT_V));
+  started = false;
+  graph_x = graph_y = 0;
 
   // get start slot
   start_slot = teleinfo_record[period].slot;
 
-  // loop to load array
+  // loop thru slots, from oldest to newest
   for (index = 0; index < GRAPH_SAMPLE; index++)
   {
-    // get current array index
-    index_array = (start_slot + index) % GRAPH_SAMPLE;
-
-    // solar forecast production data
-    if ((phase == TIC_PHASE_FORECAST) && (data == TELEINFO_UNIT_W) && (tic_graph_slot[period][index_array].fcast_pact != UINT8_MAX))
-      arr_value[index] = (long)tic_graph_slot[period][index_array].fcast_pact * teleinfo_contract.ssousc / 200;
+    // get slot value, curve starts with first defined value
+    value = TeleinfoGraphGetSlotValue (data, period, phase, (start_slot + index) % GRAPH_SAMPLE);
+    if (!started && (value == LONG_MAX)) continue;
 
-    // solar production data
-    else if ((phase == TIC_PHASE_SOLAR) && (data == TELEINFO_UNIT_W) && (tic_graph_slot[period][index_array].solar_pact != UINT8_MAX))
-      arr_value[index] = (long)tic_graph_slot[period][index_array].solar_pact * teleinfo_contract.ssousc / 200;
+    // calculate x position
+    graph_x = GRAPH_LEFT + index * GRAPH_WIDE / GRAPH_SAMPLE;
 
-    // meter production data
-    else if (phase == TIC_PHASE_PROD) switch (data)
+    // calculate y position according to data (undefined value keeps previous level, except for power)
+    graph_delta = 0;
+    switch (data)
     {
-      case TELEINFO_UNIT_VA:  if (tic_graph_slot[period][index_array].prod_papp != UINT8_MAX) arr_value[index] = (long)tic_graph_slot[period][index_array].prod_papp * teleinfo_contract.ssousc / 200; break;
-      case TELEINFO_UNIT_W:   if (tic_graph_slot[period][index_array].prod_pact != UINT8_MAX) arr_value[index] = (long)tic_graph_slot[period][index_array].prod_pact * teleinfo_contract.ssousc / 200; break;
-      case TELEINFO_UNIT_COS: if (tic_graph_slot[period][index_array].prod_cphi != UINT8_MAX) arr_value[index] = (long)tic_graph_slot[period][index_array].prod_cphi; break;
+      case TELEINFO_UNIT_VA:
+      case TELEINFO_UNIT_VAMAX:
+      case TELEINFO_UNIT_W:
+        if (value == LONG_MAX) graph_y = GRAPH_HEIGHT;
+          else graph_y = GRAPH_HEIGHT - (value * GRAPH_HEIGHT / graph_status.max_power);
+        break;
+
+      case TELEINFO_UNIT_V:
+      case TELEINFO_UNIT_VMAX:
+        if (value != LONG_MAX)
+        {
+          graph_range = abs (graph_status.max_volt - TIC_VOLTAGE_DEFAULT);
+          if (graph_range != 0) graph_delta = (TIC_VOLTAGE_DEFAULT - value) * GRAPH_HEIGHT / 2 / graph_range;
+          graph_y = (GRAPH_HEIGHT / 2) + graph_delta;
+          if (graph_y < 0) graph_y = 0;
+          if (graph_y > GRAPH_HEIGHT) graph_y = GRAPH_HEIGHT;  
+        }
+        break;
+
+      case TELEINFO_UNIT_COS:
+        if (value != LONG_MAX) graph_y = GRAPH_HEIGHT - (value * GRAPH_HEIGHT / 100);
+        break;
     }
 
-    // conso data
-    else switch (data)
+    // first point : filled curve starts from bottom line
+    if (!started && filled)
     {
-      case TELEINFO_UNIT_VA:    if (tic_graph_slot[period][index_array].arr_papp[phase]     != UINT8_MAX) arr_value[index] = (long)tic_graph_slot[period][index_array].arr_papp[phase] * teleinfo_contract.ssousc / 200; break;
-      case TELEINFO_UNIT_VAMAX: if (tic_graph_slot[period][index_array].arr_papp_max[phase] != UINT8_MAX) arr_value[index] = (long)tic_graph_slot[period][index_array].arr_papp_max[phase] * teleinfo_contract.ssousc / 200; break;
-      case TELEINFO_UNIT_W:     if (tic_graph_slot[period][index_array].arr_pact[phase]     != UINT8_MAX) arr_value[index] = (long)tic_graph_slot[period][index_array].arr_pact[phase] * teleinfo_contract.ssousc / 200; break;
-      case TELEINFO_UNIT_V:     if (tic_graph_slot[period][index_array].arr_volt_min[phase] != UINT8_MAX) arr_value[index] = (long)TIC_VOLTAGE_DEFAULT - 128 + tic_graph_slot[period][index_array].arr_volt_min[phase]; break;
-      case TELEINFO_UNIT_VMAX:  if (tic_graph_slot[period][index_array].arr_volt_max[phase] != UINT8_MAX) arr_value[index] = (long)TIC_VOLTAGE_DEFAULT - 128 + tic_graph_slot[period][index_array].arr_volt_max[phase]; break;
-      case TELEINFO_UNIT_COS:   if (tic_graph_slot[period][index_array].arr_cphi[phase]     != UINT8_MAX) arr_value[index] = (long)tic_graph_slot[period][index_array].arr_cphi[phase]; break;
+      TeleinfoGraphPathMove (path, graph_x, GRAPH_HEIGHT);
+      TeleinfoGraphPathLine (path, graph_x, graph_y);
     }
-  }
-
-  // init display
-  prev_x  = LONG_MAX;
-  prev_y  = 0;
-  graph_x = 0;
-
-  // loop to display points
-  for (index = 0; index < GRAPH_SAMPLE; index++)
-  {
-    // get previous value
-    value = arr_value[index];
-    if (index == 0) prev_value = arr_value[0];
-      else prev_value = arr_value[index - 1];
-
-    // if curve should start
-    if ((prev_x != LONG_MAX) || (value != LONG_MAX))
-    {
-      // calculate x position
-      graph_x = GRAPH_LEFT + index * GRAPH_WIDE / GRAPH_SAMPLE;
+    else if (!started) TeleinfoGraphPathMove (path, graph_x, graph_y);
 
-      // calculate y position according to data
-      graph_y     = 0;
-      graph_delta = 0;
-      switch (data)
-      {
-        case TELEINFO_UNIT_VA:
-        case TELEINFO_UNIT_VAMAX:
-        case TELEINFO_UNIT_W:
-          if (value == LONG_MAX) graph_y = GRAPH_HEIGHT;
-            else if (graph_status.max_power != 0) graph_y = GRAPH_HEIGHT - (value * GRAPH_HEIGHT / graph_status.max_power);
-          break;
-
-        case TELEINFO_UNIT_V:
-        case TELEINFO_UNIT_VMAX:
-          if (value == LONG_MAX) graph_y = prev_y;
-          else
-          {
-            graph_range = abs (graph_status.max_volt - TIC_VOLTAGE_DEFAULT);
-            if (graph_range != 0) graph_delta = (TIC_VOLTAGE_DEFAULT - value) * GRAPH_HEIGHT / 2 / graph_range;
-            graph_y = (GRAPH_HEIGHT / 2) + graph_delta;
-            if (graph_y < 0) graph_y = 0;
-            if (graph_y > GRAPH_HEIGHT) graph_y = GRAPH_HEIGHT;  
-          }
-          break;
-
-        case TELEINFO_UNIT_COS:
-          if (value == LONG_MAX) graph_y = prev_y;
-            else graph_y = GRAPH_HEIGHT - (value * GRAPH_HEIGHT / 100);
-          break;
-      }
-
-      // display curve point
-      switch (data)
-      {
-        // path curve
-        case TELEINFO_UNIT_VA:
-        case TELEINFO_UNIT_W:
-        case TELEINFO_UNIT_V:
-          // if first point draw start point and line to first point, else draw line to next point
-          if (prev_x == LONG_MAX) WSContentSend_P (PSTR ("M%d %d L%d %d "), graph_x, GRAPH_HEIGHT, graph_x, graph_y); 
-            else WSContentSend_P (PSTR ("L%d %d "), graph_x, graph_y); 
-          break;
-
-        // polyline curve
-        case TELEINFO_UNIT_VAMAX:
-        case TELEINFO_UNIT_VMAX:
-        case TELEINFO_UNIT_COS:
-          // draw point
-          WSContentSend_P (PSTR ("%d,%d "), graph_x, graph_y);
-          break;
-      }
-
-      // save previous y position
-      prev_x = graph_x;
-      prev_y = graph_y;
-    }
+    // next points
+    else TeleinfoGraphPathLine (path, graph_x, graph_y);
+    started = true;
   }
 
-  // if curve has started, end curve
-  if (prev_x != LONG_MAX) switch (data)
-  {
-    case TELEINFO_UNIT_VA:
-    case TELEINFO_UNIT_W:
-    case TELEINFO_UNIT_V:
-      WSContentSend_P (PSTR ("L%d %d Z"), graph_x, GRAPH_HEIGHT); 
-      break;
-  }
+  // if curve has started, end curve (back to bottom line for filled curves)
+  TeleinfoGraphPathWriteSegment (path);
+  if (started && filled) TeleinfoGraphPathAppend (path, PSTR ("V%dZ"), GRAPH_HEIGHT);
+  TeleinfoGraphPathFlush (path);
+
+  // update encoding time
+  graph_curve.time += micros () - time_start;
 }
 
 // Graph dislay page
@@ -782,18 +993,45 @@ void TeleinfoGraphWebDisplayPage ()
   //   -> phase 1, phase 2, phase 3, prod, solar, forecast, peak 1, ...
   // -------------------------------------------
 
-  counter = 0;
+  //   curve rendering from raw 8 bits slots
+  //   -> u : 0 power, 1 voltage, 2 cosphi, f : filled curve, a : ssousc;voltage;max power;max voltage
+  // -------------------------------------------
+
+  if (graph_status.data == TELEINFO_UNIT_V) choice = 1;
+    else if (graph_status.data == TELEINFO_UNIT_COS) choice = 2;
+    else choice = 0;
+  WSContentSend_P (PSTR ("\nfunction drawCurve(id,b,u,f,a){\n"));
+  WSContentSend_P (PSTR (" var e=document.getElementById(id),s=atob(b),d='',i,v,x,y=0,r=Math.abs(a[3]-a[1]);\n"));
+  WSContentSend_P (PSTR (" if (e==null) return;\n"));
+  WSContentSend_P (PSTR (" if (u==0 && !a[2]) {e.setAttribute('d','');return;}\n"));
+  WSContentSend_P (PSTR (" for (i=0;i<s.length;i++){\n"));
+  WSContentSend_P (PSTR ("  v=s.charCodeAt(i);\n"));
+  WSContentSend_P (PSTR ("  if (d=='' && v==255) continue;\n"));
+  WSContentSend_P (PSTR ("  x=%d+Math.trunc(i*%d/s.length);\n"), GRAPH_LEFT, GRAPH_WIDE);
+  WSContentSend_P (PSTR ("  if (u==0) y=(v==255)?%d:%d-Math.trunc(Math.trunc(v*a[0]/200)*%d/a[2]);\n"), GRAPH_HEIGHT, GRAPH_HEIGHT, GRAPH_HEIGHT);
+  WSContentSend_P (PSTR ("  else if (u==1 && v!=255) y=Math.min(Math.max(%d+(r?Math.trunc(Math.trunc((128-v)*%d/2)/r):0),0),%d);\n"), GRAPH_HEIGHT / 2, GRAPH_HEIGHT, GRAPH_HEIGHT);
+  WSContentSend_P (PSTR ("  else if (u==2 && v!=255) y=%d-Math.trunc(v*%d/100);\n"), GRAPH_HEIGHT, GRAPH_HEIGHT);
+  WSContentSend_P (PSTR ("  if (d=='') d='M'+x+' '+(f?%d+' '+x+' ':'')+y; else d+=' '+x+' '+y;\n"), GRAPH_HEIGHT);
+  WSContentSend_P (PSTR (" }\n"));
+  WSContentSend_P (PSTR (" if (f && d!='') d+='V%dZ';\n"), GRAPH_HEIGHT);
+  WSContentSend_P (PSTR (" e.setAttribute('d',d);\n"));
+  WSContentSend_P (PSTR ("}\n"));
+
+  //   curve update
+  //   -> ssousc, voltage, max power, max voltage, phase 1, phase 2, phase 3, prod, solar, forecast, peak 1, ...
+  // -------------------------------------------
+
+  counter = 4;
   WSContentSend_P (PSTR ("\nfunction updateCurve(){\n"));
   WSContentSend_P (PSTR (" httpCurve=new XMLHttpRequest();\n"));
-  WSContentSend_P (PSTR (" httpCurve.open('GET','%s',true);\n"), PSTR_GRAPH_PAGE_CURVE);
+  WSContentSend_P (PSTR (" httpCurve.open('GET','%s',true);\n"), PSTR_GRAPH_PAGE_RAW);
   WSContentSend_P (PSTR (" httpCurve.onreadystatechange=function(){\n"));
   WSContentSend_P (PSTR ("  if (httpCurve.readyState===XMLHttpRequest.DONE){\n"));
   WSContentSend_P (PSTR ("   if (httpCurve.status===0 || (httpCurve.status>=200 && httpCurve.status<400)){\n"));
   WSContentSend_P (PSTR ("    arr_value=httpCurve.responseText.split(';');\n"));
-  for (phase = 0; phase < TIC_PHASE_END; phase++)
-    if (graph_status.data == TELEINFO_UNIT_COS) WSContentSend_P (PSTR ("    if (document.getElementById('m%u')!=null) document.getElementById('m%u').setAttribute('points',arr_value[%u]);\n"), phase, phase, counter++ );
-      else WSContentSend_P (PSTR ("    if (document.getElementById('m%u')!=null) document.getElementById('m%u').setAttribute('d',arr_value[%u]);\n"), phase, phase, counter++ );
-  for (phase = 0; phase < teleinfo_contract.phase; phase++) WSContentSend_P (PSTR ("    if (document.getElementById('p%u')!=null) document.getElementById('p%u').setAttribute('points',arr_value[%u]);\n"), phase, phase, counter++ );     // phase peak curve
+  WSContentSend_P (PSTR ("    arr_scale=arr_value.slice(0,4).map(Number);\n"));
+  for (phase = 0; phase < TIC_PHASE_END; phase++) WSContentSend_P (PSTR ("    drawCurve('m%u',arr_value[%u],%u,%u,arr_scale);\n"), phase, counter++, choice, (choice != 2));
+  for (phase = 0; phase < teleinfo_contract.phase; phase++) WSContentSend_P (PSTR ("    drawCurve('p%u',arr_value[%u],%u,0,arr_scale);\n"), phase, counter++, choice);     // phase peak curve
   WSContentSend_P (PSTR ("   }\n"));
   if (graph_status.period == GRAPH_PERIOD_LIVE) WSContentSend_P (PSTR ("   setTimeout(updateCurve,%u);\n"), 2000);     // ask for next curve update 
   WSContentSend_P (PSTR ("  }\n"));
@@ -939,7 +1177,7 @@ void TeleinfoGraphWebDisplayPage ()
 
   // svg : curves
   WSContentSend_P (PSTR ("path {fill-opacity:0.25;}\n"));
-  WSContentSend_P (PSTR ("polyline {fill:none;}\n"));
+  WSContentSend_P (PSTR ("path.line {fill:none;}\n"));
 
   // svg : style of curves for phases, solar production, forecast and production curves
   for (phase = 0; phase < TIC_PHASE_END; phase++) 
@@ -947,13 +1185,13 @@ void TeleinfoGraphWebDisplayPage ()
     // phase color
     GetTextIndexed (str_text, sizeof (str_text), phase, kTeleinfoPhaseCurve);
 
-    // if curve is cosphi use polyline, else use path
-    if (graph_status.data == TELEINFO_UNIT_COS) WSContentSend_P (PSTR ("polyline.ph%u {stroke:%s;}\n"), phase, str_text);
+    // if curve is cosphi use line, else use filled path
+    if (graph_status.data == TELEINFO_UNIT_COS) WSContentSend_P (PSTR ("path.ph%u {stroke:%s;}\n"), phase, str_text);
       else WSContentSend_P (PSTR ("path.ph%u {stroke:%s;fill:%s;}\n"), phase, str_text, str_text);
 
     // if conso pahse, set peak curve
     GetTextIndexed (str_text, sizeof (str_text), phase, kTeleinfoPhasePeak);
-    if (phase < TIC_PHASE_PROD) WSContentSend_P (PSTR ("polyline.pk%u {stroke:%s;stroke-dasharray:1 3;}\n"), phase, str_text);
+    if (phase < TIC_PHASE_PROD) WSContentSend_P (PSTR ("path.pk%u {stroke:%s;stroke-dasharray:1 3;}\n"), phase, str_text);
   }
 
   WSContentSend_P (PSTR ("</style>\n"));
@@ -970,16 +1208,16 @@ void TeleinfoGraphWebDisplayPage ()
   // display curves of all phase types
   for (phase = 0; phase < TIC_PHASE_END; phase++) 
   {
-    // cosphi : use polyline
-    if (graph_status.data == TELEINFO_UNIT_COS) WSContentSend_P (PSTR ("<polyline id='m%u' class='ph%u' points='' />\n"), phase, phase);
+    // cosphi : use line
+    if (graph_status.data == TELEINFO_UNIT_COS) WSContentSend_P (PSTR ("<path id='m%u' class='line ph%u' d='' />\n"), phase, phase);
 
-    // VA, W and V : use path
+    // VA, W and V : use filled path
     else WSContentSend_P (PSTR ("<path id='m%u' class='ph%u' d='' />\n"), phase, phase);
 
   }
 
   // svg : style of conso phase peaks
-  for (phase = 0; phase < teleinfo_contract.phase; phase++) WSContentSend_P (PSTR ("<polyline id='p%u' class='pk%u' points='' />\n"), phase, phase);
+  for (phase = 0; phase < teleinfo_contract.phase; phase++) WSContentSend_P (PSTR ("<path id='p%u' class='line pk%u' d='' />\n"), phase, phase);
 
   // svg : frame
   WSContentSend_P (PSTR ("<rect class='main' x=%d y=%d width=%d height=%d rx=10 />\n"), GRAPH_LEFT, 0, GRAPH_WIDE, GRAPH_HEIGHT + 1);
@@ -1159,55 +1397,78 @@ void TeleinfoGraphWebUpdateData ()
   AddLog (LOG_LEVEL_DEBUG, PSTR ("TIC: Update Data in %ums"), millis () - timestart);
 }
 
-// Graph data update
+// Graph SVG paths update : phase 1;...;forecast;peak 1;...
+//   the graph page now renders curves from /curve.dat, this endpoint is kept for external
+//   clients (dashboards, scripts) that embed ready to use SVG paths
 void TeleinfoGraphWebUpdateCurve ()
 {
-  bool     display;
   uint8_t  phase, curve;
   uint32_t timestart;
 
   // timestamp
   timestart = millis ();
 
+  // init encoding statistics
+  memset (&graph_curve, 0, sizeof (graph_curve));
+
   // start stream
   WSContentBegin (200, CT_PLAIN);
 
   // loop thru phases
   for (phase = 0; phase < TIC_PHASE_END; phase ++)
   {
-    // check if curve should be displayed
-    display = false;
-    if (phase < TIC_PHASE_PROD)           display = ((graph_status.display & (0x01 << (phase + 3))) && teleinfo_conso.enabled);
-    else if (phase == TIC_PHASE_PROD)     display = ((graph_status.display & (0x01 << 2))           && (teleinfo_prod.enabled || teleinfo_prod.cacsi));
-    else if (phase == TIC_PHASE_SOLAR)    display = ((graph_status.display & (0x01 << 1))           && teleinfo_solar.enabled);
-    else if (phase == TIC_PHASE_FORECAST) display = ((graph_status.display & (0x01 << 0))           && teleinfo_forecast.enabled);
-    
-    // if needed, display curve
-    if (display) TeleinfoGraphDisplayCurve (graph_status.data, graph_status.period, phase);
+    curve = TeleinfoGraphGetDisplayedCurve (phase, false);
+    if (curve != TELEINFO_UNIT_MAX) TeleinfoGraphDisplayCurve (curve, graph_status.period, phase);
     WSContentSend_P (PSTR (";"));
   }
 
   // loop thru phases to display peak curve
   for (phase = 0; phase < teleinfo_contract.phase; phase++)
   {
-    // check if curve should be displayed
-    display = (teleinfo_conso.enabled && (graph_status.display & (0x01 << (phase + 3))));
+    curve = TeleinfoGraphGetDisplayedCurve (phase, true);
+    if (curve != TELEINFO_UNIT_MAX) TeleinfoGraphDisplayCurve (curve, graph_status.period, phase);
+    WSContentSend_P (PSTR (";"));
+  }
 
-    // set curve to display (VA max or V max)
-    if (graph_status.data == TELEINFO_UNIT_VA) curve = TELEINFO_UNIT_VAMAX;
-    else if (graph_status.data == TELEINFO_UNIT_V) curve = TELEINFO_UNIT_VMAX;
-    else curve = TELEINFO_UNIT_MAX;
+  // end of stream
+  WSContentEnd ();
 
-    // if needed, display curve
-    if (display && (curve != TELEINFO_UNIT_MAX)) TeleinfoGraphDisplayCurve (curve, graph_status.period, phase);
+  // log page serving time
+  AddLog (LOG_LEVEL_DEBUG, PSTR ("TIC: [%ums] Curve period %u, encoded %u points in %u us, %u bytes"), millis () - timestart, graph_status.period, graph_curve.nb_point, graph_curve.time, graph_curve.nb_byte);
+}
+
+// Graph raw data update : ssousc;voltage;max power;max voltage;phase 1;...;forecast;peak 1;...
+//   each curve is given as base64 of its 8 bits slots, from oldest to newest (255 : undefined)
+void TeleinfoGraphWebUpdateRaw ()
+{
+  uint8_t  phase, curve;
+  uint32_t timestart;
+  tic_path path;
+
+  // timestamp
+  timestart = millis ();
+  memset (&graph_curve, 0, sizeof (graph_curve));
+
+  // start stream with scaling factors
+  WSContentBegin (200, CT_PLAIN);
+  WSContentSend_P (PSTR ("%d;%d;%d;%d"), teleinfo_contract.ssousc, TIC_VOLTAGE_DEFAULT, graph_status.max_power, graph_status.max_volt);
+
+  // loop thru main curves, then peak curves
+  path.length = 0;
+  for (phase = 0; phase < TIC_PHASE_END + teleinfo_contract.phase; phase ++)
+  {
     WSContentSend_P (PSTR (";"));
+    if (phase < TIC_PHASE_END) curve = TeleinfoGraphGetDisplayedCurve (phase, false);
+      else curve = TeleinfoGraphGetDisplayedCurve (phase - TIC_PHASE_END, true);
+    if (RtcTime.valid && (graph_status.max_power != 0) && (curve != TELEINFO_UNIT_MAX)) TeleinfoGraphSendCurveRaw (path, curve, graph_status.period, (phase < TIC_PHASE_END) ? phase : phase - TIC_PHASE_END);
+    TeleinfoGraphPathFlush (path);
   }
 
   // end of stream
   WSContentEnd ();
 
   // log page serving time
-  AddLog (LOG_LEVEL_DEBUG, PSTR ("TIC: [%ums] Curve period %u"), millis () - timestart);
+  AddLog (LOG_LEVEL_DEBUG, PSTR ("TIC: [%ums] Raw curve period %u, %u points, %u bytes"), millis () - timestart, graph_status.period, graph_curve.nb_point, graph_curve.nb_byte);
 }
 
 #endif    // USE_WEBSERVER
@@ -1240,6 +1501,7 @@ bool XdrvTeleinfoGraph (const uint32_t function)
       Webserver->on (FPSTR (PSTR_GRAPH_PAGE),       TeleinfoGraphWebDisplayPage);
       Webserver->on (FPSTR (PSTR_GRAPH_PAGE_DATA),  TeleinfoGraphWebUpdateData);
       Webserver->on (FPSTR (PSTR_GRAPH_PAGE_CURVE), TeleinfoGraphWebUpdateCurve);
+      Webserver->on (FPSTR (PSTR_GRAPH_PAGE_RAW),   TeleinfoGraphWebUpdateRaw);
     break;
 #endif    // USE_WEBSERVER
   }
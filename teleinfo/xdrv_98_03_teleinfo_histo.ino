@@ -9,8 +9,15 @@
     20/03/2025 v2.0 - Complete rewrite
     30/04/2025 v2.1 - Optimize memory usage for ESP8266 
     10/07/2025 v3.0 - Refactoring based on Tasmota 15
+    16/10/2026 v3.1 - Binary yearly history files with day index (one time migration of CSV files)
+                      CSV export thru /histo.csv?year=yyyy
+                      Daily and monthly rollup files for week, month and year graphs
+    16/10/2026 v3.2 - CSV migration done in steps of 100 lines every 250ms
+                      Count and log records dropped when counters don't match file
+                      Cleanup of leftover CSV files
+                      After a contract switch, reload history once new contract code is known
 
-  RAM : 1944 bytes
+  RAM : 2296 bytes
 
   This program is free software: you can redistribute it and/or modify
   it under the terms of the GNU General Public License as published by
@@ -38,6 +45,7 @@
 #define HISTO_GRAPH_MAX               32          // maximum number of values in graph
 
 #define HISTO_FS_MINSIZE              50          // minimum left size on FS before cleaning old files (kB)
+#define HISTO_MIGRATE_LINES           100         // CSV lines converted per migration step
 
 // graph default and boundaries
 #define HISTO_DEF_KWH_DAY             2           // default hourly power in day graph
@@ -64,20 +72,41 @@
 #define CMND_HISTO_DAYOFWEEK          "dow"
 #define CMND_HISTO_DAYOFMONTH         "dom"
 #define CMND_HISTO_MONTHOFYEAR        "moy"
+#define CMND_HISTO_YEAR               "year"
 
 // week days name for history
 static const char kTeleinfoHistoWeekdayNames[] = D_DAY3LIST;
 
 // web URL
-const char PSTR_PAGE_HISTO[] PROGMEM = "/histo";
-
-enum HistoFile { HISTO_FILE_BEFORE, HISTO_FILE_FOUND, HISTO_FILE_LAST, HISTO_FILE_BEYOND, HISTO_FILE_MAX };
+const char PSTR_PAGE_HISTO[]     PROGMEM = "/histo";
+const char PSTR_PAGE_HISTO_CSV[] PROGMEM = "/histo.csv";
 
 // files on FS
 const char PSTR_HISTO_DATA[]          PROGMEM = "/teleinfo-histo.dat";
 const char PSTR_HISTO_FILE_ORIGINAL[] PROGMEM = "/teleinfo-%04u.csv";
 const char PSTR_HISTO_FILE_CONTRACT[] PROGMEM = "/teleinfo-%s-%04u.csv";
-const char PSTR_HISTO_FILE_MASK[]     PROGMEM = "teleinfo-*.csv";
+const char PSTR_HISTO_FILE_BINARY[]   PROGMEM = "/teleinfo-%s-%04u.bin";
+const char PSTR_HISTO_FILE_ROLLUP[]   PROGMEM = "/teleinfo-%s-%04u.sum";
+const char PSTR_HISTO_FILE_MASK[]     PROGMEM = "teleinfo-*.bin|teleinfo-*.csv";
+
+// binary history file :
+//   status (counters at creation and at last record), index of first record of each day of year,
+//   then fixed size hourly records (record header followed by delta of every counter since previous record)
+#define HISTO_BIN_MAGIC               0x48434954  // 'TICH'
+#define HISTO_BIN_VERSION             1           // binary history file version
+#define HISTO_COUNTER_MAX             (TIC_PERIOD_MAX + 3)  // prod, conso periods, solar and forecast
+#define HISTO_BIN_DAY_MAX             367         // day of year index (1..366)
+#define HISTO_BIN_DAY_OFFSET          (sizeof (histo_bin_status))
+#define HISTO_BIN_DAY_SIZE            (HISTO_BIN_DAY_MAX * sizeof (uint16_t))
+#define HISTO_BIN_RECORD_OFFSET       (HISTO_BIN_DAY_OFFSET + HISTO_BIN_DAY_SIZE)
+#define HISTO_BIN_RECORD_SIZE(qty)    (sizeof (histo_record) + (qty) * sizeof (int32_t))
+
+// rollup file, updated with every hourly record :
+//   status, then daily totals of every counter (day of year 1..366), then monthly totals (month 1..12)
+#define HISTO_SUM_MONTH_MAX           13          // month index (1..12)
+#define HISTO_SUM_DAY_OFFSET          (sizeof (histo_sum_status))
+#define HISTO_SUM_ENTRY_SIZE(qty)     ((qty) * sizeof (int32_t))
+#define HISTO_SUM_MONTH_OFFSET(qty)   (HISTO_SUM_DAY_OFFSET + HISTO_BIN_DAY_MAX * HISTO_SUM_ENTRY_SIZE (qty))
 
 /****************************************\
  *                 Data
@@ -91,6 +120,8 @@ static struct {                     // 24 bytes
   long     max_value[CALENDAR_PERIOD_MAX];           // max value according to period
 } histo_status;
 
+static bool histo_reload = false;                 // history reload asked after contract switch
+
 struct histo_delta {                // 68 bytes
   long forecast;                                  // forecast solar production (in wh)
   long solar;                                     // solar production (in wh)
@@ -100,13 +131,46 @@ struct histo_delta {                // 68 bytes
 
 histo_delta histo_data[HISTO_GRAPH_MAX];          // display data for graph, 2048 bytes
 
-struct histo_value {                // 136 bytes
-  long long forecast;                             // forecast solar production (in wh)
-  long long solar;                                // solar production (in wh)
-  long long prod;                                 // production (in wh)
-  long long conso[TIC_PERIOD_MAX];                // conso periods (in wh)
+struct histo_bin_status {           // 280 bytes
+  uint32_t  magic;                                // file signature
+  uint8_t   version;                              // file format version
+  uint8_t   counter_qty;                          // number of counters per record
+  uint16_t  nb_record;                            // number of hourly records
+  long long arr_first[HISTO_COUNTER_MAX];         // counters at file creation (in wh)
+  long long arr_last[HISTO_COUNTER_MAX];          // counters at last record (in wh)
+};
+
+struct histo_record {               // 8 bytes
+  uint16_t day;                                   // day of year (1..366)
+  uint8_t  week;                                  // week number
+  uint8_t  dow;                                   // day of week (1:monday .. 7:sunday)
+  uint8_t  month;                                 // month (1..12)
+  uint8_t  dom;                                   // day of month (1..31)
+  uint8_t  hour;                                  // hour (0..23)
+  uint8_t  unused;
 };
 
+struct histo_sum_status {           // 8 bytes
+  uint32_t  magic;                                // file signature
+  uint8_t   version;                              // file format version
+  uint8_t   counter_qty;                          // number of counters per entry
+  uint16_t  nb_record;                            // number of hourly records aggregated
+};
+
+static struct {                     // 352 bytes
+  bool     checked   = false;                     // migration of current year has been checked
+  uint16_t year      = 0;                         // year of CSV file under migration (0 if none)
+  uint16_t nb_line   = 0;                         // number of CSV lines handled
+  uint32_t time_start = 0;                        // migration start (ms)
+  uint32_t time_save = 0;                         // hourly record to save once migration is over (timestamp)
+  uint32_t nb_drop   = 0;                         // number of records dropped (counters not matching file)
+  histo_bin_status status;                        // status of binary file under construction
+  char     str_csv[UFS_FILENAME_SIZE];            // CSV file under migration
+  char     str_binary[UFS_FILENAME_SIZE];         // binary file under construction
+  File     file_csv;
+  File     file_bin;
+} histo_migrate;
+
 /*********************************************\
  *               Functions
 \*********************************************/
@@ -143,21 +207,31 @@ void TeleinfoHistoInitData ()
 
 bool TeleinfoHistoFileIsCandidate (const char* pstr_filename, const time_t filetime, time_t& prevtime)
 {
-  bool  candidate = false;
-  char *pstr_digit;
-  char  str_mask[32];
+  bool    candidate = false;
+  uint8_t index;
+  char   *pstr_digit;
+  char    str_mask[32];
 
   // check parameters
   if (pstr_filename == nullptr) return false;
 
-  // setup file mask
-  strcpy_P (str_mask, PSTR_HISTO_FILE_MASK);
-  pstr_digit = strchr (str_mask, '*');
-  *pstr_digit++ = 0;
+  // loop thru file masks (binary files and leftover CSV files)
+  for (index = 0; !candidate; index++)
+  {
+    // setup file mask
+    GetTextIndexed (str_mask, sizeof (str_mask), index, PSTR_HISTO_FILE_MASK);
+    if (str_mask[0] == 0) break;
+    pstr_digit = strchr (str_mask, '*');
+    if (pstr_digit == nullptr) continue;
+    *pstr_digit++ = 0;
+
+    // check file mask (without leading /)
+    candidate = (strncmp (str_mask, pstr_filename, strlen (str_mask)) == 0);
+    if (candidate) candidate = (strstr (pstr_filename, pstr_digit) != nullptr);
+  }
 
-  // check file mask (without leading /)
-  candidate = (strncmp (str_mask, pstr_filename, strlen (str_mask)) == 0);
-  if (candidate) candidate = (strstr (pstr_filename, pstr_digit) != nullptr);
+  // CSV file under migration is kept
+  if (candidate && (histo_migrate.year != 0)) candidate = (strcmp (histo_migrate.str_csv + 1, pstr_filename) != 0);
 
   // if file mask matches
   if (candidate)
@@ -217,18 +291,22 @@ void TeleinfoHistoFileCleanup ()
     
     // log
     AddLog (LOG_LEVEL_INFO, PSTR ("TIC: removed %s"), str_target.c_str ());
+
+    // remove associated rollup file
+    if (str_target.endsWith (".bin"))
+    {
+      str_target.replace (".bin", ".sum");
+      ffsp->remove (str_target.c_str ());
+    }
   }
 }
 
-// get current filename and create it if needed
-void TeleinfoHistoGetFilename (const uint16_t number, char *pstr_filename, const size_t size_filename)
+// get history filename of a year according to contract
+void TeleinfoHistoGetFilename (const uint16_t number, const char* pstr_format, char *pstr_filename, const size_t size_filename)
 {
-  uint8_t  index;
   uint16_t year;
-  char     str_value[12];
   char     str_name[HISTO_LINE_SIZE];
   char    *pstr_name;
-  File     file;
 
   // check parameters
   if (pstr_filename == nullptr) return;
@@ -240,7 +318,7 @@ void TeleinfoHistoGetFilename (const uint16_t number, char *pstr_filename, const
 
   // set filename according to contract
   strcpy_P (pstr_filename, PSTR("/"));
-  sprintf_P (str_name, PSTR_HISTO_FILE_CONTRACT, teleinfo_contract_db.str_code, year);
+  snprintf_P (str_name, sizeof (str_name), pstr_format, teleinfo_contract_db.str_code, year);
 
   // cleanup name
   pstr_name = str_name;
@@ -254,325 +332,637 @@ void TeleinfoHistoGetFilename (const uint16_t number, char *pstr_filename, const
     }
     pstr_name++;
   }
+}
 
-  // if file doesn't exist
-  if (!ffsp->exists (pstr_filename))
+// get current counters : prod, conso periods, solar and forecast
+uint8_t TeleinfoHistoGetCounters (long long *parr_counter)
+{
+  uint8_t index, qty;
+
+  qty = 0;
+  parr_counter[qty++] = teleinfo_prod_wh.total;
+  for (index = 0; index < teleinfo_contract_db.period_qty; index++) parr_counter[qty++] = teleinfo_conso_wh.index[index];
+  parr_counter[qty++] = teleinfo_solar.total_wh;
+  parr_counter[qty++] = teleinfo_forecast.total_wh;
+
+  return qty;
+}
+
+// create binary history file with initial counters
+bool TeleinfoHistoBinCreate (const char* pstr_filename, const uint8_t counter_qty, const long long *parr_counter)
+{
+  uint8_t  index;
+  uint16_t size;
+  uint8_t  arr_byte[64];
+  histo_bin_status status;
+  File     file;
+
+  // check parameters
+  if ((counter_qty < 3) || (counter_qty > HISTO_COUNTER_MAX)) return false;
+
+  // init status
+  memset (&status, 0, sizeof (status));
+  status.magic       = HISTO_BIN_MAGIC;
+  status.version     = HISTO_BIN_VERSION;
+  status.counter_qty = counter_qty;
+  for (index = 0; index < counter_qty; index++) status.arr_first[index] = status.arr_last[index] = parr_counter[index];
+
+  // write status and empty day index
+  file = ffsp->open (pstr_filename, "w");
+  if (!file) return false;
+  file.write ((uint8_t*)&status, sizeof (status));
+  memset (arr_byte, 0xFF, sizeof (arr_byte));
+  for (size = 0; size < HISTO_BIN_DAY_SIZE; size += sizeof (arr_byte)) file.write (arr_byte, min ((uint16_t)sizeof (arr_byte), (uint16_t)(HISTO_BIN_DAY_SIZE - size)));
+  file.close ();
+
+  return true;
+}
+
+// read binary history file status
+bool TeleinfoHistoBinReadStatus (File &file, histo_bin_status &status)
+{
+  file.seek (0);
+  if (file.read ((uint8_t*)&status, sizeof (status)) != sizeof (status)) return false;
+  if (status.magic != HISTO_BIN_MAGIC) return false;
+  if (status.version != HISTO_BIN_VERSION) return false;
+  if ((status.counter_qty < 3) || (status.counter_qty > HISTO_COUNTER_MAX)) return false;
+
+  return true;
+}
+
+// append an hourly record to an open binary history file (status is updated, to be written by caller)
+void TeleinfoHistoBinAppend (File &file, histo_bin_status &status, const histo_record &record, const long long *parr_counter, int32_t *parr_delta)
+{
+  uint8_t  index;
+  uint16_t first;
+
+  // check record capacity and day
+  if (status.nb_record == UINT16_MAX) return;
+  if ((record.day == 0) || (record.day >= HISTO_BIN_DAY_MAX)) return;
+
+  // if first record of the day, update day index
+  file.seek (HISTO_BIN_DAY_OFFSET + record.day * sizeof (uint16_t));
+  file.read ((uint8_t*)&first, sizeof (first));
+  if (first == UINT16_MAX)
+  {
+    first = status.nb_record;
+    file.seek (HISTO_BIN_DAY_OFFSET + record.day * sizeof (uint16_t));
+    file.write ((uint8_t*)&first, sizeof (first));
+  }
+
+  // calculate counters delta since previous record
+  for (index = 0; index < status.counter_qty; index++)
+  {
+    parr_delta[index] = (int32_t)(parr_counter[index] - status.arr_last[index]);
+    status.arr_last[index] = parr_counter[index];
+  }
+
+  // write record
+  file.seek (HISTO_BIN_RECORD_OFFSET + (uint32_t)status.nb_record * HISTO_BIN_RECORD_SIZE (status.counter_qty));
+  file.write ((uint8_t*)&record, sizeof (record));
+  file.write ((uint8_t*)parr_delta, status.counter_qty * sizeof (int32_t));
+  status.nb_record++;
+}
+
+// set record header from a timestamp
+void TeleinfoHistoBinSetRecord (const uint32_t timestamp, histo_record &record)
+{
+  TIME_T time_dst;
+
+  BreakTime (timestamp, time_dst);
+  record.day    = time_dst.day_of_year + 1;
+  record.week   = CalendarGetWeekNumber (timestamp);
+  record.dow    = CalendarGetDayOfWeek (timestamp);
+  record.month  = time_dst.month;
+  record.dom    = time_dst.day_of_month;
+  record.hour   = time_dst.hour;
+  record.unused = 0;
+}
+
+// parse a CSV history line : dddwwdmmddhh;prod;conso1;conso2;...;solar;forecast
+//   return number of counters
+uint8_t TeleinfoHistoCsvParse (char* pstr_line, histo_record &record, long long *parr_counter)
+{
+  uint8_t column = 0;
+  char   *pstr_token;
+
+  pstr_token = strtok (pstr_line, ";");
+  while ((pstr_token != nullptr) && (column <= HISTO_COUNTER_MAX))
   {
-    // check previous generic name
-    sprintf_P (str_name, PSTR_HISTO_FILE_ORIGINAL, year);
-    if (ffsp->exists (str_name))
+    if (column == 0)
     {
-      ffsp->rename (str_name, pstr_filename);
-      AddLog (LOG_LEVEL_INFO, PSTR ("TIC: File %s renamed to %s"), str_name, pstr_filename);
-    } 
+      if (strlen (pstr_token) < 12) return 0;
+      record.day    = (uint16_t)(100 * (pstr_token[0] - '0') + 10 * (pstr_token[1] - '0') + (pstr_token[2] - '0'));
+      record.week   = (uint8_t)(10 * (pstr_token[3] - '0') + (pstr_token[4] - '0'));
+      record.dow    = (uint8_t)(pstr_token[5] - '0');
+      record.month  = (uint8_t)(10 * (pstr_token[6] - '0') + (pstr_token[7] - '0'));
+      record.dom    = (uint8_t)(10 * (pstr_token[8] - '0') + (pstr_token[9] - '0'));
+      record.hour   = (uint8_t)(10 * (pstr_token[10] - '0') + (pstr_token[11] - '0'));
+      record.unused = 0;
+    }
+    else if (column <= HISTO_COUNTER_MAX) parr_counter[column - 1] = atoll (pstr_token);
+    column++;
+    pstr_token = strtok (nullptr, ";");
   }
 
-  // if file exists, ignore
-  if (ffsp->exists (pstr_filename)) return;
+  return (column > 0) ? column - 1 : 0;
+}
+
+// start migration of a yearly CSV file to binary format, return true if migration is started or running
+//   CSV file is converted by TeleinfoHistoMigrateStep () and removed once converted
+bool TeleinfoHistoMigrateStart (const uint16_t year, const char* pstr_binary)
+{
+  uint16_t year_full;
+  char     str_line[HISTO_LINE_SIZE];
 
-  // open file in create mode
-  file = ffsp->open (pstr_filename, "w");
+  // if a migration is running, check if it is the same year
+  year_full = (year < 1970) ? 1970 + year : year;
+  if (histo_migrate.year != 0) return (histo_migrate.year == year_full);
 
-  // generate header :  dddwwdmmddhh;prod;conso1;conso2;...;solar;forecast
-  strcpy_P (str_name, PSTR ("dddwwdmmddhh;prod"));
-  for (index = 0; index < teleinfo_contract_db.period_qty; index++)
+  // look for CSV file, renaming previous generic name if needed
+  TeleinfoHistoGetFilename (year_full, PSTR_HISTO_FILE_CONTRACT, histo_migrate.str_csv, sizeof (histo_migrate.str_csv));
+  if (!ffsp->exists (histo_migrate.str_csv))
   {
-    sprintf_P (str_value, PSTR (";conso%u"), index + 1);
-    strcat (str_name, str_value);
+    sprintf_P (str_line, PSTR_HISTO_FILE_ORIGINAL, year_full);
+    if (ffsp->exists (str_line)) ffsp->rename (str_line, histo_migrate.str_csv);
   }
-  strcat_P (str_name, PSTR (";solar;forecast\n"));
-  file.print (str_name);
+  if (!ffsp->exists (histo_migrate.str_csv)) return false;
 
-  // first line : beginning
-  strcpy_P (str_name, PSTR ("000000000000;"));
+  // open CSV file and skip header line
+  histo_migrate.file_csv = ffsp->open (histo_migrate.str_csv, "r");
+  if (!histo_migrate.file_csv) return false;
+  histo_migrate.file_csv.readBytesUntil ('\n', str_line, sizeof (str_line) - 1);
 
-  // first line : production counter
-  lltoa (teleinfo_prod_wh.total, str_value, 10);
-  strlcat (str_name, str_value, sizeof (str_name));
+  // init migration
+  strlcpy (histo_migrate.str_binary, pstr_binary, sizeof (histo_migrate.str_binary));
+  histo_migrate.year       = year_full;
+  histo_migrate.nb_line    = 0;
+  histo_migrate.time_start = millis ();
+  AddLog (LOG_LEVEL_INFO, PSTR ("TIC: Migration of %s started"), histo_migrate.str_csv);
 
-  // first line : conso indexes
-  for (index = 0; index < teleinfo_contract_db.period_qty; index++)
+  return true;
+}
+
+// convert next lines of CSV file under migration (called every 250ms)
+void TeleinfoHistoMigrateStep ()
+{
+  bool      result = true;
+  uint8_t   count, qty;
+  uint32_t  time_save;
+  size_t    length = 1;
+  char      str_line[HISTO_LINE_SIZE];
+  int32_t   arr_delta[HISTO_COUNTER_MAX];
+  long long arr_counter[HISTO_COUNTER_MAX];
+  histo_record record;
+
+  // check if a migration is running
+  if (histo_migrate.year == 0) return;
+
+  // loop thru next CSV lines
+  for (count = 0; result && (count < HISTO_MIGRATE_LINES); count++)
   {
-    lltoa (teleinfo_conso_wh.index[index], str_value, 10);
-    strcat_P (str_name, PSTR (";"));
-    strlcat (str_name, str_value, sizeof (str_name));
+    // read line
+    length = histo_migrate.file_csv.readBytesUntil ('\n', str_line, sizeof (str_line) - 1);
+    str_line[length] = 0;
+    if (length == 0) break;
+    qty = TeleinfoHistoCsvParse (str_line, record, arr_counter);
+
+    // first line gives initial counters and creates binary file
+    if (histo_migrate.nb_line == 0)
+    {
+      result = TeleinfoHistoBinCreate (histo_migrate.str_binary, qty, arr_counter);
+      if (result) histo_migrate.file_bin = ffsp->open (histo_migrate.str_binary, "r+");
+      if (result) result = TeleinfoHistoBinReadStatus (histo_migrate.file_bin, histo_migrate.status);
+    }
+
+    // next lines are hourly records
+    else if (qty == histo_migrate.status.counter_qty) TeleinfoHistoBinAppend (histo_migrate.file_bin, histo_migrate.status, record, arr_counter, arr_delta);
+
+    // else record is dropped
+    else
+    {
+      histo_migrate.nb_drop++;
+      AddLog (LOG_LEVEL_INFO, PSTR ("TIC: %s line %u dropped, %u counters for %u expected (%u dropped)"), histo_migrate.str_csv, histo_migrate.nb_line + 1, qty, histo_migrate.status.counter_qty, histo_migrate.nb_drop);
+    }
+    histo_migrate.nb_line++;
   }
 
-  // first line : solar production counter
-  lltoa (teleinfo_solar.total_wh, str_value, 10);
-  strcat_P (str_name, PSTR (";"));
-  strlcat (str_name, str_value, sizeof (str_name));
+  // if CSV file is not over, wait for next step
+  if (result && (length > 0)) return;
+  histo_migrate.file_csv.close ();
 
-  // first line : solar production forecast counter
-  lltoa (teleinfo_forecast.total_wh, str_value, 10);
-  strcat_P (str_name, PSTR (";"));
-  strlcat (str_name, str_value, sizeof (str_name));
+  // write status and remove CSV file (available thru CSV export)
+  if (result)
+  {
+    histo_migrate.file_bin.seek (0);
+    histo_migrate.file_bin.write ((uint8_t*)&histo_migrate.status, sizeof (histo_migrate.status));
+    histo_migrate.file_bin.close ();
+    ffsp->remove (histo_migrate.str_csv);
+    AddLog (LOG_LEVEL_INFO, PSTR ("TIC: %s converted to %s (%u records) [%ums]"), histo_migrate.str_csv, histo_migrate.str_binary, histo_migrate.status.nb_record, millis () - histo_migrate.time_start);
+  }
 
-  // first line : write
-  strcat_P (str_name, PSTR ("\n"));
-  file.print (str_name);
+  // else remove partial binary file, CSV file is kept
+  else
+  {
+    if (histo_migrate.file_bin) histo_migrate.file_bin.close ();
+    ffsp->remove (histo_migrate.str_binary);
+    AddLog (LOG_LEVEL_INFO, PSTR ("TIC: Migration of %s failed"), histo_migrate.str_csv);
+  }
 
-  // close file
-  file.close ();
+  // migration is over, save hourly record received meanwhile
+  histo_migrate.year = 0;
+  time_save = histo_migrate.time_save;
+  histo_migrate.time_save = 0;
+  if (time_save != 0) TeleinfoHistoFileSaveRecord (time_save);
 }
 
-// Save historisation data : dddwwdmmddhh;prod;conso1;conso2;...;solar;forecast (max 630k per year)
-void TeleinfoHistoFileSaveData ()
+// get binary history file of a year, creating it if needed
+//   return false while a CSV file of this year is under migration
+bool TeleinfoHistoFilePrepare (const uint16_t year, char *pstr_filename, const size_t size_filename, const bool create)
 {
-  uint8_t  index;
-  uint32_t time_now;
-  TIME_T   time_dst;
-  char     str_value[12];
-  char     str_text[HISTO_LINE_SIZE];
-  File     file;
+  uint8_t   qty;
+  long long arr_counter[HISTO_COUNTER_MAX];
 
-  // if date not defined, cancel
-  if (!RtcTime.valid) return;
+  // get binary filename, unavailable while under construction
+  TeleinfoHistoGetFilename (year, PSTR_HISTO_FILE_BINARY, pstr_filename, size_filename);
+  if (histo_migrate.year == ((year < 1970) ? 1970 + year : year)) return false;
+  if (ffsp->exists (pstr_filename)) return true;
 
-  // calculate timestamp (30sec before to get previous slot)
-  time_now = LocalTime () - 30;
-  BreakTime (time_now, time_dst);
+  // if CSV file exists, start its conversion
+  if (TeleinfoHistoMigrateStart (year, pstr_filename)) return false;
+  if (!create) return false;
 
-  // open in append mode
-  TeleinfoHistoGetFilename (time_dst.year, str_text, sizeof (str_text));
-  file = ffsp->open (str_text, "a");
-
-  // line : beginning
-  CalendarFileGetHeader (time_now, str_text, sizeof (str_text));
+  // create file with current counters
+  qty = TeleinfoHistoGetCounters (arr_counter);
+  return TeleinfoHistoBinCreate (pstr_filename, qty, arr_counter);
+}
 
-  // line : production counter
-  lltoa (teleinfo_prod_wh.total, str_value, 10);
-  strlcat (str_text, str_value, sizeof (str_text));
+// add counters delta to a rollup entry
+void TeleinfoHistoSumAddEntry (File &file, const uint32_t offset, const uint8_t counter_qty, const int32_t *parr_delta)
+{
+  uint8_t index;
+  int32_t arr_total[HISTO_COUNTER_MAX];
+
+  // read entry, add delta and write it back
+  file.seek (offset);
+  if (file.read ((uint8_t*)arr_total, HISTO_SUM_ENTRY_SIZE (counter_qty)) != HISTO_SUM_ENTRY_SIZE (counter_qty)) return;
+  for (index = 0; index < counter_qty; index++) arr_total[index] += parr_delta[index];
+  file.seek (offset);
+  file.write ((uint8_t*)arr_total, HISTO_SUM_ENTRY_SIZE (counter_qty));
+}
 
-  // line : conso indexes
-  for (index = 0; index < teleinfo_contract_db.period_qty; index++)
+// rebuild rollup file from all records of binary history file
+bool TeleinfoHistoSumRebuild (const char* pstr_binary, const char* pstr_rollup)
+{
+  uint8_t  index, month;
+  uint16_t day, size, length;
+  uint32_t record, time_now;
+  uint8_t  arr_byte[64];
+  int32_t  arr_delta[HISTO_COUNTER_MAX];
+  int32_t  arr_day[HISTO_COUNTER_MAX];
+  int32_t  arr_month[HISTO_COUNTER_MAX];
+  histo_bin_status bin_status;
+  histo_sum_status sum_status;
+  histo_record     line;
+  File     file_bin, file_sum;
+
+  // open binary file and check status
+  file_bin = ffsp->open (pstr_binary, "r");
+  if (!file_bin) return false;
+  if (!TeleinfoHistoBinReadStatus (file_bin, bin_status)) { file_bin.close (); return false; }
+
+  // create rollup file with empty tables
+  time_now = millis ();
+  file_sum = ffsp->open (pstr_rollup, "w+");
+  if (!file_sum) { file_bin.close (); return false; }
+  sum_status.magic       = HISTO_BIN_MAGIC;
+  sum_status.version     = HISTO_BIN_VERSION;
+  sum_status.counter_qty = bin_status.counter_qty;
+  sum_status.nb_record   = bin_status.nb_record;
+  file_sum.write ((uint8_t*)&sum_status, sizeof (sum_status));
+  memset (arr_byte, 0, sizeof (arr_byte));
+  length = (HISTO_BIN_DAY_MAX + HISTO_SUM_MONTH_MAX) * HISTO_SUM_ENTRY_SIZE (bin_status.counter_qty);
+  for (size = 0; size < length; size += sizeof (arr_byte)) file_sum.write (arr_byte, min ((uint16_t)sizeof (arr_byte), (uint16_t)(length - size)));
+
+  // loop thru records, accumulating totals while day and month are unchanged
+  day = month = 0;
+  memset (arr_day,   0, sizeof (arr_day));
+  memset (arr_month, 0, sizeof (arr_month));
+  file_bin.seek (HISTO_BIN_RECORD_OFFSET);
+  for (record = 0; record < (uint32_t)bin_status.nb_record + 1; record++)
   {
-    lltoa (teleinfo_conso_wh.index[index], str_value, 10);
-    strcat_P (str_text, PSTR (";"));
-    strlcat (str_text, str_value, sizeof (str_text));
+    // read next record (end of records flushes pending totals)
+    if (record < bin_status.nb_record)
+    {
+      if (file_bin.read ((uint8_t*)&line, sizeof (line)) != sizeof (line)) break;
+      if (file_bin.read ((uint8_t*)arr_delta, HISTO_SUM_ENTRY_SIZE (bin_status.counter_qty)) != HISTO_SUM_ENTRY_SIZE (bin_status.counter_qty)) break;
+    }
+    else line.day = line.month = 0;
+
+    // if day has changed, save day totals
+    if ((day != line.day) && (day > 0) && (day < HISTO_BIN_DAY_MAX)) TeleinfoHistoSumAddEntry (file_sum, HISTO_SUM_DAY_OFFSET + day * HISTO_SUM_ENTRY_SIZE (bin_status.counter_qty), bin_status.counter_qty, arr_day);
+    if (day != line.day) memset (arr_day, 0, sizeof (arr_day));
+
+    // if month has changed, save month totals
+    if ((month != line.month) && (month > 0) && (month < HISTO_SUM_MONTH_MAX)) TeleinfoHistoSumAddEntry (file_sum, HISTO_SUM_MONTH_OFFSET (bin_status.counter_qty) + month * HISTO_SUM_ENTRY_SIZE (bin_status.counter_qty), bin_status.counter_qty, arr_month);
+    if (month != line.month) memset (arr_month, 0, sizeof (arr_month));
+
+    // accumulate record
+    day   = line.day;
+    month = line.month;
+    if (record < bin_status.nb_record) for (index = 0; index < bin_status.counter_qty; index++)
+    {
+      arr_day[index]   += arr_delta[index];
+      arr_month[index] += arr_delta[index];
+    }
+
+    // do a yield every 500 records
+    if (record % 500 == 499) yield ();
   }
+  file_sum.close ();
+  file_bin.close ();
 
-  // line : solar production counter
-  lltoa (teleinfo_solar.total_wh, str_value, 10);
-  strcat_P (str_text, PSTR (";"));
-  strlcat (str_text, str_value, sizeof (str_text));
+  // log
+  AddLog (LOG_LEVEL_INFO, PSTR ("TIC: %s rebuilt from %u records [%ums]"), pstr_rollup, bin_status.nb_record, millis () - time_now);
 
-  // line : solar production forecast counter
-  lltoa (teleinfo_forecast.total_wh, str_value, 10);
-  strcat_P (str_text, PSTR (";"));
-  strlcat (str_text, str_value, sizeof (str_text));
+  return true;
+}
+
+// get rollup file of a year, rebuilding it if missing or not in line with binary history file
+bool TeleinfoHistoSumPrepare (const uint16_t year, char *pstr_filename, const size_t size_filename)
+{
+  bool     result;
+  char     str_binary[UFS_FILENAME_SIZE];
+  histo_bin_status bin_status;
+  histo_sum_status sum_status;
+  File     file;
 
-  // write line and close file
-  strcat_P (str_text, PSTR ("\n"));
-  file.print (str_text);
+  // get binary history file
+  if (!TeleinfoHistoFilePrepare (year, str_binary, sizeof (str_binary), false)) return false;
+  file = ffsp->open (str_binary, "r");
+  if (!file) return false;
+  result = TeleinfoHistoBinReadStatus (file, bin_status);
   file.close ();
+  if (!result) return false;
+
+  // check rollup file status
+  TeleinfoHistoGetFilename (year, PSTR_HISTO_FILE_ROLLUP, pstr_filename, size_filename);
+  file = ffsp->open (pstr_filename, "r");
+  if (file) result = (file.read ((uint8_t*)&sum_status, sizeof (sum_status)) == sizeof (sum_status));
+    else result = false;
+  if (file) file.close ();
+  if (result) result = ((sum_status.magic == HISTO_BIN_MAGIC) && (sum_status.version == HISTO_BIN_VERSION));
+  if (result) result = ((sum_status.counter_qty == bin_status.counter_qty) && (sum_status.nb_record == bin_status.nb_record));
+
+  // if needed, rebuild rollup file
+  if (!result) result = TeleinfoHistoSumRebuild (str_binary, pstr_filename);
+
+  return result;
 }
 
-// extract data from a line
-int TeleinfoHistoExtractLine (char* pstr_line, struct histo_value &value)
+// add hourly record to rollup file of the year
+void TeleinfoHistoSumUpdate (const uint16_t year, const histo_bin_status &bin_status, const histo_record &record, const int32_t *parr_delta)
 {
-  int   column = 0;
-  char *pstr_token;
+  bool     result;
+  char     str_filename[UFS_FILENAME_SIZE];
+  histo_sum_status sum_status;
+  File     file;
 
-  // loop thru delimiter
-  pstr_token = strtok (pstr_line, ";");
-  while (pstr_token)
+  // open rollup file and check it is in line with previous record
+  TeleinfoHistoGetFilename (year, PSTR_HISTO_FILE_ROLLUP, str_filename, sizeof (str_filename));
+  file = ffsp->open (str_filename, "r+");
+  if (file) result = (file.read ((uint8_t*)&sum_status, sizeof (sum_status)) == sizeof (sum_status));
+    else result = false;
+  if (result) result = ((sum_status.magic == HISTO_BIN_MAGIC) && (sum_status.version == HISTO_BIN_VERSION));
+  if (result) result = ((sum_status.counter_qty == bin_status.counter_qty) && (sum_status.nb_record + 1 == bin_status.nb_record));
+  if (result) result = ((record.day > 0) && (record.day < HISTO_BIN_DAY_MAX) && (record.month > 0) && (record.month < HISTO_SUM_MONTH_MAX));
+
+  // add delta to day and month totals
+  if (result)
   {
-    // extract data according to column
-    column++;
-    if (column == 2) value.prod = atoll (pstr_token);
-    else if (column == 3 + teleinfo_contract_db.period_qty) value.solar = atoll (pstr_token);
-    else if (column == 4 + teleinfo_contract_db.period_qty) value.forecast = atoll (pstr_token);
-    else if (column > 2) value.conso[column - 3] = atoll (pstr_token);
-
-    // look for next token
-    pstr_token = strtok (nullptr, ";");
+    TeleinfoHistoSumAddEntry (file, HISTO_SUM_DAY_OFFSET + record.day * HISTO_SUM_ENTRY_SIZE (sum_status.counter_qty), sum_status.counter_qty, parr_delta);
+    TeleinfoHistoSumAddEntry (file, HISTO_SUM_MONTH_OFFSET (sum_status.counter_qty) + record.month * HISTO_SUM_ENTRY_SIZE (sum_status.counter_qty), sum_status.counter_qty, parr_delta);
+    sum_status.nb_record = bin_status.nb_record;
+    file.seek (0);
+    file.write ((uint8_t*)&sum_status, sizeof (sum_status));
   }
+  if (file) file.close ();
 
- return column;
+  // if rollup file is missing or out of sync, rebuild it
+  if (!result) TeleinfoHistoSumPrepare (year, str_filename, sizeof (str_filename));
 }
 
-// load data from file
-bool TeleinfoHistoFileLoadPeriod (const uint8_t period, const uint32_t timestamp)
+// Save historisation data as an hourly binary record (delta of prod, conso periods, solar and forecast counters)
+void TeleinfoHistoFileSaveRecord (const uint32_t timestamp)
 {
-  bool     read_next;
-  int      index_min, index_begin, index_previous, index_current;
-  uint8_t  count, status;
-  uint32_t time_now;
-  size_t   tgt_start, tgt_length, idx_start, idx_length;
-  size_t   length, line_first, line_current;
-  char     str_target[4];
-  char     str_index[4];
-  char     str_previous[HISTO_LINE_SIZE];
-  char     str_current[HISTO_LINE_SIZE];
+  bool     result;
+  uint8_t  qty;
   TIME_T   time_dst;
+  char     str_filename[UFS_FILENAME_SIZE];
+  int32_t  arr_delta[HISTO_COUNTER_MAX];
+  long long arr_counter[HISTO_COUNTER_MAX];
+  histo_bin_status status;
+  histo_record     record;
   File     file;
-  histo_value total_begin, total_stop;
-
-  // check parameters
-  if (period >= CALENDAR_PERIOD_MAX) return false;
-  if (timestamp == 0) return false;
 
-  // check data file presence
+  // open file in update mode
   BreakTime (timestamp, time_dst);
-  TeleinfoHistoGetFilename (time_dst.year, str_current, sizeof (str_current));
-  if (!ffsp->exists (str_current)) return false;
-  
-  // init data
-  time_now = millis ();
-  status   = HISTO_FILE_BEFORE;
-  line_first   = 0;
-  line_current = 0;
-  index_begin    = INT_MAX;
-  index_previous = INT_MAX;
-  index_current  = INT_MAX;
-  memset (&total_begin, 0, sizeof (histo_value));
-  memset (&total_stop,  0, sizeof (histo_value));
-
-  // prepare data according to period
-  switch (period)
+  if (!TeleinfoHistoFilePrepare (time_dst.year, str_filename, sizeof (str_filename), true))
   {
-    case CALENDAR_PERIOD_DAY:
-      tgt_start = 0;  tgt_length = 3;
-      idx_start = 10; idx_length = 2;
-      index_min = 0;
-      sprintf_P (str_target, PSTR ("%03u"), time_dst.day_of_year + 1);
-      break;
+    // if CSV file of the year is under migration, save record once it is over
+    if (histo_migrate.year == 1970 + time_dst.year) histo_migrate.time_save = timestamp;
+    return;
+  }
+  file = ffsp->open (str_filename, "r+");
+  if (!file) return;
 
-    case CALENDAR_PERIOD_WEEK:
-      tgt_start = 3; tgt_length = 2;
-      idx_start = 5; idx_length = 1;
-      index_min = 1;
-      count = CalendarGetWeekNumber (timestamp);
-      sprintf_P (str_target, PSTR ("%02u"), count);
-      break;
+  // append record if counters are consistent with file
+  result = TeleinfoHistoBinReadStatus (file, status);
+  qty = TeleinfoHistoGetCounters (arr_counter);
+  if (result && (qty != status.counter_qty))
+  {
+    result = false;
+    histo_migrate.nb_drop++;
+    AddLog (LOG_LEVEL_INFO, PSTR ("TIC: %s record dropped, %u counters for %u in file (%u dropped)"), str_filename, qty, status.counter_qty, histo_migrate.nb_drop);
+  }
+  if (result)
+  {
+    TeleinfoHistoBinSetRecord (timestamp, record);
+    TeleinfoHistoBinAppend (file, status, record, arr_counter, arr_delta);
+    file.seek (0);
+    file.write ((uint8_t*)&status, sizeof (status));
+  }
+  file.close ();
 
-    case CALENDAR_PERIOD_MONTH:
-      tgt_start = 6; tgt_length = 2;
-      idx_start = 8; idx_length = 2;
-      index_min = 1;
-      sprintf_P (str_target, PSTR ("%02u"), time_dst.month);
-      break;
+  // update rollup totals
+  if (result) TeleinfoHistoSumUpdate (time_dst.year, status, record, arr_delta);
+}
 
-    case CALENDAR_PERIOD_YEAR:
-      tgt_start = 0; tgt_length = 0;
-      idx_start = 6; idx_length = 2;
-      index_min = 1;
-      str_target[0] = 0;
-      break;
-  }
+// Save historisation data of previous hour
+void TeleinfoHistoFileSaveData ()
+{
+  // if date not defined, cancel
+  if (!RtcTime.valid) return;
 
-  // open file and skip header
-  file = ffsp->open (str_current, "r");
-  file.readBytesUntil ('\n', str_current, sizeof (str_current) - 1);
+  // save record with timestamp 30sec before to get previous slot
+  TeleinfoHistoFileSaveRecord (LocalTime () - 30);
+}
 
-  // parse file
-  read_next = file.available ();
-  while (read_next)
-  {
-    // read next line
-    length    = file.readBytesUntil ('\n', str_current, sizeof (str_current) - 1);
-    read_next = file.available ();
+// load hourly data of a day from binary history file
+bool TeleinfoHistoFileLoadDay (const uint32_t timestamp)
+{
+  uint8_t  index;
+  uint16_t day, record, nb_read;
+  uint32_t time_now;
+  char     str_filename[UFS_FILENAME_SIZE];
+  int32_t  arr_delta[HISTO_COUNTER_MAX];
+  TIME_T   time_dst;
+  histo_bin_status status;
+  histo_record     line;
+  File     file;
 
-    // handle current line
-    str_current[length] = 0;
-    line_current++;
+  // check data file presence
+  BreakTime (timestamp, time_dst);
+  if (!TeleinfoHistoFilePrepare (time_dst.year, str_filename, sizeof (str_filename), false)) return false;
 
-    // check if target is found or beyond
-    if (period == CALENDAR_PERIOD_YEAR) (line_current > 1) ? status = HISTO_FILE_FOUND : status = HISTO_FILE_BEFORE;
-    else if (strncmp (str_current + tgt_start, str_target, tgt_length) == 0) status = HISTO_FILE_FOUND;
-    else if (status == HISTO_FILE_FOUND) status = HISTO_FILE_BEYOND;
+  // open file and check status
+  time_now = millis ();
+  file = ffsp->open (str_filename, "r");
+  if (!TeleinfoHistoBinReadStatus (file, status)) { file.close (); return false; }
+
+  // look for first record of the day in day index
+  day = time_dst.day_of_year + 1;
+  file.seek (HISTO_BIN_DAY_OFFSET + day * sizeof (uint16_t));
+  file.read ((uint8_t*)&record, sizeof (record));
+
+  // loop thru records of the day
+  nb_read = 0;
+  if (record < status.nb_record) file.seek (HISTO_BIN_RECORD_OFFSET + (uint32_t)record * HISTO_BIN_RECORD_SIZE (status.counter_qty));
+  for (; record < status.nb_record; record++)
+  {
+    // read record
+    if (file.read ((uint8_t*)&line, sizeof (line)) != sizeof (line)) break;
+    if (file.read ((uint8_t*)arr_delta, status.counter_qty * sizeof (int32_t)) != status.counter_qty * sizeof (int32_t)) break;
+    if (line.day != day) break;
+    if (line.hour >= HISTO_GRAPH_MAX) continue;
+    nb_read++;
+
+    // add record delta to hour slot
+    histo_data[line.hour].prod += arr_delta[0];
+    for (index = 0; (index < status.counter_qty - 3) && (index < TIC_PERIOD_MAX); index++) histo_data[line.hour].conso[index] += arr_delta[1 + index];
+    histo_data[line.hour].solar    += arr_delta[status.counter_qty - 2];
+    histo_data[line.hour].forecast += arr_delta[status.counter_qty - 1];
+  }
+  file.close ();
 
-    // if target found and end of file is reached, set flag to read last line
-    if (!read_next && (status == HISTO_FILE_FOUND)) status = HISTO_FILE_LAST;
+  // log data loading
+  AddLog (LOG_LEVEL_DEBUG, PSTR ("TIC: Loaded %u, day %u, %u records [%ums]"), 1970 + time_dst.year, day, nb_read, millis () - time_now);
 
-    // if beyond target, stop to read file
-    if (status == HISTO_FILE_BEYOND) read_next = false;
+  return (nb_read > 0);
+}
 
-    // if line should be analysed
-    if (status > HISTO_FILE_BEFORE)
-    {
-      // if needed, set first line
-      if (line_first == 0) line_first = line_current;
+// open rollup file of a year and read its status
+bool TeleinfoHistoSumOpen (const uint16_t year, File &file, histo_sum_status &status)
+{
+  char str_filename[UFS_FILENAME_SIZE];
 
-      // read new index
-      strlcpy (str_index, str_current + idx_start, idx_length + 1);
-      index_current = (uint8_t)atoi (str_index);
+  if (!TeleinfoHistoSumPrepare (year, str_filename, sizeof (str_filename))) return false;
+  file = ffsp->open (str_filename, "r");
+  if (!file) return false;
+  if ((file.read ((uint8_t*)&status, sizeof (status)) == sizeof (status)) && (status.counter_qty >= 3) && (status.counter_qty <= HISTO_COUNTER_MAX)) return true;
+  file.close ();
 
-      // if no index for previous line, set current index
-      if (index_previous == INT_MAX) index_previous = index_current;
+  return false;
+}
 
-      // if no begin index, extract values from previous line (wich was not within target)
-      if (index_begin == INT_MAX) 
-      {
-        index_begin = index_min - 1;
-        TeleinfoHistoExtractLine (str_previous, total_begin);
-      }
+// load data of a period : hourly records for a day, rollup totals for week, month and year
+//   return true if at least one slot has been read
+bool TeleinfoHistoFileLoadPeriod (const uint8_t period, const uint32_t timestamp)
+{
+  bool     opened;
+  uint8_t  slot, index, count, nb_read;
+  uint16_t day, year, year_missing;
+  uint32_t time_now, time_calc, offset;
+  int32_t  arr_total[HISTO_COUNTER_MAX];
+  TIME_T   time_dst, calc_dst;
+  histo_sum_status status;
+  File     file;
 
-      // if beyond target, set current index to max value
-      if (status == HISTO_FILE_BEYOND) index_current = INT_MAX;
+  // check parameters
+  if (period >= CALENDAR_PERIOD_MAX) return false;
+  if (timestamp == 0) return false;
 
-      // if index has changed from previous line, calculate delta for current valid index
-      if (index_current > index_previous)
-      {
-        if ((index_previous < HISTO_GRAPH_MAX) && (index_previous > index_begin))
-        {
-          // extract totals from previous line
-          TeleinfoHistoExtractLine (str_previous, total_stop);
-
-          // save delta from last valid index till previous index
-          histo_data[index_previous].prod     = (long)(total_stop.prod     - total_begin.prod);
-          for (count = 0; count < TIC_PERIOD_MAX; count++) histo_data[index_previous].conso[count] = (long)(total_stop.conso[count] - total_begin.conso[count]);
-          histo_data[index_previous].solar    = (long)(total_stop.solar    - total_begin.solar);
-          histo_data[index_previous].forecast = (long)(total_stop.forecast - total_begin.forecast);
-        }
+  // day graph is read from hourly records
+  if (period == CALENDAR_PERIOD_DAY) return TeleinfoHistoFileLoadDay (timestamp);
 
-        // set begin totals to previous ones
-        index_begin = index_previous;
-        total_begin = total_stop;
-      }
+  // slots of the period
+  BreakTime (timestamp, time_dst);
+  switch (period)
+  {
+    case CALENDAR_PERIOD_WEEK:  count = 7;  time_calc = CalendarGetFirstDayOfWeek (timestamp);  break;
+    case CALENDAR_PERIOD_MONTH: count = CalendarGetDaysInMonth (timestamp); time_calc = CalendarGetFirstDayOfMonth (timestamp); break;
+    default:                    count = 12; time_calc = 0; break;
+  }
 
-      // handle last line of file if it is within index target
-      if (status == HISTO_FILE_LAST)
+  // loop thru period slots
+  time_now = millis ();
+  nb_read  = 0;
+  opened   = false;
+  year     = time_dst.year;
+  year_missing = UINT16_MAX;
+  for (slot = 1; slot <= count; slot++)
+  {
+    // for week and month, get day of slot (day of week can belong to previous or next year)
+    day = 0;
+    if (period != CALENDAR_PERIOD_YEAR)
+    {
+      BreakTime (time_calc + (uint32_t)(slot - 1) * 86400, calc_dst);
+      day = calc_dst.day_of_year + 1;
+      if (day >= HISTO_BIN_DAY_MAX) continue;
+
+      // if needed, switch to rollup file of day's year
+      if (calc_dst.year != year)
       {
-        if ((index_current < HISTO_GRAPH_MAX) && (index_current > index_begin))
-        {
-          // extract totals from current line
-          TeleinfoHistoExtractLine (str_current, total_stop);
-  
-          // save delta from last valid index till previous index
-          histo_data[index_current].prod     = (long)(total_stop.prod     - total_begin.prod);
-          for (count = 0; count < TIC_PERIOD_MAX; count++) histo_data[index_current].conso[count] = (long)(total_stop.conso[count] - total_begin.conso[count]);        
-          histo_data[index_current].solar    = (long)(total_stop.solar    - total_begin.solar);
-          histo_data[index_current].forecast = (long)(total_stop.forecast - total_begin.forecast);
-        }
+        if (opened) file.close ();
+        opened = false;
+        year   = calc_dst.year;
       }
-
-      // save previous index
-      index_previous = index_current;
     }
 
-    // save previous line data
-    strcpy (str_previous, str_current);
-
-    // do a yield every 500 lines
-    if (line_current % 500 == 0) yield ();
+    // open rollup file of the year (missing file leaves slot empty)
+    if (!opened && (year != year_missing)) opened = TeleinfoHistoSumOpen (year, file, status);
+    if (!opened) { year_missing = year; continue; }
+
+    // get entry offset : daily total for week and month, monthly total for year
+    if (period == CALENDAR_PERIOD_YEAR) offset = HISTO_SUM_MONTH_OFFSET (status.counter_qty) + slot * HISTO_SUM_ENTRY_SIZE (status.counter_qty);
+      else offset = HISTO_SUM_DAY_OFFSET + day * HISTO_SUM_ENTRY_SIZE (status.counter_qty);
+
+    // read entry and add totals to slot
+    file.seek (offset);
+    if (file.read ((uint8_t*)arr_total, HISTO_SUM_ENTRY_SIZE (status.counter_qty)) != HISTO_SUM_ENTRY_SIZE (status.counter_qty)) continue;
+    nb_read++;
+    histo_data[slot].prod += arr_total[0];
+    for (index = 0; (index < status.counter_qty - 3) && (index < TIC_PERIOD_MAX); index++) histo_data[slot].conso[index] += arr_total[1 + index];
+    histo_data[slot].solar    += arr_total[status.counter_qty - 2];
+    histo_data[slot].forecast += arr_total[status.counter_qty - 1];
   }
-  file.close ();
+  if (opened) file.close ();
 
   // log data loading
-  if (line_first == 0) strcpy_P (str_current, PSTR ("no data"));
-    else sprintf_P (str_current, PSTR ("lines %u to %u"),  line_first, line_current);
-  AddLog (LOG_LEVEL_DEBUG, PSTR ("TIC: Loaded %u, period %u, target %s, %s [%ums]"), 1970 + time_dst.year, histo_status.period, str_target, str_current, millis () - time_now);
+  AddLog (LOG_LEVEL_DEBUG, PSTR ("TIC: Loaded %u, period %u, %u/%u slots [%ums]"), 1970 + time_dst.year, period, nb_read, count, millis () - time_now);
 
-  return (line_first > 0);
+  return (nb_read > 0);
+}
+
+// ask for history reload once new contract is known
+void TeleinfoHistoContractChange ()
+{
+  histo_reload = true;
 }
 
 // load data from file
 void TeleinfoHistoFileLoadData ()
 {
-  uint8_t week;
-
   // check parameters
   if (histo_status.period >= CALENDAR_PERIOD_MAX) return;
   if (histo_status.timestamp == 0) return;
@@ -580,21 +970,8 @@ void TeleinfoHistoFileLoadData ()
   // init data
   TeleinfoHistoInitData ();
 
-  // load data for current period
+  // load data for current period (week spanning two years is read from both rollup files)
   TeleinfoHistoFileLoadPeriod (histo_status.period, histo_status.timestamp);
-
-  // if dealing with weekly period
-  if (histo_status.period == CALENDAR_PERIOD_WEEK)
-  {
-    // get current week number
-    week = CalendarIsWeekComplete (histo_status.timestamp);
-
-    // if needed, append first week of next year (6 days shift)
-    if (week == 1) TeleinfoHistoFileLoadPeriod (histo_status.period, histo_status.timestamp + 518400);
-
-    // else if needed, append last week of previous year (6 days shift)
-    else if (week == 53) TeleinfoHistoFileLoadPeriod (histo_status.period, histo_status.timestamp - 518400);
-  }
 }
 
 /*********************************************\
@@ -667,6 +1044,7 @@ void TeleinfoHistoInit ()
 void TeleinfoHistoEverySecond ()
 {
   TIME_T time_dst;
+  char   str_filename[UFS_FILENAME_SIZE];
 
   // ignore if time is not valid
   if (!RtcTime.valid) return;
@@ -678,6 +1056,23 @@ void TeleinfoHistoEverySecond ()
   // init historisation to today's day
   if (histo_status.timestamp == 0) histo_status.timestamp = LocalTime ();
 
+  // wait for contract code, as it is part of file names (empty after a contract switch till first complete message)
+  if (strlen (teleinfo_contract_db.str_code) == 0) return;
+
+  // after a contract switch, reload history display from new contract files
+  if (histo_reload)
+  {
+    histo_reload = false;
+    TeleinfoHistoFileLoadData ();
+  }
+
+  // once contract is known, start migration of current year CSV file if any
+  if (!histo_migrate.checked)
+  {
+    histo_migrate.checked = true;
+    TeleinfoHistoFilePrepare (time_dst.year, str_filename, sizeof (str_filename), false);
+  }
+
   // detect hour change to save data
   if (histo_status.hour == UINT8_MAX) histo_status.hour = time_dst.hour;
   if (histo_status.hour != time_dst.hour)
@@ -991,6 +1386,77 @@ uint16_t TeleinfoHistoButtonStatus (const uint16_t shift, char *pstr_status, siz
   return choice;
 } 
 
+// CSV export of a yearly history file : dddwwdmmddhh;prod;conso1;conso2;...;solar;forecast
+void TeleinfoHistoWebCsv ()
+{
+  uint8_t   index;
+  uint16_t  year, record;
+  uint32_t  timestamp;
+  TIME_T    time_dst;
+  char      str_value[24];
+  char      str_line[HISTO_LINE_SIZE];
+  char      str_filename[UFS_FILENAME_SIZE];
+  int32_t   arr_delta[HISTO_COUNTER_MAX];
+  long long arr_counter[HISTO_COUNTER_MAX];
+  histo_bin_status status;
+  histo_record     line;
+  File      file;
+
+  // get year (default is year of displayed period)
+  timestamp = histo_status.timestamp;
+  if (timestamp == 0) timestamp = LocalTime ();
+  BreakTime (timestamp, time_dst);
+  year = (uint16_t)TeleinfoGetArgValue (CMND_HISTO_YEAR, 1970, 2199, 1970 + time_dst.year);
+
+  // open binary file
+  if (TeleinfoHistoFilePrepare (year, str_filename, sizeof (str_filename), false)) file = ffsp->open (str_filename, "r");
+  if (!file || !TeleinfoHistoBinReadStatus (file, status))
+  {
+    if (file) file.close ();
+    Webserver->send (404, "text/plain", "");
+    return;
+  }
+
+  // start of CSV file
+  snprintf_P (str_line, sizeof (str_line), PSTR ("attachment; filename=%s"), str_filename + 1);
+  strcpy_P (str_line + strlen (str_line) - 3, PSTR ("csv"));
+  Webserver->sendHeader (F ("Content-Disposition"), str_line);
+  WSContentBegin (200, CT_PLAIN);
+
+  // header and initial counters
+  strcpy_P (str_line, PSTR ("dddwwdmmddhh;prod"));
+  for (index = 0; index < status.counter_qty - 3; index++) { sprintf_P (str_value, PSTR (";conso%u"), index + 1); strlcat (str_line, str_value, sizeof (str_line)); }
+  WSContentSend_P (PSTR ("%s;solar;forecast\n000000000000"), str_line);
+  for (index = 0; index < status.counter_qty; index++)
+  {
+    arr_counter[index] = status.arr_first[index];
+    lltoa (arr_counter[index], str_value, 10);
+    WSContentSend_P (PSTR (";%s"), str_value);
+  }
+  WSContentSend_P (PSTR ("\n"));
+
+  // hourly lines, counters rebuilt from record deltas
+  file.seek (HISTO_BIN_RECORD_OFFSET);
+  for (record = 0; record < status.nb_record; record++)
+  {
+    if (file.read ((uint8_t*)&line, sizeof (line)) != sizeof (line)) break;
+    if (file.read ((uint8_t*)arr_delta, status.counter_qty * sizeof (int32_t)) != status.counter_qty * sizeof (int32_t)) break;
+    sprintf_P (str_line, PSTR ("%03u%02u%u%02u%02u%02u"), line.day, line.week, line.dow, line.month, line.dom, line.hour);
+    for (index = 0; index < status.counter_qty; index++)
+    {
+      arr_counter[index] += arr_delta[index];
+      lltoa (arr_counter[index], str_value, 10);
+      strlcat (str_line, ";", sizeof (str_line));
+      strlcat (str_line, str_value, sizeof (str_line));
+    }
+    WSContentSend_P (PSTR ("%s\n"), str_line);
+  }
+  file.close ();
+
+  // end of CSV file
+  WSContentEnd ();
+}
+
 // Graph public page
 void TeleinfoHistoWebPage ()
 {
@@ -1335,6 +1801,10 @@ bool XdrvTeleinfoHisto (const uint32_t function)
       TeleinfoHistoSaveConfig ();
       break;
 
+    case FUNC_EVERY_250_MSECOND:
+      TeleinfoHistoMigrateStep ();
+      break;
+
     case FUNC_EVERY_SECOND:
       TeleinfoHistoEverySecond ();
       break;
@@ -1346,6 +1816,7 @@ bool XdrvTeleinfoHisto (const uint32_t function)
 
     case FUNC_WEB_ADD_HANDLER:
       Webserver->on (FPSTR (PSTR_PAGE_HISTO), TeleinfoHistoWebPage);
+      Webserver->on (FPSTR (PSTR_PAGE_HISTO_CSV), TeleinfoHistoWebCsv);
     break;
 #endif    // USE_WEBSERVER
   }
@@ -10,6 +10,10 @@
     20/06/2024 v1.2 - Add meter serial number and global conso counter
     10/07/2025 v2.0 - Refactoring based on Tasmota 15
     07/09/2025 v2.1 - Limit publications to 1 per sec.
+    16/10/2026 v2.2 - Publish thru driver scheduler (data as live or totals, declaration as discovery)
+                      Restart declaration on contract change
+    16/10/2026 v2.3 - Own publication budget of 1 message per sec.
+                      Data cursor wraps around, so new data does not restart publication
                        
   Configuration values are stored in :
     - Settings->rf_code[16][1]  : Flag en enable/disable integration
@@ -34,7 +38,6 @@
  *               Variables
 \*************************************************/
 
-#define TELEINFO_HOMIE_NB_MESSAGE    5
 
 static const char PSTR_HOMIE_URL_CONNECT[]         PROGMEM = "|/$homie" "|/$name"       "|/$state" "|/$nodes" "|END";
 static const char PSTR_HOMIE_URL_DISCONNECT[]      PROGMEM = "|/$state" "|END";
@@ -151,13 +154,19 @@ void TeleinfoHomieSet (const bool enabled)
   if (!enabled) TeleinfoHomiePublishStage (TIC_PUB_DISCONNECT);
 
   // reset publication flags
+  TeleinfoHomieRestart ();
+
+  // save configuration
+  TeleinfoHomieSaveConfig ();
+}
+
+// restart declaration publication (contract may have changed)
+void TeleinfoHomieRestart () 
+{
   teleinfo_homie.stage     = TIC_PUB_CONNECT; 
   teleinfo_homie.sub_stage = 0; 
   teleinfo_homie.sub_step  = 1; 
   teleinfo_homie.data      = 0; 
-
-  // save configuration
-  TeleinfoHomieSaveConfig ();
 }
 
 // get integration
@@ -188,78 +197,106 @@ void TeleinfoHomieInit ()
   // load config
   TeleinfoHomieLoadConfig ();
 
+  // register to publication scheduler
+  TeleinfoSchedulerRegister (TIC_PRODUCER_HOMIE, TeleinfoHomiePubPending, TeleinfoHomiePubPublish);
+
   // log help command
   AddLog (LOG_LEVEL_INFO, PSTR ("HLP: Run homie to set Homie auto-discovery [%u]"), teleinfo_homie.enabled);
 }
 
-// trigger publication
-void TeleinfoHomieEvery100ms ()
+// scheduler : priority of next message
+uint8_t TeleinfoHomiePubPending (uint16_t &backlog)
 {
-  // check publication validity
-  if (!teleinfo_homie.enabled) return;
-  if (teleinfo_homie.data == UINT8_MAX) return;
+  uint8_t index, count, first;
+
+  // if on battery, no publication of persistent data
+  if (TeleinfoDriverIsOnBattery ()) teleinfo_homie.stage = UINT8_MAX;
+
+  // check publication validity 
+  if (!teleinfo_homie.enabled) return TIC_PRIO_MAX;
 
-  // do not publish value before end of auto-discovery declaration
-  if (teleinfo_homie.stage != UINT8_MAX) return;
+  // auto-discovery declaration
+  if (teleinfo_homie.stage != UINT8_MAX)
+  {
+    if (!MqttIsConnected ()) return TIC_PRIO_MAX;
+    backlog = TIC_PUB_END - teleinfo_homie.stage;
+    return TIC_PRIO_DISCOVERY;
+  }
 
-  // check query timestamp
-  if (!TeleinfoDriverWebAllow (TIC_WEB_MQTT)) return; 
+  // data publication, from cursor with wrap around
+  if (teleinfo_homie.data >= TIC_PUB_END) teleinfo_homie.data = 0;
+  first   = UINT8_MAX;
+  backlog = 0;
+  for (count = 0; count < TIC_PUB_END; count ++)
+  {
+    index = (teleinfo_homie.data + count) % TIC_PUB_END;
+    if (!teleinfo_homie.arr_data[index]) continue;
+    if (first == UINT8_MAX) first = index;
+    backlog++;
+  }
 
-  // publish current data
-  if (TeleinfoHomiePublishStage (teleinfo_homie.data)) teleinfo_homie.data++;
-  if (teleinfo_homie.data >= TIC_PUB_END) teleinfo_homie.data = UINT8_MAX;
+  // nothing left to publish
+  if (backlog == 0) return TIC_PRIO_MAX;
+
+  // totals have lower priority than live data
+  if ((first >= TIC_PUB_TOTAL) && (first < TIC_PUB_ALERT)) return TIC_PRIO_TOTAL;
+    else return TIC_PRIO_LIVE;
 }
 
-// trigger publication
-void TeleinfoHomieEvery250ms ()
+// scheduler : publish next message
+bool TeleinfoHomiePubPublish ()
 {
-  bool result;
-
-  // if on battery, no publication of persistent data
-  if (TeleinfoDriverIsOnBattery ()) teleinfo_homie.stage = UINT8_MAX;
+  bool    published = false;
+  uint8_t count;
 
-  // check publication validity 
-  if (!teleinfo_homie.enabled) return;
-  if (teleinfo_homie.stage == UINT8_MAX) return;
-//  if (!RtcTime.valid) return;
-  if (!MqttIsConnected ()) return;
+  // auto-discovery declaration : publish next step, else switch to next stage
+  while (!published && (teleinfo_homie.stage != UINT8_MAX))
+  {
+    published = TeleinfoHomiePublishSubStage (teleinfo_homie.stage, teleinfo_homie.sub_stage, teleinfo_homie.sub_step);
+    if (published) teleinfo_homie.sub_step++;
+      else TeleinfoHomieNextStage ();
+  }
+  if (published) return true;
 
-  // check query timestamp
-  if (!TeleinfoDriverWebAllow (TIC_WEB_MQTT)) return; 
+  // data : publish next pending value, from cursor with wrap around
+  for (count = 0; !published && (count <= TIC_PUB_END); count ++)
+  {
+    if (teleinfo_homie.data >= TIC_PUB_END) teleinfo_homie.data = 0;
+    published = (teleinfo_homie.arr_data[teleinfo_homie.data] != 0);
+    if (TeleinfoHomiePublishStage (teleinfo_homie.data)) teleinfo_homie.data++;
+  }
 
-  // publish current data
-  result = TeleinfoHomiePublishSubStage (teleinfo_homie.stage, teleinfo_homie.sub_stage, teleinfo_homie.sub_step);
+  return published;
+}
 
-  // if publication done, increase step within stage, else increase stage
-  if (result) teleinfo_homie.sub_step++;
-  else 
+// switch auto-discovery declaration to next stage
+void TeleinfoHomieNextStage ()
+{
+  // reset step
+  teleinfo_homie.sub_step = 1;
+
+  // handle increment
+  if ((teleinfo_homie.stage == TIC_PUB_RELAY_DATA) || (teleinfo_homie.stage == TIC_PUB_TOTAL_INDEX)) teleinfo_homie.sub_stage++;
+    else teleinfo_homie.stage++;
+  if ((teleinfo_homie.stage == TIC_PUB_RELAY_DATA) && (teleinfo_homie.sub_stage >= 8)) teleinfo_homie.stage++;
+  if ((teleinfo_homie.stage == TIC_PUB_TOTAL_INDEX) && (teleinfo_homie.sub_stage >= teleinfo_contract_db.period_qty)) teleinfo_homie.stage++;
+  if ((teleinfo_homie.stage != TIC_PUB_RELAY_DATA) && (teleinfo_homie.stage != TIC_PUB_TOTAL_INDEX)) teleinfo_homie.sub_stage = 0; 
+
+  // handle data publication
+  if ((teleinfo_homie.stage == TIC_PUB_CALENDAR)    && !teleinfo_config.calendar)                        teleinfo_homie.stage = TIC_PUB_PROD;
+  if ((teleinfo_homie.stage == TIC_PUB_PROD)        && !teleinfo_config.meter)                           teleinfo_homie.stage = TIC_PUB_RELAY;
+  if ((teleinfo_homie.stage == TIC_PUB_PROD)        && (!teleinfo_prod.enabled && !teleinfo_prod.cacsi)) teleinfo_homie.stage = TIC_PUB_CONSO;
+  if ((teleinfo_homie.stage == TIC_PUB_PROD_W)      && !teleinfo_prod.enabled)                           teleinfo_homie.stage = TIC_PUB_CONSO;
+  if ((teleinfo_homie.stage == TIC_PUB_CONSO)       && !teleinfo_conso.enabled)                          teleinfo_homie.stage = TIC_PUB_RELAY;
+  if ((teleinfo_homie.stage == TIC_PUB_PH1)         && (teleinfo_contract.phase == 1))                   teleinfo_homie.stage = TIC_PUB_RELAY;
+  if ((teleinfo_homie.stage == TIC_PUB_RELAY)       && !teleinfo_config.relay)                           teleinfo_homie.stage = TIC_PUB_TOTAL;
+  if ((teleinfo_homie.stage == TIC_PUB_TOTAL)       && !teleinfo_config.meter)                           teleinfo_homie.stage = TIC_PUB_ALERT;
+  if ((teleinfo_homie.stage == TIC_PUB_TOTAL_PROD)  && !teleinfo_prod.enabled)                           teleinfo_homie.stage = TIC_PUB_TOTAL_CONSO;
+  if ((teleinfo_homie.stage == TIC_PUB_TOTAL_CONSO) && !teleinfo_conso.enabled)                          teleinfo_homie.stage = TIC_PUB_ALERT;
+  if  (teleinfo_homie.stage == TIC_PUB_END)
   {
-    // reset step
-    teleinfo_homie.sub_step = 1;
-
-    // handle increment
-    if ((teleinfo_homie.stage == TIC_PUB_RELAY_DATA) || (teleinfo_homie.stage == TIC_PUB_TOTAL_INDEX)) teleinfo_homie.sub_stage++;
-      else teleinfo_homie.stage++;
-    if ((teleinfo_homie.stage == TIC_PUB_RELAY_DATA) && (teleinfo_homie.sub_stage >= 8)) teleinfo_homie.stage++;
-    if ((teleinfo_homie.stage == TIC_PUB_TOTAL_INDEX) && (teleinfo_homie.sub_stage >= teleinfo_contract_db.period_qty)) teleinfo_homie.stage++;
-    if ((teleinfo_homie.stage != TIC_PUB_RELAY_DATA) && (teleinfo_homie.stage != TIC_PUB_TOTAL_INDEX)) teleinfo_homie.sub_stage = 0; 
-
-    // handle data publication
-    if ((teleinfo_homie.stage == TIC_PUB_CALENDAR)    && !teleinfo_config.calendar)                        teleinfo_homie.stage = TIC_PUB_PROD;
-    if ((teleinfo_homie.stage == TIC_PUB_PROD)        && !teleinfo_config.meter)                           teleinfo_homie.stage = TIC_PUB_RELAY;
-    if ((teleinfo_homie.stage == TIC_PUB_PROD)        && (!teleinfo_prod.enabled && !teleinfo_prod.cacsi)) teleinfo_homie.stage = TIC_PUB_CONSO;
-    if ((teleinfo_homie.stage == TIC_PUB_PROD_W)      && !teleinfo_prod.enabled)                           teleinfo_homie.stage = TIC_PUB_CONSO;
-    if ((teleinfo_homie.stage == TIC_PUB_CONSO)       && !teleinfo_conso.enabled)                          teleinfo_homie.stage = TIC_PUB_RELAY;
-    if ((teleinfo_homie.stage == TIC_PUB_PH1)         && (teleinfo_contract.phase == 1))                   teleinfo_homie.stage = TIC_PUB_RELAY;
-    if ((teleinfo_homie.stage == TIC_PUB_RELAY)       && !teleinfo_config.relay)                           teleinfo_homie.stage = TIC_PUB_TOTAL;
-    if ((teleinfo_homie.stage == TIC_PUB_TOTAL)       && !teleinfo_config.meter)                           teleinfo_homie.stage = TIC_PUB_ALERT;
-    if ((teleinfo_homie.stage == TIC_PUB_TOTAL_PROD)  && !teleinfo_prod.enabled)                           teleinfo_homie.stage = TIC_PUB_TOTAL_CONSO;
-    if ((teleinfo_homie.stage == TIC_PUB_TOTAL_CONSO) && !teleinfo_conso.enabled)                          teleinfo_homie.stage = TIC_PUB_ALERT;
-    if  (teleinfo_homie.stage == TIC_PUB_END)
-    {
-      teleinfo_homie.stage     = UINT8_MAX;
-      teleinfo_homie.sub_stage = 0;
-    }
+    teleinfo_homie.stage     = UINT8_MAX;
+    teleinfo_homie.sub_stage = 0;
   }
 }
 
@@ -318,9 +355,6 @@ void TeleinfoHomieDataConsoProd ()
 {
   uint8_t index;
 
-  // ask for data publication
-  teleinfo_homie.data = 0;
-
   // conso
   if (teleinfo_conso.enabled)
   {
@@ -354,9 +388,6 @@ void TeleinfoHomieDataCalendar ()
 {
   uint8_t index;
 
-  // ask for data publication
-  teleinfo_homie.data = 0;
-
   // calendar data
   for (index = TIC_PUB_CALENDAR_PERIOD; index <= TIC_PUB_CALENDAR_TOMRW; index++) teleinfo_homie.arr_data[index] = 1;
 }
@@ -631,13 +662,6 @@ bool XdrvTeleinfoHomie (const uint32_t function)
       TeleinfoHomieInit ();
       break;
 
-    case FUNC_EVERY_100_MSECOND:
-      TeleinfoHomieEvery100ms ();
-      break;
-
-    case FUNC_EVERY_250_MSECOND:
-      TeleinfoHomieEvery250ms ();
-      break;
   }
 
   return result;
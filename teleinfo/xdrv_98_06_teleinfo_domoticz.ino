@@ -13,6 +13,7 @@
     10/07/2025 v2.0 - Refactoring based on Tasmota 15
     07/09/2025 v2.1 - Limit publications to 1 per sec.
     17/03/2026 v2.2 - Publish production excess for CACSI contract
+    16/10/2026 v2.3 - Publish thru driver scheduler (live data priority)
 
   Configuration values are stored in :
 
@@ -42,7 +43,6 @@
  *               Variables
 \*******************************************/
 
-#define TELEINFO_DOMOTICZ_NB_MESSAGE    5
 
 // Data type
 enum DomoticzDataType { DOMO_DATA_METER_BLUE, DOMO_DATA_METER_WHITE, DOMO_DATA_METER_RED, 
@@ -237,24 +237,35 @@ void TeleinfoDomoticzInit ()
 {
   // load config
   TeleinfoDomoticzLoadConfig ();
+
+  // register to publication scheduler
+  TeleinfoSchedulerRegister (TIC_PRODUCER_DOMOTICZ, TeleinfoDomoticzPubPending, TeleinfoDomoticzPubPublish);
   
   // log help command
   AddLog (LOG_LEVEL_INFO, PSTR ("HLP: Run domo to get help on Domoticz integration"));
 }
 
-// called 10 times per second
-void TeleinfoDomoticzEvery250ms ()
+// scheduler : priority of next message
+uint8_t TeleinfoDomoticzPubPending (uint16_t &backlog)
 {
   // check if enabled
-//  if (!RtcTime.valid) return;
-  if (!teleinfo_domoticz.enabled) return;
-  if (!MqttIsConnected ()) return;
+  if (!teleinfo_domoticz.enabled) return TIC_PRIO_MAX;
+  if (!MqttIsConnected ()) return TIC_PRIO_MAX;
+
+  // check if something to publish
+  if (teleinfo_contract.period == UINT8_MAX) return TIC_PRIO_MAX;
+  if (teleinfo_domoticz.index >= DOMO_DATA_MAX) return TIC_PRIO_MAX;
+
+  backlog = DOMO_DATA_MAX - teleinfo_domoticz.index;
+  return TIC_PRIO_LIVE;
+}
 
-  // check query timestamp
-  if (!TeleinfoDriverWebAllow (TIC_WEB_MQTT)) return;  
+// scheduler : publish next pending data
+bool TeleinfoDomoticzPubPublish ()
+{
+  TeleinfoDomoticzPublishNext ();
 
-  // publish if needed
-  if (teleinfo_domoticz.index < DOMO_DATA_MAX) TeleinfoDomoticzPublishNext ();
+  return (ResponseLength () > 0);
 }
 
 /***************************************\
@@ -488,10 +499,6 @@ bool XdrvTeleinfoDomoticz (const uint32_t function)
     case FUNC_INIT:
       TeleinfoDomoticzInit ();
       break;
-
-    case FUNC_EVERY_250_MSECOND:
-      TeleinfoDomoticzEvery250ms ();
-      break;
   }
 
   return result;
@@ -19,10 +19,21 @@
     21/11/2025 v2.3 - Add volt and load ALERT
     29/11/2025 v2.4 - Handle suppression of retain data according to publication selection
     28/02/2026 v2.5 - Handle suppression of prod data according to production status
+    16/10/2026 v2.6 - Publish auto-discovery thru driver scheduler (lowest priority)
+                      Skip unchanged entities thru content hash cache (RTC memory and teleinfo-hass.dat)
+                      Restart auto-discovery on contract change
+    16/10/2026 v2.7 - Store entity hash only once publication has succeeded
+                      Limit number of entities rendered per scheduler tick
 
   Configuration values are stored in :
     - Settings->rf_code[16][0]  : Flag en enable/disable integration
 
+  A hash of every published entity configuration (topic and payload) is kept
+  in RTC memory and in /teleinfo-hass.dat. Only entities whose configuration
+  has changed are published again. A hash is stored only once its entity has
+  been sent to the broker, so a failed publication is retried on next pass.
+  Command hass_publish forces publication.
+
   This program is free software: you can redistribute it and/or modify
   it under the terms of the GNU General Public License as published by
   the Free Software Foundation, either version 3 of the License, or
@@ -43,7 +54,6 @@
  *               Variables
 \*************************************************/
 
-#define TELEINFO_HASS_NB_MESSAGE    5
 
 static const char HOMEASSISTANT_PUB_CONTRACT_NAME[]    PROGMEM = "Contrat"               "|CONTRACT_NAME"   "|.CONTRACT.name"     "|calendar"               "|"               "|"            "|";
 static const char HOMEASSISTANT_PUB_CONTRACT_SERIAL[]  PROGMEM = "N° série compteur"     "|CONTRACT_SERIAL" "|.CONTRACT.serial"   "|calendar"               "|"               "|"            "|";
@@ -117,6 +127,14 @@ static const char HOMEASSISTANT_PUB_RTE_POINTE_TOMRW[] PROGMEM = "Pointe Demain"
 
 static const char kTicHomeAssistantVersion[]        PROGMEM = EXTENSION_VERSION;
 
+// entities hash cache : one slot per stage, then relays, then contract indexes
+#define TIC_HASS_HASH_RELAY         TIC_PUB_END
+#define TIC_HASS_HASH_INDEX         (TIC_HASS_HASH_RELAY + 8)
+#define TIC_HASS_HASH_MAX           (TIC_HASS_HASH_INDEX + TIC_PERIOD_MAX)
+#define TIC_HASS_CACHE_MAGIC        (0x48415300 + TIC_HASS_HASH_MAX)          // 'HAS' + number of slots
+#define TIC_HASS_RENDER_MAX         8                                         // maximum entities rendered per scheduler tick
+static const char PSTR_HASS_CACHE_FILE[]           PROGMEM = "/teleinfo-hass.dat";
+
 // Commands
 static const char kTeleinfoHomeAsssistantCommands[] PROGMEM = "hass|"      ""                  "|"           "_publish";
 void (* const TeleinfoHomeAssistantCommand[])(void) PROGMEM = { &CmndTeleinfoHomeAssistantEnable, &CmndTeleinfoHomeAssistantPublish };
@@ -126,7 +144,11 @@ void (* const TeleinfoHomeAssistantCommand[])(void) PROGMEM = { &CmndTeleinfoHom
 \********************************/
 
 static struct {
-  bool enabled = false;                       // flag to enable integration
+  bool    enabled    = false;                 // flag to enable integration
+  bool    changed    = false;                 // hash cache has changed since last save
+  uint8_t nb_publish = 0;                     // number of published entities during current pass
+  uint8_t nb_skip    = 0;                     // number of unchanged entities during current pass
+  uint8_t nb_error   = 0;                     // number of failed publications during current pass
 } teleinfo_hass;
 
 #ifdef ESP32
@@ -134,8 +156,10 @@ RTC_DATA_ATTR struct {                        // data in NVRAM to survive deepsl
 #else
 static struct {                               // data in normal RAM
 #endif // ESP32
-  uint8_t stage;                              // auto-discovery publication stage
-  uint8_t sub_stage;                          // auto-discovery publication sub-stage
+  uint8_t  stage;                             // auto-discovery publication stage
+  uint8_t  sub_stage;                         // auto-discovery publication sub-stage
+  uint32_t magic;                             // hash cache validity
+  uint32_t arr_hash[TIC_HASS_HASH_MAX];       // hash of last published configuration per entity
 } teleinfo_hass_sleep;
 
 /**********************************************\
@@ -169,9 +193,8 @@ void CmndTeleinfoHomeAssistantEnable ()
 // Publish home assistant retain data
 void CmndTeleinfoHomeAssistantPublish ()
 {
-  // reset publication flags
-  teleinfo_hass_sleep.stage     = TIC_PUB_CONNECT; 
-  teleinfo_hass_sleep.sub_stage = 0; 
+  // restart complete publication
+  TeleinfoHomeAssistantRestart ();
 
   // answer
   ResponseCmndDone ();
@@ -181,6 +204,111 @@ void CmndTeleinfoHomeAssistantPublish ()
  *               Function
 \***************************************/
 
+// forget all published configurations
+void TeleinfoHomeAssistantCacheClear ()
+{
+  memset (teleinfo_hass_sleep.arr_hash, 0, sizeof (teleinfo_hass_sleep.arr_hash));
+  teleinfo_hass_sleep.magic = TIC_HASS_CACHE_MAGIC;
+  teleinfo_hass.changed = true;
+}
+
+// load hash cache (kept in RTC memory thru deepsleep, else read from file)
+void TeleinfoHomeAssistantCacheLoad ()
+{
+  // if RTC memory is valid, nothing to do
+  if (teleinfo_hass_sleep.magic == TIC_HASS_CACHE_MAGIC) return;
+
+  // init cache
+  TeleinfoHomeAssistantCacheClear ();
+  teleinfo_hass.changed = false;
+
+#ifdef USE_UFILESYS
+  uint32_t magic = 0;
+  char     str_filename[24];
+  File     file;
+
+  // read cache file
+  strcpy_P (str_filename, PSTR_HASS_CACHE_FILE);
+  if ((ffsp == nullptr) || !ffsp->exists (str_filename)) return;
+  file = ffsp->open (str_filename, "r");
+  file.read ((uint8_t*)&magic, sizeof (magic));
+  if (magic == TIC_HASS_CACHE_MAGIC) file.read ((uint8_t*)teleinfo_hass_sleep.arr_hash, sizeof (teleinfo_hass_sleep.arr_hash));
+  file.close ();
+#endif    // USE_UFILESYS
+}
+
+// save hash cache if it has changed
+void TeleinfoHomeAssistantCacheSave ()
+{
+  if (!teleinfo_hass.changed) return;
+  teleinfo_hass.changed = false;
+
+#ifdef USE_UFILESYS
+  uint32_t magic = TIC_HASS_CACHE_MAGIC;
+  char     str_filename[24];
+  File     file;
+
+  // write cache file
+  if (ffsp == nullptr) return;
+  strcpy_P (str_filename, PSTR_HASS_CACHE_FILE);
+  file = ffsp->open (str_filename, "w");
+  if (file > 0)
+  {
+    file.write ((uint8_t*)&magic, sizeof (magic));
+    file.write ((uint8_t*)teleinfo_hass_sleep.arr_hash, sizeof (teleinfo_hass_sleep.arr_hash));
+    file.close ();
+  }
+#endif    // USE_UFILESYS
+}
+
+// get cache slot of an entity
+uint8_t TeleinfoHomeAssistantCacheSlot (const uint8_t stage, const uint8_t index)
+{
+  if (stage == TIC_PUB_RELAY_DATA) return TIC_HASS_HASH_RELAY + index;
+  else if (stage == TIC_PUB_TOTAL_INDEX) return TIC_HASS_HASH_INDEX + index;
+  else return stage;
+}
+
+// calculate hash of entity configuration (topic and current response)
+uint32_t TeleinfoHomeAssistantCacheHash (const char *pstr_topic)
+{
+  uint32_t    hash = 2166136261UL;
+  const char *pstr_data;
+
+  // FNV-1a hash of payload and topic
+  for (pstr_data = ResponseData (); *pstr_data != 0; pstr_data++) hash = (hash ^ (uint8_t)*pstr_data) * 16777619UL;
+  for (pstr_data = pstr_topic; *pstr_data != 0; pstr_data++) hash = (hash ^ (uint8_t)*pstr_data) * 16777619UL;
+  if (hash == 0) hash = 1;
+
+  return hash;
+}
+
+// check if entity configuration has changed since last publication
+bool TeleinfoHomeAssistantCacheChanged (const uint8_t slot, const uint32_t hash)
+{
+  if (slot >= TIC_HASS_HASH_MAX) return true;
+  return (teleinfo_hass_sleep.arr_hash[slot] != hash);
+}
+
+// store hash of published entity configuration
+void TeleinfoHomeAssistantCacheStore (const uint8_t slot, const uint32_t hash)
+{
+  if (slot >= TIC_HASS_HASH_MAX) return;
+  teleinfo_hass_sleep.arr_hash[slot] = hash;
+  teleinfo_hass.changed = true;
+}
+
+// restart complete auto-discovery publication (contract may have changed)
+void TeleinfoHomeAssistantRestart ()
+{
+  // forget published configurations
+  TeleinfoHomeAssistantCacheClear ();
+
+  // reset publication flags
+  teleinfo_hass_sleep.stage     = TIC_PUB_CONNECT; 
+  teleinfo_hass_sleep.sub_stage = 0; 
+}
+
 // set integration
 void TeleinfoHomeAssistantSet (const bool enabled) 
 {
@@ -201,19 +329,29 @@ bool TeleinfoHomeAssistantGet ()
   return teleinfo_hass.enabled;
 }
 
-// puslish next home assistant integration message
-void TeleinfoHomeAssistantPublishNextRetain ()
+// puslish next home assistant integration message (return true if a message has been published)
+bool TeleinfoHomeAssistantPublishNextRetain ()
 {
+  bool published;
+
   // if not connected or no message received, ignore 
-  if (!MqttIsConnected ()) return;
-  if (teleinfo_meter.nb_message == 0) return;
+  if (!MqttIsConnected ()) return false;
+  if (teleinfo_meter.nb_message == 0) return false;
 
   // if disabled or already published, ignore 
   if (!teleinfo_hass.enabled) teleinfo_hass_sleep.stage = UINT8_MAX;
-  if (teleinfo_hass_sleep.stage == UINT8_MAX) return;
+  if (teleinfo_hass_sleep.stage == UINT8_MAX) return false;
+
+  // start of publication pass
+  if ((teleinfo_hass_sleep.stage == TIC_PUB_CONNECT) && (teleinfo_hass_sleep.sub_stage == 0))
+  {
+    teleinfo_hass.nb_publish = 0;
+    teleinfo_hass.nb_skip    = 0;
+    teleinfo_hass.nb_error   = 0;
+  }
 
   // publish current integration message
-  TeleinfoHomeAssistantPublish (teleinfo_hass_sleep.stage, teleinfo_hass_sleep.sub_stage);
+  published = TeleinfoHomeAssistantPublish (teleinfo_hass_sleep.stage, teleinfo_hass_sleep.sub_stage);
 
   // calculate next stage or sub-stage increment
   if ((teleinfo_hass_sleep.stage == TIC_PUB_RELAY_DATA)  || (teleinfo_hass_sleep.stage == TIC_PUB_TOTAL_INDEX) ) teleinfo_hass_sleep.sub_stage++;
@@ -221,7 +359,16 @@ void TeleinfoHomeAssistantPublishNextRetain ()
   if ((teleinfo_hass_sleep.stage == TIC_PUB_RELAY_DATA)  && (teleinfo_hass_sleep.sub_stage >= 8)               ) teleinfo_hass_sleep.stage++;
   if ((teleinfo_hass_sleep.stage == TIC_PUB_TOTAL_INDEX) && (teleinfo_hass_sleep.sub_stage >= teleinfo_contract_db.period_qty)) teleinfo_hass_sleep.stage++;
   if ((teleinfo_hass_sleep.stage != TIC_PUB_RELAY_DATA)  && (teleinfo_hass_sleep.stage != TIC_PUB_TOTAL_INDEX) ) teleinfo_hass_sleep.sub_stage = 0; 
-  if (teleinfo_hass_sleep.stage == TIC_PUB_END) teleinfo_hass_sleep.stage = UINT8_MAX;
+
+  // end of publication pass, save hash cache
+  if (teleinfo_hass_sleep.stage == TIC_PUB_END)
+  {
+    teleinfo_hass_sleep.stage = UINT8_MAX;
+    TeleinfoHomeAssistantCacheSave ();
+    AddLog (LOG_LEVEL_DEBUG, PSTR ("TIC: Auto-discovery Home Assistant, %u publiés, %u inchangés, %u en erreur"), teleinfo_hass.nb_publish, teleinfo_hass.nb_skip, teleinfo_hass.nb_error);
+  }
+
+  return published;
 }
 
 /*******************************\
@@ -230,33 +377,59 @@ void TeleinfoHomeAssistantPublishNextRetain ()
 
 void TeleinfoHomeAssistantInit ()
 {
-  // load config
+  // load config and hash cache
   TeleinfoHomeAssistantLoadConfig ();
+  TeleinfoHomeAssistantCacheLoad ();
+
+  // register to publication scheduler
+  TeleinfoSchedulerRegister (TIC_PRODUCER_HASS, TeleinfoHomeAssistantPubPending, TeleinfoHomeAssistantPubPublish);
 
   // log help command
   AddLog (LOG_LEVEL_INFO, PSTR ("HLP: Run hass <0/1> to disable/enable Home Assistant auto-discovery"));
   AddLog (LOG_LEVEL_INFO, PSTR ("HLP: Run hass_publish to force auto_discovery publication"));
 }
 
-// trigger publication
-void TeleinfoHomeAssistantEvery250ms ()
+// scheduler : priority of next message
+uint8_t TeleinfoHomeAssistantPubPending (uint16_t &backlog)
 {
-  // if already published, not connected or no message received, ignore 
-  if (teleinfo_hass_sleep.stage == UINT8_MAX) return;
-  if (!TeleinfoDriverWebAllow (TIC_WEB_MQTT)) return;
+  // if disabled, already published, not connected or no message received, ignore 
+  if (!teleinfo_hass.enabled) teleinfo_hass_sleep.stage = UINT8_MAX;
+  if (teleinfo_hass_sleep.stage == UINT8_MAX) return TIC_PRIO_MAX;
+  if (!MqttIsConnected ()) return TIC_PRIO_MAX;
+  if (teleinfo_meter.nb_message == 0) return TIC_PRIO_MAX;
 
-  // publish next home assistant integration message
-  TeleinfoHomeAssistantPublishNextRetain ();
+  // auto-discovery declaration
+  backlog = TIC_PUB_END - teleinfo_hass_sleep.stage;
+  return TIC_PRIO_DISCOVERY;
+}
+
+// scheduler : publish next changed home assistant integration message
+bool TeleinfoHomeAssistantPubPublish ()
+{
+  bool    published = false;
+  uint8_t count     = 0;
+
+  // loop thru unchanged entities till one is published (limited number of entities rendered per tick)
+  while (!published && (count < TIC_HASS_RENDER_MAX) && (teleinfo_hass_sleep.stage != UINT8_MAX) && MqttIsConnected () && (teleinfo_meter.nb_message > 0))
+  {
+    published = TeleinfoHomeAssistantPublishNextRetain ();
+    count++;
+  }
+
+  return published;
 }
 
 /***************************************\
  *           JSON publication
 \***************************************/
 
-void TeleinfoHomeAssistantPublish (const uint8_t stage, const uint8_t index)
+// publish entity configuration (return true if published, false if unchanged, not handled or failed)
+bool TeleinfoHomeAssistantPublish (const uint8_t stage, const uint8_t index)
 {
-  bool        publish = true;
-  uint32_t    ip_address;
+  bool        publish   = true;
+  bool        published = false;
+  uint8_t     slot;
+  uint32_t    hash, ip_address;
   const char* pstr_param = nullptr;
   char        str_text1[32];
   char        str_text2[128];
@@ -266,9 +439,9 @@ void TeleinfoHomeAssistantPublish (const uint8_t stage, const uint8_t index)
   char        str_icon[24];
 
   // check parameters
-  if (stage >= TIC_PUB_END) return;
-  if ((stage == TIC_PUB_RELAY_DATA) && (index >= 8)) return;
-  if ((stage == TIC_PUB_TOTAL_INDEX) && (index >= TIC_PERIOD_MAX)) return;
+  if (stage >= TIC_PUB_END) return false;
+  if ((stage == TIC_PUB_RELAY_DATA) && (index >= 8)) return false;
+  if ((stage == TIC_PUB_TOTAL_INDEX) && (index >= TIC_PERIOD_MAX)) return false;
 
   // init
   strcpy_P (str_text1, PSTR (""));
@@ -432,12 +605,25 @@ void TeleinfoHomeAssistantPublish (const uint8_t stage, const uint8_t index)
     strlcat  (str_text2, str_id, sizeof (str_text2));
     strcat_P (str_text2, PSTR ("/config"));
 
-    // publish sensor topic
-    MqttPublish (str_text2, true);
+    // if configuration is unchanged since last publication, skip
+    slot = TeleinfoHomeAssistantCacheSlot (stage, index);
+    hash = TeleinfoHomeAssistantCacheHash (str_text2);
+    if (!TeleinfoHomeAssistantCacheChanged (slot, hash)) teleinfo_hass.nb_skip++;
+
+    // else publish sensor topic, and store hash only if sent to broker
+    else if (MqttPublishLib (str_text2, (const uint8_t*)ResponseData (), ResponseLength (), true))
+    {
+      TeleinfoHomeAssistantCacheStore (slot, hash);
+      teleinfo_hass.nb_publish++;
+      published = true;
 
-    // declare publication
-    TeleinfoDriverWebDeclare (TIC_WEB_MQTT);
+      // declare publication
+      TeleinfoDriverWebDeclare (TIC_WEB_MQTT);
+    }
+    else teleinfo_hass.nb_error++;
   }
+
+  return published;
 }
 
 /***************************************\
@@ -458,10 +644,6 @@ bool XdrvTeleinfoHomeAssistant (const uint32_t function)
     case FUNC_INIT:
       TeleinfoHomeAssistantInit ();
       break;
-
-    case FUNC_EVERY_250_MSECOND:
-      TeleinfoHomeAssistantEvery250ms ();
-      break;
   }
 
   return result;
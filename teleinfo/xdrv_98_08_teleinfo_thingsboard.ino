@@ -11,6 +11,7 @@
     25/08/2025 v2.1 - Add PAVG (production average active power) and PR (production relay)
     07/09/2025 v2.2 - Limit publications to 1 per sec.
     17/03/2026 v2.3 - Publish production excess for CACSI contract
+    16/10/2026 v2.4 - Publish thru driver scheduler (telemetry as live data, attributes as discovery)
                         
   Configuration values are stored in :
     - Settings->rf_code[16][3]  : Flag en enable/disable integration
@@ -33,7 +34,6 @@
  *               Variables
 \*************************************************/
 
-#define TELEINFO_THINGSBOARD_NB_MESSAGE    5
 
 // Commands
 const char kTeleinfoThingsboardCommands[]         PROGMEM =   "|"     "thingsboard";
@@ -107,22 +107,36 @@ void TeleinfoThingsboardInit ()
   // load config
   TeleinfoThingsboardLoadConfig ();
 
+  // register to publication scheduler
+  TeleinfoSchedulerRegister (TIC_PRODUCER_THINGSBOARD, TeleinfoThingsboardPubPending, TeleinfoThingsboardPubPublish);
+
   // log help command
   AddLog (LOG_LEVEL_INFO, PSTR ("HLP: Run thingsboard <0/1> to set ThingsBoard publication"));
 }
 
-// trigger publication
-void TeleinfoThingsboardEvery250ms ()
+// scheduler : priority of next message
+uint8_t TeleinfoThingsboardPubPending (uint16_t &backlog)
 {
   // check publication validity 
-  if (!teleinfo_thingsboard.enabled) return;
-//  if (!RtcTime.valid) return;
-  if (!MqttIsConnected ()) return;
+  if (!teleinfo_thingsboard.enabled) return TIC_PRIO_MAX;
+//  if (!RtcTime.valid) return TIC_PRIO_MAX;
+  if (!MqttIsConnected ()) return TIC_PRIO_MAX;
+
+  // telemetry first, then attributes
+  backlog = (uint16_t)teleinfo_thingsboard.pub_data + (uint16_t)teleinfo_thingsboard.pub_attr;
+  if (teleinfo_thingsboard.pub_data) return TIC_PRIO_LIVE;
+  else if (teleinfo_thingsboard.pub_attr) return TIC_PRIO_DISCOVERY;
+  else return TIC_PRIO_MAX;
+}
 
-  // check query timestamp and publish current data if needed
-  if (!TeleinfoDriverWebAllow (TIC_WEB_MQTT)) return;
-  else if (teleinfo_thingsboard.pub_data) TeleinfoThingsboardPublishData ();
+// scheduler : publish current data or attributes
+bool TeleinfoThingsboardPubPublish ()
+{
+  if (teleinfo_thingsboard.pub_data) TeleinfoThingsboardPublishData ();
   else if (teleinfo_thingsboard.pub_attr) TeleinfoThingsboardPublishAttribute ();
+  else return false;
+
+  return true;
 }
 
 // publish current data
@@ -325,10 +339,6 @@ bool XdrvTeleinfoThingsboard (const uint32_t function)
     case FUNC_INIT:
       TeleinfoThingsboardInit ();
       break;
-
-    case FUNC_EVERY_250_MSECOND:
-      TeleinfoThingsboardEvery250ms ();
-      break;
   }
 
   return result;
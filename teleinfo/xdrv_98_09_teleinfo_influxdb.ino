@@ -13,10 +13,20 @@
     07/09/2025 v2.1 - Limit publications to 1 per sec.
     26/12/2025 v2.2 - Add data to publication
     17/03/2026 v2.3 - Publish production excess for CACSI contract
+    16/10/2026 v2.4 - Timestamped points (precision=s) posted by batches thru driver request engine
+                      Buffer points in RAM during outage, spill to LittleFS when RAM buffer is full
 
   Configuration values are stored in :
 
-    - Settings->rf_code[16][5]              : Flag to enable/disable influxdb extension
+    - Settings->rf_code[16][5]              : bit 0    = flag to enable/disable influxdb extension
+                                              bit 1..7 = number of publications per batch - 1 (1..INFLUXDB_BATCH_MAX)
+                                              both values share the same byte, always update them together
+
+  Points are posted to http://host:port/api/v2/write?org=..&bucket=..&precision=s (v2)
+  or http://host:port/write?db=..&u=..&p=..&precision=s (v1), thru a kept-alive connexion.
+  Batches are posted uncompressed (no Content-Encoding: gzip), as a batch is at most
+  INFLUXDB_BATCH_SIZE bytes and Tasmota core has no deflate encoder.
+  Any HTTP server recording POST requests can stand in for InfluxDB (see tools/influx-standin).
 
   This program is free software: you can redistribute it and/or modify
   it under the terms of the GNU General Public License as published by
@@ -37,19 +47,43 @@
 // web URL
 #define INFLUXDB_PAGE_CFG           "/influx"
 
+// points buffer
+#define INFLUXDB_BATCH_MAX          60          // maximum number of publications per batch
+#define INFLUXDB_BATCH_SIZE         8192        // maximum size of a posted batch (bytes)
+#define INFLUXDB_RAM_SIZE           16384       // maximum size of points kept in RAM (bytes)
+#define INFLUXDB_SPILL_SIZE         262144      // maximum size of points spilled to LittleFS (bytes)
+#define INFLUXDB_FLUSH_TIMEOUT      300         // maximum age of buffered points before flush (sec.)
+#define INFLUXDB_DELAY_RETRY        10          // delay before retrying a failed batch (sec., with backoff)
+
+// spill file
+const char PSTR_INFLUXDB_SPILL_FILE[] PROGMEM = "/teleinfo-influx.dat";
+
 // Commands
-static const char kTeleinfoInfluxDbCommands[]  PROGMEM = "Ifx" "|"    "tic"          "|"           "ver";
-void (* const TeleinfoInfluxDbCommand[])(void) PROGMEM = { &CmndTeleinfoInfluxDbEnable, &CmndTeleinfoInfluxDbVersion };
+static const char kTeleinfoInfluxDbCommands[]  PROGMEM = "Ifx" "|"    "tic"          "|"           "ver"            "|"           "batch"        "|"           "stat";
+void (* const TeleinfoInfluxDbCommand[])(void) PROGMEM = { &CmndTeleinfoInfluxDbEnable, &CmndTeleinfoInfluxDbVersion, &CmndTeleinfoInfluxDbBatch, &CmndTeleinfoInfluxDbStat };
 
 /**************************************\
  *               Data
 \**************************************/
 
 static struct {
-  bool enabled = false;                  // flag to enable integration
-  bool ready   = false;                  // all data ready for publication
-  bool init    = false;                  // influxdb initialisation done
-  bool publish = false;                  // flag to publish data
+  bool     enabled     = false;          // flag to enable integration
+  bool     ready       = false;          // all data ready for publication
+  bool     publish     = false;          // flag to publish data
+  bool     spilled     = false;          // spill file holds points
+  bool     from_spill  = false;          // posted batch comes from spill file
+  uint8_t  batch       = 1;              // number of publications per batch
+  uint8_t  nb_sample   = 0;              // number of publications in RAM buffer
+  uint32_t time_oldest = 0;              // timestamp of oldest point in RAM buffer (sec.)
+  uint32_t time_retry  = 0;              // timestamp of next flush after a failure (sec.)
+  uint32_t spill_pos   = 0;              // read position in spill file
+  uint32_t sent_size   = 0;              // size of posted batch
+  uint32_t sent_point  = 0;              // number of points in posted batch
+  uint32_t nb_buffered = 0;              // number of points buffered
+  uint32_t nb_dropped  = 0;              // number of points dropped (buffers full)
+  uint32_t nb_flushed  = 0;              // number of points accepted by server
+  uint32_t nb_spilled  = 0;              // number of points spilled to LittleFS
+  String   str_buffer;                   // buffered points
 } teleinfo_influxdb;
 
 /**********************************************\
@@ -59,13 +93,14 @@ static struct {
 // load configuration
 void TeleinfoInfluxDbLoadConfig () 
 {
-  teleinfo_influxdb.enabled = (bool)Settings->rf_code[16][5];
+  teleinfo_influxdb.enabled = (bool)(Settings->rf_code[16][5] & 0x01);
+  teleinfo_influxdb.batch   = min (1 + (Settings->rf_code[16][5] >> 1), INFLUXDB_BATCH_MAX);
 }
 
 // save configuration
 void TeleinfoInfluxDbSaveConfig () 
 {
-  Settings->rf_code[16][5] = (uint8_t)teleinfo_influxdb.enabled;
+  Settings->rf_code[16][5] = (uint8_t)teleinfo_influxdb.enabled | ((teleinfo_influxdb.batch - 1) << 1);
 }
 
 /***************************************\
@@ -90,8 +125,7 @@ bool TeleinfoInfluxDbGet ()
 
 void TeleinfoInfluxDbData ()
 {
-  // check if enabled, ready and if there is conso or production 
-  if (TasmotaGlobal.global_state.network_down) return;
+  // check if enabled, ready and if there is conso or production (points are buffered if network is down)
   if (!teleinfo_influxdb.enabled) return;
   if (!teleinfo_influxdb.ready) return;
 
@@ -226,19 +260,78 @@ void TeleinfoInfluxDbAppendData ()
   }
 }
 
-void TeleinfoInfluxDbPublishAllData ()
+// count points (lines) of a block
+uint32_t TeleinfoInfluxDbCountPoints (const char *pstr_data, const size_t size)
 {
-  // if nothing to publish, ignore
-  if (TasmotaGlobal.global_state.network_down) return;
-  if (!teleinfo_influxdb.enabled) return;
-  if (!teleinfo_influxdb.ready) return;
+  size_t   index;
+  uint32_t count = 0;
+
+  for (index = 0; index < size; index ++) if (pstr_data[index] == '\n') count++;
+
+  return count;
+}
+
+// size of complete lines found in the first bytes of a block
+size_t TeleinfoInfluxDbLineBlock (const char *pstr_data, const size_t size, const size_t size_max)
+{
+  size_t length;
+
+  // cut after last complete line
+  for (length = min (size, size_max); length > 0; length --) if (pstr_data[length - 1] == '\n') break;
+
+  return length;
+}
+
+// move RAM buffer to spill file, or drop oldest points if not possible
+void TeleinfoInfluxDbSpill ()
+{
+  bool     is_ok = false;
+  size_t   length;
+  uint32_t count;
+  char     str_filename[24];
+  File     file;
+
+  // try to append RAM buffer to spill file
+  strcpy_P (str_filename, PSTR_INFLUXDB_SPILL_FILE);
+  if (ffsp != nullptr)
+  {
+    file = ffsp->open (str_filename, "a");
+    if (file)
+    {
+      if (file.size () + teleinfo_influxdb.str_buffer.length () <= INFLUXDB_SPILL_SIZE) is_ok = (file.write ((const uint8_t*)teleinfo_influxdb.str_buffer.c_str (), teleinfo_influxdb.str_buffer.length ()) == teleinfo_influxdb.str_buffer.length ());
+      file.close ();
+    }
+  }
+
+  // if spilled, empty RAM buffer
+  if (is_ok)
+  {
+    teleinfo_influxdb.spilled = true;
+    count = TeleinfoInfluxDbCountPoints (teleinfo_influxdb.str_buffer.c_str (), teleinfo_influxdb.str_buffer.length ());
+    teleinfo_influxdb.nb_spilled += count;
+    teleinfo_influxdb.str_buffer = "";
+    teleinfo_influxdb.nb_sample  = 0;
+    AddLog (LOG_LEVEL_DEBUG, PSTR ("IDB: %u points spilled to %s"), count, str_filename);
+  }
 
-  // if needed, init connexion
-  if (!teleinfo_influxdb.init)
+  // else drop oldest complete lines to get back under half of RAM size
+  else
   {
-    InfluxDbLoop ();
-    teleinfo_influxdb.init = true;
+    length = teleinfo_influxdb.str_buffer.length () - INFLUXDB_RAM_SIZE / 2;
+    while ((length < teleinfo_influxdb.str_buffer.length ()) && (teleinfo_influxdb.str_buffer[length - 1] != '\n')) length++;
+    count = TeleinfoInfluxDbCountPoints (teleinfo_influxdb.str_buffer.c_str (), length);
+    teleinfo_influxdb.str_buffer.remove (0, length);
+    teleinfo_influxdb.nb_dropped += count;
+    AddLog (LOG_LEVEL_INFO, PSTR ("IDB: Buffer full, %u points dropped"), count);
   }
+}
+
+// collect data and append timestamped points to RAM buffer
+void TeleinfoInfluxDbCollect ()
+{
+  uint32_t count;
+  char    *pstr_line, *pstr_next;
+  char     str_stamp[16];
 
   // collect data from drivers and sensors
   TasmotaGlobal.mqtt_data = "";
@@ -248,17 +341,189 @@ void TeleinfoInfluxDbPublishAllData ()
   TeleinfoWinkyInfluxDbAppendData ();
 #endif  // USE_TELEINFO_WINKY
 
-  // if needed, publish data
-  if (TasmotaGlobal.mqtt_data.length () > 0)
+  // append UTC timestamp (sec.) to each point
+  sprintf_P (str_stamp, PSTR (" %u\n"), Rtc.utc_time);
+  count = 0;
+  pstr_line = (char*)TasmotaGlobal.mqtt_data.c_str ();
+  while ((pstr_line != nullptr) && (*pstr_line != 0))
+  {
+    pstr_next = strchr (pstr_line, '\n');
+    if (pstr_next != nullptr) *pstr_next++ = 0;
+    if (*pstr_line != 0)
+    {
+      teleinfo_influxdb.str_buffer += pstr_line;
+      teleinfo_influxdb.str_buffer += str_stamp;
+      count++;
+    }
+    pstr_line = pstr_next;
+  }
+  TasmotaGlobal.mqtt_data = "";
+
+  // update counters
+  if (teleinfo_influxdb.nb_sample == 0) teleinfo_influxdb.time_oldest = LocalTime ();
+  if (teleinfo_influxdb.nb_sample < UINT8_MAX) teleinfo_influxdb.nb_sample++;
+  teleinfo_influxdb.nb_buffered += count;
+
+  // if RAM buffer is full and not being posted, spill it
+  if ((teleinfo_influxdb.str_buffer.length () > INFLUXDB_RAM_SIZE) && (teleinfo_influxdb.from_spill || (teleinfo_influxdb.sent_size == 0))) TeleinfoInfluxDbSpill ();
+}
+
+// batch post answer
+void TeleinfoInfluxDbReceived (tic_https_request &request)
+{
+  char str_filename[24];
+  File file;
+
+  // if failure, delay next flush
+  if (!request.valid)
+  {
+    teleinfo_influxdb.time_retry = LocalTime () + TeleinfoHttpsRetryDelay (TIC_HTTPS_EP_INFLUXDB, INFLUXDB_DELAY_RETRY);
+    AddLog (LOG_LEVEL_INFO, PSTR ("IDB: Emission InfluxDB en erreur [%d], %u points conservés"), request.http_code, teleinfo_influxdb.sent_point);
+  }
+
+  // else if batch came from spill file, move read position
+  else if (teleinfo_influxdb.from_spill)
+  {
+    teleinfo_influxdb.nb_flushed += teleinfo_influxdb.sent_point;
+    teleinfo_influxdb.spill_pos  += teleinfo_influxdb.sent_size;
+
+    // if spill file is fully sent, remove it
+    strcpy_P (str_filename, PSTR_INFLUXDB_SPILL_FILE);
+    file = ffsp->open (str_filename, "r");
+    if (file)
+    {
+      if (teleinfo_influxdb.spill_pos >= file.size ()) teleinfo_influxdb.spill_pos = 0;
+      file.close ();
+    }
+    if (teleinfo_influxdb.spill_pos == 0) teleinfo_influxdb.spilled = !ffsp->remove (str_filename);
+  }
+
+  // else remove posted points from RAM buffer
+  else
+  {
+    teleinfo_influxdb.nb_flushed += teleinfo_influxdb.sent_point;
+    teleinfo_influxdb.str_buffer.remove (0, teleinfo_influxdb.sent_size);
+    if (teleinfo_influxdb.str_buffer.length () == 0) teleinfo_influxdb.nb_sample = 0;
+  }
+
+  // batch is done
+  teleinfo_influxdb.sent_size  = 0;
+  teleinfo_influxdb.sent_point = 0;
+  teleinfo_influxdb.from_spill = false;
+}
+
+// post next batch, spilled points first
+bool TeleinfoInfluxDbFlush ()
+{
+  bool   is_ok;
+  size_t length;
+  char  *pstr_body;
+  char   str_filename[24];
+  char   str_host[64];
+  char   str_url[TIC_HTTPS_URL_SIZE];
+  char   str_auth[TIC_HTTPS_AUTH_SIZE];
+  File   file;
+
+  // generate URL and authorization
+  if (strstr_P (SettingsText (SET_INFLUXDB_HOST), PSTR ("://")) == nullptr) sprintf_P (str_host, PSTR ("http://%s"), SettingsText (SET_INFLUXDB_HOST));
+    else strlcpy (str_host, SettingsText (SET_INFLUXDB_HOST), sizeof (str_host));
+  str_auth[0] = 0;
+  if (Settings->influxdb_version == 1) snprintf_P (str_url, sizeof (str_url), PSTR ("%s:%u/write?db=%s&u=%s&p=%s&precision=s"), str_host, Settings->influxdb_port, SettingsText (SET_INFLUXDB_BUCKET), SettingsText (SET_INFLUXDB_ORG), SettingsText (SET_INFLUXDB_TOKEN));
+  else
+  {
+    snprintf_P (str_url, sizeof (str_url), PSTR ("%s:%u/api/v2/write?org=%s&bucket=%s&precision=s"), str_host, Settings->influxdb_port, SettingsText (SET_INFLUXDB_ORG), SettingsText (SET_INFLUXDB_BUCKET));
+    snprintf_P (str_auth, sizeof (str_auth), PSTR ("Token %s"), SettingsText (SET_INFLUXDB_TOKEN));
+  }
+
+  // if spill file has points left, read next batch
+  strcpy_P (str_filename, PSTR_INFLUXDB_SPILL_FILE);
+  if (teleinfo_influxdb.spilled)
+  {
+    pstr_body = (char*)malloc (INFLUXDB_BATCH_SIZE + 1);
+    if (pstr_body == nullptr) return false;
+    file = ffsp->open (str_filename, "r");
+    length = 0;
+    if (file)
+    {
+      file.seek (teleinfo_influxdb.spill_pos);
+      length = file.read ((uint8_t*)pstr_body, INFLUXDB_BATCH_SIZE);
+      file.close ();
+    }
+    length = TeleinfoInfluxDbLineBlock (pstr_body, length, INFLUXDB_BATCH_SIZE);
+    pstr_body[length] = 0;
+    teleinfo_influxdb.from_spill = true;
+  }
+
+  // else post first points of RAM buffer
+  else
+  {
+    length = TeleinfoInfluxDbLineBlock (teleinfo_influxdb.str_buffer.c_str (), teleinfo_influxdb.str_buffer.length (), INFLUXDB_BATCH_SIZE);
+    pstr_body = (char*)malloc (length + 1);
+    if (pstr_body == nullptr) return false;
+    memcpy (pstr_body, teleinfo_influxdb.str_buffer.c_str (), length);
+    pstr_body[length] = 0;
+    teleinfo_influxdb.from_spill = false;
+  }
+
+  // if nothing to post (corrupted spill file), reset
+  if (length == 0)
   {
-    InfluxDbPostData (TasmotaGlobal.mqtt_data.c_str ());
-    AddLog (LOG_LEVEL_INFO,  PSTR("IDB: Emission InfluxDB"));
-    TasmotaGlobal.mqtt_data = "";
+    if (teleinfo_influxdb.from_spill) ffsp->remove (str_filename);
+    teleinfo_influxdb.spilled    = false;
+    teleinfo_influxdb.spill_pos  = 0;
+    teleinfo_influxdb.from_spill = false;
+    free (pstr_body);
+    return false;
   }
 
-  // reset publication flag and declare last publication
+  // queue batch
+  teleinfo_influxdb.sent_size  = length;
+  teleinfo_influxdb.sent_point = TeleinfoInfluxDbCountPoints (pstr_body, length);
+  is_ok = TeleinfoHttpsQueue (TIC_HTTPS_EP_INFLUXDB, str_url, str_auth, true, pstr_body, nullptr, TeleinfoInfluxDbReceived);
+  free (pstr_body);
+
+  // log
+  if (is_ok) AddLog (LOG_LEVEL_INFO, PSTR ("IDB: Emission InfluxDB, %u points (%u bytes)"), teleinfo_influxdb.sent_point, length);
+  else
+  {
+    teleinfo_influxdb.sent_size  = 0;
+    teleinfo_influxdb.sent_point = 0;
+    teleinfo_influxdb.from_spill = false;
+  }
+
+  return is_ok;
+}
+
+// collect points and post batch if needed
+void TeleinfoInfluxDbPublishAllData ()
+{
+  bool     flush;
+  uint32_t time_now;
+
+  // if nothing to publish, ignore
+  if (!teleinfo_influxdb.enabled) return;
+  if (!teleinfo_influxdb.ready) return;
+  if (!RtcTime.valid) return;
+
+  // if needed, collect timestamped points (even if network is down)
+  if (teleinfo_influxdb.publish) TeleinfoInfluxDbCollect ();
   teleinfo_influxdb.publish = false;
-  TeleinfoDriverWebDeclare (TIC_WEB_HTTPS);
+
+  // check if a batch can be posted
+  time_now = LocalTime ();
+  if (TasmotaGlobal.global_state.network_down) return;
+  if (teleinfo_influxdb.sent_size > 0) return;
+  if (time_now < teleinfo_influxdb.time_retry) return;
+
+  // post if spilled points are waiting, if batch is complete or if oldest point is too old
+  flush = teleinfo_influxdb.spilled;
+  if (teleinfo_influxdb.str_buffer.length () > 0)
+  {
+    flush |= (teleinfo_influxdb.nb_sample >= teleinfo_influxdb.batch);
+    flush |= (teleinfo_influxdb.str_buffer.length () >= INFLUXDB_BATCH_SIZE);
+    flush |= (time_now >= teleinfo_influxdb.time_oldest + INFLUXDB_FLUSH_TIMEOUT);
+  }
+  if (flush) TeleinfoInfluxDbFlush ();
 }
 
 /*******************************\
@@ -281,6 +546,24 @@ void CmndTeleinfoInfluxDbVersion ()
   ResponseCmndNumber (Settings->influxdb_version);
 }
 
+// Set number of publications per batch
+void CmndTeleinfoInfluxDbBatch ()
+{
+  if ((XdrvMailbox.data_len > 0) && (XdrvMailbox.payload > 0) && (XdrvMailbox.payload <= INFLUXDB_BATCH_MAX))
+  {
+    teleinfo_influxdb.batch = (uint8_t)XdrvMailbox.payload;
+    TeleinfoInfluxDbSaveConfig ();
+  }
+  
+  ResponseCmndNumber (teleinfo_influxdb.batch);
+}
+
+// Publish points counters
+void CmndTeleinfoInfluxDbStat ()
+{
+  Response_P (PSTR ("{\"%s\":{\"batch\":%u,\"buffered\":%u,\"dropped\":%u,\"flushed\":%u,\"spilled\":%u,\"ram\":%u,\"spill_pos\":%u}}"), XdrvMailbox.command, teleinfo_influxdb.batch, teleinfo_influxdb.nb_buffered, teleinfo_influxdb.nb_dropped, teleinfo_influxdb.nb_flushed, teleinfo_influxdb.nb_spilled, teleinfo_influxdb.str_buffer.length (), teleinfo_influxdb.spill_pos);
+}
+
 /****************************\
  *        Callback
 \****************************/
@@ -288,6 +571,8 @@ void CmndTeleinfoInfluxDbVersion ()
 // Domoticz init message
 void TeleinfoInfluxDbInit ()
 {
+  char str_filename[24];
+
   // load config 
   TeleinfoInfluxDbLoadConfig ();
 
@@ -299,19 +584,25 @@ void TeleinfoInfluxDbInit ()
   teleinfo_influxdb.ready &= (strlen (SettingsText(SET_INFLUXDB_TOKEN))  > 0);
   teleinfo_influxdb.ready &= (Settings->influxdb_port > 0);
 
+  // points spilled before restart are still to be posted
+  strcpy_P (str_filename, PSTR_INFLUXDB_SPILL_FILE);
+  teleinfo_influxdb.spilled = ((ffsp != nullptr) && ffsp->exists (str_filename));
+
   // log help command
   AddLog (LOG_LEVEL_INFO, PSTR ("HLP: Run ifx_tic <0/1> to manage InfluxDB publication"));
   AddLog (LOG_LEVEL_INFO, PSTR ("HLP: Run ifx_ver <1/2> to set InfluxDB version"));
+  AddLog (LOG_LEVEL_INFO, PSTR ("HLP: Run ifx_batch <1..%u> to set number of publications per batch"), INFLUXDB_BATCH_MAX);
+  AddLog (LOG_LEVEL_INFO, PSTR ("HLP: Run ifx_stat to get points counters"));
 }
 
 // called every second
 void TeleinfoInfluxDbEverySecond ()
 {
-  // if nothing to publish, ignore
-  if (!teleinfo_influxdb.publish) return;
+  // if nothing to collect or post, ignore
+  if (!teleinfo_influxdb.publish && !teleinfo_influxdb.spilled && (teleinfo_influxdb.str_buffer.length () == 0)) return;
   if (!TeleinfoDriverWebAllow (TIC_WEB_HTTPS)) return;
 
-  // publish data and declare publication
+  // collect points and post batch
   TeleinfoInfluxDbPublishAllData ();
 }
 
@@ -31,6 +31,10 @@ xdrv_98_10_teleinfo_rte.ino - Handle access to RTE server for Tempo, Pointe and
     02/01/2026 v5.1 - Handle new OpenDPE JSON format
     08/01/2026 v5.2 - Add RTE Tempo Light management
     31/01/2026 v5.3 - Correct bug in midnight shift
+    16/10/2026 v5.4 - Run HTTPS streams in background thru driver request engine
+                      Parse answers thru JSON stream parser, without body buffer
+                      Retry with endpoint backoff, handle unchanged answers (304)
+                      Publish RTE topic thru driver scheduler
                       
   This module connects to french RTE server to retrieve Ecowatt, Tempo and Pointe electricity production forecast.
 
@@ -77,10 +81,7 @@ xdrv_98_10_teleinfo_rte.ino - Handle access to RTE server for Tempo, Pointe and
 #ifdef USE_TELEINFO
 #ifdef USE_TELEINFO_RTE
 
-#include <ArduinoJson.h>
-
 // global constant
-#define RTE_HTTPS_TIMEOUT               3000       // HTTPs connexion timeout (ms)
 #define RTE_TOKEN_DELAY_RETRY           30         // token retry timeout (sec.)
 #define RTE_DELAY_QUERY                 10         // initial query delay
 #define RTE_FILE_VERSION_CFG            1          // configuration version
@@ -214,6 +215,7 @@ static struct {
 // RTE server updates
 static struct {
   bool     publish          = false;                // flag to publish JSON
+  bool     pending          = false;                // flag for HTTPS request in progress
   uint8_t  hour             = 0;                    // current hour
   uint8_t  step             = RTE_UPDATE_NONE;      // current reception step
   uint32_t time_token       = UINT32_MAX;           // timestamp of next token update
@@ -259,6 +261,24 @@ static struct {
   int      arr_day[RTE_DAY_TOMORROW + 1];           // days status
 } rte_pointe_status;
 
+// stream reception (filled by JSON parser from HTTPS task, applied once request is done)
+struct rte_stream_opendpe {
+  uint8_t day;                                      // matching day (RTE_DAY_MAX if none)
+  uint8_t level;                                    // tempo level
+  uint8_t proba;                                    // tempo probability
+  uint8_t white;                                    // stock of white days
+  uint8_t red;                                      // stock of red days
+};
+static struct {
+  uint16_t count;                                   // number of received array items
+  uint32_t validity;                                // token validity (sec.)
+  char     str_token[128];                          // token value
+  uint8_t  arr_level[RTE_DAY_MAX];                  // received levels (UINT8_MAX if none)
+  char     arr_date[RTE_DAY_MAX][12];               // days to look for (yyyy-mm-dd)
+  rte_stream_opendpe arr_opendpe[RTE_DAY_MAX];      // open dpe days
+  rte_ecowatt_day    arr_ecowatt[RTE_ECOWATT_DAY_MAX];  // ecowatt days
+} rte_stream;
+
 /************************************\
  *        RTE global commands
 \************************************/
@@ -633,6 +653,7 @@ void TeleinfoRtePublishJson ()
 
   // publish message
   ResponseJsonEnd ();
+  TeleinfoSchedulerMeasure ();
   MqttPublishPrefixTopic_P (TELE, PSTR ("RTE"), Settings->flag.mqtt_sensor_retain);
   XdrvRulesProcess (true);
 
@@ -641,6 +662,105 @@ void TeleinfoRtePublishJson ()
   TeleinfoDriverWebDeclare (TIC_WEB_MQTT);
 }
 
+/***********************************\
+ *        Request management
+\***********************************/
+
+// end of a stream reception, plan next update of current step
+void TeleinfoRteRequestEnd (const uint8_t step, const bool result)
+{
+  char str_text[32];
+
+  switch (step)
+  {
+    case RTE_UPDATE_OPENDPE:
+      rte_update.time_opendpe = TeleinfoRteOpenDpeNextUpdate (!result);
+      AddLog (LOG_LEVEL_INFO, PSTR ("RTE: OpenDPE - %s"), TeleinfoRteGetDelay (rte_update.time_opendpe, str_text, sizeof (str_text)));
+      break;
+
+    case RTE_UPDATE_TEMPOLIGHT:
+      rte_update.time_tempolight = TeleinfoRteTempoLightNextUpdate (!result);
+      AddLog (LOG_LEVEL_INFO, PSTR ("RTE: TempoLight - %s"), TeleinfoRteGetDelay (rte_update.time_tempolight, str_text, sizeof (str_text)));
+      break;
+
+    case RTE_UPDATE_TOKEN:
+      // if failure, plan next retry, reset token and delay RTE streams
+      if (!result)
+      {
+        rte_update.time_token   = LocalTime () + TeleinfoHttpsRetryDelay (TIC_HTTPS_EP_TOKEN, RTE_TOKEN_DELAY_RETRY);
+        rte_update.str_token[0] = 0;
+        rte_update.time_tempo   = max (rte_update.time_token, rte_update.time_tempo);
+        rte_update.time_pointe  = max (rte_update.time_token, rte_update.time_pointe);
+        rte_update.time_ecowatt = max (rte_update.time_token, rte_update.time_ecowatt);
+      }
+      AddLog (LOG_LEVEL_INFO, PSTR ("RTE: Token - %s"), TeleinfoRteGetDelay (rte_update.time_token, str_text, sizeof (str_text)));
+      break;
+
+    case RTE_UPDATE_ECOWATT:
+      rte_update.time_ecowatt = TeleinfoRteEcowattNextUpdate (!result);
+      AddLog (LOG_LEVEL_INFO, PSTR ("RTE: Ecowatt - %s"), TeleinfoRteGetDelay (rte_update.time_ecowatt, str_text, sizeof (str_text)));
+      break;
+
+    case RTE_UPDATE_TEMPO:
+      rte_update.time_tempo = TeleinfoRteTempoNextUpdate (!result);
+      AddLog (LOG_LEVEL_INFO, PSTR ("RTE: Tempo - %s"), TeleinfoRteGetDelay (rte_update.time_tempo, str_text, sizeof (str_text)));
+      break;
+
+    case RTE_UPDATE_POINTE:
+      rte_update.time_pointe = TeleinfoRtePointeNextUpdate (!result);
+      AddLog (LOG_LEVEL_INFO, PSTR ("RTE: Pointe - %s"), TeleinfoRteGetDelay (rte_update.time_pointe, str_text, sizeof (str_text)));
+      break;
+  }
+
+  // init next step
+  rte_update.step    = RTE_UPDATE_NONE;
+  rte_update.pending = false;
+}
+
+// init stream reception data
+void TeleinfoRteStreamInit ()
+{
+  uint8_t  index;
+  uint32_t time_day;
+  TIME_T   day_dst;
+
+  memset (&rte_stream, 0, sizeof (rte_stream));
+  time_day = LocalTime ();
+  for (index = 0; index < RTE_DAY_MAX; index ++)
+  {
+    rte_stream.arr_level[index]       = UINT8_MAX;
+    rte_stream.arr_opendpe[index].day = RTE_DAY_MAX;
+    if (index < RTE_DAY_TODAY) continue;
+    BreakTime (time_day, day_dst);
+    sprintf_P (rte_stream.arr_date[index], PSTR ("%04u-%02u-%02u"), day_dst.year + 1970, day_dst.month, day_dst.day_of_month);
+    time_day += 86400;
+  }
+  for (index = 0; index < RTE_ECOWATT_DAY_MAX; index ++) memset (rte_stream.arr_ecowatt[index].arr_hvalue, RTE_ECOWATT_LEVEL_NORMAL, 24);
+}
+
+// start stream reception of current step, in background
+void TeleinfoRteRequestStart ()
+{
+  bool result;
+
+  // init reception data and queue request
+  TeleinfoRteStreamInit ();
+  switch (rte_update.step)
+  {
+    case RTE_UPDATE_OPENDPE:    result = TeleinfoRteOpenDpeRequest ();    break;
+    case RTE_UPDATE_TEMPOLIGHT: result = TeleinfoRteTempoLightRequest (); break;
+    case RTE_UPDATE_TOKEN:      result = TeleinfoRteTokenRequest ();      break;
+    case RTE_UPDATE_ECOWATT:    result = TeleinfoRteEcowattRequest ();    break;
+    case RTE_UPDATE_TEMPO:      result = TeleinfoRteTempoRequest ();      break;
+    case RTE_UPDATE_POINTE:     result = TeleinfoRtePointeRequest ();     break;
+    default:                    result = false;                           break;
+  }
+
+  // if request could not be queued, plan retry
+  rte_update.pending = result;
+  if (!result) TeleinfoRteRequestEnd (rte_update.step, false);
+}
+
 /***********************************\
  *        Token management
 \***********************************/
@@ -655,89 +775,49 @@ void TeleinfoRteTokenNextUpdate (const uint32_t validity)
   rte_update.time_ecowatt = max (rte_update.time_ecowatt, LocalTime () + RTE_ECOWATT_DELAY_INITIAL);
 }
 
-// token connexion
-bool TeleinfoRteStreamToken ()
+// token JSON value reception (HTTPS task)
+void TeleinfoRteTokenParse (tic_json_parser &parser, const char *pstr_value)
 {
-  bool     is_ok;
-  uint32_t time_start, validity;
-  int32_t  time_response;
-  int      http_code;
-  char     str_auth[128];
-  String   str_result;
-  JsonDocument     json_result;
-  HTTPClientLight *phttp;
-
-  // check private key
-  if (strlen (rte_config.str_private_key) == 0) return false;
+  if (TeleinfoJsonMatch (parser, PSTR ("access_token"))) strlcpy (rte_stream.str_token, pstr_value, sizeof (rte_stream.str_token));
+    else if (TeleinfoJsonMatch (parser, PSTR ("expires_in"))) rte_stream.validity = (uint32_t)atol (pstr_value);
+}
 
-  // create connexion
-  phttp = new HTTPClientLight ();
-  is_ok = (phttp != nullptr);
-  if (is_ok)
-  {
-    // connexion
-    is_ok = phttp->begin (RTE_URL_OAUTH2);
-    if (is_ok) 
-    {
-      // set authorisation
-      strcpy_P (str_auth, PSTR ("Basic "));
-      strlcat (str_auth, rte_config.str_private_key, sizeof (str_auth) - 1);
-
-      // set timeout and headers
-      phttp->setTimeout (RTE_HTTPS_TIMEOUT);
-      phttp->addHeader (F ("Authorization"), str_auth, false, true);
-      phttp->addHeader (F ("Accept"), F ("application/json"), false, true);
-
-      // connexion
-      time_start = millis ();
-      http_code = phttp->POST (nullptr, 0);
-      time_response = TimePassedSince (time_start);
-
-      // collect result
-      is_ok = ((http_code == HTTP_CODE_OK) || (http_code == HTTP_CODE_MOVED_PERMANENTLY));
-      if (is_ok) str_result = phttp->getString ();
-      is_ok = !str_result.isEmpty ();
-
-      // end connexion
-      phttp->end ();
-      
-      // log
-      AddLog (LOG_LEVEL_INFO, PSTR ("RTE: Token - [%d] %u char in %d ms"), http_code, str_result.length (), time_response);
-    }
-    else AddLog (LOG_LEVEL_INFO, PSTR ("RTE: Token - Connexion begin failed"));
+// token reception
+void TeleinfoRteTokenReceived (tic_https_request &request)
+{
+  bool is_ok;
 
-    // delete connexion
-    delete phttp;
-  }
-  else AddLog (LOG_LEVEL_INFO, PSTR ("RTE: Token - Connexion creation failed"));
+  // log
+  AddLog (LOG_LEVEL_INFO, PSTR ("RTE: Token - [%d] %u bytes in %u ms"), request.http_code, request.size, request.arr_stage[TIC_HTTPS_STAGE_CONNECT] + request.arr_stage[TIC_HTTPS_STAGE_REQUEST] + request.arr_stage[TIC_HTTPS_STAGE_BODY]);
 
-  // if data received
+  // if token received
+  is_ok = request.valid && (rte_stream.str_token[0] != 0);
   if (is_ok)
   {
-    // extract token from JSON
-    deserializeJson (json_result, str_result.c_str ());
+    // set token value and validity
+    strlcpy (rte_update.str_token, rte_stream.str_token, sizeof (rte_update.str_token));
+    TeleinfoRteTokenNextUpdate (rte_stream.validity);
+    AddLog (LOG_LEVEL_DEBUG, PSTR ("RTE: Token - Valid for %u seconds"), rte_stream.validity);
+  }
 
-    // get token value
-    strlcpy (rte_update.str_token, json_result[F ("access_token")].as<const char*> (), sizeof (rte_update.str_token));
+  // plan next step
+  TeleinfoRteRequestEnd (RTE_UPDATE_TOKEN, is_ok);
+}
 
-    // set token validity
-    validity = json_result[F ("expires_in")].as<unsigned int> ();
-    TeleinfoRteTokenNextUpdate (validity);
-    AddLog (LOG_LEVEL_DEBUG, PSTR ("RTE: Token - Valid for %u seconds"), validity);
-  }
+// token request
+bool TeleinfoRteTokenRequest ()
+{
+  char str_auth[TIC_HTTPS_AUTH_SIZE];
 
-  // else
-  else
-  {
-    // plan next retry and reset token
-    rte_update.time_token = LocalTime () + RTE_TOKEN_DELAY_RETRY;
-    rte_update.str_token[0] = 0;
-  }
+  // check private key
+  if (strlen (rte_config.str_private_key) == 0) return false;
 
-  // declare query
-  TeleinfoDriverWebDeclare (TIC_WEB_HTTPS);
+  // set authorisation
+  strcpy_P (str_auth, PSTR ("Basic "));
+  strlcat (str_auth, rte_config.str_private_key, sizeof (str_auth));
 
-  return is_ok;
+  // queue request
+  return TeleinfoHttpsQueue (TIC_HTTPS_EP_TOKEN, RTE_URL_OAUTH2, str_auth, true, nullptr, TeleinfoRteTokenParse, TeleinfoRteTokenReceived);
 }
 
 /***********************************\
@@ -758,7 +838,7 @@ uint32_t TeleinfoRteEcowattNextUpdate (const bool need_retry)
   result = LocalTime ();
 
   // if stream reading should be retried, else plan next update
-  if (need_retry) result += RTE_ECOWATT_DELAY_RETRY;
+  if (need_retry) result += TeleinfoHttpsRetryDelay (TIC_HTTPS_EP_ECOWATT, RTE_ECOWATT_DELAY_RETRY);
     else result += RTE_ECOWATT_DELAY_RENEW;
 
   return result;
@@ -822,135 +902,114 @@ uint8_t TeleinfoRteEcowattGetGlobalLevel (const uint8_t day, const uint8_t slot)
   return result;
 }
 
-// start of signal reception
-bool TeleinfoRteEcowattStream ()
+// ecowatt JSON value reception (HTTPS task)
+void TeleinfoRteEcowattParse (tic_json_parser &parser, const char *pstr_value)
 {
-  bool        is_ok;
-  uint8_t     slot, value;
-  uint16_t    index, index_array, size;
-  uint32_t    day_time;
-  uint32_t    time_start;
-  int32_t     time_response;
-  int         http_code;
-  char        str_day[12];
-  char        str_text[256];
-  const char *pstr_url;
-  String      str_result;
-  TIME_T      day_dst;
-  JsonArray   arr_day, arr_slot;
-  JsonDocument     json_result;
-  HTTPClientLight *phttp;
+  uint8_t  value;
+  uint16_t day, slot;
+  uint32_t day_time;
+  char     str_day[12];
+  char     str_text[32];
+  TIME_T   day_dst;
 
-  // check token
-  if (strlen (rte_update.str_token) == 0)
+  // check day index
+  day = TeleinfoJsonIndex (parser, 1);
+  if (day >= RTE_ECOWATT_DAY_MAX) return;
+
+  // hourly slot
+  if (TeleinfoJsonMatch (parser, PSTR ("signals[*].values[*].hvalue")))
   {
-    AddLog (LOG_LEVEL_INFO, PSTR ("RTE: Ecowatt - Token missing"));
-    return false;
+    slot  = TeleinfoJsonIndex (parser, 3);
+    value = (uint8_t)atoi (pstr_value);
+    if (value >= RTE_ECOWATT_LEVEL_MAX) value = RTE_ECOWATT_LEVEL_NORMAL;
+    if (slot < 24) rte_stream.arr_ecowatt[day].arr_hvalue[slot] = value;
   }
 
-  // create connexion
-  phttp = new HTTPClientLight ();
-  is_ok = (phttp != nullptr);
-  if (is_ok)
-  {
-    // connexion
-    if (rte_config.sandbox) pstr_url = RTE_URL_ECOWATT_SANDBOX;
-      else pstr_url = RTE_URL_ECOWATT_DATA;
-    AddLog (LOG_LEVEL_DEBUG, PSTR ("RTE: Ecowatt - %s"), pstr_url);
-
-    // connexion
-    is_ok = phttp->begin (pstr_url);
-    if (is_ok)
-    {
-      // set authorisation
-      strcpy_P (str_text, PSTR ("Bearer "));
-      strlcat (str_text, rte_update.str_token, sizeof (str_text) - 1);
-
-      // set timeout and headers
-      phttp->setTimeout (RTE_HTTPS_TIMEOUT);
-      phttp->addHeader (F ("Authorization"), str_text, false, true);
-      phttp->addHeader (F ("Accept"), F ("application/json"), false, true);
-
-      // connexion
-      time_start = millis ();
-      http_code = phttp->GET ();
-      time_response = TimePassedSince (time_start);
-
-      // if success, collect result
-      is_ok = ((http_code == HTTP_CODE_OK) || (http_code == HTTP_CODE_MOVED_PERMANENTLY));
-      if (is_ok) str_result = phttp->getString ();
-      is_ok = !str_result.isEmpty ();
-
-      // end connexion
-      phttp->end ();
-      
-      // log
-      AddLog (LOG_LEVEL_INFO, PSTR ("SOL: Ecowatt - [%d] %u char in %d ms"), http_code, str_result.length (), time_response);
-    }
-    else AddLog (LOG_LEVEL_INFO, PSTR ("RTE: Ecowatt - Connexion begin failed"));
+  // global status
+  else if (TeleinfoJsonMatch (parser, PSTR ("signals[*].dvalue"))) rte_stream.arr_ecowatt[day].dvalue = (uint8_t)atoi (pstr_value);
 
-    // delete connexion
-    delete phttp;
+  // date, convert from yyyy-mm-dd to day of week, day and month
+  else if (TeleinfoJsonMatch (parser, PSTR ("signals[*].jour")))
+  {
+    strcpy (str_text, D_DAY3LIST);
+    strlcpy (str_day, pstr_value, sizeof (str_day));
+    str_day[4] = str_day[7] = str_day[10] = 0;
+    day_dst.year = atoi (str_day) - 1970;
+    day_dst.month = atoi (str_day + 5);
+    day_dst.day_of_month = atoi (str_day + 8);
+    day_dst.day_of_week = 0;
+    day_dst.hour = day_dst.minute = day_dst.second = 0;
+    day_time = MakeTime (day_dst);
+    BreakTime (day_time, day_dst);
+    if (day_dst.day_of_week < 8) strlcpy (str_day, str_text + 3 * (day_dst.day_of_week - 1), 4);
+      else strcpy (str_day, "");
+
+    strlcpy (rte_stream.arr_ecowatt[day].str_day_of_week, str_day, sizeof (rte_stream.arr_ecowatt[day].str_day_of_week));
+    rte_stream.arr_ecowatt[day].day_of_month = day_dst.day_of_month;
+    rte_stream.arr_ecowatt[day].month        = day_dst.month;
   }
-  
-  else AddLog (LOG_LEVEL_INFO, PSTR ("RTE: Ecowatt - Connexion creation failed"));
 
-  // process received data
-  if (is_ok)
-  {
-    // extract token from JSON
-    deserializeJson (json_result, str_result.c_str ());
+  else return;
+
+  // update number of received days
+  rte_stream.count = max (rte_stream.count, (uint16_t)(day + 1));
+}
 
-    // check array Size
-    arr_day = json_result[F ("signals")].as<JsonArray>();
-    size = arr_day.size ();
+// ecowatt reception
+void TeleinfoRteEcowattReceived (tic_https_request &request)
+{
+  bool     is_ok;
+  uint16_t index, index_array;
+
+  // log
+  AddLog (LOG_LEVEL_INFO, PSTR ("RTE: Ecowatt - [%d] %u bytes in %u ms"), request.http_code, request.size, request.arr_stage[TIC_HTTPS_STAGE_CONNECT] + request.arr_stage[TIC_HTTPS_STAGE_REQUEST] + request.arr_stage[TIC_HTTPS_STAGE_BODY]);
 
-    // loop thru all 4 days to get today's and tomorrow's index
-    if (size <= RTE_ECOWATT_DAY_MAX) for (index = 0; index < size; index ++)
+  // process received days (answer 304 keeps current days)
+  is_ok = request.valid && ((rte_stream.count > 0) || (request.http_code == HTTP_CODE_NOT_MODIFIED));
+  if (is_ok && (rte_stream.count > 0))
+  {
+    for (index = 0; index < rte_stream.count; index ++)
     {
       // if sandbox, shift array index to avoid current day fully ok
       if (rte_config.sandbox) index_array = (index + RTE_ECOWATT_DAY_MAX - 1) % RTE_ECOWATT_DAY_MAX;
         else index_array = index;
 
-      // get global status
-      rte_ecowatt_status.arr_day[index_array].dvalue = arr_day[index][F ("dvalue")].as<unsigned int>();
-
-      // get date and convert from yyyy-mm-dd to dd.mm.yyyy
-      strcpy (str_text, D_DAY3LIST);
-      strlcpy (str_day, arr_day[index][F ("jour")], sizeof (str_day));
-      str_day[4] = str_day[7] = str_day[10] = 0;
-      day_dst.year = atoi (str_day) - 1970;
-      day_dst.month = atoi (str_day + 5);
-      day_dst.day_of_month = atoi (str_day + 8);
-      day_dst.day_of_week = 0;
-      day_time = MakeTime (day_dst);
-      BreakTime (day_time, day_dst);
-      if (day_dst.day_of_week < 8) strlcpy (str_day, str_text + 3 * (day_dst.day_of_week - 1), 4);
-        else strcpy (str_day, "");
-
-      // update current slot
-      strlcpy (rte_ecowatt_status.arr_day[index_array].str_day_of_week, str_day, sizeof (rte_ecowatt_status.arr_day[index_array].str_day_of_week));
-      rte_ecowatt_status.arr_day[index_array].day_of_month = day_dst.day_of_month;
-      rte_ecowatt_status.arr_day[index_array].month        = day_dst.month;
-
-      // loop to populate the slots
-      arr_slot = arr_day[index][F ("values")].as<JsonArray>();
-      for (slot = 0; slot < 24; slot ++)
-      {
-        value = arr_slot[slot][F ("hvalue")].as<unsigned int>();
-        if (value >= RTE_ECOWATT_LEVEL_MAX) value = RTE_ECOWATT_LEVEL_NORMAL;
-        rte_ecowatt_status.arr_day[index_array].arr_hvalue[slot] = value;
-      }
+      // update day
+      rte_ecowatt_status.arr_day[index_array] = rte_stream.arr_ecowatt[index];
     }
 
     // log
     AddLog (LOG_LEVEL_INFO, PSTR ("RTE: Ecowatt - Update till %02u/%02u"), rte_ecowatt_status.arr_day[index_array].day_of_month, rte_ecowatt_status.arr_day[index_array].month);
   }
 
-  // declare query
-  TeleinfoDriverWebDeclare (TIC_WEB_HTTPS);
+  // plan next step
+  TeleinfoRteRequestEnd (RTE_UPDATE_ECOWATT, is_ok);
+}
+
+// ecowatt request
+bool TeleinfoRteEcowattRequest ()
+{
+  const char *pstr_url;
+  char        str_auth[TIC_HTTPS_AUTH_SIZE];
+
+  // check token
+  if (strlen (rte_update.str_token) == 0)
+  {
+    AddLog (LOG_LEVEL_INFO, PSTR ("RTE: Ecowatt - Token missing"));
+    return false;
+  }
+
+  // set URL
+  if (rte_config.sandbox) pstr_url = RTE_URL_ECOWATT_SANDBOX;
+    else pstr_url = RTE_URL_ECOWATT_DATA;
+  AddLog (LOG_LEVEL_DEBUG, PSTR ("RTE: Ecowatt - %s"), pstr_url);
 
-  return is_ok;
+  // set authorisation
+  strcpy_P (str_auth, PSTR ("Bearer "));
+  strlcat (str_auth, rte_update.str_token, sizeof (str_auth));
+
+  // queue request
+  return TeleinfoHttpsQueue (TIC_HTTPS_EP_ECOWATT, pstr_url, str_auth, false, nullptr, TeleinfoRteEcowattParse, TeleinfoRteEcowattReceived);
 }
 
 // Append Ecowatt data to SENSOR
@@ -1071,7 +1130,7 @@ uint32_t TeleinfoRteTempoNextUpdate (const bool need_retry)
   result = LocalTime ();
 
   // calculate next update
-  if (need_retry) result += RTE_TEMPO_DELAY_RETRY;                                                                      // stream reading should be retried
+  if (need_retry) result += TeleinfoHttpsRetryDelay (TIC_HTTPS_EP_TEMPO, RTE_TEMPO_DELAY_RETRY);                                                                      // stream reading should be retried
     else if (hour < 11) result += (11 - hour) * 3600;                                                                   // before 11h, plan next update after 11h
     else if (rte_tempo_status.arr_day[RTE_DAY_TOMORROW].proba != RTE_TEMPO_KNOWN) result += RTE_TEMPO_DELAY_UNKNOWN;    // after 11h and tomorrow unknown, plan next update in 30 mn
     else result += (24 + 11 - hour) * 3600;                                                                             // tomorrow known, plan next update after 11h tomorrow
@@ -1131,110 +1190,50 @@ uint8_t TeleinfoRteTempoGetProbability (const uint8_t day)
   return rte_tempo_status.arr_day[day].proba;;
 }
 
-// tempo stream reception
-bool TeleinfoRteTempoStream ()
+// tempo JSON value reception (HTTPS task)
+void TeleinfoRteTempoParse (tic_json_parser &parser, const char *pstr_value)
 {
-  bool      is_ok;
-  int       http_code;
-  int32_t   tz_offset;
-  uint16_t  size;
-  uint32_t  time_start;
-  int32_t   time_response;
-  char      str_text[256];
-  TIME_T    start_dst, stop_dst;
-  String    str_result;
-  JsonArray arr_day;
-  JsonDocument     json_result;
-  HTTPClientLight *phttp;
-
-  // check token
-  if (strlen (rte_update.str_token) == 0)
-  {
-    AddLog (LOG_LEVEL_INFO, PSTR ("RTE: Tempo - Token missing"));
-    return false;
-  }
-
-  // create connexion
-  phttp = new HTTPClientLight ();
-  is_ok = (phttp != nullptr);
-  if (is_ok)
-  {
-    // calculate time window
-    time_start = LocalTime ();
-    BreakTime (time_start - 86400, start_dst);
-    BreakTime (time_start + 172800, stop_dst);
-
-    // calculate timezone offset
-    tz_offset = Rtc.time_timezone / 60;
+  uint16_t index;
+  char     str_text[16];
 
-    // generate URL
-    sprintf_P (str_text, PSTR ("%s?start_date=%04u-%02u-%02uT00:00:00+%02d:00&end_date=%04u-%02u-%02uT00:00:00+%02d:00"), RTE_URL_TEMPO_DATA, 1970 + start_dst.year, start_dst.month, start_dst.day_of_month, tz_offset, 1970 + stop_dst.year, stop_dst.month, stop_dst.day_of_month, tz_offset);
-    AddLog (LOG_LEVEL_DEBUG, PSTR ("RTE: Tempo - %s"), str_text);
+  // check path
+  if (!TeleinfoJsonMatch (parser, PSTR ("tempo_like_calendars.values[*].value"))) return;
 
-    // connexion
-    is_ok = phttp->begin (str_text);
-    if (is_ok)
-    {
-      // set authorisation
-      strcpy_P (str_text, PSTR ("Bearer "));
-      strlcat (str_text, rte_update.str_token, sizeof (str_text) - 1);
-
-      // set timeout and headers
-      phttp->setTimeout (RTE_HTTPS_TIMEOUT);
-      phttp->addHeader (F ("Authorization"), str_text, false, true);
-      phttp->addHeader (F ("Accept"), F ("application/json"), false, true);
-
-      // connexion
-      time_start = millis ();
-      http_code = phttp->GET ();
-      time_response = TimePassedSince (time_start);
-
-      // if success, collect result
-      is_ok = ((http_code == HTTP_CODE_OK) || (http_code == HTTP_CODE_MOVED_PERMANENTLY));
-      if (is_ok) str_result = phttp->getString ();
-      is_ok = !str_result.isEmpty ();
-
-      // end connexion
-      phttp->end ();
-      
-      // log
-      AddLog (LOG_LEVEL_INFO, PSTR ("RTE: Tempo - [%d] %u char in %d ms"), http_code, str_result.length (), time_response);
-    }
+  // update number of received days and day level (most recent first)
+  index = TeleinfoJsonIndex (parser, 2);
+  rte_stream.count = max (rte_stream.count, (uint16_t)(index + 1));
+  if (index < 3) rte_stream.arr_level[index] = GetCommandCode (str_text, sizeof (str_text), pstr_value, kTeleinfoRteTempoJSON);
+}
 
-    else AddLog (LOG_LEVEL_INFO, PSTR ("RTE: Tempo - Connexion begin failed"));
+// tempo reception
+void TeleinfoRteTempoReceived (tic_https_request &request)
+{
+  bool is_ok;
 
-    // delete connexion
-    delete phttp;
-  }
-  else AddLog (LOG_LEVEL_INFO, PSTR ("RTE: Tempo - Connexion creation failed"));
+  // log
+  AddLog (LOG_LEVEL_INFO, PSTR ("RTE: Tempo - [%d] %u bytes in %u ms"), request.http_code, request.size, request.arr_stage[TIC_HTTPS_STAGE_CONNECT] + request.arr_stage[TIC_HTTPS_STAGE_REQUEST] + request.arr_stage[TIC_HTTPS_STAGE_BODY]);
 
   // process received data
+  is_ok = request.valid;
   if (is_ok)
   {
-    // extract token from JSON
-    deserializeJson (json_result, str_result.c_str ());
-
-    // check array Size
-    arr_day = json_result["tempo_like_calendars"]["values"].as<JsonArray>();
-    size = arr_day.size ();
-
     // if tomorrow is not available
-    if (size == 2)
+    if (rte_stream.count == 2)
     {
-      rte_tempo_status.arr_day[RTE_DAY_TODAY].level = GetCommandCode (str_text, sizeof (str_text), arr_day[0][F ("value")], kTeleinfoRteTempoJSON);
+      rte_tempo_status.arr_day[RTE_DAY_TODAY].level = rte_stream.arr_level[0];
       rte_tempo_status.arr_day[RTE_DAY_TODAY].proba = RTE_TEMPO_KNOWN;
-      rte_tempo_status.arr_day[RTE_DAY_YESTERDAY].level = GetCommandCode (str_text, sizeof (str_text), arr_day[1][F ("value")], kTeleinfoRteTempoJSON);
+      rte_tempo_status.arr_day[RTE_DAY_YESTERDAY].level = rte_stream.arr_level[1];
       rte_tempo_status.arr_day[RTE_DAY_YESTERDAY].proba = RTE_TEMPO_KNOWN;
     }
 
     // else tomorrow is available
-    else if (size == 3)
+    else if (rte_stream.count == 3)
     {
-      rte_tempo_status.arr_day[RTE_DAY_TOMORROW].level = GetCommandCode (str_text, sizeof (str_text), arr_day[0][F ("value")], kTeleinfoRteTempoJSON);
+      rte_tempo_status.arr_day[RTE_DAY_TOMORROW].level = rte_stream.arr_level[0];
       rte_tempo_status.arr_day[RTE_DAY_TOMORROW].proba = RTE_TEMPO_KNOWN;
-      rte_tempo_status.arr_day[RTE_DAY_TODAY].level = GetCommandCode (str_text, sizeof (str_text), arr_day[1][F ("value")], kTeleinfoRteTempoJSON);
+      rte_tempo_status.arr_day[RTE_DAY_TODAY].level = rte_stream.arr_level[1];
       rte_tempo_status.arr_day[RTE_DAY_TODAY].proba = RTE_TEMPO_KNOWN;
-      rte_tempo_status.arr_day[RTE_DAY_YESTERDAY].level = GetCommandCode (str_text, sizeof (str_text), arr_day[2][F ("value")], kTeleinfoRteTempoJSON);
+      rte_tempo_status.arr_day[RTE_DAY_YESTERDAY].level = rte_stream.arr_level[2];
       rte_tempo_status.arr_day[RTE_DAY_YESTERDAY].proba = RTE_TEMPO_KNOWN;
     }
 
@@ -1242,10 +1241,44 @@ bool TeleinfoRteTempoStream ()
     AddLog (LOG_LEVEL_INFO, PSTR ("RTE: Tempo - Update done (%d-%d-%d)"), rte_tempo_status.arr_day[RTE_DAY_YESTERDAY].level, rte_tempo_status.arr_day[RTE_DAY_TODAY].level, rte_tempo_status.arr_day[RTE_DAY_TOMORROW].level);
   }
 
-  // declare query
-  TeleinfoDriverWebDeclare (TIC_WEB_HTTPS);
+  // plan next step
+  TeleinfoRteRequestEnd (RTE_UPDATE_TEMPO, is_ok);
+}
+
+// tempo request
+bool TeleinfoRteTempoRequest ()
+{
+  int32_t  tz_offset;
+  uint32_t time_now;
+  TIME_T   start_dst, stop_dst;
+  char     str_url[TIC_HTTPS_URL_SIZE];
+  char     str_auth[TIC_HTTPS_AUTH_SIZE];
 
-  return is_ok;
+  // check token
+  if (strlen (rte_update.str_token) == 0)
+  {
+    AddLog (LOG_LEVEL_INFO, PSTR ("RTE: Tempo - Token missing"));
+    return false;
+  }
+
+  // calculate time window
+  time_now = LocalTime ();
+  BreakTime (time_now - 86400, start_dst);
+  BreakTime (time_now + 172800, stop_dst);
+
+  // calculate timezone offset
+  tz_offset = Rtc.time_timezone / 60;
+
+  // generate URL
+  snprintf_P (str_url, sizeof (str_url), PSTR ("%s?start_date=%04u-%02u-%02uT00:00:00+%02d:00&end_date=%04u-%02u-%02uT00:00:00+%02d:00"), RTE_URL_TEMPO_DATA, 1970 + start_dst.year, start_dst.month, start_dst.day_of_month, tz_offset, 1970 + stop_dst.year, stop_dst.month, stop_dst.day_of_month, tz_offset);
+  AddLog (LOG_LEVEL_DEBUG, PSTR ("RTE: Tempo - %s"), str_url);
+
+  // set authorisation
+  strcpy_P (str_auth, PSTR ("Bearer "));
+  strlcat (str_auth, rte_update.str_token, sizeof (str_auth));
+
+  // queue request
+  return TeleinfoHttpsQueue (TIC_HTTPS_EP_TEMPO, str_url, str_auth, false, nullptr, TeleinfoRteTempoParse, TeleinfoRteTempoReceived);
 }
 
 // Append Tempo data to SENSOR
@@ -1345,7 +1378,7 @@ uint32_t TeleinfoRteTempoLightNextUpdate (const bool need_retry)
   result = LocalTime ();
 
   // calculate next update slot
-  if (need_retry) result += RTE_TEMPOLIGHT_DELAY_RETRY;       // reading should be retried
+  if (need_retry) result += TeleinfoHttpsRetryDelay (TIC_HTTPS_EP_TEMPOLIGHT, RTE_TEMPOLIGHT_DELAY_RETRY);       // reading should be retried
   else if (hour < 6)  result += 3600 * (6 - hour);            // before 6h, plan after 6h
   else if (hour < 12) result += 3600;                         // before 12h, plan every hour
   else                result += 3600 * (24 + 6 - hour);       // after 12h, plan tomorrow after 6h
@@ -1353,98 +1386,59 @@ uint32_t TeleinfoRteTempoLightNextUpdate (const bool need_retry)
   return result;
 }
 
-// tempo loight stream reception
-bool TeleinfoRteTempoLightStream ()
-{
-  bool        is_ok, daysleft, found;
-  int         index, position, size, http_code;
-  uint32_t    time_start;
-  int32_t     time_response;
-  TIME_T      time_day;
-  const char *pstr_color;
-  char        str_color[8];
-  char        str_text[64];
-  String      str_result;
-  JsonDocument     json_result;
-  HTTPClientLight *phttp;
-
-  // create connexion
-  phttp = new HTTPClientLight ();
-  is_ok = (phttp != nullptr);
-  if (is_ok)
-  {
-    // connexion
-    strcpy_P (str_text, RTE_URL_TEMPOLIGHT_DATA);
-    is_ok = phttp->begin (str_text);
-    if (is_ok)
-    {
-      // set timeout and headers
-      phttp->setTimeout (RTE_HTTPS_TIMEOUT);
-      phttp->addHeader (F ("Accept"), F ("application/json"), false, true);
-
-      // connexion
-      time_start = millis ();
-      http_code = phttp->GET ();
-      time_response = TimePassedSince (time_start);
-
-      // if success, collect result
-      is_ok = ((http_code == HTTP_CODE_OK) || (http_code == HTTP_CODE_MOVED_PERMANENTLY));
-      if (is_ok) str_result = phttp->getString ();
-      is_ok = !str_result.isEmpty ();
-    
-      // end connexion
-      phttp->end ();
-      
-      // log
-      AddLog (LOG_LEVEL_INFO, PSTR ("RTE: TempoLight - [%d] %u char in %d ms"), http_code, str_result.length (), time_response);
-    }
+// tempo light JSON value reception (HTTPS task)
+void TeleinfoRteTempoLightParse (tic_json_parser &parser, const char *pstr_value)
+{
+  uint8_t index;
+  char    str_color[8];
 
-    else AddLog (LOG_LEVEL_INFO, PSTR ("RTE: TempoLight - Connexion begin failed"));
+  // check path
+  if (!TeleinfoJsonMatch (parser, PSTR ("values.*"))) return;
 
-    // delete connexion
-    delete phttp;
-  }
-  else AddLog (LOG_LEVEL_INFO, PSTR ("RTE: TempoLight - Connexion creation failed"));
+  // look for today's and tomorrow's date
+  for (index = RTE_DAY_TODAY; index <= RTE_DAY_TOMORROW; index ++)
+    if (strcmp (TeleinfoJsonKey (parser, 1), rte_stream.arr_date[index]) == 0) rte_stream.arr_level[index] = max (0, GetCommandCode (str_color, sizeof (str_color), pstr_value, kTeleinfoRteTempoJSON));
+}
+
+// tempo light reception
+void TeleinfoRteTempoLightReceived (tic_https_request &request)
+{
+  bool    is_ok;
+  uint8_t index;
+  char    str_color[8];
+
+  // log
+  AddLog (LOG_LEVEL_INFO, PSTR ("RTE: TempoLight - [%d] %u bytes in %u ms"), request.http_code, request.size, request.arr_stage[TIC_HTTPS_STAGE_CONNECT] + request.arr_stage[TIC_HTTPS_STAGE_REQUEST] + request.arr_stage[TIC_HTTPS_STAGE_BODY]);
 
   // process received data
+  is_ok = request.valid;
   if (is_ok)
   {
-    // extract token from JSON
-    deserializeJson (json_result, str_result.c_str ());
-
     // loop thru days
-    time_start = LocalTime ();
     for (index = RTE_DAY_TODAY; index <= RTE_DAY_TOMORROW; index ++)
     {
-      // if day is not a known RTE day
-      if (rte_tempo_status.arr_day[index].proba < RTE_TEMPO_KNOWN)
+      // if day is not a known RTE day and has been received
+      if ((rte_tempo_status.arr_day[index].proba < RTE_TEMPO_KNOWN) && (rte_stream.arr_level[index] != UINT8_MAX))
       {
-        // calculate current day
-        BreakTime (time_start, time_day);
-        sprintf_P (str_text, PSTR ("%04u-%02u-%02u"), time_day.year + 1970, time_day.month, time_day.day_of_month);
+        // update day
+        rte_tempo_status.arr_day[index].level = rte_stream.arr_level[index];
+        rte_tempo_status.arr_day[index].proba = RTE_TEMPOLIGHT_KNOWN;
 
-        // detect stream section
-        pstr_color = json_result[F ("values")][str_text].as<const char*>();
-        if (pstr_color != nullptr)
-        {
-          // update day
-          rte_tempo_status.arr_day[index].level = max (0, GetCommandCode (str_color, sizeof (str_color), pstr_color, kTeleinfoRteTempoJSON));
-          rte_tempo_status.arr_day[index].proba = RTE_TEMPOLIGHT_KNOWN;
-
-          // log update
-          AddLog (LOG_LEVEL_INFO, PSTR ("RTE: TempoLight - %s = %s)"), str_text, str_color);
-        }
+        // log update
+        GetTextIndexed (str_color, sizeof (str_color), rte_stream.arr_level[index], kTeleinfoRteTempoJSON);
+        AddLog (LOG_LEVEL_INFO, PSTR ("RTE: TempoLight - %s = %s)"), rte_stream.arr_date[index], str_color);
       }
-
-      // set next day
-      time_start += 86400;
     }
   }
 
-  // declare query
-  TeleinfoDriverWebDeclare (TIC_WEB_HTTPS);
+  // plan next step
+  TeleinfoRteRequestEnd (RTE_UPDATE_TEMPOLIGHT, is_ok);
+}
 
-  return is_ok;
+// tempo light request
+bool TeleinfoRteTempoLightRequest ()
+{
+  return TeleinfoHttpsQueue (TIC_HTTPS_EP_TEMPOLIGHT, RTE_URL_TEMPOLIGHT_DATA, nullptr, false, nullptr, TeleinfoRteTempoLightParse, TeleinfoRteTempoLightReceived);
 }
 
 /***********************************\
@@ -1461,7 +1455,7 @@ uint32_t TeleinfoRteOpenDpeNextUpdate (const bool need_retry)
   result = LocalTime ();
 
   // calculate next update slot
-  if (need_retry) result += RTE_OPENDPE_DELAY_RETRY;          // reading should be retried
+  if (need_retry) result += TeleinfoHttpsRetryDelay (TIC_HTTPS_EP_OPENDPE, RTE_OPENDPE_DELAY_RETRY);          // reading should be retried
   else if (hour < 8)  result += 3600 * (8 - hour);            // before 8h, plan after 8h
   else if (hour < 16) result += 3600 * (16 - hour);           // before 16h, plan after 16h
   else                result += 3600 * (24 + 8 - hour);       // after 16h, plan tomorrow after 8h
@@ -1469,115 +1463,82 @@ uint32_t TeleinfoRteOpenDpeNextUpdate (const bool need_retry)
   return result;
 }
 
-// open dpe stream reception
-bool TeleinfoRteOpenDpeStream ()
-{
-  bool        is_ok, daysleft, found;
-  int         index, position, size, http_code;
-  uint32_t    time_start;
-  int32_t     time_response;
-  TIME_T      time_day;
-  const char *pstr_date;
-  char        str_color[8];
-  char        str_text[64];
-  String      str_result;
-  JsonDocument     json_result;
-  HTTPClientLight *phttp;
-
-  // create connexion
-  phttp = new HTTPClientLight ();
-  is_ok = (phttp != nullptr);
-  if (is_ok)
-  {
-    // connexion
-    strcpy_P (str_text, RTE_URL_OPENDPE_DATA);
-    is_ok = phttp->begin (str_text);
-    if (is_ok)
-    {
-      // set timeout and headers
-      phttp->setTimeout (RTE_HTTPS_TIMEOUT);
-      phttp->addHeader (F ("Accept"), F ("application/json"), false, true);
-
-      // connexion
-      time_start = millis ();
-      http_code = phttp->GET ();
-      time_response = TimePassedSince (time_start);
-
-      // if success, collect result
-      is_ok = ((http_code == HTTP_CODE_OK) || (http_code == HTTP_CODE_MOVED_PERMANENTLY));
-      if (is_ok) str_result = phttp->getString ();
-      is_ok = !str_result.isEmpty ();
-    
-      // end connexion
-      phttp->end ();
-      
-      // log
-      AddLog (LOG_LEVEL_INFO, PSTR ("RTE: OpenDPE - [%d] %u char in %d ms"), http_code, str_result.length (), time_response);
-    }
+// open dpe JSON value reception (HTTPS task)
+void TeleinfoRteOpenDpeParse (tic_json_parser &parser, const char *pstr_value)
+{
+  uint8_t  index;
+  uint16_t position;
+  char     str_color[8];
 
-    else AddLog (LOG_LEVEL_INFO, PSTR ("RTE: OpenDPE - Connexion begin failed"));
+  // check section
+  position = TeleinfoJsonIndex (parser, 0);
+  if (position >= RTE_DAY_MAX) return;
 
-    // delete connexion
-    delete phttp;
+  // date : look for matching day
+  if (TeleinfoJsonMatch (parser, PSTR ("[*].date")))
+  {
+    for (index = RTE_DAY_TODAY; index < RTE_DAY_MAX; index ++)
+      if (strcmp (pstr_value, rte_stream.arr_date[index]) == 0) rte_stream.arr_opendpe[position].day = index;
   }
-  else AddLog (LOG_LEVEL_INFO, PSTR ("RTE: OpenDPE - Connexion creation failed"));
+
+  // color, probability and tempo days left
+  else if (TeleinfoJsonMatch (parser, PSTR ("[*].tempo_color"))) rte_stream.arr_opendpe[position].level = max (0, GetCommandCode (str_color, sizeof (str_color), pstr_value, kRteOpenDpeColorJSON));
+  else if (TeleinfoJsonMatch (parser, PSTR ("[*].probability"))) rte_stream.arr_opendpe[position].proba = (uint8_t)(100 * atof (pstr_value));
+  else if (TeleinfoJsonMatch (parser, PSTR ("[*].stock_blanc"))) rte_stream.arr_opendpe[position].white = (uint8_t)atoi (pstr_value);
+  else if (TeleinfoJsonMatch (parser, PSTR ("[*].stock_rouge"))) rte_stream.arr_opendpe[position].red   = (uint8_t)atoi (pstr_value);
+}
+
+// open dpe reception
+void TeleinfoRteOpenDpeReceived (tic_https_request &request)
+{
+  bool    is_ok, daysleft;
+  uint8_t index, position;
+  char    str_color[8];
+
+  // log
+  AddLog (LOG_LEVEL_INFO, PSTR ("RTE: OpenDPE - [%d] %u bytes in %u ms"), request.http_code, request.size, request.arr_stage[TIC_HTTPS_STAGE_CONNECT] + request.arr_stage[TIC_HTTPS_STAGE_REQUEST] + request.arr_stage[TIC_HTTPS_STAGE_BODY]);
 
   // process received data
+  is_ok = request.valid;
   if (is_ok)
   {
-    // extract token from JSON
-    deserializeJson (json_result, str_result.c_str ());
-
     // loop thru days
-    daysleft   = false;
-    time_start = LocalTime ();
+    daysleft = false;
     for (index = RTE_DAY_TODAY; index < RTE_DAY_MAX; index ++)
     {
       // if day is not a known RTE day
-      if ((rte_tempo_status.arr_day[index].proba != RTE_TEMPO_KNOWN) && (rte_tempo_status.arr_day[index].proba != RTE_TEMPOLIGHT_KNOWN))
-      {
-        // calculate current day
-        BreakTime (time_start, time_day);
-        sprintf_P (str_text, PSTR ("%04u-%02u-%02u"), time_day.year + 1970, time_day.month, time_day.day_of_month);
+      if ((rte_tempo_status.arr_day[index].proba == RTE_TEMPO_KNOWN) || (rte_tempo_status.arr_day[index].proba == RTE_TEMPOLIGHT_KNOWN)) continue;
 
-        // detect stream section
-        found = false;
-        for (position = 0; position < 9; position ++)
-        {
-          pstr_date = json_result[position][F ("date")].as<const char*>();
-          if (pstr_date != nullptr) found = (strcmp (str_text, pstr_date) == 0);
-          if (found) break;
-        }
+      // look for matching section
+      for (position = 0; position < RTE_DAY_MAX; position ++) if (rte_stream.arr_opendpe[position].day == index) break;
+      if (position == RTE_DAY_MAX) continue;
 
-        // if section found
-        if (found)
-        {
-          // set color and probability
-          rte_tempo_status.arr_day[index].level = max (0, GetCommandCode (str_color, sizeof (str_color), json_result[position][F ("tempo_color")].as<const char*>(), kRteOpenDpeColorJSON));
-          rte_tempo_status.arr_day[index].proba = (uint8_t)(100 * json_result[position][F ("probability")].as<float>());
-
-          // log update
-          AddLog (LOG_LEVEL_INFO, PSTR ("RTE: OpenDPE - %s = %s, %u%%)"), str_text, str_color, rte_tempo_status.arr_day[index].proba);
-
-          // if needed, update tempo days left
-          if (!daysleft)
-          {
-            rte_tempo_status.left.white = (uint8_t)(json_result[position][F ("stock_blanc")].as<unsigned short>());
-            rte_tempo_status.left.red   = (uint8_t)(json_result[position][F ("stock_rouge")].as<unsigned short>());
-            daysleft = true;
-          }
-        }
-      }
+      // set color and probability
+      rte_tempo_status.arr_day[index].level = rte_stream.arr_opendpe[position].level;
+      rte_tempo_status.arr_day[index].proba = rte_stream.arr_opendpe[position].proba;
 
-      // set next day
-      time_start += 86400;
+      // log update
+      GetTextIndexed (str_color, sizeof (str_color), rte_tempo_status.arr_day[index].level, kRteOpenDpeColorJSON);
+      AddLog (LOG_LEVEL_INFO, PSTR ("RTE: OpenDPE - %s = %s, %u%%)"), rte_stream.arr_date[index], str_color, rte_tempo_status.arr_day[index].proba);
+
+      // if needed, update tempo days left
+      if (!daysleft)
+      {
+        rte_tempo_status.left.white = rte_stream.arr_opendpe[position].white;
+        rte_tempo_status.left.red   = rte_stream.arr_opendpe[position].red;
+        daysleft = true;
+      }
     }
   }
 
-  // declare query
-  TeleinfoDriverWebDeclare (TIC_WEB_HTTPS);
+  // plan next step
+  TeleinfoRteRequestEnd (RTE_UPDATE_OPENDPE, is_ok);
+}
 
-  return is_ok;
+// open dpe request
+bool TeleinfoRteOpenDpeRequest ()
+{
+  return TeleinfoHttpsQueue (TIC_HTTPS_EP_OPENDPE, RTE_URL_OPENDPE_DATA, nullptr, false, nullptr, TeleinfoRteOpenDpeParse, TeleinfoRteOpenDpeReceived);
 }
 
 /***********************************\
@@ -1598,7 +1559,7 @@ uint32_t TeleinfoRtePointeNextUpdate (const bool need_retry)
   result = LocalTime ();
 
   // if stream reading should be retried, else plan next update
-  if (need_retry) result += RTE_POINTE_DELAY_RETRY;
+  if (need_retry) result += TeleinfoHttpsRetryDelay (TIC_HTTPS_EP_POINTE, RTE_POINTE_DELAY_RETRY);
     else result += RTE_POINTE_DELAY_RENEW;
 
   return result;
@@ -1639,101 +1600,66 @@ uint8_t TeleinfoRtePointeGetLevel (const uint8_t day, const uint8_t slot)
   return level;
 }
 
-// start of pointe period reception
-bool TeleinfoRtePointeStream ()
+// pointe period JSON value reception (HTTPS task)
+void TeleinfoRtePointeParse (tic_json_parser &parser, const char *pstr_value)
 {
-  bool      is_ok;
-  int       http_code;
-  uint16_t  size;
-  uint32_t  time_start;
-  int32_t   time_response;
-  char      str_text[256];
-  String    str_result;
-  JsonArray arr_day;
-  JsonDocument     json_result;
-  HTTPClientLight *phttp;
+  uint16_t index;
 
-  // check token
-  if (strlen (rte_update.str_token) == 0)
-  {
-    AddLog (LOG_LEVEL_INFO, PSTR ("RTE: Pointe - Token missing"));
-    return false;
-  }
-
-  // create connexion
-  phttp = new HTTPClientLight ();
-  is_ok = (phttp != nullptr);
-  if (is_ok)
-  {
-    // connexion
-    sprintf (str_text, "%s", RTE_URL_POINTE_DATA);
-    AddLog (LOG_LEVEL_DEBUG, PSTR ("RTE: Pointe - %s"), str_text);
+  // check path
+  if (!TeleinfoJsonMatch (parser, PSTR ("signals[0].signaled_dates[*].aoe_signals"))) return;
 
-    // connexion
-    is_ok = phttp->begin (str_text);
-    if (is_ok)
-    {
-      // set authorisation
-      strcpy_P (str_text, PSTR ("Bearer "));
-      strlcat (str_text, rte_update.str_token, sizeof (str_text) - 1);
-
-      // set timeout and headers
-      phttp->setTimeout (RTE_HTTPS_TIMEOUT);
-      phttp->addHeader (F ("Authorization"), str_text, false, true);
-      phttp->addHeader (F ("Accept"), F ("application/json"), false, true);
-
-      // check connexion status
-      time_start = millis ();
-      http_code = phttp->GET ();
-      time_response = TimePassedSince (time_start);
-
-      // if success, collect result
-      is_ok = ((http_code == HTTP_CODE_OK) || (http_code == HTTP_CODE_MOVED_PERMANENTLY));
-      if (is_ok) str_result = phttp->getString ();
-      is_ok = !str_result.isEmpty ();
-
-      // end connexion
-      phttp->end ();
-      
-      // log
-      AddLog (LOG_LEVEL_INFO, PSTR ("RTE: Pointe - [%d] %u char in %d ms"), http_code, str_result.length (), time_response);
-    }
+  // update number of received days and day level (tomorrow first)
+  index = TeleinfoJsonIndex (parser, 3);
+  rte_stream.count = max (rte_stream.count, (uint16_t)(index + 1));
+  if (index < 2) rte_stream.arr_level[index] = (uint8_t)min (1 + atoi (pstr_value), (int)RTE_POINTE_LEVEL_RED);
+}
 
-    else AddLog (LOG_LEVEL_INFO, PSTR ("RTE: Pointe - Connexion begin failed"));
-  }
+// pointe period reception
+void TeleinfoRtePointeReceived (tic_https_request &request)
+{
+  bool is_ok;
 
-  else AddLog (LOG_LEVEL_INFO, PSTR ("RTE: Pointe - Connexion creation failed"));
+  // log
+  AddLog (LOG_LEVEL_INFO, PSTR ("RTE: Pointe - [%d] %u bytes in %u ms"), request.http_code, request.size, request.arr_stage[TIC_HTTPS_STAGE_CONNECT] + request.arr_stage[TIC_HTTPS_STAGE_REQUEST] + request.arr_stage[TIC_HTTPS_STAGE_BODY]);
 
   // process received data
+  is_ok = request.valid;
   if (is_ok)
   {
-    // extract token from JSON
-    deserializeJson (json_result, str_result.c_str ());
-
-    // check array size
-    arr_day = json_result[F ("signals")][0][F ("signaled_dates")].as<JsonArray>();
-    size = arr_day.size ();
-
-    // if both days are available
-    if (size == 2)
+    // if both days are available, set tomorrow and today
+    if (rte_stream.count == 2)
     {
-      // set tomorrow
-      rte_pointe_status.arr_day[RTE_DAY_TOMORROW] = 1 + arr_day[0][F ("aoe_signals")].as<unsigned int>();
-      if (rte_pointe_status.arr_day[RTE_DAY_TOMORROW] > RTE_POINTE_LEVEL_RED) rte_pointe_status.arr_day[RTE_DAY_TOMORROW] = RTE_POINTE_LEVEL_RED;
-
-      // set today
-      rte_pointe_status.arr_day[RTE_DAY_TODAY] = 1 + arr_day[1][F ("aoe_signals")].as<unsigned int>();
-      if (rte_pointe_status.arr_day[RTE_DAY_TODAY] > RTE_POINTE_LEVEL_RED) rte_pointe_status.arr_day[RTE_DAY_TODAY] = RTE_POINTE_LEVEL_RED;
+      rte_pointe_status.arr_day[RTE_DAY_TOMORROW] = rte_stream.arr_level[0];
+      rte_pointe_status.arr_day[RTE_DAY_TODAY]    = rte_stream.arr_level[1];
     }
 
     // log
     AddLog (LOG_LEVEL_INFO, PSTR ("RTE: Pointe - Update done (%d-%d-%d)"), rte_pointe_status.arr_day[RTE_DAY_YESTERDAY], rte_pointe_status.arr_day[RTE_DAY_TODAY], rte_pointe_status.arr_day[RTE_DAY_TOMORROW]);
   }
 
-  // declare query
-  TeleinfoDriverWebDeclare (TIC_WEB_HTTPS);
+  // plan next step
+  TeleinfoRteRequestEnd (RTE_UPDATE_POINTE, is_ok);
+}
+
+// pointe period request
+bool TeleinfoRtePointeRequest ()
+{
+  char str_auth[TIC_HTTPS_AUTH_SIZE];
+
+  // check token
+  if (strlen (rte_update.str_token) == 0)
+  {
+    AddLog (LOG_LEVEL_INFO, PSTR ("RTE: Pointe - Token missing"));
+    return false;
+  }
+  AddLog (LOG_LEVEL_DEBUG, PSTR ("RTE: Pointe - %s"), RTE_URL_POINTE_DATA);
+
+  // set authorisation
+  strcpy_P (str_auth, PSTR ("Bearer "));
+  strlcat (str_auth, rte_update.str_token, sizeof (str_auth));
 
-  return is_ok;
+  // queue request
+  return TeleinfoHttpsQueue (TIC_HTTPS_EP_POINTE, RTE_URL_POINTE_DATA, str_auth, false, nullptr, TeleinfoRtePointeParse, TeleinfoRtePointeReceived);
 }
 
 // Append Pointe data to SENSOR
@@ -1838,6 +1764,9 @@ void TeleinfoRteInit ()
 
   // load data file
   TeleinfoRteLoadData ();
+
+  // register to publication scheduler
+  TeleinfoSchedulerRegister (TIC_PRODUCER_RTE, TeleinfoRtePubPending, TeleinfoRtePubPublish);
   
   // log help command
   AddLog (LOG_LEVEL_INFO, PSTR ("HLP: Run rte to get help on RTE integration"));
@@ -1850,8 +1779,6 @@ void TeleinfoRteInit ()
 void TeleinfoRteEverySecond ()
 {
   bool     result;
-//  uint8_t  period, level;
-  uint8_t  level;
   uint32_t time_now, time_next;
   char     str_text[32];
 
@@ -1919,98 +1846,11 @@ void TeleinfoRteEverySecond ()
       else if (rte_update.time_pointe     <= time_now) rte_update.step = RTE_UPDATE_POINTE;       // priority 6 : check for Pointe update
       break;
 
-    // Open DPE reception
-    case RTE_UPDATE_OPENDPE:
-      if (TeleinfoDriverWebAllow (TIC_WEB_HTTPS))
-      {
-        // update data and calculate next update slot
-        result = TeleinfoRteOpenDpeStream ();
-        rte_update.time_opendpe = TeleinfoRteOpenDpeNextUpdate (!result);
-        AddLog (LOG_LEVEL_INFO, PSTR ("RTE: OpenDPE - %s"), TeleinfoRteGetDelay (rte_update.time_opendpe, str_text, sizeof (str_text)));
-
-        // init next step
-        rte_update.step = RTE_UPDATE_NONE; 
-      }
+    // stream reception in progress or to be started
+    default:
+      if (!rte_update.pending && TeleinfoDriverWebAllow (TIC_WEB_HTTPS)) TeleinfoRteRequestStart ();
       break;
-
-    // Tempo Light reception
-    case RTE_UPDATE_TEMPOLIGHT:
-      if (TeleinfoDriverWebAllow (TIC_WEB_HTTPS))
-      {
-        // update data and calculate next update slot
-        result = TeleinfoRteTempoLightStream ();
-        rte_update.time_tempolight = TeleinfoRteTempoLightNextUpdate (!result);
-        AddLog (LOG_LEVEL_INFO, PSTR ("RTE: TempoLight - %s"), TeleinfoRteGetDelay (rte_update.time_tempolight, str_text, sizeof (str_text)));
-
-        // init next step
-        rte_update.step = RTE_UPDATE_NONE; 
-      }
-      break;
-
-    // token reception
-    case RTE_UPDATE_TOKEN:
-      if (TeleinfoDriverWebAllow (TIC_WEB_HTTPS))
-      {
-        // init token update
-        result = TeleinfoRteStreamToken ();
-        AddLog (LOG_LEVEL_INFO, PSTR ("RTE: Token - %s"), TeleinfoRteGetDelay (rte_update.time_token, str_text, sizeof (str_text)));
-
-        // if failure
-        if (!result)
-        {
-          // update RTE stream planification
-          rte_update.time_tempo   = max (rte_update.time_token, rte_update.time_tempo);
-          rte_update.time_pointe  = max (rte_update.time_token, rte_update.time_pointe);
-          rte_update.time_ecowatt = max (rte_update.time_token, rte_update.time_ecowatt);
-        }
-
-        // init next step
-        rte_update.step = RTE_UPDATE_NONE; 
-      }
-      break;
-
-    // ecowatt reception
-    case RTE_UPDATE_ECOWATT:
-      if (TeleinfoDriverWebAllow (TIC_WEB_HTTPS))
-      {
-        // update data and calculate next update slot
-        result = TeleinfoRteEcowattStream ();
-        rte_update.time_ecowatt = TeleinfoRteEcowattNextUpdate (!result);
-        AddLog (LOG_LEVEL_INFO, PSTR ("RTE: Ecowatt - %s"), TeleinfoRteGetDelay (rte_update.time_ecowatt, str_text, sizeof (str_text)));
-
-        // init next step
-        rte_update.step = RTE_UPDATE_NONE; 
-      }
-      break;
-
-    // tempo reception
-    case RTE_UPDATE_TEMPO:
-      if (TeleinfoDriverWebAllow (TIC_WEB_HTTPS))
-      {
-        // update data and calculate next update slot
-        result = TeleinfoRteTempoStream ();
-        rte_update.time_tempo = TeleinfoRteTempoNextUpdate (!result);
-        AddLog (LOG_LEVEL_INFO, PSTR ("RTE: Tempo - %s"), TeleinfoRteGetDelay (rte_update.time_tempo, str_text, sizeof (str_text)));
-
-        // init next step
-        rte_update.step = RTE_UPDATE_NONE; 
-      }
-      break;
-      
-    // pointe reception
-    case RTE_UPDATE_POINTE:
-      if (TeleinfoDriverWebAllow (TIC_WEB_HTTPS))
-      {
-        // update data and calculate next update slot
-        result = TeleinfoRtePointeStream ();
-        rte_update.time_pointe = TeleinfoRtePointeNextUpdate (!result);
-        AddLog (LOG_LEVEL_INFO, PSTR ("RTE: Pointe - %s"), TeleinfoRteGetDelay (rte_update.time_pointe, str_text, sizeof (str_text)));
-
-        // init next step
-        rte_update.step = RTE_UPDATE_NONE;
-      }
-      break;
-    }
+  }
 
   // check for tempo JSON update
   if (rte_config.tempo.enabled)
@@ -2033,8 +1873,23 @@ void TeleinfoRteEverySecond ()
     rte_update.publish |= (rte_ecowatt_status.time_json <= time_now);
   }
 
-  // if needed, publish TEMPO, POINTE and/or ECOWATT
-  if (rte_update.publish && TeleinfoDriverWebAllow (TIC_WEB_MQTT)) TeleinfoRtePublishJson ();
+}
+
+// scheduler : priority of next message (TEMPO, POINTE and/or ECOWATT)
+uint8_t TeleinfoRtePubPending (uint16_t &backlog)
+{
+  if (!rte_update.publish) return TIC_PRIO_MAX;
+
+  backlog = 1;
+  return TIC_PRIO_TOTAL;
+}
+
+// scheduler : publish TEMPO, POINTE and/or ECOWATT
+bool TeleinfoRtePubPublish ()
+{
+  TeleinfoRtePublishJson ();
+
+  return (ResponseLength () > 0);
 }
 
 // Append RTE data to SENSOR
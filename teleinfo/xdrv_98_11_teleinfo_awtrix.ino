@@ -11,6 +11,7 @@
     23/09/2025 v2.3 - Handle publication for Winky with deepsleep on super capa
     01/03/2026 v3.0 - Complete rework (api/mqtt, colors, ...)
                       Data are now saved on FS
+    16/10/2026 v3.1 - Send API publications thru driver request engine
 
   Previous configuration values were stored in :
 
@@ -54,8 +55,6 @@
 #define AWTRIX_LUX_MIN_DEFAULT          10            // minimum Lux level
 #define AWTRIX_LUX_MAX_DEFAULT          1000          // maximum Lux level
 #define AWTRIX_LUX_REF_DEFAULT          100000        // reference Lux level
-#define AWTRIX_CONNECT_TIMEOUT          250           // connexion timeout to Awtrix device (ms)
-#define AWTRIX_ANSWER_TIMEOUT           1000          // result timeout to Awtrix device (ms)
 
 // data file
 #define AWTRIX_FILE_VERSION             1
@@ -376,9 +375,8 @@ uint8_t TeleinfoAwtrixGenerateDigit (const uint32_t value, char *pstr_digit, con
 // publish data thru REST API
 void TeleinfoAwtrixPublishAPI (const uint8_t type)
 {
-  const char      *pstr_type;
-  char             str_url[48];
-  HTTPClientLight *phttp_client;
+  const char *pstr_type;
+  char        str_url[48];
 
   // check parameter
   if (type >= TIC_AWTRIX_TYPE_MAX) return;
@@ -387,25 +385,11 @@ void TeleinfoAwtrixPublishAPI (const uint8_t type)
   if (type == TIC_AWTRIX_TYPE_SETTING) pstr_type = PSTR ("settings");
     else pstr_type = PSTR ("custom?name=tic");
 
-  // declare publication
-  TeleinfoDriverWebDeclare (TIC_WEB_HTTP);
-
   // generate URL
   sprintf_P (str_url, PSTR ("http://%s/api/%s"), awtrix_config.str_device, pstr_type); 
 
-  // call awtrix device
-  phttp_client = new HTTPClientLight ();  
-  phttp_client->begin (str_url);
-
-  // send command
-  phttp_client->setConnectTimeout (AWTRIX_CONNECT_TIMEOUT);
-  phttp_client->setTimeout (AWTRIX_ANSWER_TIMEOUT);
-  phttp_client->addHeader (F ("Content-Type"), F ("application/json"));
-  phttp_client->POST (TasmotaGlobal.mqtt_data);
-
-  // end connexion
-  phttp_client->end ();
-  delete phttp_client;
+  // queue publication, web access is declared once sent
+  if (!TeleinfoHttpsQueue (TIC_HTTPS_EP_AWTRIX, str_url, nullptr, true, ResponseData (), nullptr, nullptr)) AddLog (LOG_LEVEL_DEBUG, PSTR ("API: %s not queued"), str_url);
 
   // log
   AddLog (LOG_LEVEL_DEBUG, PSTR ("API: %s = %s"), str_url, ResponseData ());
@@ -745,6 +729,7 @@ void TeleinfoAwtrixEverySecond ()
   // check if publication can be done
   if (awtrix_config.time_upd > LocalTime ()) return;
   if (!TeleinfoDriverWebAllow (TIC_WEB_HTTP)) return;
+  if (!awtrix_config.use_mqtt && TeleinfoHttpsIsPending (TIC_HTTPS_EP_AWTRIX)) return;
 
   // if needed display parameters, else 
   if (!awtrix_status.init) awtrix_status.init = TeleinfoAwtrixUpdateParameters ();
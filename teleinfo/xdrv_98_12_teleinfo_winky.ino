@@ -15,6 +15,11 @@
     01/08/2025 v3.1 - Add winky_display command
     19/09/2025 v3.2 - Hide and Show with click on main page display
     12/10/2025 v3.3 - Change on winky_max command
+    16/10/2026 v3.4 - Fast resume of meter and contract data from RTC memory after deepsleep
+                      Add wake-to-publish time
+                      Adaptive deepsleep based on learnt charge rate and wake phases cost
+                      Batch integrations publication according to energy budget
+    16/10/2026 v3.5 - Energy model as pure functions, shared with host simulation (tools/winky-sim)
 
   Configuration values are stored in :
     - Settings->knx_GA_addr[0..2] : multiplicator
@@ -76,6 +81,11 @@
 #define WINKY_LINKY_DISCHARGED     7000                               // minimum linky voltage to consider as low
 #define WINKY_LINKY_CRITICAL       5000                               // minimum linky voltage to consider as very low
 
+#define WINKY_RESUME_MAGIC         0x57494E4B                         // fast resume snapshot marker
+
+#define WINKY_TARGET_MARGIN        100                                // margin added to calculated wake-up voltage (mV)
+#define WINKY_BATCH_MAX            10                                 // maximum number of wake-up between integrations publication
+
 /***************************************\
  *               Variables
 \***************************************/
@@ -95,6 +105,15 @@ enum TeleinfoWinkyVolt  { WINKY_VCAP_START, WINKY_VCAP_STOP, WINKY_VCAP_BOOT, WI
 enum  TeleinfoWinkyLevel                    { WINKY_LEVEL_CRITICAL, WINKY_LEVEL_DISCHARGED, WINKY_LEVEL_CORRECT, WINKY_LEVEL_CHARGED, WINKY_LEVEL_MAX };  // voltage levels
 const char kTeleinfoWinkyColor[] PROGMEM    =       "red"        "|"     "orange"        "|"     "yellow"     "|"     "white";                            // level display color
 
+// wake-up phases
+//  - WINKY_PHASE_WIFI    : from boot to IP address
+//  - WINKY_PHASE_CONNECT : from IP address to MQTT connexion (TLS included)
+//  - WINKY_PHASE_MEASURE : from MQTT connexion to suspend (TIC reception)
+//  - WINKY_PHASE_PUBLISH : SENSOR and TIC publication
+//  - WINKY_PHASE_BATCH   : integrations publication (Domoticz, Homie, Thingsboard, InfluxDB, Awtrix)
+enum  TeleinfoWinkyPhase                    { WINKY_PHASE_WIFI, WINKY_PHASE_CONNECT, WINKY_PHASE_MEASURE, WINKY_PHASE_PUBLISH, WINKY_PHASE_BATCH, WINKY_PHASE_MAX };
+const char kTeleinfoWinkyPhase[] PROGMEM    =       "wifi"     "|"     "connect"     "|"     "measure"     "|"     "publish"     "|"     "batch";
+
 /***************************************\
  *                  Data
 \***************************************/
@@ -110,6 +129,7 @@ struct winky_time {                 // ms
   uint32_t wifi;                    // wifi connexion timestamp
   uint32_t rtc;                     // RTC synchro timestamp
   uint32_t mqtt;                    // MQTT connexion timestamp
+  uint32_t publish;                 // first MQTT publication timestamp
   uint32_t capa;                    // Capa discharge timestamp
 };
 
@@ -129,11 +149,19 @@ struct winky_meter {
   uint32_t volt;                    // meter max voltage (mV)
 };
 
+struct winky_mark {
+  uint32_t time;                    // timestamp of last phase end (ms)
+  uint32_t volt;                    // capa voltage at last phase end (mV)
+};
+
 struct {
   bool         enabled   = false;       // flag set if winky configured
   bool         display   = false;       // flag set if winky is displayed in main mage
   bool         suspend   = false;       // flag set if suspending soon
+  bool         resumed   = false;       // flag set if data have been resumed from RTC memory
+  bool         batch     = true;        // flag set if integrations are published during this wake-up
   uint32_t     deepsleep = 0;           // calculated deepsleep time (ms)
+  winky_mark   mark;
   winky_meter  meter;
   winky_farad  farad;
   winky_volt   volt;
@@ -144,11 +172,42 @@ struct {
 } teleinfo_winky;
 
 RTC_DATA_ATTR struct {               // data in NVRAM to survive deepsleep
+  uint8_t  batch;                    // number of wake-up between integrations publication
+  uint32_t nb_wake;                  // number of wake-up from deepsleep
   uint32_t delay_ms;                 // last deepsleep delay (ms)
   uint32_t volt_mv;                  // last deepsleep voltage (mV)
+  uint32_t target_mv;                // calculated wake-up voltage (mV)
   uint32_t charge_mw;                // average charging power during deepsleep (mW)
+  uint32_t awake_ms;                 // average awake time (ms)
+  uint32_t arr_cost_mj[WINKY_PHASE_MAX];  // average energy cost of wake-up phases (mJ)
 } teleinfo_winky_sleep;
 
+// snapshot of data detected during previous cycle, to start publishing
+// right after wake-up (no speed detection, no contract file, no meter identification)
+struct winky_resume_data {
+  uint16_t    baudrate;                                 // serial speed
+  uint8_t     mode;                                     // meter mode
+  uint8_t     unit;                                     // contract unit
+  uint8_t     phase;                                    // number of phases
+  uint8_t     period;                                   // current period index
+  uint8_t     company;                                  // meter manufacturer
+  uint8_t     model;                                    // meter model
+  char        sep_line;                                 // line separator
+  uint16_t    year;                                     // meter year
+  long        isousc;                                   // contract max current per phase
+  long        ssousc;                                   // contract max power per phase
+  long long   ident;                                    // meter serial number
+  char        str_period[TIC_PERIOD_CODE_SIZE];         // code of current period
+  tic_cal_day arr_calendar[TIC_DAY_MAX];                // calendar days
+  uint8_t     arr_contract_db[sizeof (teleinfo_contract_db)];  // contract periods database
+};
+
+RTC_DATA_ATTR struct {               // data in NVRAM to survive deepsleep
+  uint32_t          magic;           // snapshot marker
+  uint32_t          crc;             // CRC32 of snapshot data
+  winky_resume_data data;            // snapshot data
+} teleinfo_winky_resume;
+
 /************************\
  *        Commands
 \************************/
@@ -413,6 +472,77 @@ void TeleinfoWinkyReadVoltageLinky ()
   }
 }
 
+/************************************\
+ *   Energy model (pure functions)
+\************************************/
+
+// These functions only depend on their parameters, so the same code
+// is compiled by the host capacitor simulation (tools/winky-sim)
+
+// average with previous value (first value is taken as is)
+uint32_t TeleinfoWinkyCalculateAverage (const uint32_t previous, const uint32_t value)
+{
+  if (previous == 0) return value;
+    else return (3 * previous + value) / 4;
+}
+
+// energy consumed during a phase (mJ) : capacitor discharge plus Linky supply during the phase
+uint32_t TeleinfoWinkyCalculatePhaseCost (const uint32_t high_mv, const uint32_t low_mv, const uint32_t capa_mf, const uint32_t charge_mw, const uint32_t duration_ms)
+{
+  float high_v, low_v, capa_f, energy_mj;
+
+  // collect data
+  high_v = (float)high_mv / 1000;
+  low_v  = (float)low_mv  / 1000;
+  capa_f = (float)capa_mf / 1000;
+
+  // capacitor energy variation and energy supplied by Linky (mJ)
+  energy_mj = 500 * capa_f * (high_v * high_v - low_v * low_v) + (float)charge_mw * duration_ms / 1000;
+  if (energy_mj < 0) energy_mj = 0;
+
+  return (uint32_t)energy_mj;
+}
+
+// capa voltage needed at wake-up to spend cost_mj during awake_ms without going under stop_mv
+uint32_t TeleinfoWinkyCalculateTargetVoltage (const uint32_t cost_mj, const uint32_t awake_ms, const uint32_t charge_mw, const uint32_t stop_mv, const uint32_t capa_mf)
+{
+  float stop_v, capa_f, energy_mj, target_v;
+
+  // check parameters
+  if (capa_mf == 0) return stop_mv + WINKY_TARGET_MARGIN;
+
+  // collect data
+  stop_v = (float)stop_mv / 1000;
+  capa_f = (float)capa_mf / 1000;
+
+  // energy to be taken from capacitor (part of the cost is supplied by Linky while awake)
+  energy_mj = (float)cost_mj - (float)charge_mw * awake_ms / 1000;
+  if (energy_mj < 0) energy_mj = 0;
+
+  // needed voltage : E = 1/2 C (Vt² - Vs²)
+  target_v = sqrt (stop_v * stop_v + energy_mj / 500 / capa_f);
+
+  return (uint32_t)(target_v * 1000) + WINKY_TARGET_MARGIN;
+}
+
+// number of wake-up between integrations publication, so that integrations cost is spread
+// over enough cycles for Linky supply to recharge the capacitor within minimum deepsleep time
+uint8_t TeleinfoWinkyCalculateBatch (const uint32_t base_mj, const uint32_t batch_mj, const uint32_t awake_ms, const uint32_t charge_mw)
+{
+  uint32_t budget_mj, batch;
+
+  // energy supplied by Linky during a cycle with minimum deepsleep time (mJ)
+  budget_mj = charge_mw * (WINKY_SLEEP_MINIMUM + awake_ms) / 1000;
+
+  // if no batch cost, publish every time, if base cost exceeds budget, publish as rarely as possible
+  if (batch_mj == 0) batch = 1;
+    else if (budget_mj <= base_mj) batch = WINKY_BATCH_MAX;
+    else batch = (batch_mj + budget_mj - base_mj - 1) / (budget_mj - base_mj);
+
+  return (uint8_t)max ((uint32_t)1, min (batch, (uint32_t)WINKY_BATCH_MAX));
+}
+
+// average charging power (mW) from capacitor voltage rise during a delay
 uint32_t TeleinfoWinkyCalculateChargePower (const uint32_t high_mv, const uint32_t low_mv, const uint32_t capa_mf, const uint32_t delay_ms)
 {
   float high_v, low_v, capa_f, delay_s, energy_mj, power_mw;
@@ -433,6 +563,7 @@ uint32_t TeleinfoWinkyCalculateChargePower (const uint32_t high_mv, const uint32
   return (uint32_t)power_mw;
 }
 
+// time needed (ms) to charge capacitor from low to high voltage at given power
 uint32_t TeleinfoWinkyCalculateChargeTime (const uint32_t high_mv, const uint32_t low_mv, const uint32_t capa_mf, const uint32_t power_mw)
 {
   float high_v, low_v, capa_f, power_w, energy_mj, time_ms;
@@ -457,6 +588,65 @@ uint32_t TeleinfoWinkyCalculateChargeTime (const uint32_t high_mv, const uint32_
   return (uint32_t)time_ms;
 }
 
+// next wake-up plan : integrations batch ratio and needed wake-up voltage (start voltage if no cost known yet, never above)
+uint32_t TeleinfoWinkyCalculatePlan (const uint32_t *arr_cost_mj, const uint32_t nb_wake, const uint32_t awake_ms, const uint32_t charge_mw, const uint32_t start_mv, const uint32_t stop_mv, const uint32_t capa_mf, uint8_t &batch)
+{
+  uint8_t  phase;
+  uint32_t base_mj, cost_mj;
+
+  // cost of a wake-up without integrations
+  base_mj = 0;
+  for (phase = 0; phase < WINKY_PHASE_BATCH; phase ++) base_mj += arr_cost_mj[phase];
+
+  // integrations batch ratio
+  batch = TeleinfoWinkyCalculateBatch (base_mj, arr_cost_mj[WINKY_PHASE_BATCH], awake_ms, charge_mw);
+
+  // cost of next wake-up
+  cost_mj = base_mj;
+  if ((nb_wake + 1) % batch == 0) cost_mj += arr_cost_mj[WINKY_PHASE_BATCH];
+
+  // needed wake-up voltage
+  if (base_mj == 0) return start_mv;
+    else return min (start_mv, TeleinfoWinkyCalculateTargetVoltage (cost_mj, awake_ms, charge_mw, stop_mv, capa_mf));
+}
+
+/************************************\
+ *         Wake-up planning
+\************************************/
+
+// end of a wake-up phase : update its average energy cost
+void TeleinfoWinkyPhaseEnd (const uint8_t phase)
+{
+  uint32_t now, cost_mj;
+
+  // check parameter and battery mode
+  if (phase >= WINKY_PHASE_MAX) return;
+  if (!TeleinfoDriverIsOnBattery ()) return;
+
+  // read capa voltage and calculate phase cost
+  now = millis ();
+  TeleinfoWinkyReadVoltageCapa ();
+  cost_mj = TeleinfoWinkyCalculatePhaseCost (teleinfo_winky.mark.volt, teleinfo_winky.capa.volt, teleinfo_winky.farad.ref, teleinfo_winky_sleep.charge_mw, now - teleinfo_winky.mark.time);
+  teleinfo_winky_sleep.arr_cost_mj[phase] = TeleinfoWinkyCalculateAverage (teleinfo_winky_sleep.arr_cost_mj[phase], cost_mj);
+
+  // next phase starts now
+  teleinfo_winky.mark.time = now;
+  teleinfo_winky.mark.volt = teleinfo_winky.capa.volt;
+}
+
+// plan next wake-up : integrations batch ratio and needed wake-up voltage
+void TeleinfoWinkyPlanNextWake ()
+{
+  teleinfo_winky_sleep.target_mv = TeleinfoWinkyCalculatePlan (teleinfo_winky_sleep.arr_cost_mj, teleinfo_winky_sleep.nb_wake, teleinfo_winky_sleep.awake_ms, teleinfo_winky_sleep.charge_mw, teleinfo_winky.volt.start, teleinfo_winky.volt.stop, teleinfo_winky.farad.ref, teleinfo_winky_sleep.batch);
+}
+
+// minimum capa voltage to start a wake-up cycle
+uint32_t TeleinfoWinkyStartVoltage ()
+{
+  if ((Settings->deepsleep < 1000) && (teleinfo_winky_sleep.target_mv > 0)) return min (teleinfo_winky.volt.start, teleinfo_winky_sleep.target_mv);
+    else return teleinfo_winky.volt.start;
+}
+
 uint32_t TeleinfoWinkyCalculateSleepTime ()
 {
   uint32_t delay_ms;
@@ -467,11 +657,12 @@ uint32_t TeleinfoWinkyCalculateSleepTime ()
   // else if needed apply a multiplicator to awake time
   else if (Settings->deepsleep >= 1000) delay_ms = millis () * Settings->deepsleep / 1000;
 
-  // else read capa voltage and calculate estimated charging time to VSTART
+  // else read capa voltage and calculate estimated charging time to voltage needed by next wake-up
   else
   {
     TeleinfoWinkyReadVoltageCapa ();
-    delay_ms = TeleinfoWinkyCalculateChargeTime (teleinfo_winky.volt.start, teleinfo_winky.capa.volt, teleinfo_winky.farad.ref, teleinfo_winky_sleep.charge_mw);
+    TeleinfoWinkyPlanNextWake ();
+    delay_ms = TeleinfoWinkyCalculateChargeTime (teleinfo_winky_sleep.target_mv, teleinfo_winky.capa.volt, teleinfo_winky.farad.ref, teleinfo_winky_sleep.charge_mw);
   }
 
   // cap min and max deepsleep time
@@ -481,6 +672,107 @@ uint32_t TeleinfoWinkyCalculateSleepTime ()
   return delay_ms;
 }
 
+/************************************\
+ *     Fast resume after deepsleep
+\************************************/
+
+// calculate CRC32 of snapshot data
+uint32_t TeleinfoWinkyResumeCRC ()
+{
+  uint8_t  bit;
+  uint32_t index, crc;
+  uint8_t *pdata;
+
+  crc   = UINT32_MAX;
+  pdata = (uint8_t*)&teleinfo_winky_resume.data;
+  for (index = 0; index < sizeof (teleinfo_winky_resume.data); index++)
+  {
+    crc ^= pdata[index];
+    for (bit = 0; bit < 8; bit++) crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+  }
+
+  return ~crc;
+}
+
+// save snapshot of detected data before deepsleep
+void TeleinfoWinkyResumeSave ()
+{
+  uint8_t index;
+
+  // if no contract detected, snapshot is invalid
+  if (strlen (teleinfo_contract_db.str_code) == 0)
+  {
+    teleinfo_winky_resume.magic = 0;
+    return;
+  }
+
+  // meter and contract data (padding is cleared for CRC)
+  memset (&teleinfo_winky_resume.data, 0, sizeof (teleinfo_winky_resume.data));
+  teleinfo_winky_resume.data.baudrate = teleinfo_config.baudrate;
+  teleinfo_winky_resume.data.mode     = teleinfo_contract.mode;
+  teleinfo_winky_resume.data.unit     = teleinfo_contract.unit;
+  teleinfo_winky_resume.data.phase    = teleinfo_contract.phase;
+  teleinfo_winky_resume.data.period   = teleinfo_contract.period;
+  teleinfo_winky_resume.data.company  = teleinfo_meter.company;
+  teleinfo_winky_resume.data.model    = teleinfo_meter.model;
+  teleinfo_winky_resume.data.sep_line = teleinfo_meter.sep_line;
+  teleinfo_winky_resume.data.year     = teleinfo_meter.year;
+  teleinfo_winky_resume.data.isousc   = teleinfo_contract.isousc;
+  teleinfo_winky_resume.data.ssousc   = teleinfo_contract.ssousc;
+  teleinfo_winky_resume.data.ident    = teleinfo_meter.ident;
+  strlcpy (teleinfo_winky_resume.data.str_period, teleinfo_contract.str_period, sizeof (teleinfo_winky_resume.data.str_period));
+  for (index = 0; index < TIC_DAY_MAX; index ++) teleinfo_winky_resume.data.arr_calendar[index] = teleinfo_calendar[index];
+  memcpy (teleinfo_winky_resume.data.arr_contract_db, &teleinfo_contract_db, sizeof (teleinfo_contract_db));
+
+  // validate snapshot
+  teleinfo_winky_resume.crc   = TeleinfoWinkyResumeCRC ();
+  teleinfo_winky_resume.magic = WINKY_RESUME_MAGIC;
+}
+
+// on wake-up from deepsleep, restore snapshot (energy totals are already kept in RTC memory)
+bool TeleinfoWinkyResumeLoad ()
+{
+  uint8_t index;
+
+  // check wake-up cause and snapshot validity
+  teleinfo_winky.resumed = false;
+  if (ESP_SLEEP_WAKEUP_TIMER != esp_sleep_get_wakeup_cause ()) return false;
+  if (teleinfo_winky_resume.magic != WINKY_RESUME_MAGIC) return false;
+  if (teleinfo_winky_resume.crc != TeleinfoWinkyResumeCRC ()) return false;
+  if (teleinfo_winky_resume.data.baudrate != teleinfo_config.baudrate) return false;
+
+  // meter and contract data
+  teleinfo_contract.mode   = teleinfo_winky_resume.data.mode;
+  teleinfo_contract.unit   = teleinfo_winky_resume.data.unit;
+  teleinfo_contract.phase  = teleinfo_winky_resume.data.phase;
+  teleinfo_contract.period = teleinfo_winky_resume.data.period;
+  teleinfo_contract.isousc = teleinfo_winky_resume.data.isousc;
+  teleinfo_contract.ssousc = teleinfo_winky_resume.data.ssousc;
+  teleinfo_meter.company   = teleinfo_winky_resume.data.company;
+  teleinfo_meter.model     = teleinfo_winky_resume.data.model;
+  teleinfo_meter.sep_line  = teleinfo_winky_resume.data.sep_line;
+  teleinfo_meter.year      = teleinfo_winky_resume.data.year;
+  teleinfo_meter.ident     = teleinfo_winky_resume.data.ident;
+  strlcpy (teleinfo_contract.str_period, teleinfo_winky_resume.data.str_period, sizeof (teleinfo_contract.str_period));
+  for (index = 0; index < TIC_DAY_MAX; index ++) teleinfo_calendar[index] = teleinfo_winky_resume.data.arr_calendar[index];
+  memcpy (&teleinfo_contract_db, teleinfo_winky_resume.data.arr_contract_db, sizeof (teleinfo_contract_db));
+
+  // speed is known, no need to detect it
+  teleinfo_detect.active = false;
+
+  // log
+  teleinfo_winky.resumed = true;
+  AddLog (LOG_LEVEL_INFO, PSTR ("TIC: Reprise rapide, contrat %s, %u périodes"), teleinfo_contract_db.str_code, teleinfo_contract_db.period_qty);
+
+  return true;
+}
+
+// declare MQTT publication (to measure wake-to-publish time)
+void TeleinfoWinkyDeclarePublish ()
+{
+  if (teleinfo_winky.timestamp.publish == 0) teleinfo_winky.timestamp.publish = millis ();
+}
+
 // Enter deep sleep mode
 void TeleinfoWinkyEnterSleepMode (const uint32_t sleep_ms, const bool append)
 {
@@ -492,6 +784,10 @@ void TeleinfoWinkyEnterSleepMode (const uint32_t sleep_ms, const bool append)
   {
     teleinfo_winky_sleep.delay_ms = sleep_ms;
     teleinfo_winky_sleep.volt_mv  = teleinfo_winky.capa.volt;
+    teleinfo_winky_sleep.awake_ms = TeleinfoWinkyCalculateAverage (teleinfo_winky_sleep.awake_ms, millis ());
+
+    // save snapshot for next wake-up
+    TeleinfoWinkyResumeSave ();
   }
 
   // convert sleeptime in micro seconds
@@ -510,6 +806,9 @@ void TeleinfoWinkyEnterSleepMode (const uint32_t sleep_ms, const bool append)
 // Generate WINKY section
 void TeleinfoWinkyAppendSensor ()
 {
+  uint8_t phase;
+  char    str_phase[12];
+
 //  bool      ipv4, ipv6;
 //  IPAddress ip_addr;
 
@@ -526,7 +825,17 @@ void TeleinfoWinkyAppendSensor ()
   ResponseAppend_P (PSTR (",\"vboot\":%u.%02u,\"vsleep\":%u.%02u,\"vmeter\":%u.%02u"), teleinfo_winky.volt.boot / 1000, teleinfo_winky.volt.boot % 1000 / 10, teleinfo_winky.capa.volt / 1000, teleinfo_winky.capa.volt % 1000 / 10, teleinfo_winky.meter.volt / 1000, teleinfo_winky.meter.volt % 1000 / 10);
 //  ResponseAppend_P (PSTR (",\"capa\":{\"Vmax\":%u.%02u,\"Vmin\":%u.%02u}"), teleinfo_winky.volt.boot / 1000, teleinfo_winky.volt.boot % 1000 / 10, teleinfo_winky.capa.volt / 1000, teleinfo_winky.capa.volt % 1000 / 10);
 //  ResponseAppend_P (PSTR (",\"vmeter\":%u.%02u"), teleinfo_winky.meter.volt / 1000, teleinfo_winky.meter.volt % 1000 / 10);
-  ResponseAppend_P (PSTR (",\"net\":%u,\"rtc\":%u,\"mqtt\":%u,\"up\":%u,\"sleep\":%u}"), teleinfo_winky.timestamp.wifi, teleinfo_winky.timestamp.rtc, teleinfo_winky.timestamp.mqtt, millis (), teleinfo_winky.deepsleep);
+  ResponseAppend_P (PSTR (",\"net\":%u,\"rtc\":%u,\"mqtt\":%u,\"pub\":%u,\"up\":%u,\"sleep\":%u,\"resume\":%u"), teleinfo_winky.timestamp.wifi, teleinfo_winky.timestamp.rtc, teleinfo_winky.timestamp.mqtt, teleinfo_winky.timestamp.publish, millis (), teleinfo_winky.deepsleep, teleinfo_winky.resumed);
+
+  // adaptive deepsleep : learnt charge power, wake-up voltage, batch ratio and phases cost (mJ)
+  ResponseAppend_P (PSTR (",\"charge\":%u,\"vtarget\":%u.%02u,\"batch\":%u,\"cost\":{"), teleinfo_winky_sleep.charge_mw, teleinfo_winky_sleep.target_mv / 1000, teleinfo_winky_sleep.target_mv % 1000 / 10, teleinfo_winky_sleep.batch);
+  for (phase = 0; phase < WINKY_PHASE_MAX; phase ++)
+  {
+    GetTextIndexed (str_phase, sizeof (str_phase), phase, kTeleinfoWinkyPhase);
+    if (phase > 0) ResponseAppend_P (PSTR (","));
+    ResponseAppend_P (PSTR ("\"%s\":%u"), str_phase, teleinfo_winky_sleep.arr_cost_mj[phase]);
+  }
+  ResponseAppend_P (PSTR ("}}"));
 }
 
 /************************************\
@@ -538,14 +847,15 @@ void TeleinfoWinkyInit ()
 {
   uint8_t  counter;
   uint32_t pin;
-  uint32_t charge_mw;
+  uint32_t charge_mw, delay_ms;
   uint32_t adc_type;
 
   // init timestamps
-  teleinfo_winky.timestamp.wifi = 0;
-  teleinfo_winky.timestamp.rtc  = 0;
-  teleinfo_winky.timestamp.mqtt = 0;
-  teleinfo_winky.timestamp.capa = 0;
+  teleinfo_winky.timestamp.wifi    = 0;
+  teleinfo_winky.timestamp.rtc     = 0;
+  teleinfo_winky.timestamp.mqtt    = 0;
+  teleinfo_winky.timestamp.publish = 0;
+  teleinfo_winky.timestamp.capa    = 0;
 
   // detect analog GPIO
   counter = 0;
@@ -579,8 +889,14 @@ void TeleinfoWinkyInit ()
   // if running on capa
   if (teleinfo_winky.enabled && TeleinfoDriverIsOnBattery ())
   {
-    // if voltage too low to start, back to sleep mode
-    if (teleinfo_winky.capa.volt < teleinfo_winky.volt.start - 50) TeleinfoWinkyEnterSleepMode (WINKY_SLEEP_DEFAULT, true);
+    // if voltage too low to start, back to sleep mode till needed voltage is reached
+    if (teleinfo_winky.capa.volt < TeleinfoWinkyStartVoltage () - 50)
+    {
+      delay_ms = TeleinfoWinkyCalculateChargeTime (TeleinfoWinkyStartVoltage (), teleinfo_winky.capa.volt, teleinfo_winky.farad.ref, teleinfo_winky_sleep.charge_mw);
+      delay_ms = max (delay_ms, (uint32_t)WINKY_SLEEP_MINIMUM);
+      delay_ms = min (delay_ms, (uint32_t)WINKY_SLEEP_MAXIMUM);
+      TeleinfoWinkyEnterSleepMode (delay_ms, true);
+    }
 
     // if waking-up from deepslep, calculate charging power
     if (ESP_SLEEP_WAKEUP_TIMER == esp_sleep_get_wakeup_cause ())
@@ -589,13 +905,18 @@ void TeleinfoWinkyInit ()
       charge_mw = TeleinfoWinkyCalculateChargePower (teleinfo_winky.volt.boot, teleinfo_winky_sleep.volt_mv, teleinfo_winky.farad.ref, teleinfo_winky_sleep.delay_ms);
 
       // save average charging power
-      if (teleinfo_winky_sleep.charge_mw == 0) teleinfo_winky_sleep.charge_mw = charge_mw;
-        else teleinfo_winky_sleep.charge_mw = (3 * teleinfo_winky_sleep.charge_mw + charge_mw) / 4;
+      teleinfo_winky_sleep.charge_mw = TeleinfoWinkyCalculateAverage (teleinfo_winky_sleep.charge_mw, charge_mw);
+
+      // count wake-up and check if integrations should be published
+      teleinfo_winky_sleep.nb_wake++;
+      if ((Settings->deepsleep < 1000) && (teleinfo_winky_sleep.batch > 1)) teleinfo_winky.batch = (teleinfo_winky_sleep.nb_wake % teleinfo_winky_sleep.batch == 0);
     }
   } 
 
-  // save boot voltage
+  // save boot voltage and start first phase
   teleinfo_winky.volt.boot = teleinfo_winky.capa.volt;
+  teleinfo_winky.mark.time = 0;
+  teleinfo_winky.mark.volt = teleinfo_winky.capa.volt;
 
   // log help command
   AddLog (LOG_LEVEL_INFO, PSTR ("HLP: Run winky to get help on Winky commands"));
@@ -612,10 +933,15 @@ void TeleinfoWinkyEvery100ms ()
   {
     if (WifiHasIPv4 ())      teleinfo_winky.timestamp.wifi = millis ();
     else if (WifiHasIPv6 ()) teleinfo_winky.timestamp.wifi = millis ();
+    if (teleinfo_winky.timestamp.wifi != 0) TeleinfoWinkyPhaseEnd (WINKY_PHASE_WIFI);
   }
 
   // check for mqtt connectivity
-  if ((teleinfo_winky.timestamp.mqtt == 0) && MqttIsConnected ()) teleinfo_winky.timestamp.mqtt = millis ();
+  if ((teleinfo_winky.timestamp.mqtt == 0) && MqttIsConnected ())
+  {
+    teleinfo_winky.timestamp.mqtt = millis ();
+    TeleinfoWinkyPhaseEnd (WINKY_PHASE_CONNECT);
+  }
 }
 
 // called every second to check capa level and deepsleep condition
@@ -673,11 +999,22 @@ void TeleinfoWinkyEverySecond ()
     teleinfo_winky.suspend = (voltage_low || cosphi_reached || max_reached);
     if (teleinfo_winky.suspend)
     {
+      // end of measure phase
+      if (teleinfo_winky.timestamp.mqtt != 0) TeleinfoWinkyPhaseEnd (WINKY_PHASE_MEASURE);
+
       // publish MQTT JSON data
       TeleinfoDriverJsonPublish ();
 
       // if needed, publish raw TIC
       if (teleinfo_meter.json.tic) TeleinfoDriverPublishTic ();
+      TeleinfoWinkyPhaseEnd (WINKY_PHASE_PUBLISH);
+
+      // if integrations are not published during this wake-up, go to sleep
+      if (!teleinfo_winky.batch)
+      {
+        teleinfo_winky.deepsleep = TeleinfoWinkyCalculateSleepTime ();
+        TeleinfoWinkyEnterSleepMode (teleinfo_winky.deepsleep, false);
+      }
 
 #ifdef USE_TELEINFO_DOMOTICZ
       // publish Domoticz data
@@ -710,6 +1047,9 @@ void TeleinfoWinkyEverySecond ()
       TeleinfoAwtrixUpdatePage ();
 #endif    // USE_TELEINFO_AWTRIX
 
+      // end of integrations publication
+      TeleinfoWinkyPhaseEnd (WINKY_PHASE_BATCH);
+
       // calculate deepsleep time to go to sleep
       teleinfo_winky.deepsleep = TeleinfoWinkyCalculateSleepTime ();
 
@@ -752,6 +1092,10 @@ void TeleinfoWinkyInfluxDbAppendData ()
   snprintf_P (str_line, sizeof (str_line), PSTR("%s,device=%s,sensor=%s value=%u\n"), PSTR ("winky"), TasmotaGlobal.hostname, PSTR ("rtc"), teleinfo_winky.timestamp.rtc);
   TasmotaGlobal.mqtt_data += str_line;
 
+  // time to first publication (ms)
+  snprintf_P (str_line, sizeof (str_line), PSTR("%s,device=%s,sensor=%s value=%u\n"), PSTR ("winky"), TasmotaGlobal.hostname, PSTR ("pub"), teleinfo_winky.timestamp.publish);
+  TasmotaGlobal.mqtt_data += str_line;
+
   // time to establish mqtt (ms)
 //  snprintf_P (str_line, sizeof (str_line), PSTR("%s,device=%s,sensor=%s value=%u\n"), PSTR ("winky"), TasmotaGlobal.hostname, PSTR ("ms-mqtt"), teleinfo_winky.timestamp.mqtt);
 //  TasmotaGlobal.mqtt_data += str_line;
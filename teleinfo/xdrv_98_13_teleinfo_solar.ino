@@ -10,6 +10,9 @@ xdrv_98_13_teleinfo_solar.ino - Handle access to solar production and forecast
                       Limit publications to 1 per sec.
     19/09/2025 v1.3 - Hide and Show with click on main page display
                       Add MQTT to solar production update
+    16/10/2026 v1.4 - Run forecast HTTPS request in background thru driver request engine
+                      Parse forecast thru JSON stream parser, without body buffer
+                      Retry with endpoint backoff, publish quota to request statistics
 
   solar production API is accessible thru :
 
@@ -53,11 +56,11 @@ xdrv_98_13_teleinfo_solar.ino - Handle access to solar production and forecast
 
 
 // global constant
-#define SOLAR_HTTP_TIMEOUT            3000       // HTTP connexion timeout (ms)
 #define SOLAR_DELAY_INITIAL           12         // first update 12s after boot
 #define SOLAR_DELAY_TELEPERIOD        5          // publish data 5s after teleperiod
 #define SOLAR_DELAY_UPDATE            60         // update after 1mn
 #define SOLAR_DELAY_RENEW             10800      // update every 3 hours
+#define SOLAR_DELAY_RETRY             900        // retry after 15 mn (with backoff)
 
 // commands
 #define D_CMND_SOLAR                  "solar"
@@ -90,6 +93,17 @@ void (* const SolarCommand[])(void)      PROGMEM = {        &CmndTeleinfoSolar,
 static const char kForecastCommands[]    PROGMEM = D_CMND_FORECAST "|"          "|_"    D_CMND_FORECAST_DECLIN    "|_"  D_CMND_FORECAST_AZIMUT  "|_"  D_CMND_FORECAST_KEY "|_"  D_CMND_FORECAST_UPDATE    ;
 void (* const ForecastCommand[])(void)   PROGMEM = {        &CmndTeleinfoForecast, &CmndTeleinfoForecastDeclination, &CmndTeleinfoForecastAzimuth, &CmndTeleinfoForecastKey, &CmndTeleinfoForecastUpdate };
 
+// forecast reception (filled by JSON parser from HTTPS task, applied once request is done)
+static struct {
+  uint16_t  credit_total;                           // request credit
+  uint16_t  credit_left;                            // remaining requests
+  char      str_today[12];                          // today's date (yyyy-mm-dd)
+  char      str_tomorrow[12];                       // tomorrow's date (yyyy-mm-dd)
+  char      str_place[64];                          // place given by API
+  solar_day today;                                  // today's data
+  solar_day tomorrow;                               // tomorrow's data
+} solar_stream;
+
 /************************************\
  *           Commands
 \************************************/
@@ -323,22 +337,78 @@ void TeleinfoSolarPublishJson ()
  *            API call
 \***********************************/
 
+// forecast JSON value reception (HTTPS task)
+void TeleinfoSolarForecastParse (tic_json_parser &parser, const char *pstr_value)
+{
+  uint8_t     hour;
+  const char *pstr_key;
+  solar_day  *pday;
+
+  // ignore null values
+  if (!parser.is_string && (strcmp_P (pstr_value, PSTR ("null")) == 0)) return;
+
+  // place and credits
+  if (TeleinfoJsonMatch (parser, PSTR ("message.info.place"))) strlcpy (solar_stream.str_place, pstr_value, sizeof (solar_stream.str_place));
+  else if (TeleinfoJsonMatch (parser, PSTR ("message.ratelimit.remaining"))) solar_stream.credit_left  = (uint16_t)atoi (pstr_value);
+  else if (TeleinfoJsonMatch (parser, PSTR ("message.ratelimit.limit")))     solar_stream.credit_total = (uint16_t)atoi (pstr_value);
+
+  // forecast values, keys are yyyy-mm-dd or yyyy-mm-dd hh:00:00
+  else if (TeleinfoJsonMatch (parser, PSTR ("result.*.*")))
+  {
+    // get target day
+    pstr_key = TeleinfoJsonKey (parser, 2);
+    if (strncmp (pstr_key, solar_stream.str_today, 10) == 0) pday = &solar_stream.today;
+      else if (strncmp (pstr_key, solar_stream.str_tomorrow, 10) == 0) pday = &solar_stream.tomorrow;
+      else return;
+
+    // daily total
+    if (pstr_key[10] == 0)
+    {
+      if (TeleinfoJsonMatch (parser, PSTR ("result.watt_hours_day.*"))) pday->total = (uint16_t)atoi (pstr_value);
+      return;
+    }
+
+    // hourly values (only on exact hours)
+    if ((pstr_key[10] != ' ') || (strcmp_P (pstr_key + 13, PSTR (":00:00")) != 0)) return;
+    hour = (uint8_t)atoi (pstr_key + 11);
+    if (hour >= 24) return;
+    if (TeleinfoJsonMatch (parser, PSTR ("result.watts.*"))) pday->arr_pact[hour] = (uint16_t)atoi (pstr_value);
+      else if (TeleinfoJsonMatch (parser, PSTR ("result.watt_hours_period.*"))) pday->arr_wh[hour] = (uint16_t)atoi (pstr_value);
+  }
+}
+
+// forecast reception
+void TeleinfoSolarForecastReceived (tic_https_request &request)
+{
+  // log
+  AddLog (LOG_LEVEL_INFO, PSTR ("SOL: Forecast: [%d] %u bytes in %u ms"), request.http_code, request.size, request.arr_stage[TIC_HTTPS_STAGE_CONNECT] + request.arr_stage[TIC_HTTPS_STAGE_REQUEST] + request.arr_stage[TIC_HTTPS_STAGE_BODY]);
+
+  // if failure, plan retry
+  if (!request.valid) teleinfo_forecast.time_update = LocalTime () + TeleinfoHttpsRetryDelay (TIC_HTTPS_EP_FORECAST, SOLAR_DELAY_RETRY);
+
+  // else if stream is complete, update forecast (answer 304 keeps current forecast)
+  else if (request.http_code != HTTP_CODE_NOT_MODIFIED)
+  {
+    teleinfo_forecast.credit_left  = solar_stream.credit_left;
+    teleinfo_forecast.credit_total = solar_stream.credit_total;
+    strlcpy (teleinfo_forecast.str_place, solar_stream.str_place, sizeof (teleinfo_forecast.str_place));
+    memcpy (&teleinfo_forecast.today,    &solar_stream.today,    sizeof (solar_day));
+    memcpy (&teleinfo_forecast.tomorrow, &solar_stream.tomorrow, sizeof (solar_day));
+    TeleinfoHttpsSetQuota (TIC_HTTPS_EP_FORECAST, teleinfo_forecast.credit_left, teleinfo_forecast.credit_total);
+
+    // log
+    AddLog (LOG_LEVEL_INFO, PSTR ("SOL: Solar forecast updated, credit %u/%u, production is now %u W, will be %u Wh today and %u Wh tomorrow"), teleinfo_forecast.credit_left, teleinfo_forecast.credit_total, teleinfo_forecast.today.arr_pact[RtcTime.hour], teleinfo_forecast.today.total, teleinfo_forecast.tomorrow.total );
+  }
+}
+
+// forecast request, answer is handled by TeleinfoSolarForecastReceived ()
 bool TeleinfoSolarForecastUpdate ()
 {
-  bool     is_ok;
-  uint8_t  index;
-  uint32_t time_start;
-  int32_t  time_response;
-  int      latitude_int, longitude_int, latitude_dec, longitude_dec;
-  int      http_code;
-  TIME_T   tomorrow;
-  char     str_today[12];
-  char     str_tomorrow[12];
-  char     str_key[28];
-  char     str_text[128];
-  String   str_result;
-  JsonDocument     json_result;
-  HTTPClientLight *phttp = nullptr;
+  bool   is_ok;
+  int    latitude_int, longitude_int, latitude_dec, longitude_dec;
+  TIME_T tomorrow;
+  char   str_key[28];
+  char   str_url[TIC_HTTPS_URL_SIZE];
 
   // check time
   if (!RtcTime.valid) return false;
@@ -350,7 +420,7 @@ bool TeleinfoSolarForecastUpdate ()
   is_ok = true;
   if (teleinfo_config.prod_max == 0) { is_ok = false; AddLog (LOG_LEVEL_INFO, PSTR ("SOL: Forecast: No peak production defined [energyconfig prod=xxxxx]")); }
 
-  // construct URL
+  // construct URL and queue request
   if (is_ok)
   {
     // get latitude and longitude
@@ -361,96 +431,20 @@ bool TeleinfoSolarForecastUpdate ()
 
     // generate URL
     if (strlen (teleinfo_forecast.str_apikey) > 0) sprintf_P (str_key, PSTR ("%s/"), teleinfo_forecast.str_apikey); else str_key[0] = 0;
-    sprintf_P (str_text, PSTR_FORECAST_URL, str_key, latitude_int, latitude_dec, longitude_int, longitude_dec, teleinfo_forecast.declination, teleinfo_forecast.azimuth, teleinfo_config.prod_max / 1000, teleinfo_config.prod_max % 1000); 
-    AddLog (LOG_LEVEL_DEBUG, PSTR ("SOL: Forecast: %s"), str_text);
-
-    // start connexion
-    phttp = new HTTPClientLight ();
-    is_ok = (phttp != nullptr);
-  }
-
-  if (is_ok)
-  {
-    // connexion
-    is_ok = phttp->begin (str_text);
-    if (is_ok)
-    {
-      // set timeout and headers
-      phttp->setTimeout (SOLAR_HTTP_TIMEOUT);
-      phttp->addHeader (F ("Accept"), F ("application/json"), false, true);
-
-      // check connexion status
-      time_start = millis ();
-      http_code  = phttp->GET ();
-      time_response = TimePassedSince (time_start);
-
-      // if success, collect result
-      is_ok = ((http_code == HTTP_CODE_OK) || (http_code == HTTP_CODE_MOVED_PERMANENTLY));
-      if (is_ok) str_result = phttp->getString ();
-      is_ok = (!str_result.isEmpty ());
-
-      // end connexion
-      phttp->end ();
-      
-      // declare query
-      TeleinfoDriverWebDeclare (TIC_WEB_HTTP);
-
-      // log
-      AddLog (LOG_LEVEL_INFO, PSTR ("SOL: Forecast: [%d] %u char in %d ms"), http_code, str_result.length (), time_response);
-    }
-
-    else AddLog (LOG_LEVEL_INFO, PSTR ("SOL: Forecast: Connexion begin failed"));
-
-    // delete connexion
-    delete phttp;
-  }
-  else AddLog (LOG_LEVEL_INFO, PSTR ("SOL: Forecast: Connexion creation failed"));
-
-  // analyse received stream
-  if (is_ok)
-  {
-    // init data
-    memset (&teleinfo_forecast.today,    0, sizeof (solar_day));
-    memset (&teleinfo_forecast.tomorrow, 0, sizeof (solar_day));
-
-    // generate JSON
-    deserializeJson (json_result, str_result.c_str ());
-
-    // calculate tomorrow
+    snprintf_P (str_url, sizeof (str_url), PSTR_FORECAST_URL, str_key, latitude_int, latitude_dec, longitude_int, longitude_dec, teleinfo_forecast.declination, teleinfo_forecast.azimuth, teleinfo_config.prod_max / 1000, teleinfo_config.prod_max % 1000); 
+    AddLog (LOG_LEVEL_DEBUG, PSTR ("SOL: Forecast: %s"), str_url);
+
+    // init reception data, keeping current place and credits
+    memset (&solar_stream, 0, sizeof (solar_stream));
+    solar_stream.credit_left  = teleinfo_forecast.credit_left;
+    solar_stream.credit_total = teleinfo_forecast.credit_total;
+    strlcpy (solar_stream.str_place, teleinfo_forecast.str_place, sizeof (solar_stream.str_place));
     BreakTime (LocalTime () + 86400, tomorrow);
+    sprintf_P (solar_stream.str_today,    PSTR ("%u-%02u-%02u"), RtcTime.year,         RtcTime.month,  RtcTime.day_of_month);
+    sprintf_P (solar_stream.str_tomorrow, PSTR ("%u-%02u-%02u"), tomorrow.year + 1970, tomorrow.month, tomorrow.day_of_month);
 
-    // gerenerate today and tomorrow strings
-    sprintf_P (str_today,    PSTR ("%u-%02u-%02u"), RtcTime.year,         RtcTime.month,  RtcTime.day_of_month);
-    sprintf_P (str_tomorrow, PSTR ("%u-%02u-%02u"), tomorrow.year + 1970, tomorrow.month, tomorrow.day_of_month);
-    
-    // retrieve place
-    if (!json_result[F ("message")][F ("info")][F ("place")].isNull ()) strlcpy (teleinfo_forecast.str_place, json_result[F ("message")][F ("info")][F ("place")].as<const char*>(), sizeof (teleinfo_forecast.str_place));
-
-    // update credits
-    if (!json_result[F ("message")][F ("ratelimit")][F ("remaining")].isNull ()) teleinfo_forecast.credit_left  = json_result[F ("message")][F ("ratelimit")][F ("remaining")].as<unsigned int>();
-    if (!json_result[F ("message")][F ("ratelimit")][F ("limit")].isNull ())     teleinfo_forecast.credit_total = json_result[F ("message")][F ("ratelimit")][F ("limit")].as<unsigned int>();
-
-    // recover today's forecast
-    if (!json_result[F ("result")][F ("watt_hours_day")][str_today].isNull ()) teleinfo_forecast.today.total = json_result[F ("result")][F ("watt_hours_day")][str_today].as<unsigned int>();
-    for (index = 0; index < 24; index ++)
-    {
-      sprintf_P (str_text, PSTR ("%s %02u:00:00"), str_today, index);
-      if (!json_result[F ("result")][F ("watts")][str_text].isNull ()) teleinfo_forecast.today.arr_pact[index] = json_result[F ("result")][F ("watts")][str_text].as<unsigned int>();
-      if (!json_result[F ("result")][F ("watt_hours_period")][str_text].isNull ()) teleinfo_forecast.today.arr_wh[index] = json_result[F ("result")][F ("watt_hours_period")][str_text].as<unsigned int>();
-    }
-
-    // recover tomorrow hourly forecast
-    if (!json_result[F ("result")][F ("watt_hours_day")][str_tomorrow].isNull ()) teleinfo_forecast.tomorrow.total = json_result[F ("result")][F ("watt_hours_day")][str_tomorrow].as<unsigned int>();
-    for (index = 0; index < 24; index ++)
-    {
-      sprintf_P (str_text, PSTR ("%s %02u:00:00"), str_tomorrow, index);
-      if (!json_result[F ("result")][F ("watts")][str_text].isNull ()) teleinfo_forecast.tomorrow.arr_pact[index] = json_result[F ("result")][F ("watts")][str_text].as<unsigned int>();
-      if (!json_result[F ("result")][F ("watt_hours_period")][str_text].isNull ()) teleinfo_forecast.tomorrow.arr_wh[index] = json_result[F ("result")][F ("watt_hours_period")][str_text].as<unsigned int>();
-    }
-
-    // set new update time and log
-    teleinfo_forecast.time_update = LocalTime () + SOLAR_DELAY_RENEW;
-    AddLog (LOG_LEVEL_INFO, PSTR ("SOL: Solar forecast updated, credit %u/%u, production is now %u W, will be %u Wh today and %u Wh tomorrow"), teleinfo_forecast.credit_left, teleinfo_forecast.credit_total, teleinfo_forecast.today.arr_pact[RtcTime.hour], teleinfo_forecast.today.total, teleinfo_forecast.tomorrow.total );
+    // queue request
+    is_ok = TeleinfoHttpsQueue (TIC_HTTPS_EP_FORECAST, str_url, nullptr, false, nullptr, TeleinfoSolarForecastParse, TeleinfoSolarForecastReceived);
   }
 
   // set renew timestamp
@@ -3,6 +3,10 @@ xdrv_98_14_teleinfo_prometheus.ino - Publish Prometheus metrics
 
   Copyright (C) 2026  Nicolas Bernaerts
     04/01/2026 v1.0 - Creation
+    16/10/2026 v1.1 - Pre-render exposition, refreshed by section on value change
+                      Add scrape duration and size self metrics
+    16/10/2026 v1.2 - Signature on published values, instant values split in phase, conso and prod sections
+                      Stream cached sections without page copy
 
   Prometheus metrics are available thru :
 
@@ -30,6 +34,29 @@ xdrv_98_14_teleinfo_prometheus.ino - Publish Prometheus metrics
 // path and url
 #define TIC_PROMETHEUS_PAGE_METRICS   "/api/prometheus/metrics"
 
+// cache
+#define TIC_PROMETHEUS_LINE_SIZE      128       // maximum size of a sample line
+#define TIC_PROMETHEUS_ACTIVE         60        // cache is refreshed on new messages if scraped during last 60 sec.
+
+// cached sections
+enum TeleinfoPrometheusSection { TIC_PROMETHEUS_GENERAL, TIC_PROMETHEUS_METER, TIC_PROMETHEUS_PHASE, TIC_PROMETHEUS_CONSO, TIC_PROMETHEUS_PROD, TIC_PROMETHEUS_RELAY, TIC_PROMETHEUS_ALERT, TIC_PROMETHEUS_SOLAR, TIC_PROMETHEUS_FORECAST, TIC_PROMETHEUS_TEMPO, TIC_PROMETHEUS_MAX };
+
+/***********************************************\
+ *                    Data
+\***********************************************/
+
+#ifdef USE_WEBSERVER
+
+static struct {
+  uint32_t time_scrape = 0;                         // timestamp of last scrape (ms)
+  uint32_t nb_scrape   = 0;                         // number of scrapes
+  uint32_t nb_render   = 0;                         // number of rendered sections
+  uint32_t arr_hash[TIC_PROMETHEUS_MAX];            // signature of values of each section
+  String   arr_section[TIC_PROMETHEUS_MAX];         // pre-rendered sections, streamed one after the other
+} teleinfo_prometheus;
+
+#endif  // USE_WEBSERVER
+
 /***********************************************\
  *                  Functions
 \***********************************************/
@@ -57,122 +84,150 @@ char* TeleinfoPrometheusCleanupString (char *pstr_string)
 }
 
 /***********************************************\
- *                    Web
+ *                    Cache
 \***********************************************/
 
 #ifdef USE_WEBSERVER
 
-// Append METER and PROD
-void TeleinfoPrometheusAppendMeter ()
+// FNV-1a signature of a block of values
+uint32_t TeleinfoPrometheusHash (uint32_t hash, const void *pdata, const size_t size)
 {
-  uint8_t phase, value;
-  long    voltage, current, power_app, power_act;
+  size_t index;
+  const uint8_t *pbyte = (const uint8_t*)pdata;
+
+  for (index = 0; index < size; index ++) hash = (hash ^ pbyte[index]) * 16777619UL;
+
+  return hash;
+}
 
+// append a formatted sample to a section
+void TeleinfoPrometheusAppend (String &str_section, const char *pstr_format, ...)
+{
+  va_list arg;
+  char    str_line[TIC_PROMETHEUS_LINE_SIZE];
+
+  va_start (arg, pstr_format);
+  vsnprintf_P (str_line, sizeof (str_line), pstr_format, arg);
+  va_end (arg);
+
+  str_section += str_line;
+}
+
+// calculate conso totals over phases (voltage is averaged)
+void TeleinfoPrometheusConsoTotal (long &voltage, long &current, long &power_app, long &power_act)
+{
+  uint8_t phase;
+
+  voltage = current = power_app = power_act = 0;
+  for (phase = 0; phase < teleinfo_contract.phase; phase++)
+  {
+    voltage   += teleinfo_conso.phase[phase].voltage;
+    current   += teleinfo_conso.phase[phase].current;
+    power_app += teleinfo_conso.phase[phase].papp;
+    power_act += teleinfo_conso.phase[phase].pact;
+  }
+  if (teleinfo_contract.phase > 1) voltage = voltage / (long)teleinfo_contract.phase;
+}
+
+// Append METER : contract and daily totals
+void TeleinfoPrometheusAppendMeter (String &str_section)
+{
   // METER basic data
-  WSContentSend_P (PSTR ("phase_number %u\n"), teleinfo_contract.phase);
-  WSContentSend_P (PSTR ("current_max_amperes %u\n"), teleinfo_contract.isousc);
-  WSContentSend_P (PSTR ("power_max_voltamperes %u\n"), teleinfo_contract.ssousc);
+  TeleinfoPrometheusAppend (str_section, PSTR ("phase_number %u\n"), teleinfo_contract.phase);
+  TeleinfoPrometheusAppend (str_section, PSTR ("current_max_amperes %u\n"), teleinfo_contract.isousc);
+  TeleinfoPrometheusAppend (str_section, PSTR ("power_max_voltamperes %u\n"), teleinfo_contract.ssousc);
 
-  // conso 
+  // conso : total of yesterday and today
   if (teleinfo_conso.enabled)
   {
-    // conso : loop thru phases
-    voltage = 0;
-    current = 0;
-    power_app = 0;
-    power_act = 0;
-    for (phase = 0; phase < teleinfo_contract.phase; phase++)
-    {
-      // calculate parameters
-      voltage   += teleinfo_conso.phase[phase].voltage;
-      current   += teleinfo_conso.phase[phase].current;
-      power_app += teleinfo_conso.phase[phase].papp;
-      power_act += teleinfo_conso.phase[phase].pact;
-
-      // if needed, phase data
-      if (teleinfo_contract.phase > 1) 
-      {
-        value = phase + 1;
-        WSContentSend_P (PSTR ("phase%u_voltage_volts_u%u %d\n"), value, teleinfo_conso.phase[phase].voltage);
-        WSContentSend_P (PSTR ("phase%u_current_amperes %d.%03d\n"), value, teleinfo_conso.phase[phase].current / 1000, teleinfo_conso.phase[phase].current % 1000);
-        WSContentSend_P (PSTR ("phase%u_apparent_voltamperes %d\n"), value, teleinfo_conso.phase[phase].papp);
-        WSContentSend_P (PSTR ("phase%u_active_watts %d\n"), value, teleinfo_conso.phase[phase].pact);
-      }
-    } 
-
-    // conso : values and cosphi
-    if (teleinfo_contract.phase > 1) voltage = voltage / (long)teleinfo_contract.phase;
-    WSContentSend_P (PSTR ("conso_voltage_volts %d\n"), voltage);
-    WSContentSend_P (PSTR ("conso_current_amperes %d.%03d\n"), current / 1000, current % 1000);
-    WSContentSend_P (PSTR ("conso_apparent_voltamperes %d\n"), power_app);
-    WSContentSend_P (PSTR ("conso_active_watts %d\n"), power_act);
-    if (teleinfo_conso.cosphi.quantity >= TIC_COSPHI_MIN) WSContentSend_P (PSTR ("conso_cosphi_ratio %d.%02d\n"), teleinfo_conso.cosphi.value / 1000, teleinfo_conso.cosphi.value % 1000 / 10);
-
-    // conso : total of yesterday and today
-    WSContentSend_P (PSTR ("conso_yesterday_watthours %d\n"), teleinfo_conso_wh.yesterday);
-    WSContentSend_P (PSTR ("conso_today_watthours %d\n"), teleinfo_conso_wh.today);
+    TeleinfoPrometheusAppend (str_section, PSTR ("conso_yesterday_watthours %d\n"), teleinfo_conso_wh.yesterday);
+    TeleinfoPrometheusAppend (str_section, PSTR ("conso_today_watthours %d\n"), teleinfo_conso_wh.today);
   }
-  
-  // production 
-  if (teleinfo_prod.enabled || teleinfo_prod.cacsi) WSContentSend_P (PSTR ("prod_apparent_voltamperes %d\n"), teleinfo_prod.papp);
+
+  // prod : total of yesterday and today
   if (teleinfo_prod.enabled)
   {
-    // prod : global values
-    WSContentSend_P (PSTR ("prod_active_watts %d\n"), teleinfo_prod.pact);
-
-    // prod : cosphi
-    if (teleinfo_prod.cosphi.quantity >= TIC_COSPHI_MIN) WSContentSend_P (PSTR ("prod_cosphi_ratio %d.%02d\n"), teleinfo_prod.cosphi.value / 1000, teleinfo_prod.cosphi.value % 1000 / 10);
+    TeleinfoPrometheusAppend (str_section, PSTR ("prod_yesterday_watthours %d\n"), teleinfo_prod_wh.yesterday);
+    TeleinfoPrometheusAppend (str_section, PSTR ("prod_today_watthours %d\n"), teleinfo_prod_wh.today);
+  }
+}
 
-    // prod : average power
-    WSContentSend_P (PSTR ("prod_average_watts %d\n"), (long)teleinfo_prod.pact_avg);
+// Append PHASE : instant values of each phase
+void TeleinfoPrometheusAppendPhase (String &str_section)
+{
+  uint8_t phase, value;
 
-    // prod : total of yesterday and today
-    WSContentSend_P (PSTR ("prod_yesterday_watthours %d\n"), teleinfo_prod_wh.yesterday);
-    WSContentSend_P (PSTR ("prod_today_watthours %d\n"), teleinfo_prod_wh.today);
+  for (phase = 0; phase < teleinfo_contract.phase; phase++)
+  {
+    value = phase + 1;
+    TeleinfoPrometheusAppend (str_section, PSTR ("phase%u_voltage_volts_u%u %d\n"), value, teleinfo_conso.phase[phase].voltage);
+    TeleinfoPrometheusAppend (str_section, PSTR ("phase%u_current_amperes %d.%03d\n"), value, teleinfo_conso.phase[phase].current / 1000, teleinfo_conso.phase[phase].current % 1000);
+    TeleinfoPrometheusAppend (str_section, PSTR ("phase%u_apparent_voltamperes %d\n"), value, teleinfo_conso.phase[phase].papp);
+    TeleinfoPrometheusAppend (str_section, PSTR ("phase%u_active_watts %d\n"), value, teleinfo_conso.phase[phase].pact);
   }
 }
 
+// Append CONSO : instant totals and cosphi
+void TeleinfoPrometheusAppendConso (String &str_section)
+{
+  long voltage, current, power_app, power_act;
+
+  TeleinfoPrometheusConsoTotal (voltage, current, power_app, power_act);
+  TeleinfoPrometheusAppend (str_section, PSTR ("conso_voltage_volts %d\n"), voltage);
+  TeleinfoPrometheusAppend (str_section, PSTR ("conso_current_amperes %d.%03d\n"), current / 1000, current % 1000);
+  TeleinfoPrometheusAppend (str_section, PSTR ("conso_apparent_voltamperes %d\n"), power_app);
+  TeleinfoPrometheusAppend (str_section, PSTR ("conso_active_watts %d\n"), power_act);
+  if (teleinfo_conso.cosphi.quantity >= TIC_COSPHI_MIN) TeleinfoPrometheusAppend (str_section, PSTR ("conso_cosphi_ratio %d.%02d\n"), teleinfo_conso.cosphi.value / 1000, teleinfo_conso.cosphi.value % 1000 / 10);
+}
+
+// Append PROD : instant values and cosphi
+void TeleinfoPrometheusAppendProd (String &str_section)
+{
+  // apparent power, also published for CACSI contract
+  TeleinfoPrometheusAppend (str_section, PSTR ("prod_apparent_voltamperes %d\n"), teleinfo_prod.papp);
+  if (!teleinfo_prod.enabled) return;
+
+  // active power, cosphi and average power
+  TeleinfoPrometheusAppend (str_section, PSTR ("prod_active_watts %d\n"), teleinfo_prod.pact);
+  if (teleinfo_prod.cosphi.quantity >= TIC_COSPHI_MIN) TeleinfoPrometheusAppend (str_section, PSTR ("prod_cosphi_ratio %d.%02d\n"), teleinfo_prod.cosphi.value / 1000, teleinfo_prod.cosphi.value % 1000 / 10);
+  TeleinfoPrometheusAppend (str_section, PSTR ("prod_average_watts %d\n"), (long)teleinfo_prod.pact_avg);
+}
+
 // Append CONTRACT
-void TeleinfoPrometheusAppendGeneral ()
+void TeleinfoPrometheusAppendGeneral (String &str_section, const char *pstr_contract, const char *pstr_period)
 {
   uint8_t index;
   char    str_value[16];
   char    str_serial[16];
-  char    str_contract[24];
-  char    str_period[24];
 
   // meter serial number
   strcpy_P (str_value, PSTR (EXTENSION_VERSION));
   lltoa (teleinfo_meter.ident, str_serial, 10);
-  TeleinfoContractGetName (str_contract, sizeof (str_contract));
-  TeleinfoPrometheusCleanupString (str_contract);
-  TeleinfoContractGetPeriodLabel (str_period, sizeof (str_period));
-  TeleinfoPrometheusCleanupString (str_period);
 
   // meter general data
-  WSContentSend_P (PSTR ("meter_info{version=\"%s\",serial=\"%s\",contract=\"%s\",period=\"%s\"} 1\n"), str_value, str_serial, str_contract, str_period);
+  TeleinfoPrometheusAppend (str_section, PSTR ("meter_info{version=\"%s\",serial=\"%s\",contract=\"%s\",period=\"%s\"} 1\n"), str_value, str_serial, pstr_contract, pstr_period);
 
   // conso
   if (teleinfo_conso.enabled)
   {
     // contract period
-    WSContentSend_P (PSTR ("meter_period_index %u\n"), teleinfo_contract.period + 1);
+    TeleinfoPrometheusAppend (str_section, PSTR ("meter_period_index %u\n"), teleinfo_contract.period + 1);
 
     // period level
-    WSContentSend_P (PSTR ("meter_level_index %u\n"), TeleinfoContractGetPeriodLevel ());
+    TeleinfoPrometheusAppend (str_section, PSTR ("meter_level_index %u\n"), TeleinfoContractGetPeriodLevel ());
 
     // period type
-    WSContentSend_P (PSTR ("meter_hchp_index %u\n"), TeleinfoContractGetPeriodHP ());
+    TeleinfoPrometheusAppend (str_section, PSTR ("meter_hchp_index %u\n"), TeleinfoContractGetPeriodHP ());
 
     // total conso counter
     lltoa (teleinfo_conso_wh.total, str_value, 10);
-    WSContentSend_P (PSTR ("conso_watthours_total %s\n"), str_value);
+    TeleinfoPrometheusAppend (str_section, PSTR ("conso_watthours_total %s\n"), str_value);
 
     // loop to publish conso counters
     for (index = 0; index < teleinfo_contract_db.period_qty; index ++)
     {
       lltoa (teleinfo_conso_wh.index[index], str_value, 10);
-      WSContentSend_P (PSTR ("period%u_watthours_total %s\n"), index + 1, str_value);
+      TeleinfoPrometheusAppend (str_section, PSTR ("period%u_watthours_total %s\n"), index + 1, str_value);
     }
   }
 
@@ -181,35 +236,33 @@ void TeleinfoPrometheusAppendGeneral ()
   {
     // total production counter
     lltoa (teleinfo_prod_wh.total, str_value, 10) ;
-    WSContentSend_P (PSTR ("prod_watthours_total %s\n"), str_value);
+    TeleinfoPrometheusAppend (str_section, PSTR ("prod_watthours_total %s\n"), str_value);
   }
 }
 
 // Append RELAY
-void TeleinfoPrometheusAppendRelay ()
+void TeleinfoPrometheusAppendRelay (String &str_section)
 {
-  bool    status, first;
-  uint8_t index, level, hchp;
-  char    str_name[32];
+  uint8_t index;
 
   // production relay
   if (teleinfo_prod.enabled)
   {
-    WSContentSend_P (PSTR ("relay_prod_state %u\n"), teleinfo_prod.relay);
-    WSContentSend_P (PSTR ("relay_prod_trigger_watts %d\n"), teleinfo_config.prod_trigger);
+    TeleinfoPrometheusAppend (str_section, PSTR ("relay_prod_state %u\n"), teleinfo_prod.relay);
+    TeleinfoPrometheusAppend (str_section, PSTR ("relay_prod_trigger_watts %d\n"), teleinfo_config.prod_trigger);
   }
 
   // virtual relays
   if (teleinfo_conso.enabled)
-    for (index = 0; index < 8; index ++) WSContentSend_P (PSTR ("relay_virtual%u_state %u\n"), index + 1, TeleinfoRelayStatus (index));
+    for (index = 0; index < 8; index ++) TeleinfoPrometheusAppend (str_section, PSTR ("relay_virtual%u_state %u\n"), index + 1, TeleinfoRelayStatus (index));
 
   // contract period relays
   if (teleinfo_conso.enabled)
-    for (index = 0; index < teleinfo_contract_db.period_qty; index ++) WSContentSend_P (PSTR ("relay_period%u %u\n"), index + 1, (index == teleinfo_contract.period));
+    for (index = 0; index < teleinfo_contract_db.period_qty; index ++) TeleinfoPrometheusAppend (str_section, PSTR ("relay_period%u %u\n"), index + 1, (index == teleinfo_contract.period));
 }
 
 // Append ALERT
-void TeleinfoPrometheusAppendAlert ()
+void TeleinfoPrometheusAppendAlert (String &str_section)
 {
   uint8_t index;
   char    str_name[8];
@@ -218,28 +271,28 @@ void TeleinfoPrometheusAppendAlert ()
   for (index = 0; index < TIC_ALERT_MAX; index ++)
   {
     GetTextIndexed (str_name, sizeof (str_name), index, kTeleinfoAlert);  
-    WSContentSend_P (PSTR ("alert_%s_index %u\n"), str_name, (teleinfo_meter.arr_alert[index].timeout != UINT32_MAX));
+    TeleinfoPrometheusAppend (str_section, PSTR ("alert_%s_index %u\n"), str_name, (teleinfo_meter.arr_alert[index].timeout != UINT32_MAX));
   } 
 }
 
 #ifdef USE_TELEINFO_SOLAR
 
 // Append SOLAR
-void TeleinfoPrometheusAppendSolar ()
+void TeleinfoPrometheusAppendSolar (String &str_section)
 {
   char str_value[16];
 
   lltoa (teleinfo_solar.total_wh, str_value, 10);
-  WSContentSend_P (PSTR ("solar_prod_power_watts %d\n"), teleinfo_solar.pact);
-  WSContentSend_P (PSTR ("solar_prod_watthours_total %s\n"), str_value);
+  TeleinfoPrometheusAppend (str_section, PSTR ("solar_prod_power_watts %d\n"), teleinfo_solar.pact);
+  TeleinfoPrometheusAppend (str_section, PSTR ("solar_prod_watthours_total %s\n"), str_value);
 }
 
 // Append FORECAST
-void TeleinfoPrometheusAppendForecast ()
+void TeleinfoPrometheusAppendForecast (String &str_section)
 {
-  WSContentSend_P (PSTR ("solar_forecast_power_watts %u\n"), teleinfo_forecast.pact);
-  WSContentSend_P (PSTR ("solar_forecast_tday_watthours %u\n"), teleinfo_forecast.today.total);
-  WSContentSend_P (PSTR ("solar_forecast_tmrw_watthours %u\n"), teleinfo_forecast.tomorrow.total);
+  TeleinfoPrometheusAppend (str_section, PSTR ("solar_forecast_power_watts %u\n"), teleinfo_forecast.pact);
+  TeleinfoPrometheusAppend (str_section, PSTR ("solar_forecast_tday_watthours %u\n"), teleinfo_forecast.today.total);
+  TeleinfoPrometheusAppend (str_section, PSTR ("solar_forecast_tmrw_watthours %u\n"), teleinfo_forecast.tomorrow.total);
 }
 
 #endif  // USE_TELEINFO_SOLAR
@@ -247,42 +300,229 @@ void TeleinfoPrometheusAppendForecast ()
 #ifdef USE_TELEINFO_RTE
 
 // Append TEMPO
-void TeleinfoPrometheusAppendTempo ()
+void TeleinfoPrometheusAppendTempo (String &str_section)
 {
   uint8_t day;
 
   // today and tomorrow
-  WSContentSend_P (PSTR ("tempo_today_level %u\n"), rte_tempo_status.arr_day[RTE_DAY_TODAY].level);
-  WSContentSend_P (PSTR ("tempo_tomorrow_level %u\n"), rte_tempo_status.arr_day[RTE_DAY_TOMORROW].level);
+  TeleinfoPrometheusAppend (str_section, PSTR ("tempo_today_level %u\n"), rte_tempo_status.arr_day[RTE_DAY_TODAY].level);
+  TeleinfoPrometheusAppend (str_section, PSTR ("tempo_tomorrow_level %u\n"), rte_tempo_status.arr_day[RTE_DAY_TOMORROW].level);
 
   // days after
-  for (day = RTE_DAY_PLUS2; day < RTE_DAY_PLUS7; day ++) WSContentSend_P (PSTR ("tempo_day%u_level %u\n"), day - 1, rte_tempo_status.arr_day[day].level);
+  for (day = RTE_DAY_PLUS2; day < RTE_DAY_PLUS7; day ++) TeleinfoPrometheusAppend (str_section, PSTR ("tempo_day%u_level %u\n"), day - 1, rte_tempo_status.arr_day[day].level);
 }
 
 #endif  // USE_TELEINFO_RTE
 
-// Prometheus Metrics API
-void TeleinfoPrometheusWebMetrics ()
+// calculate signature of values published by a section (0 if section is disabled)
+uint32_t TeleinfoPrometheusSignature (const uint8_t section, const char *pstr_contract, const char *pstr_period)
 {
-  // page start
-  WSContentBegin (200, CT_PLAIN);
+  bool     enabled;
+  uint8_t  index, value;
+  uint32_t hash = 2166136261UL;
+  long     arr_value[5];
 
-  // main data
-  if (teleinfo_config.meter) TeleinfoPrometheusAppendGeneral ();
-  if (teleinfo_config.meter) TeleinfoPrometheusAppendMeter ();
-  if (teleinfo_config.relay) TeleinfoPrometheusAppendRelay ();
-  TeleinfoPrometheusAppendAlert ();
+  switch (section)
+  {
+    case TIC_PROMETHEUS_GENERAL:
+      enabled = teleinfo_config.meter;
+      if (!enabled) break;
+      value = TeleinfoContractGetPeriodLevel () * 16 + TeleinfoContractGetPeriodHP ();
+      hash = TeleinfoPrometheusHash (hash, pstr_contract, strlen (pstr_contract));
+      hash = TeleinfoPrometheusHash (hash, pstr_period, strlen (pstr_period));
+      hash = TeleinfoPrometheusHash (hash, &teleinfo_meter.ident, sizeof (teleinfo_meter.ident));
+      hash = TeleinfoPrometheusHash (hash, &teleinfo_contract.period, sizeof (teleinfo_contract.period));
+      hash = TeleinfoPrometheusHash (hash, &value, sizeof (value));
+      hash = TeleinfoPrometheusHash (hash, &teleinfo_conso.enabled, sizeof (teleinfo_conso.enabled));
+      hash = TeleinfoPrometheusHash (hash, &teleinfo_prod.enabled, sizeof (teleinfo_prod.enabled));
+      hash = TeleinfoPrometheusHash (hash, &teleinfo_conso_wh.total, sizeof (teleinfo_conso_wh.total));
+      hash = TeleinfoPrometheusHash (hash, teleinfo_conso_wh.index, sizeof (teleinfo_conso_wh.index));
+      hash = TeleinfoPrometheusHash (hash, &teleinfo_prod_wh.total, sizeof (teleinfo_prod_wh.total));
+      break;
+
+    case TIC_PROMETHEUS_METER:
+      enabled = teleinfo_config.meter;
+      if (!enabled) break;
+      hash = TeleinfoPrometheusHash (hash, &teleinfo_contract.phase, sizeof (teleinfo_contract.phase));
+      hash = TeleinfoPrometheusHash (hash, &teleinfo_contract.isousc, sizeof (teleinfo_contract.isousc));
+      hash = TeleinfoPrometheusHash (hash, &teleinfo_contract.ssousc, sizeof (teleinfo_contract.ssousc));
+      hash = TeleinfoPrometheusHash (hash, &teleinfo_conso.enabled, sizeof (teleinfo_conso.enabled));
+      hash = TeleinfoPrometheusHash (hash, &teleinfo_prod.enabled, sizeof (teleinfo_prod.enabled));
+      hash = TeleinfoPrometheusHash (hash, &teleinfo_conso_wh.yesterday, sizeof (teleinfo_conso_wh.yesterday));
+      hash = TeleinfoPrometheusHash (hash, &teleinfo_conso_wh.today, sizeof (teleinfo_conso_wh.today));
+      hash = TeleinfoPrometheusHash (hash, &teleinfo_prod_wh.yesterday, sizeof (teleinfo_prod_wh.yesterday));
+      hash = TeleinfoPrometheusHash (hash, &teleinfo_prod_wh.today, sizeof (teleinfo_prod_wh.today));
+      break;
+
+    case TIC_PROMETHEUS_PHASE:
+      enabled = teleinfo_config.meter && teleinfo_conso.enabled && (teleinfo_contract.phase > 1);
+      if (!enabled) break;
+      for (index = 0; index < teleinfo_contract.phase; index ++)
+      {
+        hash = TeleinfoPrometheusHash (hash, &teleinfo_conso.phase[index].voltage, sizeof (teleinfo_conso.phase[index].voltage));
+        hash = TeleinfoPrometheusHash (hash, &teleinfo_conso.phase[index].current, sizeof (teleinfo_conso.phase[index].current));
+        hash = TeleinfoPrometheusHash (hash, &teleinfo_conso.phase[index].papp, sizeof (teleinfo_conso.phase[index].papp));
+        hash = TeleinfoPrometheusHash (hash, &teleinfo_conso.phase[index].pact, sizeof (teleinfo_conso.phase[index].pact));
+      }
+      break;
+
+    case TIC_PROMETHEUS_CONSO:
+      enabled = teleinfo_config.meter && teleinfo_conso.enabled;
+      if (!enabled) break;
+      TeleinfoPrometheusConsoTotal (arr_value[0], arr_value[1], arr_value[2], arr_value[3]);
+      arr_value[4] = (teleinfo_conso.cosphi.quantity >= TIC_COSPHI_MIN) ? teleinfo_conso.cosphi.value / 10 : LONG_MAX;
+      hash = TeleinfoPrometheusHash (hash, arr_value, sizeof (arr_value));
+      break;
+
+    case TIC_PROMETHEUS_PROD:
+      enabled = teleinfo_config.meter && (teleinfo_prod.enabled || teleinfo_prod.cacsi);
+      if (!enabled) break;
+      arr_value[0] = teleinfo_prod.papp;
+      arr_value[1] = teleinfo_prod.enabled ? teleinfo_prod.pact : LONG_MAX;
+      arr_value[2] = (teleinfo_prod.enabled && (teleinfo_prod.cosphi.quantity >= TIC_COSPHI_MIN)) ? teleinfo_prod.cosphi.value / 10 : LONG_MAX;
+      arr_value[3] = teleinfo_prod.enabled ? (long)teleinfo_prod.pact_avg : LONG_MAX;
+      arr_value[4] = 0;
+      hash = TeleinfoPrometheusHash (hash, arr_value, sizeof (arr_value));
+      break;
+
+    case TIC_PROMETHEUS_RELAY:
+      enabled = teleinfo_config.relay;
+      if (!enabled) break;
+      for (index = 0; index < 8; index ++) { value = TeleinfoRelayStatus (index); hash = TeleinfoPrometheusHash (hash, &value, sizeof (value)); }
+      hash = TeleinfoPrometheusHash (hash, &teleinfo_prod.relay, sizeof (teleinfo_prod.relay));
+      hash = TeleinfoPrometheusHash (hash, &teleinfo_config.prod_trigger, sizeof (teleinfo_config.prod_trigger));
+      hash = TeleinfoPrometheusHash (hash, &teleinfo_contract.period, sizeof (teleinfo_contract.period));
+      hash = TeleinfoPrometheusHash (hash, &teleinfo_contract_db.period_qty, sizeof (teleinfo_contract_db.period_qty));
+      hash = TeleinfoPrometheusHash (hash, &teleinfo_conso.enabled, sizeof (teleinfo_conso.enabled));
+      hash = TeleinfoPrometheusHash (hash, &teleinfo_prod.enabled, sizeof (teleinfo_prod.enabled));
+      break;
+
+    case TIC_PROMETHEUS_ALERT:
+      enabled = true;
+      for (index = 0; index < TIC_ALERT_MAX; index ++) { value = (teleinfo_meter.arr_alert[index].timeout != UINT32_MAX); hash = TeleinfoPrometheusHash (hash, &value, sizeof (value)); }
+      break;
 
 #ifdef USE_TELEINFO_SOLAR
-  // solar and forecast data
-  if (teleinfo_solar.enabled) TeleinfoPrometheusAppendSolar ();
-  if (teleinfo_forecast.enabled) TeleinfoPrometheusAppendForecast ();
+    case TIC_PROMETHEUS_SOLAR:
+      enabled = teleinfo_solar.enabled;
+      if (!enabled) break;
+      hash = TeleinfoPrometheusHash (hash, &teleinfo_solar.pact, sizeof (teleinfo_solar.pact));
+      hash = TeleinfoPrometheusHash (hash, &teleinfo_solar.total_wh, sizeof (teleinfo_solar.total_wh));
+      break;
+
+    case TIC_PROMETHEUS_FORECAST:
+      enabled = teleinfo_forecast.enabled;
+      if (!enabled) break;
+      hash = TeleinfoPrometheusHash (hash, &teleinfo_forecast.pact, sizeof (teleinfo_forecast.pact));
+      hash = TeleinfoPrometheusHash (hash, &teleinfo_forecast.today.total, sizeof (teleinfo_forecast.today.total));
+      hash = TeleinfoPrometheusHash (hash, &teleinfo_forecast.tomorrow.total, sizeof (teleinfo_forecast.tomorrow.total));
+      break;
 #endif  // USE_TELEINFO_SOLAR
 
 #ifdef USE_TELEINFO_RTE
-  // tempo data
-  if (rte_config.tempo.enabled) TeleinfoPrometheusAppendTempo ();
+    case TIC_PROMETHEUS_TEMPO:
+      enabled = rte_config.tempo.enabled;
+      if (!enabled) break;
+      for (index = RTE_DAY_TODAY; index < RTE_DAY_PLUS7; index ++) hash = TeleinfoPrometheusHash (hash, &rte_tempo_status.arr_day[index].level, sizeof (rte_tempo_status.arr_day[index].level));
+      break;
+#endif  // USE_TELEINFO_RTE
+
+    default:
+      enabled = false;
+      break;
+  }
+
+  // disabled section has a null signature
+  if (!enabled) hash = 0;
+    else if (hash == 0) hash = 1;
+
+  return hash;
+}
+
+// update sections whose published values have changed
+void TeleinfoPrometheusUpdate ()
+{
+  uint8_t  section;
+  uint32_t hash;
+  char     str_contract[24];
+  char     str_period[24];
+
+  // get contract and period labels
+  TeleinfoContractGetName (str_contract, sizeof (str_contract));
+  TeleinfoPrometheusCleanupString (str_contract);
+  TeleinfoContractGetPeriodLabel (str_period, sizeof (str_period));
+  TeleinfoPrometheusCleanupString (str_period);
+
+  // loop thru sections to re-render changed ones
+  for (section = 0; section < TIC_PROMETHEUS_MAX; section ++)
+  {
+    hash = TeleinfoPrometheusSignature (section, str_contract, str_period);
+    if (hash == teleinfo_prometheus.arr_hash[section]) continue;
+
+    // render section
+    teleinfo_prometheus.arr_hash[section] = hash;
+    teleinfo_prometheus.arr_section[section] = "";
+    if (hash != 0) switch (section)
+    {
+      case TIC_PROMETHEUS_GENERAL:  TeleinfoPrometheusAppendGeneral  (teleinfo_prometheus.arr_section[section], str_contract, str_period); break;
+      case TIC_PROMETHEUS_METER:    TeleinfoPrometheusAppendMeter    (teleinfo_prometheus.arr_section[section]); break;
+      case TIC_PROMETHEUS_PHASE:    TeleinfoPrometheusAppendPhase    (teleinfo_prometheus.arr_section[section]); break;
+      case TIC_PROMETHEUS_CONSO:    TeleinfoPrometheusAppendConso    (teleinfo_prometheus.arr_section[section]); break;
+      case TIC_PROMETHEUS_PROD:     TeleinfoPrometheusAppendProd     (teleinfo_prometheus.arr_section[section]); break;
+      case TIC_PROMETHEUS_RELAY:    TeleinfoPrometheusAppendRelay    (teleinfo_prometheus.arr_section[section]); break;
+      case TIC_PROMETHEUS_ALERT:    TeleinfoPrometheusAppendAlert    (teleinfo_prometheus.arr_section[section]); break;
+#ifdef USE_TELEINFO_SOLAR
+      case TIC_PROMETHEUS_SOLAR:    TeleinfoPrometheusAppendSolar    (teleinfo_prometheus.arr_section[section]); break;
+      case TIC_PROMETHEUS_FORECAST: TeleinfoPrometheusAppendForecast (teleinfo_prometheus.arr_section[section]); break;
+#endif  // USE_TELEINFO_SOLAR
+#ifdef USE_TELEINFO_RTE
+      case TIC_PROMETHEUS_TEMPO:    TeleinfoPrometheusAppendTempo    (teleinfo_prometheus.arr_section[section]); break;
 #endif  // USE_TELEINFO_RTE
+    }
+    teleinfo_prometheus.nb_render++;
+  }
+}
+
+// called at end of each received message : refresh cache only if scrapers are active
+void TeleinfoPrometheusMessageStop ()
+{
+  if (teleinfo_prometheus.nb_scrape == 0) return;
+  if (TimePassedSince (teleinfo_prometheus.time_scrape) > TIC_PROMETHEUS_ACTIVE * 1000) return;
+
+  TeleinfoPrometheusUpdate ();
+}
+
+/***********************************************\
+ *                    Web
+\***********************************************/
+
+// Prometheus Metrics API
+void TeleinfoPrometheusWebMetrics ()
+{
+  uint8_t  section;
+  uint32_t time_start, length;
+
+  // update cache (no change if already refreshed by last message)
+  time_start = micros ();
+  TeleinfoPrometheusUpdate ();
+  teleinfo_prometheus.time_scrape = millis ();
+  teleinfo_prometheus.nb_scrape++;
+
+  // page start and pre-rendered sections, streamed without intermediate copy
+  WSContentBegin (200, CT_PLAIN);
+  length = 0;
+  for (section = 0; section < TIC_PROMETHEUS_MAX; section ++)
+  {
+    if (teleinfo_prometheus.arr_section[section].length () == 0) continue;
+    WSContentSend (teleinfo_prometheus.arr_section[section].c_str (), teleinfo_prometheus.arr_section[section].length ());
+    length += teleinfo_prometheus.arr_section[section].length ();
+  }
+
+  // self metrics
+  WSContentSend_P (PSTR ("prometheus_scrape_total %u\n"), teleinfo_prometheus.nb_scrape);
+  WSContentSend_P (PSTR ("prometheus_render_sections_total %u\n"), teleinfo_prometheus.nb_render);
+  WSContentSend_P (PSTR ("prometheus_scrape_bytes %u\n"), length);
+  WSContentSend_P (PSTR ("prometheus_scrape_duration_microseconds %u\n"), micros () - time_start);
 
   // page end
   WSContentEnd ();
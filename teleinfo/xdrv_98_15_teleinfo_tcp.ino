@@ -9,6 +9,15 @@
     - start TCP server on port 8888 : tcp_start 8888
     - stop TCP server               : tcp_stop
     - check TCP server status       : tcp_status
+    - set maximum clients           : tcp_client 4
+    - set slow client policy        : tcp_policy 0 (skip) or 1 (drop)
+    - get per client statistics     : tcp_stats
+
+  Several clients can be connected at the same time. Each client has its own
+  ring buffer fed with the raw stream and emptied thru non-blocking writes.
+  When a client is too slow and its buffer is full :
+    - skip policy : data is skipped up to next message start (STX)
+    - drop policy : client is disconnected
 
   From any linux or raspberry, you can retrieve the teleinfo stream with
     # nc 192.168.x.x 8888
@@ -19,6 +28,9 @@
     03/01/2024 v2.0 - tcp_status bug correction
                       Dynamic loading thru tcp_start
     10/07/2025 v3.0 - Refactoring based on Tasmota 15
+    16/10/2026 v3.1 - Multi-clients with per client ring buffer and non-blocking writes
+                      Slow client skip or drop policy, per client statistics
+                      Received data handed over by block
 
   This program is free software: you can redistribute it and/or modify
   it under the terms of the GNU General Public License as published by
@@ -36,49 +48,78 @@
 #ifdef USE_TELEINFO_TCP
 
 #ifdef ESP32
-  #define TCP_DATA_MAX                256
+  #define TCP_CLIENT_MAX              4         // maximum number of simultaneous clients
+  #define TCP_CLIENT_BUFFER           2048      // per client ring buffer (power of 2)
 #else
-  #define TCP_DATA_MAX                64
+  #define TCP_CLIENT_MAX              2
+  #define TCP_CLIENT_BUFFER           512
 #endif    // ESP32
 
+// slow client policy
+enum TCPServerPolicy { TCP_POLICY_SKIP, TCP_POLICY_DROP, TCP_POLICY_MAX };
+const char kTCPServerPolicy[] PROGMEM = "skip|drop";
+
+// configuration
+static struct {
+  uint8_t max_client = TCP_CLIENT_MAX;              // number of allowed clients
+  uint8_t policy     = TCP_POLICY_SKIP;             // slow client policy
+} tcp_server_config;
+
 /****************************************\
  *           Class TCPServer
 \****************************************/
 
+struct tcp_client {                       // 28 bytes + WiFiClient + ring buffer
+  WiFiClient client;                        // TCP client
+  bool       skip;                          // data skipped till next message start
+  uint16_t   head;                          // ring write index
+  uint16_t   tail;                          // ring read index
+  uint32_t   nb_sent;                       // number of bytes sent
+  uint32_t   nb_skipped;                    // number of bytes skipped (buffer full)
+  uint32_t   nb_overflow;                   // number of buffer overflows
+  char       arr_data[TCP_CLIENT_BUFFER];   // ring buffer
+};
+
 class TCPServer
 {
 public:
   TCPServer ();
   bool start (const int port);
   bool stop ();
-  void send (const char to_send);
+  void send (const char *pdata, const size_t size);
   void check_for_client ();
   int  get_port ();
+  void append_stats ();
 
 private:
+  void append (tcp_client &slot, const char *pdata, size_t size);
+  void flush (tcp_client &slot);
+  int  write (tcp_client &slot, const char *pdata, const size_t size);
+
   WiFiServer *server;                       // TCP server pointer
-  WiFiClient client;                        // TCP client
   int        server_port;                   // TCP server port number
-  uint8_t    client_next;                   // next client slot
-  uint8_t    buffer_index;                  // buffer current index
-  char       buffer[TCP_DATA_MAX];          // data transfer buffer
+  uint32_t   nb_refused;                    // number of refused connexions (all slots used)
+  uint32_t   nb_dropped;                    // number of clients dropped (slow client)
+  tcp_client arr_slot[TCP_CLIENT_MAX];      // client slots
 };
 
 TCPServer::TCPServer ()
 {
-  server       = nullptr;
-  server_port  = 0;
-  client_next  = 0;
-  buffer_index = 0;
+  server      = nullptr;
+  server_port = 0;
+  nb_refused  = 0;
+  nb_dropped  = 0;
 }
 
 bool TCPServer::stop ()
 {
+  uint8_t index;
+
   // if TCP server is inactive, cancel 
   if (server == nullptr) return false;
 
-  // stop client
-  client.stop ();
+  // stop clients
+  for (index = 0; index < TCP_CLIENT_MAX; index ++) arr_slot[index].client.stop ();
 
   // kill server
   server->stop ();
@@ -107,51 +148,159 @@ bool TCPServer::start (const int port)
   server_port = port;
   server->begin ();
 
-  // reset buffer index
-  buffer_index = 0;
-
   return true;
 }
 
-// TCP server data send
-void TCPServer::send (const char to_send)
+// non-blocking write, return number of bytes sent (-1 if connexion is broken)
+int TCPServer::write (tcp_client &slot, const char *pdata, const size_t size)
 {
-  // if TCP server is inactive, cancel 
-  if (server == nullptr) return;
+  int result;
 
-  // append caracter to buffer
-  if (buffer_index < sizeof (buffer)) buffer[buffer_index] = to_send;
-  buffer_index++;
+#ifdef ESP32
+  // socket write without waiting for free space
+  if (slot.client.fd () < 0) return -1;
+  result = ::send (slot.client.fd (), pdata, size, MSG_DONTWAIT);
+  if ((result < 0) && ((errno == EAGAIN) || (errno == EWOULDBLOCK))) result = 0;
+#else
+  // limit write to available space in TCP send buffer
+  result = (int)min (size, (size_t)slot.client.availableForWrite ());
+  if (result > 0) result = (int)slot.client.write ((const uint8_t*)pdata, (size_t)result);
+#endif    // ESP32
 
-  // if end of line or buffer size reached
-  if ((to_send == 13) || (buffer_index == sizeof (buffer)))
+  return result;
+}
+
+// send pending data of a client ring buffer
+void TCPServer::flush (tcp_client &slot)
+{
+  int      result;
+  uint16_t index, size;
+
+  // loop while data is pending (ring may wrap once)
+  while (slot.head != slot.tail)
   {
-    // send data to connected clients
-    if (client.connected ()) client.write (buffer, buffer_index);
+    // write contiguous segment
+    index  = slot.tail & (TCP_CLIENT_BUFFER - 1);
+    size   = min ((uint16_t)(slot.head - slot.tail), (uint16_t)(TCP_CLIENT_BUFFER - index));
+    result = write (slot, slot.arr_data + index, size);
+
+    // if connexion is broken, stop client
+    if (result < 0) { slot.client.stop (); slot.head = slot.tail; return; }
+
+    // update ring
+    slot.tail    += (uint16_t)result;
+    slot.nb_sent += (uint32_t)result;
+    if (result < size) break;
+  }
+}
+
+// append data to a client ring buffer
+void TCPServer::append (tcp_client &slot, const char *pdata, size_t size)
+{
+  char    *pstart;
+  uint16_t index, length;
+
+  // if skipping, wait for next message start
+  if (slot.skip)
+  {
+    pstart = (char*)memchr (pdata, 0x02, size);
+    if (pstart == nullptr) { slot.nb_skipped += size; return; }
+    slot.nb_skipped += (uint32_t)(pstart - pdata);
+    size -= (size_t)(pstart - pdata);
+    pdata = pstart;
+    slot.skip = false;
+  }
+
+  // if client ring is full, apply slow client policy
+  if (size > (size_t)(TCP_CLIENT_BUFFER - (uint16_t)(slot.head - slot.tail)))
+  {
+    slot.nb_overflow++;
+    if (tcp_server_config.policy == TCP_POLICY_DROP)
+    {
+      AddLog (LOG_LEVEL_INFO, PSTR ("TCP: Slow client %s dropped"), slot.client.remoteIP ().toString ().c_str ());
+      slot.client.stop ();
+      slot.head = slot.tail;
+      nb_dropped++;
+    }
+    else
+    {
+      slot.skip = true;
+      slot.nb_skipped += size;
+    }
+    return;
+  }
 
-    // reset buffer index
-    buffer_index = 0;
+  // copy data (ring may wrap once)
+  while (size > 0)
+  {
+    index  = slot.head & (TCP_CLIENT_BUFFER - 1);
+    length = (uint16_t)min (size, (size_t)(TCP_CLIENT_BUFFER - index));
+    memcpy (slot.arr_data + index, pdata, length);
+    slot.head += length;
+    pdata     += length;
+    size      -= length;
   }
 }
 
+// TCP server data send to all connected clients
+void TCPServer::send (const char *pdata, const size_t size)
+{
+  uint8_t index;
+
+  // if TCP server is inactive, cancel 
+  if ((server == nullptr) || (pdata == nullptr) || (size == 0)) return;
+
+  // loop thru connected clients
+  for (index = 0; index < TCP_CLIENT_MAX; index ++)
+    if (arr_slot[index].client.connected ())
+    {
+      append (arr_slot[index], pdata, size);
+      flush (arr_slot[index]);
+    }
+}
+
 // TCP server client connexion management
 void TCPServer::check_for_client ()
 {
+  uint8_t    index, count, slot;
+  WiFiClient client;
+
   // if TCP server is inactive, cancel 
   if (server == nullptr) return;
 
-  // if a new client connection is waitong
-  if (server->hasClient ())
+  // loop thru slots to flush pending data and count connected clients
+  count = 0;
+  slot  = UINT8_MAX;
+  for (index = 0; index < TCP_CLIENT_MAX; index ++)
   {
-    // if needed, disconnect previous client
-    if (client.connected ()) client.stop ();
+    if (arr_slot[index].client.connected ()) { flush (arr_slot[index]); count++; }
+      else if (slot == UINT8_MAX) slot = index;
+  }
 
-    // connect new client
-    client = server->available ();
+  // if no new client connection is waiting, ignore
+  if (!server->hasClient ()) return;
+  client = server->available ();
 
-    // reset buffer
-    buffer_index = 0;
+  // if all slots are used, refuse new client
+  if ((slot == UINT8_MAX) || (count >= tcp_server_config.max_client))
+  {
+    AddLog (LOG_LEVEL_INFO, PSTR ("TCP: Client %s refused, %u clients connected"), client.remoteIP ().toString ().c_str (), count);
+    client.stop ();
+    nb_refused++;
+    return;
   }
+
+  // connect new client in free slot
+  arr_slot[slot].client.stop ();
+  arr_slot[slot].client      = client;
+  arr_slot[slot].skip        = true;
+  arr_slot[slot].head        = 0;
+  arr_slot[slot].tail        = 0;
+  arr_slot[slot].nb_sent     = 0;
+  arr_slot[slot].nb_skipped  = 0;
+  arr_slot[slot].nb_overflow = 0;
+  arr_slot[slot].client.setNoDelay (true);
+  AddLog (LOG_LEVEL_INFO, PSTR ("TCP: Client %s connected on slot %u"), client.remoteIP ().toString ().c_str (), slot + 1);
 }
 
 // TCP server running port number
@@ -160,13 +309,32 @@ int TCPServer::get_port ()
   return server_port;
 }
 
+// append server and per client statistics to JSON
+void TCPServer::append_stats ()
+{
+  bool    first = true;
+  uint8_t index;
+  char    str_policy[8];
+
+  GetTextIndexed (str_policy, sizeof (str_policy), tcp_server_config.policy, kTCPServerPolicy);
+  ResponseAppend_P (PSTR ("\"port\":%d,\"max\":%u,\"policy\":\"%s\",\"refused\":%u,\"dropped\":%u,\"client\":["), server_port, tcp_server_config.max_client, str_policy, nb_refused, nb_dropped);
+  for (index = 0; index < TCP_CLIENT_MAX; index ++)
+    if (arr_slot[index].client.connected ())
+    {
+      if (!first) ResponseAppend_P (PSTR (","));
+      ResponseAppend_P (PSTR ("{\"slot\":%u,\"ip\":\"%s\",\"sent\":%u,\"skipped\":%u,\"overflow\":%u,\"pending\":%u}"), index + 1, arr_slot[index].client.remoteIP ().toString ().c_str (), arr_slot[index].nb_sent, arr_slot[index].nb_skipped, arr_slot[index].nb_overflow, (uint16_t)(arr_slot[index].head - arr_slot[index].tail));
+      first = false;
+    }
+  ResponseAppend_P (PSTR ("]"));
+}
+
 /***********************************************************\
  *                      Variables
 \***********************************************************/
 
 // TCP - MQTT commands
-const char kTCPServerCommands[]         PROGMEM = "tcp" "|"            "|"       "_start"     "|"      "_stop"      "|"     "_status";
-void (* const TCPServerCommand[])(void) PROGMEM = { &CmndTeleinfoTCPHelp, &CmndTeleinfoTCPStart, &CmndTeleinfoTCPStop, &CmndTeleinfoTCPStatus };
+const char kTCPServerCommands[]         PROGMEM = "tcp" "|"            "|"       "_start"     "|"      "_stop"      "|"     "_status"      "|"     "_client"      "|"     "_policy"      "|"     "_stats";
+void (* const TCPServerCommand[])(void) PROGMEM = { &CmndTeleinfoTCPHelp, &CmndTeleinfoTCPStart, &CmndTeleinfoTCPStop, &CmndTeleinfoTCPStatus, &CmndTeleinfoTCPClient, &CmndTeleinfoTCPPolicy, &CmndTeleinfoTCPStats };
 
 // TCP server instance
 TCPServer *ptcp_server = nullptr;
@@ -187,8 +355,12 @@ void CmndTeleinfoTCPHelp ()
   AddLog (LOG_LEVEL_INFO, PSTR (" - tcp_status       = server listening port, 0 if stopped (%d)"), tcp_port);
   AddLog (LOG_LEVEL_INFO, PSTR (" - tcp_start <port> = start server on specified port"));
   AddLog (LOG_LEVEL_INFO, PSTR (" - tcp_stop         = stop stream"));
-  AddLog (LOG_LEVEL_INFO, PSTR ("   Server allows only 1 concurrent connexion"));
-  AddLog (LOG_LEVEL_INFO, PSTR ("   Any new client will kill previous one"));
+  AddLog (LOG_LEVEL_INFO, PSTR (" - tcp_client <n>   = maximum concurrent clients, 1..%u (%u)"), TCP_CLIENT_MAX, tcp_server_config.max_client);
+  AddLog (LOG_LEVEL_INFO, PSTR (" - tcp_policy <n>   = slow client policy (%u)"), tcp_server_config.policy);
+  AddLog (LOG_LEVEL_INFO, PSTR ("     0 : skip data till next message"));
+  AddLog (LOG_LEVEL_INFO, PSTR ("     1 : drop client"));
+  AddLog (LOG_LEVEL_INFO, PSTR (" - tcp_stats        = server and per client statistics"));
+  AddLog (LOG_LEVEL_INFO, PSTR ("   New clients are refused when all slots are used"));
   ResponseCmndDone();
 }
 
@@ -261,6 +433,29 @@ void CmndTeleinfoTCPStatus (void)
   ResponseCmndNumber (tcp_port);
 }
 
+// Set maximum number of clients
+void CmndTeleinfoTCPClient (void)
+{
+  if ((XdrvMailbox.payload > 0) && (XdrvMailbox.payload <= TCP_CLIENT_MAX)) tcp_server_config.max_client = (uint8_t)XdrvMailbox.payload;
+  ResponseCmndNumber (tcp_server_config.max_client);
+}
+
+// Set slow client policy
+void CmndTeleinfoTCPPolicy (void)
+{
+  if ((XdrvMailbox.data_len > 0) && (XdrvMailbox.payload >= 0) && (XdrvMailbox.payload < TCP_POLICY_MAX)) tcp_server_config.policy = (uint8_t)XdrvMailbox.payload;
+  ResponseCmndNumber (tcp_server_config.policy);
+}
+
+// Get TCP server statistics
+void CmndTeleinfoTCPStats (void)
+{
+  Response_P (PSTR ("{\"%s\":{"), XdrvMailbox.command);
+  if (ptcp_server != nullptr) ptcp_server->append_stats ();
+    else ResponseAppend_P (PSTR ("\"port\":0"));
+  ResponseAppend_P (PSTR ("}}"));
+}
+
 /***********************************************************\
  *                      Functions
 \***********************************************************/
@@ -279,11 +474,11 @@ void TeleinfoTCPEvery100ms ()
   if (ptcp_server != nullptr) ptcp_server->check_for_client ();
 }
 
-// send caracter
-void TeleinfoTCPSend (const char to_send)
+// send block of received data
+void TeleinfoTCPSend (const char *pdata, const size_t size)
 {
-  // if server is active, send caracter
-  if (ptcp_server != nullptr) ptcp_server->send (to_send);
+  // if server is active, send data
+  if (ptcp_server != nullptr) ptcp_server->send (pdata, size);
 }
 
 /***************************************\
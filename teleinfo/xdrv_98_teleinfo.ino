@@ -60,10 +60,46 @@
     17/04/2026 v15.2  - Remove baudrate auto-detect
                         Switch ti historique mode by default
                         Add SOLAR and FORECAST to Live data
+    16/10/2026 v15.3  - Add asynchronous HTTPS request engine (ESP32)
+                        Add JSON stream parser for HTTPS answers
+                        Add per endpoint conditional GET, backoff and statistics
+                        Add kept-alive connexions and plain text POST per endpoint
+                        Add MQTT store-and-forward queue during broker outages
+                        Add MQTT publication scheduler (token bucket, priorities and round-robin)
+                        Add per field deadband report-by-exception (sparse SENSOR with delta policy)
+                        Hand received data to TCP stream server by block
+                        Rebuild contract dependant modules on contract change (no more restart)
+                        Feed speed detector with received data until speed is confirmed
+                        Resume contract data from RTC memory on Winky wake-up (no data file read)
+    16/10/2026 v15.4  - Time HTTPS connexion and TLS handshake apart from request
+                        Key conditional GET validators on URL only
+                        Short connexion timeout and priority for LAN endpoints (Awtrix)
+                        Keep MQTT ring header in memory, written to file every minute
+                        Own publication budget for paced producers (Homie), message size measured before rules
+                        Sparse delta messages published on tele/DELTA, SENSOR always complete
+                        MQTT queue records batched in memory, SENSOR queued as binary record
 
   Configuration :
       Settings->rf_code[15][8] : connexion speed
 
+  MQTT queue :
+      When broker is not reachable, SENSOR publications are stored in a LittleFS
+      ring file (/teleinfo-mqtt.dat) and LIVE / TIC publications are coalesced
+      in RAM (only last value is kept). Everything is replayed in order at
+      a controlled rate once the broker is back.
+      SENSOR is stored as a binary record of its measured values (field index
+      and int32 or int64 value) and rebuilt as METER, CONTRACT and RELAY JSON
+      on replay. Records are batched in memory (RTC memory on ESP32) and
+      written to the ring file every 15 mn (5 mn on ESP8266) or when batch is full.
+
+  Delta policy :
+      Every field (U, I, P, W per phase and global, cosphi, totals, period,
+      relays) has its own deadband (absolute or % of last published value)
+      with minimum and maximum publication intervals. Only fields out of their
+      deadband are published in a sparse message on tele/DELTA (not retained),
+      so SENSOR consumers (Home Assistant templates, Domoticz, rules) always get
+      complete messages. Every teleperiod, a full SENSOR message resets all references.
+
   This program is free software: you can redistribute it and/or modify
   it under the terms of the GNU General Public License as published by
   the Free Software Foundation, either version 3 of the License, or
@@ -558,857 +594,2703 @@ void TeleinfoDriverCalendarGetDate (const uint32_t delta, char *pstr_date, const
 }
 
 /*************************************************\
- *               JSON publication
+ *          MQTT store-and-forward queue
 \*************************************************/
 
-// Trigger publication flags
-void TeleinfoDriverJsonPublish ()
+// check of records batch copy
+uint32_t TeleinfoMqttBatchCheck ()
 {
-  // message start
-  ResponseClear ();
-  if (RtcTime.valid) ResponseAppendTime ();
-    else ResponseAppend_P (PSTR ("{"));
-
-  // populate message
-  TeleinfoDriverJsonAppend ();
-
-  // message end and publication
-  ResponseJsonEnd ();
-  MqttPublishPrefixTopic_P (TELE, PSTR(D_RSLT_SENSOR),  Settings->flag.mqtt_sensor_retain);
-  XdrvRulesProcess (true);
+  return TIC_MQTT_QUEUE_MAGIC ^ teleinfo_mqtt_batch.used ^ ((uint32_t)teleinfo_mqtt_batch.count << 16);
+}
 
-  // reset flag and declare publication
-  teleinfo_meter.json.data = false;
-  TeleinfoDriverWebDeclare (TIC_WEB_MQTT);
+// reset records batch
+void TeleinfoMqttBatchClear ()
+{
+  teleinfo_mqtt_batch.count = 0;
+  teleinfo_mqtt_batch.used  = 0;
+  teleinfo_mqtt_batch.check = TeleinfoMqttBatchCheck ();
+  teleinfo_mqtt.time_batch  = millis ();
 }
 
-// Generate LIVE JSON
-void TeleinfoDriverPublishLive ()
+// UTC timestamp of oldest record in batch (0 if empty)
+uint32_t TeleinfoMqttBatchOldest ()
 {
-  // start of message
-  ResponseClear ();
-  ResponseAppend_P (PSTR ("{"));
+  tic_mqtt_record record;
 
-  // METER data
-  TeleinfoDriverAppendMeterSensor ();
+  if (teleinfo_mqtt_batch.count == 0) return 0;
+  memcpy (&record, teleinfo_mqtt_batch.arr_data, sizeof (record));
 
-#ifdef USE_TELEINFO_SOLAR
-  // SOLAR and FORECAST data
-  TeleinfoSolarAppendSensor ();
-#endif    // USE_TELEINFO_SOLAR
+  return record.time;
+}
 
-  // end of message
-  ResponseJsonEnd ();
+// remove oldest record from batch
+void TeleinfoMqttBatchRemoveFirst ()
+{
+  uint16_t size;
+  tic_mqtt_record record;
+
+  // check batch
+  if (teleinfo_mqtt_batch.count == 0) return;
+
+  // shift following records
+  memcpy (&record, teleinfo_mqtt_batch.arr_data, sizeof (record));
+  size = sizeof (record) + record.size;
+  memmove (teleinfo_mqtt_batch.arr_data, teleinfo_mqtt_batch.arr_data + size, teleinfo_mqtt_batch.used - size);
+  teleinfo_mqtt_batch.used -= size;
+  teleinfo_mqtt_batch.count--;
+  teleinfo_mqtt_batch.check = TeleinfoMqttBatchCheck ();
+}
 
-  // message publication
-  MqttPublishPrefixTopicRulesProcess_P (TELE, PSTR ("LIVE"), false);
+#ifdef USE_UFILESYS
 
-  // reset JSON flag and declare publication
-  teleinfo_meter.json.live = false;
-  TeleinfoDriverWebDeclare (TIC_WEB_MQTT);
+// read from ring file data area (handle wrap at end of data area)
+void TeleinfoMqttQueueRead (File &file, const uint32_t position, uint8_t *pdata, const uint32_t size)
+{
+  uint32_t offset, length;
+
+  // read up to end of data area, then from start
+  offset = position % TIC_MQTT_QUEUE_SIZE;
+  length = min (size, TIC_MQTT_QUEUE_SIZE - offset);
+  file.seek (sizeof (tic_mqtt_header) + offset);
+  file.read (pdata, length);
+  if (length < size)
+  {
+    file.seek (sizeof (tic_mqtt_header));
+    file.read (pdata + length, size - length);
+  }
 }
 
-// Generate TIC full JSON
-void TeleinfoDriverPublishTic ()
+// write to ring file data area (handle wrap at end of data area)
+void TeleinfoMqttQueueWrite (File &file, const uint32_t position, const uint8_t *pdata, const uint32_t size)
 {
-  bool    is_first = true;
-  uint8_t index;
+  uint32_t offset, length;
+
+  // write up to end of data area, then from start
+  offset = position % TIC_MQTT_QUEUE_SIZE;
+  length = min (size, TIC_MQTT_QUEUE_SIZE - offset);
+  file.seek (sizeof (tic_mqtt_header) + offset);
+  file.write (pdata, length);
+  if (length < size)
+  {
+    file.seek (sizeof (tic_mqtt_header));
+    file.write (pdata + length, size - length);
+  }
+}
 
-  // start of message
-  ResponseClear ();
-  ResponseAppend_P (PSTR ("{"));
+// check of ring header copy
+uint32_t TeleinfoMqttQueueCheck (const tic_mqtt_header &header)
+{
+  return TIC_MQTT_QUEUE_MAGIC ^ header.head ^ (header.tail << 1) ^ (header.used << 2) ^ ((uint32_t)header.count << 16) ^ header.version;
+}
 
-  // loop thru TIC message lines to add lines
-  for (index = 0; index < TIC_LINE_QTY; index ++)
-    if (teleinfo_message.arr_last[index].checksum != 0)
-    {
-      if (!is_first) ResponseAppend_P (PSTR (",")); else is_first = false;
-      ResponseAppend_P (PSTR ("\"%s\":\"%s\""), teleinfo_message.arr_last[index].str_etiquette, teleinfo_message.arr_last[index].str_donnee);
-    }
+// ring header has changed : update oldest record timestamp and RTC copy, file header is written later
+void TeleinfoMqttQueueUpdateHeader (File &file)
+{
+  tic_mqtt_record record;
 
-  // end of message
-  ResponseJsonEnd ();
+  // update oldest record timestamp (ring file first, then batch)
+  if (teleinfo_mqtt.header.count > 0)
+  {
+    TeleinfoMqttQueueRead (file, teleinfo_mqtt.header.tail, (uint8_t*)&record, sizeof (record));
+    teleinfo_mqtt.time_oldest = record.time;
+  }
+  else teleinfo_mqtt.time_oldest = TeleinfoMqttBatchOldest ();
 
-  // message publication
-  MqttPublishPrefixTopic_P (TELE, PSTR ("TIC"),  false);
-  XdrvRulesProcess (true);
+  // keep a copy surviving restart
+#ifdef ESP32
+  teleinfo_mqtt_rtc.header = teleinfo_mqtt.header;
+  teleinfo_mqtt_rtc.check  = TeleinfoMqttQueueCheck (teleinfo_mqtt.header);
+#endif    // ESP32
 
-  // reset JSON flag and declare publication
-  teleinfo_meter.json.tic = false;
-  TeleinfoDriverWebDeclare (TIC_WEB_MQTT);
+  teleinfo_mqtt.dirty = true;
 }
 
-// Append ALERT to JSON
-void TeleinfoDriverAppendAlert ()
+// write ring header to file, at most every TIC_MQTT_QUEUE_FLUSH sec. unless forced
+void TeleinfoMqttQueueFlush (const bool force)
 {
-  bool    is_active;
-  uint8_t index;
-  char    str_key[8];
-  char    str_source[TIC_ALERT_SRC_SIZE];
+  char str_filename[24];
+  File file;
+
+  // check if header should be written
+  if (!teleinfo_mqtt.dirty || !teleinfo_mqtt.stored || (ffsp == nullptr)) return;
+  if (!force && (TimePassedSince (teleinfo_mqtt.time_flush) < TIC_MQTT_QUEUE_FLUSH * 1000)) return;
+
+  // write header
+  strcpy_P (str_filename, PSTR_MQTT_QUEUE_FILE);
+  file = ffsp->open (str_filename, "r+");
+  if (!file) return;
+  file.write ((uint8_t*)&teleinfo_mqtt.header, sizeof (tic_mqtt_header));
+  file.close ();
+
+  teleinfo_mqtt.dirty      = false;
+  teleinfo_mqtt.time_flush = millis ();
+}
 
-  // start of section
-  ResponseAppend_P (PSTR (",\"ALERT\":{"));
+// open ring file to append records (create it with its header if needed)
+bool TeleinfoMqttQueueOpen (File &file)
+{
+  char str_filename[24];
 
-  // loop thru alerts
-  for (index = 0; index < TIC_ALERT_MAX; index ++)
+  // check filesystem
+  if (ffsp == nullptr) return false;
+
+  // open ring file
+  strcpy_P (str_filename, PSTR_MQTT_QUEUE_FILE);
+  if (teleinfo_mqtt.stored) file = ffsp->open (str_filename, "r+");
+    else file = ffsp->open (str_filename, "w+");
+  if (!file) return false;
+
+  // write header of new file
+  if (!teleinfo_mqtt.stored)
   {
-    // get alert data
-    GetTextIndexed (str_key, sizeof (str_key), index, kTeleinfoAlert);
-    TeleinfoDriverAlertGetSource (index, str_source);
+    file.write ((uint8_t*)&teleinfo_mqtt.header, sizeof (tic_mqtt_header));
+    teleinfo_mqtt.time_flush = millis ();
+  }
 
-    // append alert
-    if (index > 0) ResponseAppend_P (PSTR (","));
-    ResponseAppend_P (PSTR ("\"%s\":\"%s\""), str_key, str_source);
+  return true;
+}
+
+// append a record to opened ring file, dropping oldest records if needed
+void TeleinfoMqttQueueAppend (File &file, const tic_mqtt_record &record, const uint8_t *pdata)
+{
+  tic_mqtt_record oldest;
+
+  // drop oldest records until new one fits
+  while ((teleinfo_mqtt.header.count > 0) && (teleinfo_mqtt.header.used + sizeof (record) + record.size > TIC_MQTT_QUEUE_SIZE))
+  {
+    TeleinfoMqttQueueRead (file, teleinfo_mqtt.header.tail, (uint8_t*)&oldest, sizeof (oldest));
+    teleinfo_mqtt.header.tail  = (teleinfo_mqtt.header.tail + sizeof (oldest) + oldest.size) % TIC_MQTT_QUEUE_SIZE;
+    teleinfo_mqtt.header.used -= sizeof (oldest) + oldest.size;
+    teleinfo_mqtt.header.count--;
+    teleinfo_mqtt.nb_dropped++;
   }
 
-  // end of section
-  ResponseAppend_P (PSTR ("}"));
+  // write record header and payload
+  TeleinfoMqttQueueWrite (file, teleinfo_mqtt.header.head, (uint8_t*)&record, sizeof (record));
+  TeleinfoMqttQueueWrite (file, teleinfo_mqtt.header.head + sizeof (record), pdata, record.size);
+
+  // update header in memory
+  teleinfo_mqtt.header.head  = (teleinfo_mqtt.header.head + sizeof (record) + record.size) % TIC_MQTT_QUEUE_SIZE;
+  teleinfo_mqtt.header.used += sizeof (record) + record.size;
+  teleinfo_mqtt.header.count++;
+  teleinfo_mqtt.stored = true;
 }
 
-// Append METER and PROD to JSON
-void TeleinfoDriverAppendMeterSensor ()
+#endif    // USE_UFILESYS
+
+// write records batch to ring file in one pass, return false if batch could not be written
+bool TeleinfoMqttBatchWrite ()
 {
-  uint8_t phase, value;
-  long    voltage, current, power_app, power_act;
+  teleinfo_mqtt.time_batch = millis ();
+  if (teleinfo_mqtt_batch.count == 0) return true;
 
-  // METER basic data
-  MiscOptionPrepareJsonSection ();
-  ResponseAppend_P (PSTR ("\"METER\":{\"PH\":%u,\"ISUB\":%u,\"PSUB\":%u,\"PMAX\":%d"), teleinfo_contract.phase, teleinfo_contract.isousc, teleinfo_contract.ssousc, (long)teleinfo_config.percent * teleinfo_contract.ssousc / 100);
+#ifdef USE_UFILESYS
+  uint16_t position;
+  File     file;
+  tic_mqtt_record record;
 
-  // conso 
-  if (teleinfo_conso.enabled)
+  // append batch records
+  if (!TeleinfoMqttQueueOpen (file)) return false;
+  for (position = 0; position < teleinfo_mqtt_batch.used; position += sizeof (record) + record.size)
   {
-    // conso : loop thru phases
-    voltage = 0;
-    current = 0;
-    power_app = 0;
-    power_act = 0;
-    for (phase = 0; phase < teleinfo_contract.phase; phase++)
-    {
-      // calculate parameters
-      voltage   += teleinfo_conso.phase[phase].voltage;
-      current   += teleinfo_conso.phase[phase].current;
-      power_app += teleinfo_conso.phase[phase].papp;
-      power_act += teleinfo_conso.phase[phase].pact;
+    memcpy (&record, teleinfo_mqtt_batch.arr_data + position, sizeof (record));
+    TeleinfoMqttQueueAppend (file, record, teleinfo_mqtt_batch.arr_data + position + sizeof (record));
+  }
 
-      // if needed, publish phase data
-      value = phase + 1;
-      ResponseAppend_P (PSTR (",\"U%u\":%d,\"I%u\":%d.%02d"), value, teleinfo_conso.phase[phase].voltage, value, teleinfo_conso.phase[phase].current / 1000, teleinfo_conso.phase[phase].current % 1000 / 10);
-      ResponseAppend_P (PSTR (",\"P%u\":%d,\"W%u\":%d"), value, teleinfo_conso.phase[phase].papp, value, teleinfo_conso.phase[phase].pact);
-    } 
+  // batch is now empty
+  TeleinfoMqttBatchClear ();
+  TeleinfoMqttQueueUpdateHeader (file);
+  file.close ();
 
-    // conso : values and cosphi
-    if (teleinfo_contract.phase > 1) voltage = voltage / (long)teleinfo_contract.phase;
-    ResponseAppend_P (PSTR (",\"U\":%d,\"I\":%d.%02d,\"P\":%d,\"W\":%d"), voltage, current / 1000, current % 1000 / 10, power_app, power_act);
-    if (teleinfo_conso.cosphi.quantity >= TIC_COSPHI_MIN) ResponseAppend_P (PSTR (",\"C\":%d.%02d"), teleinfo_conso.cosphi.value / 1000, teleinfo_conso.cosphi.value % 1000 / 10);
+  return true;
+#else
+  return false;
+#endif    // USE_UFILESYS
+}
 
-    // conso : if not on battery, publish total of yesterday and today
-    if (TeleinfoDriverIsPowered ())
-    {
-      ResponseAppend_P (PSTR (",\"YDAY\":%d"), teleinfo_conso_wh.yesterday);
-      ResponseAppend_P (PSTR (",\"TDAY\":%d"), teleinfo_conso_wh.today);
-    }
-  }
-  
-  // if meter in production mode, publish complete production data
-  if (teleinfo_prod.enabled)
+// reset ring header
+void TeleinfoMqttQueueClear ()
+{
+  teleinfo_mqtt.stored             = false;
+  teleinfo_mqtt.dirty              = false;
+  teleinfo_mqtt.time_oldest        = TeleinfoMqttBatchOldest ();
+  teleinfo_mqtt.header.version     = TIC_MQTT_QUEUE_VERSION;
+  teleinfo_mqtt.header.reserved    = 0;
+  teleinfo_mqtt.header.count       = 0;
+  teleinfo_mqtt.header.head        = 0;
+  teleinfo_mqtt.header.tail        = 0;
+  teleinfo_mqtt.header.used        = 0;
+
+#ifdef ESP32
+  teleinfo_mqtt_rtc.check = 0;
+#endif    // ESP32
+}
+
+// load ring header and records batch left before a restart
+void TeleinfoMqttQueueLoad ()
+{
+  // records batch is kept if it survived restart (RTC memory on ESP32)
+  if ((teleinfo_mqtt_batch.check != TeleinfoMqttBatchCheck ()) || (teleinfo_mqtt_batch.used > TIC_MQTT_BATCH_SIZE)) TeleinfoMqttBatchClear ();
+  teleinfo_mqtt.time_batch = millis ();
+
+  TeleinfoMqttQueueClear ();
+
+#ifdef USE_UFILESYS
+  char str_filename[24];
+  File file;
+
+  // check ring file
+  if (ffsp == nullptr) return;
+  strcpy_P (str_filename, PSTR_MQTT_QUEUE_FILE);
+  if (!ffsp->exists (str_filename)) return;
+
+  // read header, RTC copy is more recent if it survived restart
+  file = ffsp->open (str_filename, "r");
+  file.read ((uint8_t*)&teleinfo_mqtt.header, sizeof (tic_mqtt_header));
+#ifdef ESP32
+  if (teleinfo_mqtt_rtc.check == TeleinfoMqttQueueCheck (teleinfo_mqtt_rtc.header)) teleinfo_mqtt.header = teleinfo_mqtt_rtc.header;
+#endif    // ESP32
+
+  // if header is valid, records are waiting
+  teleinfo_mqtt.stored = ((teleinfo_mqtt.header.version == TIC_MQTT_QUEUE_VERSION) && (teleinfo_mqtt.header.count > 0) && (teleinfo_mqtt.header.used <= TIC_MQTT_QUEUE_SIZE));
+  if (teleinfo_mqtt.stored) TeleinfoMqttQueueUpdateHeader (file);
+  file.close ();
+
+  // else remove file
+  if (!teleinfo_mqtt.stored)
   {
-    // prod : global values
-    ResponseAppend_P (PSTR (",\"PP\":%d"), teleinfo_prod.papp);
-    ResponseAppend_P (PSTR (",\"PW\":%d"), teleinfo_prod.pact);
+    TeleinfoMqttQueueClear ();
+    ffsp->remove (str_filename);
+  }
+#endif    // USE_UFILESYS
 
-    // prod : cosphi
-    if (teleinfo_prod.cosphi.quantity >= TIC_COSPHI_MIN) ResponseAppend_P (PSTR (",\"PC\":%d.%02d"), teleinfo_prod.cosphi.value / 1000, teleinfo_prod.cosphi.value % 1000 / 10);
+  // log
+  if (teleinfo_mqtt.header.count + teleinfo_mqtt_batch.count > 0) AddLog (LOG_LEVEL_INFO, PSTR ("TIC: %u messages MQTT en attente"), teleinfo_mqtt.header.count + teleinfo_mqtt_batch.count);
+}
 
-    // prod : average power
-    ResponseAppend_P (PSTR (",\"PAVG\":%d"), (long)teleinfo_prod.pact_avg);
+// purge all waiting messages
+void TeleinfoMqttQueuePurge ()
+{
+  uint8_t index;
 
-    // prod : if not on battery, publish total of yesterday and today
-    if (TeleinfoDriverIsPowered ())
+  // free coalesced values
+  for (index = 0; index < TIC_MQTT_MAX; index ++)
+    if (teleinfo_mqtt.arr_last[index] != nullptr)
     {
-      ResponseAppend_P (PSTR (",\"PYDAY\":%d"), teleinfo_prod_wh.yesterday);
-      ResponseAppend_P (PSTR (",\"PTDAY\":%d"), teleinfo_prod_wh.today);
+      free (teleinfo_mqtt.arr_last[index]);
+      teleinfo_mqtt.arr_last[index] = nullptr;
     }
-  }
 
-  // prodcution apparent power (allow to track excess of self production)
-  else if (teleinfo_prod.cacsi) ResponseAppend_P (PSTR (",\"PP\":%d"), teleinfo_prod.papp);
+#ifdef USE_UFILESYS
+  char str_filename[24];
 
-  // end of message
-  ResponseJsonEnd ();
+  // remove ring file
+  strcpy_P (str_filename, PSTR_MQTT_QUEUE_FILE);
+  if ((ffsp != nullptr) && ffsp->exists (str_filename)) ffsp->remove (str_filename);
+#endif    // USE_UFILESYS
+
+  TeleinfoMqttBatchClear ();
+  TeleinfoMqttQueueClear ();
+  teleinfo_mqtt.replay = false;
 }
 
-// Append CONTRACT to JSON
-void TeleinfoDriverAppendContractSensor ()
+// check if some messages are waiting
+bool TeleinfoMqttQueuePending ()
 {
   uint8_t index;
-  char    str_value[32];
-  char    str_period[32];
-
-  // section CONTRACT
-  MiscOptionPrepareJsonSection ();
-  ResponseAppend_P (PSTR ("\"CONTRACT\":{"));
+  bool    pending = teleinfo_mqtt.stored || (teleinfo_mqtt_batch.count > 0);
 
-  // meter serial number
-  lltoa (teleinfo_meter.ident, str_value, 10);
-  ResponseAppend_P (PSTR ("\"serial\":\"%s\""), str_value);
-
-  // contract name
-  TeleinfoContractGetName (str_value, sizeof (str_value));
-  ResponseAppend_P (PSTR (",\"name\":\"%s\""), str_value);
+  for (index = 0; index < TIC_MQTT_MAX; index ++) pending |= (teleinfo_mqtt.arr_last[index] != nullptr);
 
-  // contract period
-  TeleinfoContractGetPeriodLabel (str_value, sizeof (str_value));
-  ResponseAppend_P (PSTR (",\"period\":\"%s\""), str_value);
+  return pending;
+}
 
-  // period profile
-  TeleinfoContractGetPeriodProfile (str_value, sizeof (str_value));
-  ResponseAppend_P (PSTR (",\"profile\":\"%s\""), str_value);
+// size of a field value in binary SENSOR record
+uint8_t TeleinfoMqttSensorLength (const uint8_t field)
+{
+  if ((field == TIC_DELTA_CONSO) || (field == TIC_DELTA_PROD) || (field >= TIC_SENSOR_INDEX)) return sizeof (long long);
+  return sizeof (int32_t);
+}
 
-  // period color
-  index = TeleinfoContractGetPeriodLevel ();
-  GetTextIndexed (str_value, sizeof (str_value), index, kTeleinfoLevelLabel);
-  ResponseAppend_P (PSTR (",\"color\":\"%s\""), str_value);
+// section of a field in SENSOR JSON (METER, CONTRACT or RELAY)
+uint8_t TeleinfoMqttSensorSection (const uint8_t field)
+{
+  if (field == TIC_DELTA_RELAY) return TIC_SENSOR_SECTION_RELAY;
+  if ((field >= TIC_DELTA_PERIOD) && (field < TIC_SENSOR_PH)) return TIC_SENSOR_SECTION_CONTRACT;
+  if (field >= TIC_SENSOR_INDEX) return TIC_SENSOR_SECTION_CONTRACT;
+  return TIC_SENSOR_SECTION_METER;
+}
 
-  // period type
-  index = TeleinfoContractGetPeriodHP ();
-  GetTextIndexed (str_value, sizeof (str_value), index, kTeleinfoHourLabel);
-  ResponseAppend_P (PSTR (",\"hour\":\"%s\""), str_value);
+// append a field to binary SENSOR record (ignored if record is full)
+void TeleinfoMqttSensorAppend (uint8_t *pdata, const uint16_t size, uint16_t &used, const uint8_t field, const long long value)
+{
+  uint8_t length;
+  int32_t value32;
+
+  // check space
+  length = TeleinfoMqttSensorLength (field);
+  if (used + 1 + length > size) return;
+
+  // field index and value
+  pdata[used++] = field;
+  if (length == sizeof (int32_t)) { value32 = (int32_t)value; memcpy (pdata + used, &value32, length); }
+    else memcpy (pdata + used, &value, length);
+  used += length;
+}
 
-  // level today at 12h
-  index = TeleinfoDriverCalendarGetLevel (TIC_DAY_TODAY, UINT8_MAX, false);
-  GetTextIndexed (str_value, sizeof (str_value), index, kTeleinfoLevelLabel);
-  ResponseAppend_P (PSTR (",\"tday\":\"%s\""), str_value);
+// encode SENSOR values as binary record, return record size (0 if METER and CONTRACT are not published)
+uint16_t TeleinfoMqttSensorEncode (uint8_t *pdata, const uint16_t size)
+{
+  uint8_t  index;
+  uint16_t used = 0;
+  long     value;
 
-  // level tomorrow at 12h
-  index = TeleinfoDriverCalendarGetLevel (TIC_DAY_TMROW, UINT8_MAX, false);
-  GetTextIndexed (str_value, sizeof (str_value), index, kTeleinfoLevelLabel);
-  ResponseAppend_P (PSTR (",\"tmrw\":\"%s\""), str_value);
+  // check METER publication
+  if (!teleinfo_config.meter) return 0;
 
-  // total conso counter
-  lltoa (teleinfo_conso_wh.total, str_value, 10);
-  ResponseAppend_P (PSTR (",\"CONSO\":%s"), str_value);
+  // meter data
+  TeleinfoMqttSensorAppend (pdata, size, used, TIC_SENSOR_PH,   teleinfo_contract.phase);
+  TeleinfoMqttSensorAppend (pdata, size, used, TIC_SENSOR_ISUB, teleinfo_contract.isousc);
+  TeleinfoMqttSensorAppend (pdata, size, used, TIC_SENSOR_PSUB, teleinfo_contract.ssousc);
+  TeleinfoMqttSensorAppend (pdata, size, used, TIC_SENSOR_PMAX, (long)teleinfo_config.percent * teleinfo_contract.ssousc / 100);
 
-  // loop to publish conso counters
-  for (index = 0; index < teleinfo_contract_db.period_qty; index ++)
+  // published fields, as handled by report-by-exception (energy counters are taken with their 64 bits)
+  for (index = 0; index < TIC_DELTA_MAX; index ++)
   {
-    TeleinfoContractGetPeriodCode (str_period, sizeof (str_period), index);
-    lltoa (teleinfo_conso_wh.index[index], str_value, 10);
-    ResponseAppend_P (PSTR (",\"%s\":%s"), str_period, str_value);
+    if ((index == TIC_DELTA_CONSO) || (index == TIC_DELTA_PROD)) continue;
+    if (TeleinfoDeltaGetValue (index, value)) TeleinfoMqttSensorAppend (pdata, size, used, index, value);
   }
 
-  // total production counter
-  if (teleinfo_prod.enabled)
-  {
-    lltoa (teleinfo_prod_wh.total, str_value, 10) ;
-    ResponseAppend_P (PSTR (",\"PROD\":%s"), str_value);
-  }
+  // energy counters
+  TeleinfoMqttSensorAppend (pdata, size, used, TIC_DELTA_CONSO, teleinfo_conso_wh.total);
+  for (index = 0; index < teleinfo_contract_db.period_qty; index ++) TeleinfoMqttSensorAppend (pdata, size, used, TIC_SENSOR_INDEX + index, teleinfo_conso_wh.index[index]);
+  if (teleinfo_prod.enabled) TeleinfoMqttSensorAppend (pdata, size, used, TIC_DELTA_PROD, teleinfo_prod_wh.total);
 
-  ResponseJsonEnd ();
+  return used;
 }
 
-// Generate JSON with RELAY (virtual relay mapping)
-//   V1..V8 : virtual relay = status
-//   C1..C8 : period relay  = status,level,label
-//   P1     : prod. relay status
-//   W1     : prod. relay trigger
-void TeleinfoDriverAppendRelaySensor ()
+// generate SENSOR JSON in response from a binary record
+void TeleinfoMqttSensorDecode (const uint8_t *pdata, const uint16_t size, const uint32_t time)
 {
-  bool    status, first;
-  uint8_t index, level, hchp;
-  char    str_name[32];
-
-  // loop to publish virtual relays
-  first = true;
-  MiscOptionPrepareJsonSection ();
-  ResponseAppend_P (PSTR ("\"RELAY\":{"));
-
-  // production relay
-  if (teleinfo_prod.enabled)
+  bool      first, prod;
+  uint8_t   field, length, section, index;
+  uint16_t  position;
+  int32_t   value32;
+  long long value;
+  char      str_key[16];
+  char      str_value[32];
+  TIME_T    time_dst;
+
+  // message start, with publication time
+  if (time > 0)
   {
-    ResponseAppend_P (PSTR ("\"P1\":%u,\"W1\":%d"), teleinfo_prod.relay, teleinfo_config.prod_trigger);
-    first = false;
+    BreakTime (time + LocalTime () - Rtc.utc_time, time_dst);
+    Response_P (PSTR ("{\"" D_JSON_TIME "\":\"%04u-%02u-%02uT%02u:%02u:%02u\""), time_dst.year + 1970, time_dst.month, time_dst.day_of_month, time_dst.hour, time_dst.minute, time_dst.second);
   }
+  else Response_P (PSTR ("{"));
 
-  // virtual relays
-  if (teleinfo_conso.enabled)
-    for (index = 0; index < 8; index ++)
+  // loop thru sections
+  prod = false;
+  for (section = 0; section < TIC_SENSOR_SECTION_MAX; section ++)
+  {
+    first = true;
+    for (position = 0; position < size; position += 1 + length)
     {
-      if (!first) ResponseAppend_P (PSTR (","));
-      ResponseAppend_P (PSTR ("\"V%u\":%u"), index + 1, TeleinfoRelayStatus (index));
-      first = false;
-    }
+      // read field
+      field  = pdata[position];
+      length = TeleinfoMqttSensorLength (field);
+      if ((field >= TIC_SENSOR_MAX) || (position + 1 + length > size)) break;
+      if (TeleinfoMqttSensorSection (field) != section) continue;
+      if (length == sizeof (int32_t)) { memcpy (&value32, pdata + position + 1, length); value = value32; }
+        else memcpy (&value, pdata + position + 1, length);
+
+      // section start
+      if (first)
+      {
+        MiscOptionPrepareJsonSection ();
+        GetTextIndexed (str_key, sizeof (str_key), section, kTeleinfoSensorSection);
+        ResponseAppend_P (PSTR ("\"%s\":{"), str_key);
+      }
+      else if (field != TIC_DELTA_RELAY) ResponseAppend_P (PSTR (","));
 
-  // contract period relays
-  if (teleinfo_conso.enabled)
-    for (index = 0; index < teleinfo_contract_db.period_qty; index ++) 
-    {
-      // period status
-      status = (index == teleinfo_contract.period);
-      level  = TeleinfoContractGetPeriodLevel (index);
-      hchp   = TeleinfoContractGetPeriodHP (index);
-      TeleinfoContractGetPeriodLabel (str_name, sizeof (str_name), index);
-      if (!first) ResponseAppend_P (PSTR (","));
-      ResponseAppend_P (PSTR ("\"C%u\":\"%u,%u,%u,%s\""), index + 1, status, level, hchp, str_name);
+      // relays status
+      if (field == TIC_DELTA_RELAY)
+      {
+        for (index = 0; index < 8; index ++) ResponseAppend_P (PSTR ("%s\"V%u\":%u"), (index > 0) ? "," : "", index + 1, (uint8_t)((value >> index) & 1));
+        if (prod) ResponseAppend_P (PSTR (",\"P1\":%u"), (uint8_t)((value >> 8) & 1));
+      }
+
+      // contract period
+      else if (field == TIC_DELTA_PERIOD)
+      {
+        index = (uint8_t)value;
+        TeleinfoContractGetPeriodLabel (str_value, sizeof (str_value), index);
+        ResponseAppend_P (PSTR ("\"period\":\"%s\""), str_value);
+        GetTextIndexed (str_value, sizeof (str_value), TeleinfoContractGetPeriodLevel (index), kTeleinfoLevelLabel);
+        ResponseAppend_P (PSTR (",\"color\":\"%s\""), str_value);
+        GetTextIndexed (str_value, sizeof (str_value), TeleinfoContractGetPeriodHP (index), kTeleinfoHourLabel);
+        ResponseAppend_P (PSTR (",\"hour\":\"%s\""), str_value);
+      }
+
+      // period and energy counters
+      else if (TeleinfoMqttSensorLength (field) == sizeof (long long))
+      {
+        if (field >= TIC_SENSOR_INDEX) TeleinfoContractGetPeriodCode (str_key, sizeof (str_key), field - TIC_SENSOR_INDEX);
+          else GetTextIndexed (str_key, sizeof (str_key), field, kTeleinfoDeltaKey);
+        prod |= (field == TIC_DELTA_PROD);
+        lltoa (value, str_value, 10);
+        ResponseAppend_P (PSTR ("\"%s\":%s"), str_key, str_value);
+      }
+
+      // meter data
+      else if (field >= TIC_SENSOR_PH)
+      {
+        GetTextIndexed (str_key, sizeof (str_key), field - TIC_SENSOR_PH, kTeleinfoSensorKey);
+        ResponseAppend_P (PSTR ("\"%s\":%d"), str_key, value32);
+      }
+
+      // published fields
+      else
+      {
+        GetTextIndexed (str_key, sizeof (str_key), field, kTeleinfoDeltaKey);
+        if (arrTeleinfoDeltaRule[field].format == TIC_DELTA_FMT_MILLI) ResponseAppend_P (PSTR ("\"%s\":%d.%02d"), str_key, value32 / 1000, value32 % 1000 / 10);
+          else ResponseAppend_P (PSTR ("\"%s\":%d"), str_key, value32);
+      }
       first = false;
     }
+    if (!first) ResponseJsonEnd ();
+  }
 
+  // message end
   ResponseJsonEnd ();
 }
 
-// Generate JSON with CALENDAR
-void TeleinfoDriverAppendCalendarSensor ()
+// append current response to records batch (SENSOR as binary record), batch is written to ring file when full
+void TeleinfoMqttQueuePush (const uint8_t topic, const bool retain)
 {
-  // if on battery, ignore publication
-  if (TeleinfoDriverIsOnBattery ()) return;
-
-  // publish CAL current data
-  MiscOptionPrepareJsonSection ();
-  ResponseAppend_P (PSTR ("\"CAL\":{\"level\":%u,\"hp\":%u}"), TeleinfoContractGetPeriodLevel (), TeleinfoContractGetPeriodHP ());
-}
-
-/**************************/
-/*         Alerts         */
-/**************************/
+  uint16_t size;
+  uint8_t  arr_sensor[TIC_MQTT_SENSOR_SIZE];
+  const uint8_t *pdata;
+  tic_mqtt_record record;
+
+  // SENSOR is encoded from published values, other topics are kept as JSON text
+  record.flag = retain ? TIC_MQTT_FLAG_RETAIN : 0;
+  size = 0;
+  if (topic == TIC_MQTT_SENSOR) size = TeleinfoMqttSensorEncode (arr_sensor, sizeof (arr_sensor));
+  if (size > 0)
+  {
+    record.flag |= TIC_MQTT_FLAG_SENSOR;
+    pdata = arr_sensor;
+  }
+  else
+  {
+    if (ResponseLength () > TIC_MQTT_QUEUE_PAYLOAD) { teleinfo_mqtt.nb_dropped++; return; }
+    size  = (uint16_t)ResponseLength ();
+    pdata = (const uint8_t*)ResponseData ();
+  }
 
-bool TeleinfoDriverAlertGetStatus (const uint8_t type)
-{
-  bool active;
+  // record header
+  record.time  = Rtc.utc_time;
+  record.topic = topic;
+  record.size  = size;
 
-  // check paremeters
-  if (type >= TIC_ALERT_MAX) return false;
-  if (teleinfo_meter.arr_alert[type].timeout == UINT32_MAX) return false;
+  // if record doesn't fit in batch, write batch to ring file (if not possible, drop oldest records of batch)
+  while ((teleinfo_mqtt_batch.count > 0) && (teleinfo_mqtt_batch.used + sizeof (record) + size > TIC_MQTT_BATCH_SIZE))
+    if (!TeleinfoMqttBatchWrite ())
+    {
+      TeleinfoMqttBatchRemoveFirst ();
+      teleinfo_mqtt.nb_dropped++;
+    }
 
-  // check for reset
-  active = (LocalTime () <= teleinfo_meter.arr_alert[type].timeout);
-  if (!active)
+  // if record is bigger than batch, write it directly to ring file
+  if (sizeof (record) + size > TIC_MQTT_BATCH_SIZE)
   {
-    // reset alert
-    teleinfo_meter.arr_alert[type].timeout = UINT32_MAX;
-    strcpy_P (teleinfo_meter.arr_alert[type].str_source, PSTR (""));
+#ifdef USE_UFILESYS
+    File file;
 
-    // trigger publication
-    teleinfo_meter.json.data = true;
-  } 
+    if (!TeleinfoMqttQueueOpen (file)) { teleinfo_mqtt.nb_dropped++; return; }
+    TeleinfoMqttQueueAppend (file, record, pdata);
+    TeleinfoMqttQueueUpdateHeader (file);
+    file.close ();
+    teleinfo_mqtt.nb_queued++;
+#else
+    teleinfo_mqtt.nb_dropped++;
+#endif    // USE_UFILESYS
+    return;
+  }
 
-  return active;
+  // append record to batch
+  memcpy (teleinfo_mqtt_batch.arr_data + teleinfo_mqtt_batch.used, &record, sizeof (record));
+  memcpy (teleinfo_mqtt_batch.arr_data + teleinfo_mqtt_batch.used + sizeof (record), pdata, size);
+  teleinfo_mqtt_batch.used += sizeof (record) + size;
+  teleinfo_mqtt_batch.count++;
+  teleinfo_mqtt_batch.check = TeleinfoMqttBatchCheck ();
+  if (teleinfo_mqtt.time_oldest == 0) teleinfo_mqtt.time_oldest = record.time;
+
+  teleinfo_mqtt.nb_queued++;
 }
 
-void TeleinfoDriverAlertGetSource (const uint8_t type, char *pstr_source)
+// replay oldest waiting message, ring file first, then batch and coalesced values
+bool TeleinfoMqttQueueReplay ()
 {
-  // check paremeters
-  if (type >= TIC_ALERT_MAX) return;
-  if (pstr_source == nullptr) return;
+  uint8_t  topic;
+  char    *pstr_payload = nullptr;
+  char     str_topic[8];
+  tic_mqtt_record record;
 
-  // get source
-  strlcpy (pstr_source, teleinfo_meter.arr_alert[type].str_source, TIC_ALERT_SRC_SIZE);
-}
+#ifdef USE_UFILESYS
+  char str_filename[24];
+  File file;
 
-void TeleinfoDriverAlertTrigger (const uint8_t type, const char* pstr_source)
-{
-  // check parameters
-  if (!RtcTime.valid) return;
-  if (!TeleinfoDriverMeterReady ()) return;
-  if (type >= TIC_ALERT_MAX) return;
-  if (pstr_source == nullptr) return;
-  if (strlen_P (pstr_source) >= 6) return;
+  // if records are stored, read oldest one
+  if (teleinfo_mqtt.stored)
+  {
+    strcpy_P (str_filename, PSTR_MQTT_QUEUE_FILE);
+    file = ffsp->open (str_filename, "r");
+    if (!file) { TeleinfoMqttQueueClear (); return false; }
 
-  // if needed, trigger publication
-  if (teleinfo_meter.arr_alert[type].timeout == UINT32_MAX) teleinfo_meter.json.data = true;
+    // read record (header may be up to TIC_MQTT_QUEUE_FLUSH sec. old after a power loss)
+    TeleinfoMqttQueueRead (file, teleinfo_mqtt.header.tail, (uint8_t*)&record, sizeof (record));
+    if ((record.topic >= TIC_MQTT_MAX) || (record.flag > (TIC_MQTT_FLAG_RETAIN | TIC_MQTT_FLAG_SENSOR)) || (record.size > TIC_MQTT_QUEUE_PAYLOAD) || (sizeof (record) + record.size > teleinfo_mqtt.header.used))
+    {
+      AddLog (LOG_LEVEL_INFO, PSTR ("TIC: File MQTT corrompue, %u messages perdus"), teleinfo_mqtt.header.count);
+      teleinfo_mqtt.nb_dropped += teleinfo_mqtt.header.count;
+      file.close ();
+      TeleinfoMqttQueuePurge ();
+      return false;
+    }
+    pstr_payload = (char*)malloc (record.size + 1);
+    if (pstr_payload == nullptr) { file.close (); return false; }
+    TeleinfoMqttQueueRead (file, teleinfo_mqtt.header.tail + sizeof (record), (uint8_t*)pstr_payload, record.size);
+
+    // release record
+    teleinfo_mqtt.header.tail  = (teleinfo_mqtt.header.tail + sizeof (record) + record.size) % TIC_MQTT_QUEUE_SIZE;
+    teleinfo_mqtt.header.used -= sizeof (record) + record.size;
+    teleinfo_mqtt.header.count--;
+    TeleinfoMqttQueueUpdateHeader (file);
+    file.close ();
 
-  // update alert
-  teleinfo_meter.arr_alert[type].timeout = LocalTime () + TELEINFO_ALERT_TIMEOUT;
-  strcpy_P (teleinfo_meter.arr_alert[type].str_source, pstr_source);
-}
+    // if ring is empty, remove file
+    if (teleinfo_mqtt.header.count == 0)
+    {
+      ffsp->remove (str_filename);
+      TeleinfoMqttQueueClear ();
+    }
+  }
+#endif    // USE_UFILESYS
 
-/*********************************************\
- *                Calendar
-\*********************************************/
+  // else take oldest record of batch
+  if ((pstr_payload == nullptr) && (teleinfo_mqtt_batch.count > 0))
+  {
+    memcpy (&record, teleinfo_mqtt_batch.arr_data, sizeof (record));
+    pstr_payload = (char*)malloc (record.size + 1);
+    if (pstr_payload == nullptr) return false;
+    memcpy (pstr_payload, teleinfo_mqtt_batch.arr_data + sizeof (record), record.size);
+    TeleinfoMqttBatchRemoveFirst ();
+    if (!teleinfo_mqtt.stored) teleinfo_mqtt.time_oldest = TeleinfoMqttBatchOldest ();
+  }
 
-// calculate current slot
-uint8_t TeleinfoCalendarGetSlot (const uint8_t hour, const uint8_t minute)
-{
-  uint8_t slot;
+  // else take first coalesced value
+  if (pstr_payload == nullptr)
+    for (topic = 0; topic < TIC_MQTT_MAX; topic ++)
+      if (teleinfo_mqtt.arr_last[topic] != nullptr)
+      {
+        pstr_payload = teleinfo_mqtt.arr_last[topic];
+        teleinfo_mqtt.arr_last[topic] = nullptr;
+        record.time  = 0;
+        record.topic = topic;
+        record.flag  = 0;
+        record.size  = (uint16_t)strlen (pstr_payload);
+        break;
+      }
 
-  // check parameter
-  if (hour > 23) return UINT8_MAX;
-  if (minute > 59) return UINT8_MAX;
+  // if nothing to replay, done
+  if (pstr_payload == nullptr) return false;
 
-  // calculate slot
-  slot = hour * 2 + (minute / 30);
- 
-  return slot;
+  // generate payload, binary SENSOR record or JSON text
+  if (record.flag & TIC_MQTT_FLAG_SENSOR) TeleinfoMqttSensorDecode ((uint8_t*)pstr_payload, record.size, record.time);
+  else
+  {
+    pstr_payload[record.size] = 0;
+    Response_P (PSTR ("%s"), pstr_payload);
+  }
+  free (pstr_payload);
+
+  // publish without rules processing (data is not current)
+  GetTextIndexed (str_topic, sizeof (str_topic), record.topic, kTeleinfoMqttTopic);
+  MqttPublishPrefixTopic_P (TELE, str_topic, (record.flag & TIC_MQTT_FLAG_RETAIN) != 0);
+  teleinfo_mqtt.nb_replayed++;
+
+  return true;
 }
 
-// calculate current slot
-uint8_t TeleinfoCalendarGetSlot (const char* pstr_time, const bool is_hexa)
+// publish current response on a teleinfo topic, or queue it if broker is not reachable
+void TeleinfoMqttPublish (const uint8_t topic, const bool retain)
 {
-  uint8_t slot, hour, minute;
-  char    str_value[4];
+  char str_topic[8];
 
-  // check parameter
-  if (pstr_time == nullptr) return UINT8_MAX;
-  if (strlen (pstr_time) < 4) return UINT8_MAX;
+  // check parameter and MQTT usage
+  if (topic >= TIC_MQTT_MAX) return;
+  if (!Settings->flag.mqtt_enabled) return;
 
-  // calculate hours
-  strlcpy (str_value, pstr_time, 3);
-  if (is_hexa) hour = (uint8_t)strtol (str_value, NULL, 16);
-    else hour = (uint8_t)atoi (str_value);
+  // declare message size to scheduler
+  TeleinfoSchedulerMeasure ();
 
-  // calculate minutes
-  strlcpy (str_value, pstr_time + 2, 3);
-  if (is_hexa) minute = (uint8_t)strtol (str_value, NULL, 16);
-    else minute = (uint8_t)atoi (str_value);
+  // if broker is reachable and nothing is waiting, publish
+  if (MqttIsConnected () && !TeleinfoMqttQueuePending ())
+  {
+    GetTextIndexed (str_topic, sizeof (str_topic), topic, kTeleinfoMqttTopic);
+    MqttPublishPrefixTopic_P (TELE, str_topic, retain);
+#ifdef USE_TELEINFO_WINKY
+    TeleinfoWinkyDeclarePublish ();
+#endif    // USE_TELEINFO_WINKY
+  }
 
-  // calculate slot
-  slot = TeleinfoCalendarGetSlot (hour, minute);
+  // else if only last value matters, replace previous value
+  else if (arrTeleinfoMqttCoalesce[topic])
+  {
+    if (teleinfo_mqtt.arr_last[topic] != nullptr)
+    {
+      free (teleinfo_mqtt.arr_last[topic]);
+      teleinfo_mqtt.nb_coalesced++;
+    }
+    teleinfo_mqtt.arr_last[topic] = strdup (ResponseData ());
+    if (teleinfo_mqtt.arr_last[topic] == nullptr) teleinfo_mqtt.nb_dropped++;
+  }
 
-  return slot;
+  // else append to ring file
+  else TeleinfoMqttQueuePush (topic, retain);
 }
 
-// calculate current date (format : YYYYMMDDSS)
-uint32_t TeleinfoCalendarGetDay (const char* pstr_date, const bool add_slot)
+// replay waiting messages once broker is back
+void TeleinfoMqttQueueEvery250ms ()
 {
-  uint32_t date = 0;
-  char     str_text[8];
+  uint8_t index;
 
-  // check parameter
-  if (pstr_date == nullptr) return 0;
+  // write records batch to ring file every TIC_MQTT_BATCH_FLUSH sec.
+  if (TimePassedSince (teleinfo_mqtt.time_batch) >= TIC_MQTT_BATCH_FLUSH * 1000) TeleinfoMqttBatchWrite ();
 
-  // calculate date stamp
-  if (strlen (pstr_date) >= 6)
+#ifdef USE_UFILESYS
+  // write ring header if changed
+  TeleinfoMqttQueueFlush (false);
+#endif    // USE_UFILESYS
+
+  // track broker connexion
+  if (!MqttIsConnected ()) { teleinfo_mqtt.time_connect = 0; return; }
+  if (teleinfo_mqtt.time_connect == 0) teleinfo_mqtt.time_connect = millis ();
+
+  // check if replay can start
+  if (!TeleinfoMqttQueuePending ()) return;
+  if (millis () - teleinfo_mqtt.time_connect < TIC_MQTT_QUEUE_SETTLE) return;
+
+  // start replay
+  if (!teleinfo_mqtt.replay)
   {
-    strlcpy (str_text, pstr_date, 7);
-    date = 100 * (20000000 + (uint32_t)atoi (str_text));
+    teleinfo_mqtt.replay      = true;
+    teleinfo_mqtt.time_replay = millis ();
+    teleinfo_mqtt.last_count  = 0;
+    AddLog (LOG_LEVEL_INFO, PSTR ("TIC: Rejeu de %u messages MQTT en attente"), teleinfo_mqtt.header.count + teleinfo_mqtt_batch.count);
   }
 
-  // if needed, include day slot
-  if (add_slot && (date != 0) && (strlen (pstr_date) >= 10))
-  {
-    // handle hours
-    strlcpy (str_text, pstr_date + 6, 3);
-    date += 2 * (uint8_t)atoi (str_text);
+  // replay some messages
+  for (index = 0; index < TIC_MQTT_QUEUE_RATE; index ++)
+    if (TeleinfoMqttQueueReplay ()) teleinfo_mqtt.last_count++;
+      else break;
 
-    // handle minutes
-    strlcpy (str_text, pstr_date + 8, 3);
-    date += (uint8_t)atoi (str_text) / 30;
+  // end of replay
+  if (!TeleinfoMqttQueuePending ())
+  {
+    teleinfo_mqtt.replay  = false;
+    teleinfo_mqtt.last_ms = millis () - teleinfo_mqtt.time_replay;
+    AddLog (LOG_LEVEL_INFO, PSTR ("TIC: %u messages MQTT rejoués en %u ms"), teleinfo_mqtt.last_count, teleinfo_mqtt.last_ms);
   }
-
-  return date;
 }
 
-// calculate current date (format : YYYYMMDDSS)
-uint32_t TeleinfoCalendarGetDay (const uint16_t year, const uint8_t month, const uint8_t day_of_month, const uint8_t hour, const uint8_t minute)
+// publish queue status as JSON
+void TeleinfoMqttQueuePublish ()
 {
-  uint32_t date;
+  uint8_t  index;
+  uint32_t age, rate, waiting;
+
+  // calculate oldest record age and last replay rate (x100)
+  if ((teleinfo_mqtt.time_oldest > 0) && (Rtc.utc_time > teleinfo_mqtt.time_oldest)) age = Rtc.utc_time - teleinfo_mqtt.time_oldest;
+    else age = 0;
+  if (teleinfo_mqtt.last_ms > 0) rate = (uint32_t)((uint64_t)teleinfo_mqtt.last_count * 100000 / teleinfo_mqtt.last_ms);
+    else rate = 0;
+  waiting = 0;
+  for (index = 0; index < TIC_MQTT_MAX; index ++) if (teleinfo_mqtt.arr_last[index] != nullptr) waiting++;
+
+  Response_P (PSTR ("{\"Queue\":{\"depth\":%u,\"last\":%u,\"bytes\":%u,\"size\":%u,\"oldest\":%u"), teleinfo_mqtt.header.count + teleinfo_mqtt_batch.count, waiting, teleinfo_mqtt.header.used, TIC_MQTT_QUEUE_SIZE, age);
+  ResponseAppend_P (PSTR (",\"batch\":{\"count\":%u,\"bytes\":%u,\"size\":%u}"), teleinfo_mqtt_batch.count, teleinfo_mqtt_batch.used, TIC_MQTT_BATCH_SIZE);
+  ResponseAppend_P (PSTR (",\"queued\":%u,\"coalesced\":%u,\"dropped\":%u,\"replayed\":%u"), teleinfo_mqtt.nb_queued, teleinfo_mqtt.nb_coalesced, teleinfo_mqtt.nb_dropped, teleinfo_mqtt.nb_replayed);
+  ResponseAppend_P (PSTR (",\"replay\":{\"active\":%u,\"count\":%u,\"ms\":%u,\"rate\":%u.%02u}}}"), (uint8_t)teleinfo_mqtt.replay, teleinfo_mqtt.last_count, teleinfo_mqtt.last_ms, rate / 100, rate % 100);
+}
 
-  // calculate today's date
-  date  = 1000000 * (2000 + (uint32_t)year);
-  date += 10000 * (uint32_t)month;
-  date += 100 * (uint32_t)day_of_month;
+/*************************************************\
+ *          MQTT publication scheduler
+\*************************************************/
 
-  // append daily slot
-  date += hour * 2;
-  date += minute / 30;
+// register a publication producer
+void TeleinfoSchedulerRegister (const uint8_t producer, TeleinfoPubPending pending, TeleinfoPubPublish publish)
+{
+  if (producer >= TIC_PRODUCER_MAX) return;
 
-  return date;
+  teleinfo_scheduler.arr_producer[producer].pending = pending;
+  teleinfo_scheduler.arr_producer[producer].publish = publish;
 }
 
-// set current date (format : YYYYMMDD00)
-uint32_t TeleinfoCalendarGetNextDay (const uint32_t date)
+// declare size of message about to be published (to be called before rules processing, as rules may change response)
+void TeleinfoSchedulerMeasure ()
 {
-  uint32_t date_next;
-  TIME_T   date_dst;
+  teleinfo_scheduler.size = ResponseLength ();
+}
 
-  // check parameter
-  if (date == 0) return 0;
+// reset publication statistics
+void TeleinfoSchedulerResetStats ()
+{
+  uint8_t index;
 
-  // set given date
-  date_dst.year         = (uint16_t)(date / 1000000 - 1970);
-  date_dst.month        = (uint8_t)(date / 10000 % 100);
-  date_dst.day_of_month = (uint8_t)(date / 100 % 100);
-  date_dst.hour         = 0;
-  date_dst.minute       = 0;
-  date_dst.second       = 0;
+  teleinfo_scheduler.nb_deferred = 0;
+  for (index = 0; index < TIC_PRODUCER_MAX; index ++)
+  {
+    teleinfo_scheduler.arr_producer[index].nb_message    = 0;
+    teleinfo_scheduler.arr_producer[index].nb_byte       = 0;
+    teleinfo_scheduler.arr_producer[index].latency_last  = 0;
+    teleinfo_scheduler.arr_producer[index].latency_peak  = 0;
+    teleinfo_scheduler.arr_producer[index].latency_total = 0;
+  }
+}
 
-  // calculate next day
-  date_next = MakeTime (date_dst) + 86400;
-  BreakTime (date_next, date_dst);
+// get priority of next message of a producer (TIC_PRIO_MAX if nothing to publish)
+uint8_t TeleinfoSchedulerPending (const uint8_t producer)
+{
+  uint8_t       priority;
+  tic_producer *pproducer;
 
-  // generate new date timestamp
-  date_next  = 1000000 * ((uint32_t)date_dst.year + 1970);
-  date_next += 10000 * (uint32_t)date_dst.month;
-  date_next += 100 * (uint32_t)date_dst.day_of_month;
+  // ask producer
+  pproducer = &teleinfo_scheduler.arr_producer[producer];
+  if (pproducer->pending == nullptr) priority = TIC_PRIO_MAX;
+    else priority = pproducer->pending (pproducer->backlog);
 
-  return date_next;
+  // update waiting start
+  if (priority >= TIC_PRIO_MAX)
+  {
+    pproducer->backlog      = 0;
+    pproducer->time_pending = 0;
+  }
+  else if (pproducer->time_pending == 0) pproducer->time_pending = millis ();
+
+  return priority;
 }
 
-// remise a zero des donnees de calendrier
-void TeleinfoCalendarReset (const uint8_t day)
+// publish next messages according to priority classes, round-robin and token buckets
+void TeleinfoSchedulerEvery250ms ()
 {
-  uint8_t index;
+  bool     available;
+  uint8_t  index, best;
+  uint8_t  producer, position;
+  uint8_t  arr_priority[TIC_PRODUCER_MAX];
+  uint32_t time_now, elapsed, size;
+  tic_producer *pproducer;
+
+  // refill token buckets according to elapsed time
+  time_now = millis ();
+  if (teleinfo_scheduler.time_refill == 0) teleinfo_scheduler.time_refill = time_now;
+  elapsed = min ((uint32_t)(time_now - teleinfo_scheduler.time_refill), (uint32_t)1000);
+  teleinfo_scheduler.time_refill = time_now;
+  teleinfo_scheduler.token_msg  = min (teleinfo_scheduler.token_msg  + (int32_t)(elapsed * TIC_PUB_RATE_MSG), (int32_t)TIC_PUB_BURST_MSG * 1000);
+  teleinfo_scheduler.token_byte = min (teleinfo_scheduler.token_byte + (int32_t)(elapsed * TIC_PUB_RATE_BYTE / 1000), (int32_t)TIC_PUB_BURST_BYTE);
+
+  // refill own budget of paced producers (burst of 1 message)
+  for (index = 0; index < TIC_PRODUCER_MAX; index ++)
+    if (arrTeleinfoPubRate[index] > 0) teleinfo_scheduler.arr_producer[index].token = min (teleinfo_scheduler.arr_producer[index].token + (int32_t)(elapsed * arrTeleinfoPubRate[index]), (int32_t)1000);
+
+  // collect priority of next message of every producer
+  for (index = 0; index < TIC_PRODUCER_MAX; index ++) arr_priority[index] = TeleinfoSchedulerPending (index);
+
+  // publish while tokens are available
+  do
+  {
+    // select next producer of highest priority class having tokens (round-robin)
+    best     = TIC_PRIO_MAX;
+    producer = TIC_PRODUCER_MAX;
+    for (index = 0; index < TIC_PRODUCER_MAX; index ++)
+    {
+      position = (teleinfo_scheduler.next + index) % TIC_PRODUCER_MAX;
+      if (arrTeleinfoPubRate[position] > 0) available = (teleinfo_scheduler.arr_producer[position].token >= 1000);
+        else available = ((teleinfo_scheduler.token_msg >= 1000) && (teleinfo_scheduler.token_byte > 0));
+      if (available && (arr_priority[position] < best))
+      {
+        producer = position;
+        best     = arr_priority[position];
+      }
+    }
+    if (producer == TIC_PRODUCER_MAX) break;
+    pproducer = &teleinfo_scheduler.arr_producer[producer];
+    teleinfo_scheduler.next = (producer + 1) % TIC_PRODUCER_MAX;
+
+    // publish message (size declared by producer before rules processing, else current response)
+    ResponseClear ();
+    teleinfo_scheduler.size = UINT32_MAX;
+    if (pproducer->publish ())
+    {
+      time_now = millis ();
+      if (teleinfo_scheduler.size == UINT32_MAX) size = ResponseLength ();
+        else size = teleinfo_scheduler.size;
 
-  // check parameter
-  if (day >= TIC_DAY_MAX) return;
+      // consume tokens from own budget or shared bucket
+      if (arrTeleinfoPubRate[producer] > 0) pproducer->token -= 1000;
+      else
+      {
+        teleinfo_scheduler.token_msg  -= 1000;
+        teleinfo_scheduler.token_byte -= (int32_t)size;
+      }
 
-  // reset all data
-  teleinfo_calendar[day].level = 0;
-  for (index = 0; index < TIC_DAY_SLOT_MAX; index ++) teleinfo_calendar[day].arr_slot[index] = 0; 
-  teleinfo_calendar[day].date = 0;
+      // update producer statistics
+      pproducer->nb_message++;
+      pproducer->nb_byte      += size;
+      pproducer->latency_last  = time_now - pproducer->time_pending;
+      pproducer->latency_peak  = max (pproducer->latency_peak, pproducer->latency_last);
+      pproducer->latency_total += pproducer->latency_last;
+      pproducer->time_pending  = time_now;
 
-  // reset settings
-  SettingsUpdateText (SET_TIC_CAL_TODAY + day, "");
+      // get next message priority
+      arr_priority[producer] = TeleinfoSchedulerPending (producer);
+    }
+
+    // else producer is skipped till next tick
+    else arr_priority[producer] = TIC_PRIO_MAX;
+  }
+  while (true);
+
+  // count ticks where messages are waiting for tokens
+  best = TIC_PRIO_MAX;
+  for (index = 0; index < TIC_PRODUCER_MAX; index ++) best = min (best, arr_priority[index]);
+  if (best < TIC_PRIO_MAX) teleinfo_scheduler.nb_deferred++;
+}
+
+// append publication statistics per producer to JSON
+void TeleinfoSchedulerAppendJSON ()
+{
+  uint8_t  index;
+  uint32_t average;
+  char     str_name[12];
+  tic_producer *pproducer;
+
+  ResponseAppend_P (PSTR (",\"Pub\":{\"rate\":%u,\"tokens\":%d,\"deferred\":%u"), TIC_PUB_RATE_MSG, teleinfo_scheduler.token_msg / 1000, teleinfo_scheduler.nb_deferred);
+  for (index = 0; index < TIC_PRODUCER_MAX; index ++)
+  {
+    pproducer = &teleinfo_scheduler.arr_producer[index];
+    if (pproducer->publish == nullptr) continue;
+
+    if (pproducer->nb_message > 0) average = pproducer->latency_total / pproducer->nb_message;
+      else average = 0;
+    GetTextIndexed (str_name, sizeof (str_name), index, kTeleinfoPubProducer);
+    ResponseAppend_P (PSTR (",\"%s\":{\"msg\":%u,\"bytes\":%u,\"backlog\":%u,\"last\":%u,\"avg\":%u,\"peak\":%u}"), str_name, pproducer->nb_message, pproducer->nb_byte, pproducer->backlog, pproducer->latency_last, average, pproducer->latency_peak);
+  }
+  ResponseAppend_P (PSTR ("}"));
+}
+
+// driver producer : priority of next message (LIVE and TIC as live data, SENSOR with totals)
+uint8_t TeleinfoDriverPubPending (uint16_t &backlog)
+{
+  if (!TeleinfoDriverMeterReady ()) return TIC_PRIO_MAX;
+
+  backlog = (uint16_t)teleinfo_meter.json.live + (uint16_t)teleinfo_meter.json.tic + (uint16_t)teleinfo_meter.json.data + (uint16_t)teleinfo_meter.json.delta;
+  if (teleinfo_meter.json.live || teleinfo_meter.json.tic || teleinfo_meter.json.delta) return TIC_PRIO_LIVE;
+  else if (teleinfo_meter.json.data) return TIC_PRIO_TOTAL;
+  else return TIC_PRIO_MAX;
+}
+
+// driver producer : publish next message (same order as priorities, DELTA before SENSOR)
+bool TeleinfoDriverPubPublish ()
+{
+  if (teleinfo_meter.json.live) TeleinfoDriverPublishLive ();
+  else if (teleinfo_meter.json.tic) TeleinfoDriverPublishTic ();
+  else if (teleinfo_meter.json.delta) TeleinfoDeltaPublish ();
+  else if (teleinfo_meter.json.data) 
+  {
+    TeleinfoDriverTriggerExtension ();
+    TeleinfoDriverJsonPublish ();
+  }
+  else return false;
+
+  return true;
+}
+
+/*************************************************\
+ *               JSON publication
+\*************************************************/
+
+// Trigger publication flags
+void TeleinfoDriverJsonPublish ()
+{
+  // message start
+  ResponseClear ();
+  if (RtcTime.valid) ResponseAppendTime ();
+    else ResponseAppend_P (PSTR ("{"));
+
+  // populate message
+  TeleinfoDriverJsonAppend ();
+
+  // message end and publication
+  ResponseJsonEnd ();
+  TeleinfoMqttPublish (TIC_MQTT_SENSOR, Settings->flag.mqtt_sensor_retain);
+  XdrvRulesProcess (true);
+
+  // reset flag and declare publication
+  teleinfo_meter.json.data = false;
+  TeleinfoDriverWebDeclare (TIC_WEB_MQTT);
+}
+
+// Generate LIVE JSON
+void TeleinfoDriverPublishLive ()
+{
+  // start of message
+  ResponseClear ();
+  ResponseAppend_P (PSTR ("{"));
+
+  // METER data
+  TeleinfoDriverAppendMeterSensor ();
+
+#ifdef USE_TELEINFO_SOLAR
+  // SOLAR and FORECAST data
+  TeleinfoSolarAppendSensor ();
+#endif    // USE_TELEINFO_SOLAR
+
+  // end of message
+  ResponseJsonEnd ();
+
+  // message publication
+  TeleinfoMqttPublish (TIC_MQTT_LIVE, false);
+  XdrvRulesProcess (false);
+
+  // reset JSON flag and declare publication
+  teleinfo_meter.json.live = false;
+  TeleinfoDriverWebDeclare (TIC_WEB_MQTT);
+}
+
+// Generate TIC full JSON
+void TeleinfoDriverPublishTic ()
+{
+  bool    is_first = true;
+  uint8_t index, count;
+  char    str_etiquette[TIC_ETIQUETTE_SIZE];
+  char    str_donnee[TIC_DONNEE_SIZE];
+
+  // start of message
+  ResponseClear ();
+  ResponseAppend_P (PSTR ("{"));
+
+  // loop thru TIC message lines to add lines
+  count = TeleinfoEnergyMessageLineCount ();
+  for (index = 0; index < count; index ++)
+    if (TeleinfoEnergyMessageGetLine (index, str_etiquette, sizeof (str_etiquette), str_donnee, sizeof (str_donnee)) != 0)
+    {
+      if (!is_first) ResponseAppend_P (PSTR (",")); else is_first = false;
+      ResponseAppend_P (PSTR ("\"%s\":\"%s\""), str_etiquette, str_donnee);
+    }
+
+  // end of message
+  ResponseJsonEnd ();
+
+  // message publication
+  TeleinfoMqttPublish (TIC_MQTT_TIC, false);
+  XdrvRulesProcess (true);
+
+  // reset JSON flag and declare publication
+  teleinfo_meter.json.tic = false;
+  TeleinfoDriverWebDeclare (TIC_WEB_MQTT);
+}
+
+/*************************************************\
+ *       Report by exception (delta policy)
+\*************************************************/
+
+// get current value of a field, return false if field is not available
+bool TeleinfoDeltaGetValue (const uint8_t field, long &value)
+{
+  uint8_t phase, index;
+
+  // check section publication
+  value = 0;
+  if ((field == TIC_DELTA_RELAY) && !teleinfo_config.relay) return false;
+  if ((field != TIC_DELTA_RELAY) && !teleinfo_config.meter) return false;
+
+  switch (field)
+  {
+    // conso : phase data
+    case TIC_DELTA_U1: case TIC_DELTA_U2: case TIC_DELTA_U3:
+      phase = field - TIC_DELTA_U1;
+      if (!teleinfo_conso.enabled || (phase >= teleinfo_contract.phase)) return false;
+      value = teleinfo_conso.phase[phase].voltage;
+      break;
+    case TIC_DELTA_I1: case TIC_DELTA_I2: case TIC_DELTA_I3:
+      phase = field - TIC_DELTA_I1;
+      if (!teleinfo_conso.enabled || (phase >= teleinfo_contract.phase)) return false;
+      value = teleinfo_conso.phase[phase].current;
+      break;
+    case TIC_DELTA_P1: case TIC_DELTA_P2: case TIC_DELTA_P3:
+      phase = field - TIC_DELTA_P1;
+      if (!teleinfo_conso.enabled || (phase >= teleinfo_contract.phase)) return false;
+      value = teleinfo_conso.phase[phase].papp;
+      break;
+    case TIC_DELTA_W1: case TIC_DELTA_W2: case TIC_DELTA_W3:
+      phase = field - TIC_DELTA_W1;
+      if (!teleinfo_conso.enabled || (phase >= teleinfo_contract.phase)) return false;
+      value = teleinfo_conso.phase[phase].pact;
+      break;
+
+    // conso : global data
+    case TIC_DELTA_U: case TIC_DELTA_I: case TIC_DELTA_P: case TIC_DELTA_W:
+      if (!teleinfo_conso.enabled) return false;
+      for (phase = 0; phase < teleinfo_contract.phase; phase++)
+      {
+        if (field == TIC_DELTA_U) value += teleinfo_conso.phase[phase].voltage;
+        else if (field == TIC_DELTA_I) value += teleinfo_conso.phase[phase].current;
+        else if (field == TIC_DELTA_P) value += teleinfo_conso.phase[phase].papp;
+        else value += teleinfo_conso.phase[phase].pact;
+      }
+      if ((field == TIC_DELTA_U) && (teleinfo_contract.phase > 1)) value = value / (long)teleinfo_contract.phase;
+      break;
+    case TIC_DELTA_C:
+      if (!teleinfo_conso.enabled || (teleinfo_conso.cosphi.quantity < TIC_COSPHI_MIN)) return false;
+      value = teleinfo_conso.cosphi.value;
+      break;
+    case TIC_DELTA_YDAY:
+      if (!teleinfo_conso.enabled || TeleinfoDriverIsOnBattery ()) return false;
+      value = teleinfo_conso_wh.yesterday;
+      break;
+    case TIC_DELTA_TDAY:
+      if (!teleinfo_conso.enabled || TeleinfoDriverIsOnBattery ()) return false;
+      value = teleinfo_conso_wh.today;
+      break;
+
+    // prod data
+    case TIC_DELTA_PP:
+      if (!teleinfo_prod.enabled && !teleinfo_prod.cacsi) return false;
+      value = teleinfo_prod.papp;
+      break;
+    case TIC_DELTA_PW:
+      if (!teleinfo_prod.enabled) return false;
+      value = teleinfo_prod.pact;
+      break;
+    case TIC_DELTA_PC:
+      if (!teleinfo_prod.enabled || (teleinfo_prod.cosphi.quantity < TIC_COSPHI_MIN)) return false;
+      value = teleinfo_prod.cosphi.value;
+      break;
+    case TIC_DELTA_PAVG:
+      if (!teleinfo_prod.enabled) return false;
+      value = (long)teleinfo_prod.pact_avg;
+      break;
+    case TIC_DELTA_PYDAY:
+      if (!teleinfo_prod.enabled || TeleinfoDriverIsOnBattery ()) return false;
+      value = teleinfo_prod_wh.yesterday;
+      break;
+    case TIC_DELTA_PTDAY:
+      if (!teleinfo_prod.enabled || TeleinfoDriverIsOnBattery ()) return false;
+      value = teleinfo_prod_wh.today;
+      break;
+
+    // contract data
+    case TIC_DELTA_PERIOD:
+      value = teleinfo_contract.period;
+      break;
+    case TIC_DELTA_CONSO:
+      value = (long)teleinfo_conso_wh.total;
+      break;
+    case TIC_DELTA_PROD:
+      if (!teleinfo_prod.enabled) return false;
+      value = (long)teleinfo_prod_wh.total;
+      break;
+
+    // relays bitmask (V1..V8 and P1)
+    case TIC_DELTA_RELAY:
+      if (teleinfo_conso.enabled) for (index = 0; index < 8; index ++) if (TeleinfoRelayStatus (index)) value |= (1L << index);
+      if (teleinfo_prod.enabled && teleinfo_prod.relay) value |= (1L << 8);
+      break;
+
+    default:
+      return false;
+  }
+
+  return true;
+}
+
+// detect fields out of their deadband (called on every received message)
+void TeleinfoDeltaUpdate ()
+{
+  uint8_t  field;
+  uint32_t elapsed;
+  long     value, diff, band;
+
+  for (field = 0; field < TIC_DELTA_MAX; field ++)
+  {
+    // ignore fields already waiting or not available
+    if (teleinfo_delta.mask & (1UL << field)) continue;
+    if (!TeleinfoDeltaGetValue (field, value)) continue;
+
+    // check minimum interval
+    elapsed = TasmotaGlobal.uptime - teleinfo_delta.arr_field[field].time;
+    if (elapsed < arrTeleinfoDeltaRule[field].min) continue;
+
+    // calculate deadband (absolute or % of last published value)
+    band = arrTeleinfoDeltaRule[field].abs;
+    if (band == TIC_DELTA_POWER) band = (long)Settings->energy_power_delta[0];
+    band = max (band, abs (teleinfo_delta.arr_field[field].value) * (long)arrTeleinfoDeltaRule[field].rel / 100);
+
+    // flag field if out of deadband or if heartbeat is reached
+    diff = abs (value - teleinfo_delta.arr_field[field].value);
+    if ((diff > 0) && (diff >= band)) teleinfo_delta.mask |= (1UL << field);
+    else if ((arrTeleinfoDeltaRule[field].max > 0) && (elapsed >= arrTeleinfoDeltaRule[field].max)) teleinfo_delta.mask |= (1UL << field);
+  }
+}
+
+// update reference of published fields
+void TeleinfoDeltaCommit (const uint32_t mask)
+{
+  uint8_t field;
+  long    value;
+
+  for (field = 0; field < TIC_DELTA_MAX; field ++)
+    if (mask & (1UL << field))
+    {
+      if (TeleinfoDeltaGetValue (field, value)) teleinfo_delta.arr_field[field].value = value;
+      teleinfo_delta.arr_field[field].time = TasmotaGlobal.uptime;
+    }
+  teleinfo_delta.mask &= ~mask;
+}
+
+// append changed fields to JSON (sparse METER, CONTRACT and RELAY sections)
+void TeleinfoDeltaAppend ()
+{
+  bool    first;
+  uint8_t field, index;
+  long    value, changed;
+  char    str_key[8];
+  char    str_value[32];
+
+  // METER and CONTRACT sections
+  for (index = 0; index < 2; index ++)
+  {
+    first = true;
+    for (field = 0; field < TIC_DELTA_RELAY; field ++)
+    {
+      // check field section and status
+      if ((index == 0) && (field >= TIC_DELTA_PERIOD)) continue;
+      if ((index == 1) && (field < TIC_DELTA_PERIOD)) continue;
+      if (!(teleinfo_delta.mask & (1UL << field))) continue;
+      if (!TeleinfoDeltaGetValue (field, value)) continue;
+
+      // section start
+      if (first && (index == 0)) { MiscOptionPrepareJsonSection (); ResponseAppend_P (PSTR ("\"METER\":{")); }
+      else if (first) { MiscOptionPrepareJsonSection (); ResponseAppend_P (PSTR ("\"CONTRACT\":{")); }
+      else ResponseAppend_P (PSTR (","));
+      first = false;
+
+      // append value
+      GetTextIndexed (str_key, sizeof (str_key), field, kTeleinfoDeltaKey);
+      switch (arrTeleinfoDeltaRule[field].format)
+      {
+        case TIC_DELTA_FMT_MILLI:
+          ResponseAppend_P (PSTR ("\"%s\":%d.%02d"), str_key, value / 1000, value % 1000 / 10);
+          break;
+
+        case TIC_DELTA_FMT_PERIOD:
+          TeleinfoContractGetPeriodLabel (str_value, sizeof (str_value));
+          ResponseAppend_P (PSTR ("\"%s\":\"%s\""), str_key, str_value);
+          GetTextIndexed (str_value, sizeof (str_value), TeleinfoContractGetPeriodLevel (), kTeleinfoLevelLabel);
+          ResponseAppend_P (PSTR (",\"color\":\"%s\""), str_value);
+          GetTextIndexed (str_value, sizeof (str_value), TeleinfoContractGetPeriodHP (), kTeleinfoHourLabel);
+          ResponseAppend_P (PSTR (",\"hour\":\"%s\""), str_value);
+          break;
+
+        default:
+          ResponseAppend_P (PSTR ("\"%s\":%d"), str_key, value);
+          break;
+      }
+    }
+    if (!first) ResponseJsonEnd ();
+  }
+
+  // RELAY section : only relays whose status has changed
+  if (!(teleinfo_delta.mask & (1UL << TIC_DELTA_RELAY))) return;
+  if (!TeleinfoDeltaGetValue (TIC_DELTA_RELAY, value)) return;
+  changed = value ^ teleinfo_delta.arr_field[TIC_DELTA_RELAY].value;
+  first   = true;
+  for (index = 0; index < 9; index ++)
+  {
+    if (!(changed & (1L << index))) continue;
+    if (first) { MiscOptionPrepareJsonSection (); ResponseAppend_P (PSTR ("\"RELAY\":{")); }
+      else ResponseAppend_P (PSTR (","));
+    if (index < 8) ResponseAppend_P (PSTR ("\"V%u\":%u"), index + 1, (value >> index) & 1);
+      else ResponseAppend_P (PSTR ("\"P1\":%u"), (value >> index) & 1);
+    first = false;
+  }
+  if (!first) ResponseJsonEnd ();
+}
+
+// publish sparse DELTA message with changed fields only
+void TeleinfoDeltaPublish ()
+{
+  // message start
+  ResponseClear ();
+  if (RtcTime.valid) ResponseAppendTime ();
+    else ResponseAppend_P (PSTR ("{"));
+
+  // populate message
+  TeleinfoDeltaAppend ();
+
+  // message end and publication (never retained as message is partial)
+  ResponseJsonEnd ();
+  TeleinfoMqttPublish (TIC_MQTT_DELTA, false);
+  XdrvRulesProcess (true);
+
+  // update statistics and references of published fields
+  teleinfo_delta.nb_sparse ++;
+  teleinfo_delta.nb_field += __builtin_popcount (teleinfo_delta.mask);
+  TeleinfoDeltaCommit (teleinfo_delta.mask);
+
+  // reset flag and declare publication
+  teleinfo_meter.json.delta = false;
+  TeleinfoDriverWebDeclare (TIC_WEB_MQTT);
+}
+
+// append report-by-exception statistics to stats JSON
+void TeleinfoDeltaAppendJSON ()
+{
+  ResponseAppend_P (PSTR (",\"Delta\":{\"sparse\":%u,\"field\":%u,\"full\":%u}"), teleinfo_delta.nb_sparse, teleinfo_delta.nb_field, teleinfo_delta.nb_full);
+}
+
+// reset report-by-exception statistics
+void TeleinfoDeltaResetStats ()
+{
+  teleinfo_delta.nb_sparse = 0;
+  teleinfo_delta.nb_field  = 0;
+  teleinfo_delta.nb_full   = 0;
+}
+
+// Append ALERT to JSON
+void TeleinfoDriverAppendAlert ()
+{
+  bool    is_active;
+  uint8_t index;
+  char    str_key[8];
+  char    str_source[TIC_ALERT_SRC_SIZE];
+
+  // start of section
+  ResponseAppend_P (PSTR (",\"ALERT\":{"));
+
+  // loop thru alerts
+  for (index = 0; index < TIC_ALERT_MAX; index ++)
+  {
+    // get alert data
+    GetTextIndexed (str_key, sizeof (str_key), index, kTeleinfoAlert);
+    TeleinfoDriverAlertGetSource (index, str_source);
+
+    // append alert
+    if (index > 0) ResponseAppend_P (PSTR (","));
+    ResponseAppend_P (PSTR ("\"%s\":\"%s\""), str_key, str_source);
+  }
+
+  // end of section
+  ResponseAppend_P (PSTR ("}"));
+}
+
+// Append METER and PROD to JSON
+void TeleinfoDriverAppendMeterSensor ()
+{
+  uint8_t phase, value;
+  long    voltage, current, power_app, power_act;
+
+  // METER basic data
+  MiscOptionPrepareJsonSection ();
+  ResponseAppend_P (PSTR ("\"METER\":{\"PH\":%u,\"ISUB\":%u,\"PSUB\":%u,\"PMAX\":%d"), teleinfo_contract.phase, teleinfo_contract.isousc, teleinfo_contract.ssousc, (long)teleinfo_config.percent * teleinfo_contract.ssousc / 100);
+
+  // conso 
+  if (teleinfo_conso.enabled)
+  {
+    // conso : loop thru phases
+    voltage = 0;
+    current = 0;
+    power_app = 0;
+    power_act = 0;
+    for (phase = 0; phase < teleinfo_contract.phase; phase++)
+    {
+      // calculate parameters
+      voltage   += teleinfo_conso.phase[phase].voltage;
+      current   += teleinfo_conso.phase[phase].current;
+      power_app += teleinfo_conso.phase[phase].papp;
+      power_act += teleinfo_conso.phase[phase].pact;
+
+      // if needed, publish phase data
+      value = phase + 1;
+      ResponseAppend_P (PSTR (",\"U%u\":%d,\"I%u\":%d.%02d"), value, teleinfo_conso.phase[phase].voltage, value, teleinfo_conso.phase[phase].current / 1000, teleinfo_conso.phase[phase].current % 1000 / 10);
+      ResponseAppend_P (PSTR (",\"P%u\":%d,\"W%u\":%d"), value, teleinfo_conso.phase[phase].papp, value, teleinfo_conso.phase[phase].pact);
+    } 
+
+    // conso : values and cosphi
+    if (teleinfo_contract.phase > 1) voltage = voltage / (long)teleinfo_contract.phase;
+    ResponseAppend_P (PSTR (",\"U\":%d,\"I\":%d.%02d,\"P\":%d,\"W\":%d"), voltage, current / 1000, current % 1000 / 10, power_app, power_act);
+    if (teleinfo_conso.cosphi.quantity >= TIC_COSPHI_MIN) ResponseAppend_P (PSTR (",\"C\":%d.%02d"), teleinfo_conso.cosphi.value / 1000, teleinfo_conso.cosphi.value % 1000 / 10);
+
+    // conso : if not on battery, publish total of yesterday and today
+    if (TeleinfoDriverIsPowered ())
+    {
+      ResponseAppend_P (PSTR (",\"YDAY\":%d"), teleinfo_conso_wh.yesterday);
+      ResponseAppend_P (PSTR (",\"TDAY\":%d"), teleinfo_conso_wh.today);
+    }
+  }
+  
+  // if meter in production mode, publish complete production data
+  if (teleinfo_prod.enabled)
+  {
+    // prod : global values
+    ResponseAppend_P (PSTR (",\"PP\":%d"), teleinfo_prod.papp);
+    ResponseAppend_P (PSTR (",\"PW\":%d"), teleinfo_prod.pact);
+
+    // prod : cosphi
+    if (teleinfo_prod.cosphi.quantity >= TIC_COSPHI_MIN) ResponseAppend_P (PSTR (",\"PC\":%d.%02d"), teleinfo_prod.cosphi.value / 1000, teleinfo_prod.cosphi.value % 1000 / 10);
+
+    // prod : average power
+    ResponseAppend_P (PSTR (",\"PAVG\":%d"), (long)teleinfo_prod.pact_avg);
+
+    // prod : if not on battery, publish total of yesterday and today
+    if (TeleinfoDriverIsPowered ())
+    {
+      ResponseAppend_P (PSTR (",\"PYDAY\":%d"), teleinfo_prod_wh.yesterday);
+      ResponseAppend_P (PSTR (",\"PTDAY\":%d"), teleinfo_prod_wh.today);
+    }
+  }
+
+  // prodcution apparent power (allow to track excess of self production)
+  else if (teleinfo_prod.cacsi) ResponseAppend_P (PSTR (",\"PP\":%d"), teleinfo_prod.papp);
+
+  // end of message
+  ResponseJsonEnd ();
+}
+
+// Append CONTRACT to JSON
+void TeleinfoDriverAppendContractSensor ()
+{
+  uint8_t index;
+  char    str_value[32];
+  char    str_period[32];
+
+  // section CONTRACT
+  MiscOptionPrepareJsonSection ();
+  ResponseAppend_P (PSTR ("\"CONTRACT\":{"));
+
+  // meter serial number
+  lltoa (teleinfo_meter.ident, str_value, 10);
+  ResponseAppend_P (PSTR ("\"serial\":\"%s\""), str_value);
+
+  // contract name
+  TeleinfoContractGetName (str_value, sizeof (str_value));
+  ResponseAppend_P (PSTR (",\"name\":\"%s\""), str_value);
+
+  // contract period
+  TeleinfoContractGetPeriodLabel (str_value, sizeof (str_value));
+  ResponseAppend_P (PSTR (",\"period\":\"%s\""), str_value);
+
+  // period profile
+  TeleinfoContractGetPeriodProfile (str_value, sizeof (str_value));
+  ResponseAppend_P (PSTR (",\"profile\":\"%s\""), str_value);
+
+  // period color
+  index = TeleinfoContractGetPeriodLevel ();
+  GetTextIndexed (str_value, sizeof (str_value), index, kTeleinfoLevelLabel);
+  ResponseAppend_P (PSTR (",\"color\":\"%s\""), str_value);
+
+  // period type
+  index = TeleinfoContractGetPeriodHP ();
+  GetTextIndexed (str_value, sizeof (str_value), index, kTeleinfoHourLabel);
+  ResponseAppend_P (PSTR (",\"hour\":\"%s\""), str_value);
+
+  // level today at 12h
+  index = TeleinfoDriverCalendarGetLevel (TIC_DAY_TODAY, UINT8_MAX, false);
+  GetTextIndexed (str_value, sizeof (str_value), index, kTeleinfoLevelLabel);
+  ResponseAppend_P (PSTR (",\"tday\":\"%s\""), str_value);
+
+  // level tomorrow at 12h
+  index = TeleinfoDriverCalendarGetLevel (TIC_DAY_TMROW, UINT8_MAX, false);
+  GetTextIndexed (str_value, sizeof (str_value), index, kTeleinfoLevelLabel);
+  ResponseAppend_P (PSTR (",\"tmrw\":\"%s\""), str_value);
+
+  // total conso counter
+  lltoa (teleinfo_conso_wh.total, str_value, 10);
+  ResponseAppend_P (PSTR (",\"CONSO\":%s"), str_value);
+
+  // loop to publish conso counters
+  for (index = 0; index < teleinfo_contract_db.period_qty; index ++)
+  {
+    TeleinfoContractGetPeriodCode (str_period, sizeof (str_period), index);
+    lltoa (teleinfo_conso_wh.index[index], str_value, 10);
+    ResponseAppend_P (PSTR (",\"%s\":%s"), str_period, str_value);
+  }
+
+  // total production counter
+  if (teleinfo_prod.enabled)
+  {
+    lltoa (teleinfo_prod_wh.total, str_value, 10) ;
+    ResponseAppend_P (PSTR (",\"PROD\":%s"), str_value);
+  }
+
+  ResponseJsonEnd ();
+}
+
+// Generate JSON with RELAY (virtual relay mapping)
+//   V1..V8 : virtual relay = status
+//   C1..C8 : period relay  = status,level,label
+//   P1     : prod. relay status
+//   W1     : prod. relay trigger
+void TeleinfoDriverAppendRelaySensor ()
+{
+  bool    status, first;
+  uint8_t index, level, hchp;
+  char    str_name[32];
+
+  // loop to publish virtual relays
+  first = true;
+  MiscOptionPrepareJsonSection ();
+  ResponseAppend_P (PSTR ("\"RELAY\":{"));
+
+  // production relay
+  if (teleinfo_prod.enabled)
+  {
+    ResponseAppend_P (PSTR ("\"P1\":%u,\"W1\":%d"), teleinfo_prod.relay, teleinfo_config.prod_trigger);
+    first = false;
+  }
+
+  // virtual relays
+  if (teleinfo_conso.enabled)
+    for (index = 0; index < 8; index ++)
+    {
+      if (!first) ResponseAppend_P (PSTR (","));
+      ResponseAppend_P (PSTR ("\"V%u\":%u"), index + 1, TeleinfoRelayStatus (index));
+      first = false;
+    }
+
+  // contract period relays
+  if (teleinfo_conso.enabled)
+    for (index = 0; index < teleinfo_contract_db.period_qty; index ++) 
+    {
+      // period status
+      status = (index == teleinfo_contract.period);
+      level  = TeleinfoContractGetPeriodLevel (index);
+      hchp   = TeleinfoContractGetPeriodHP (index);
+      TeleinfoContractGetPeriodLabel (str_name, sizeof (str_name), index);
+      if (!first) ResponseAppend_P (PSTR (","));
+      ResponseAppend_P (PSTR ("\"C%u\":\"%u,%u,%u,%s\""), index + 1, status, level, hchp, str_name);
+      first = false;
+    }
+
+  ResponseJsonEnd ();
+}
+
+// Generate JSON with CALENDAR
+void TeleinfoDriverAppendCalendarSensor ()
+{
+  // if on battery, ignore publication
+  if (TeleinfoDriverIsOnBattery ()) return;
+
+  // publish CAL current data
+  MiscOptionPrepareJsonSection ();
+  ResponseAppend_P (PSTR ("\"CAL\":{\"level\":%u,\"hp\":%u}"), TeleinfoContractGetPeriodLevel (), TeleinfoContractGetPeriodHP ());
+}
+
+/**************************/
+/*         Alerts         */
+/**************************/
+
+bool TeleinfoDriverAlertGetStatus (const uint8_t type)
+{
+  bool active;
+
+  // check paremeters
+  if (type >= TIC_ALERT_MAX) return false;
+  if (teleinfo_meter.arr_alert[type].timeout == UINT32_MAX) return false;
+
+  // check for reset
+  active = (LocalTime () <= teleinfo_meter.arr_alert[type].timeout);
+  if (!active)
+  {
+    // reset alert
+    teleinfo_meter.arr_alert[type].timeout = UINT32_MAX;
+    strcpy_P (teleinfo_meter.arr_alert[type].str_source, PSTR (""));
+
+    // trigger publication
+    teleinfo_meter.json.data = true;
+  } 
+
+  return active;
+}
+
+void TeleinfoDriverAlertGetSource (const uint8_t type, char *pstr_source)
+{
+  // check paremeters
+  if (type >= TIC_ALERT_MAX) return;
+  if (pstr_source == nullptr) return;
+
+  // get source
+  strlcpy (pstr_source, teleinfo_meter.arr_alert[type].str_source, TIC_ALERT_SRC_SIZE);
+}
+
+void TeleinfoDriverAlertTrigger (const uint8_t type, const char* pstr_source)
+{
+  // check parameters
+  if (!RtcTime.valid) return;
+  if (!TeleinfoDriverMeterReady ()) return;
+  if (type >= TIC_ALERT_MAX) return;
+  if (pstr_source == nullptr) return;
+  if (strlen_P (pstr_source) >= 6) return;
+
+  // if needed, trigger publication
+  if (teleinfo_meter.arr_alert[type].timeout == UINT32_MAX) teleinfo_meter.json.data = true;
+
+  // update alert
+  teleinfo_meter.arr_alert[type].timeout = LocalTime () + TELEINFO_ALERT_TIMEOUT;
+  strcpy_P (teleinfo_meter.arr_alert[type].str_source, pstr_source);
+}
+
+/*********************************************\
+ *                Calendar
+\*********************************************/
+
+// calculate current slot
+uint8_t TeleinfoCalendarGetSlot (const uint8_t hour, const uint8_t minute)
+{
+  uint8_t slot;
+
+  // check parameter
+  if (hour > 23) return UINT8_MAX;
+  if (minute > 59) return UINT8_MAX;
+
+  // calculate slot
+  slot = hour * 2 + (minute / 30);
+ 
+  return slot;
+}
+
+// calculate current slot
+uint8_t TeleinfoCalendarGetSlot (const char* pstr_time, const bool is_hexa)
+{
+  uint8_t slot, hour, minute;
+  char    str_value[4];
+
+  // check parameter
+  if (pstr_time == nullptr) return UINT8_MAX;
+  if (strlen (pstr_time) < 4) return UINT8_MAX;
+
+  // calculate hours
+  strlcpy (str_value, pstr_time, 3);
+  if (is_hexa) hour = (uint8_t)strtol (str_value, NULL, 16);
+    else hour = (uint8_t)atoi (str_value);
+
+  // calculate minutes
+  strlcpy (str_value, pstr_time + 2, 3);
+  if (is_hexa) minute = (uint8_t)strtol (str_value, NULL, 16);
+    else minute = (uint8_t)atoi (str_value);
+
+  // calculate slot
+  slot = TeleinfoCalendarGetSlot (hour, minute);
+
+  return slot;
+}
+
+// calculate current date (format : YYYYMMDDSS)
+uint32_t TeleinfoCalendarGetDay (const char* pstr_date, const bool add_slot)
+{
+  uint32_t date = 0;
+  char     str_text[8];
+
+  // check parameter
+  if (pstr_date == nullptr) return 0;
+
+  // calculate date stamp
+  if (strlen (pstr_date) >= 6)
+  {
+    strlcpy (str_text, pstr_date, 7);
+    date = 100 * (20000000 + (uint32_t)atoi (str_text));
+  }
+
+  // if needed, include day slot
+  if (add_slot && (date != 0) && (strlen (pstr_date) >= 10))
+  {
+    // handle hours
+    strlcpy (str_text, pstr_date + 6, 3);
+    date += 2 * (uint8_t)atoi (str_text);
+
+    // handle minutes
+    strlcpy (str_text, pstr_date + 8, 3);
+    date += (uint8_t)atoi (str_text) / 30;
+  }
+
+  return date;
+}
+
+// calculate current date (format : YYYYMMDDSS)
+uint32_t TeleinfoCalendarGetDay (const uint16_t year, const uint8_t month, const uint8_t day_of_month, const uint8_t hour, const uint8_t minute)
+{
+  uint32_t date;
+
+  // calculate today's date
+  date  = 1000000 * (2000 + (uint32_t)year);
+  date += 10000 * (uint32_t)month;
+  date += 100 * (uint32_t)day_of_month;
+
+  // append daily slot
+  date += hour * 2;
+  date += minute / 30;
+
+  return date;
+}
+
+// set current date (format : YYYYMMDD00)
+uint32_t TeleinfoCalendarGetNextDay (const uint32_t date)
+{
+  uint32_t date_next;
+  TIME_T   date_dst;
+
+  // check parameter
+  if (date == 0) return 0;
+
+  // set given date
+  date_dst.year         = (uint16_t)(date / 1000000 - 1970);
+  date_dst.month        = (uint8_t)(date / 10000 % 100);
+  date_dst.day_of_month = (uint8_t)(date / 100 % 100);
+  date_dst.hour         = 0;
+  date_dst.minute       = 0;
+  date_dst.second       = 0;
+
+  // calculate next day
+  date_next = MakeTime (date_dst) + 86400;
+  BreakTime (date_next, date_dst);
+
+  // generate new date timestamp
+  date_next  = 1000000 * ((uint32_t)date_dst.year + 1970);
+  date_next += 10000 * (uint32_t)date_dst.month;
+  date_next += 100 * (uint32_t)date_dst.day_of_month;
+
+  return date_next;
+}
+
+// remise a zero des donnees de calendrier
+void TeleinfoCalendarReset (const uint8_t day)
+{
+  uint8_t index;
+
+  // check parameter
+  if (day >= TIC_DAY_MAX) return;
+
+  // reset all data
+  teleinfo_calendar[day].level = 0;
+  for (index = 0; index < TIC_DAY_SLOT_MAX; index ++) teleinfo_calendar[day].arr_slot[index] = 0; 
+  teleinfo_calendar[day].date = 0;
+
+  // reset settings
+  SettingsUpdateText (SET_TIC_CAL_TODAY + day, "");
 }
 
 // save current calendar to settings
 void TeleinfoCalendarSaveToSettings ()
 {
-  uint8_t day, count, slot, period;
-  char    str_value[8];
-  String  str_setting;
+  uint8_t day, count, slot, period;
+  char    str_value[8];
+  String  str_setting;
+
+  // loop thru days to save in settings
+  for (day = TIC_DAY_TODAY; day < TIC_DAY_MAX; day ++)
+  {
+    // date
+    ultoa ((ulong)teleinfo_calendar[day].date, str_value, 16);
+    str_setting = str_value;
+
+    // loop thru slots
+    count = 0;
+    period = teleinfo_calendar[day].arr_slot[0];
+    for (slot = 0; slot < TIC_DAY_SLOT_MAX; slot ++)
+    {
+      // if period has not changed, increase counter
+      if (teleinfo_calendar[day].arr_slot[slot] == period) count ++;
+
+      // else save previous one
+      else
+      {
+        // append previous period
+        str_setting += period;
+        sprintf_P (str_value, PSTR ("%02u"), count);
+        str_setting += str_value;
+
+        // set new period
+        period = teleinfo_calendar[day].arr_slot[slot];
+        count = 1;
+      }
+    }
+
+    // append last period
+    str_setting += period;
+    sprintf_P (str_value, PSTR ("%02u"), count);
+    str_setting += str_value;    
+
+    // update string
+    SettingsUpdateText (SET_TIC_CAL_TODAY + day, str_setting.c_str ());
+  }
+}
+
+// load current calendar from settings
+bool TeleinfoCalendarLoadFromSettings (const uint8_t day)
+{
+  bool     done = false;
+  uint8_t  index, period, slot, start, stop, length;
+  uint16_t value;
+  uint32_t date;
+  char    *pstr_setting;
+  char     str_text[8];
+
+  // check parameters
+  if (day >= TIC_DAY_MAX) return done;
+
+  // loop thru setting strings
+  for (index = SET_TIC_CAL_TODAY; index <= SET_TIC_CAL_AFTER; index ++)
+  {
+    // retrieve date of current day setting
+    pstr_setting = SettingsText (index);
+    strlcpy (str_text, pstr_setting, 5);
+    date = (uint32_t)strtoul (str_text, nullptr, 16);
+
+    // if date is matching, populate slots
+    if (date == teleinfo_calendar[day].date)
+    {
+      // init
+      done  = true;
+      index = UINT8_MAX;
+      start = 0;
+      pstr_setting += 4;
+
+      // loop thru slots
+      while (strlen (pstr_setting) >= 3)
+      {
+        // get current slot description
+        strlcpy (str_text, pstr_setting, 4);
+        value = atoi (str_text);
+        period = (uint8_t)(value / 100); 
+        length = (uint8_t)(value % 100);
+
+        // update daily slot
+        stop = min (start + length, TIC_DAY_SLOT_MAX);
+        for (slot = start; slot < stop; slot ++) teleinfo_calendar[day].arr_slot[slot] = period;
+
+        // go to next slot
+        pstr_setting += 3;
+        start += length;
+      }
+    }
+  }
+
+  return done;
+}
+
+// set current date (year has offset from 2000 : 24 is 2024)
+void TeleinfoCalendarSetDate (const uint16_t year, const uint8_t month, const uint8_t day_of_month, const uint8_t hour, const uint8_t minute)
+{
+  uint8_t day;
+
+  // update current slot
+  teleinfo_meter.date = TeleinfoCalendarGetDay (year, month, day_of_month, hour, minute);
+  teleinfo_meter.slot = TeleinfoCalendarGetSlot (hour, minute);
+  
+  // if today is set, nothing else
+  if (teleinfo_calendar[TIC_DAY_TODAY].date > 0) return;
+  
+  // reset all calendar days
+  for (day = TIC_DAY_TODAY; day < TIC_DAY_MAX; day ++) TeleinfoCalendarReset (day);
+
+  // set today, tomorrow and day after tomorrow
+  teleinfo_calendar[TIC_DAY_TODAY].date = TeleinfoCalendarGetDay (year, month, day_of_month, 0, 0);
+  teleinfo_calendar[TIC_DAY_TMROW].date = TeleinfoCalendarGetNextDay (teleinfo_calendar[TIC_DAY_TODAY].date);
+  teleinfo_calendar[TIC_DAY_AFTER].date = TeleinfoCalendarGetNextDay (teleinfo_calendar[TIC_DAY_TMROW].date);
+}
+
+// set period on current slot
+void TeleinfoCalendarSetDailyCalendar (const uint8_t day, const uint8_t period)
+{
+  uint8_t index, period_hc, period_hp;
+
+  // check parameters
+  if (day >= TIC_DAY_AFTER) return;
+  if (period >= TIC_PERIOD_MAX) return;
+  
+  // if dealing with EJP calendar and announcing pointe
+  if (((teleinfo_contract_db.type == TIC_C_HIS_EJP) || (teleinfo_contract_db.type == TIC_C_STD_EJP)) && (period == 1))
+  {
+    // if today before 1h -> set period today 0h-1h
+    if ((day == TIC_DAY_TODAY) && (teleinfo_meter.slot < 2)) for (index = 0; index < 2; index ++) teleinfo_calendar[TIC_DAY_TODAY].arr_slot[index] = period;
+
+    // else if today after 7h -> set period today 7h-24h and tomorrow 0h-1h
+    else if ((day == TIC_DAY_TODAY) && (teleinfo_meter.slot >= 14))
+    {
+      for (index = 14; index < TIC_DAY_SLOT_MAX; index ++) teleinfo_calendar[TIC_DAY_TODAY].arr_slot[index] = period;
+      for (index = 0; index < 2; index ++) teleinfo_calendar[TIC_DAY_TMROW].arr_slot[index] = period;
+      teleinfo_calendar[TIC_DAY_TODAY].level = teleinfo_contract_db.arr_period[period].level;
+    }
+
+    // else if tomorrow before 1h -> set period today 0h-1h
+    else if ((day == TIC_DAY_TMROW) && (teleinfo_meter.slot < 2)) for (index = 0; index < 2; index ++) teleinfo_calendar[TIC_DAY_TODAY].arr_slot[index] = period;
+
+    // else if tomorrow after 8h -> set period tomorrow 7h-24h and day after 0h-1h
+    else if ((day == TIC_DAY_TMROW) && (teleinfo_meter.slot >= 16))
+    {
+      for (index = 14; index < TIC_DAY_SLOT_MAX; index ++) teleinfo_calendar[TIC_DAY_TMROW].arr_slot[index] = period;
+      for (index = 0; index < 2; index ++) teleinfo_calendar[TIC_DAY_AFTER].arr_slot[index] = period;
+      teleinfo_calendar[TIC_DAY_TMROW].level = teleinfo_contract_db.arr_period[period].level;
+    }
+  }
+
+  // check if default Tempo calendar should be applied
+  else if (((teleinfo_contract_db.type == TIC_C_HIS_TEMPO) || (teleinfo_contract_db.type == TIC_C_STD_TEMPO)) && (period >= 2))
+  {
+    // calculate HC and HP periods
+    period_hc = period - (period % 2);
+    period_hp = period_hc + 1;
+
+    // if today before 6h -> set period today 0h-6h hc
+    if ((day == TIC_DAY_TODAY) &&  (teleinfo_meter.slot < 12)) for (index = 0; index < 12; index ++) teleinfo_calendar[TIC_DAY_TODAY].arr_slot[index] = period_hc;
+
+    // else if today after 6h -> set period today 6h-22h hp, today 22h-24h hc and tomorrow 0h-6h hc
+    else if ((day == TIC_DAY_TODAY) &&  (teleinfo_meter.slot >= 12))
+    {
+      for (index = 12; index < 44; index ++) teleinfo_calendar[TIC_DAY_TODAY].arr_slot[index] = period_hp;
+      for (index = 44; index < TIC_DAY_SLOT_MAX; index ++) teleinfo_calendar[TIC_DAY_TODAY].arr_slot[index] = period_hc;
+      for (index = 0; index < 12; index ++) teleinfo_calendar[TIC_DAY_TMROW].arr_slot[index] = period_hc;
+      teleinfo_calendar[TIC_DAY_TODAY].level = teleinfo_contract_db.arr_period[period].level;
+    }
+
+    // else if tomorrow before 6h -> set period today 0h-6h hc
+    else if ((day == TIC_DAY_TMROW) &&  (teleinfo_meter.slot < 12)) for (index = 0; index < 12; index ++) teleinfo_calendar[TIC_DAY_TODAY].arr_slot[index] = period_hc;
+
+    // else if tomorrow after 8h -> set period tomorrow 6h-22h hp, tomorrow 22h-24h hc and day after 0h-6h hc
+    else if ((day == TIC_DAY_TMROW) &&  (teleinfo_meter.slot >= 16))
+    {
+      for (index = 12; index < 44; index ++) teleinfo_calendar[TIC_DAY_TMROW].arr_slot[index] = period_hp;
+      for (index = 44; index < TIC_DAY_SLOT_MAX; index ++) teleinfo_calendar[TIC_DAY_TMROW].arr_slot[index] = period_hc;
+      for (index = 0; index < 12; index ++) teleinfo_calendar[TIC_DAY_AFTER].arr_slot[index] = period_hc;
+      teleinfo_calendar[TIC_DAY_TMROW].level = teleinfo_contract_db.arr_period[period].level;
+    }
+  }
+}
+
+void TeleinfoCalendarSetDemain (const char* pstr_color)
+{
+  uint8_t level, period;
+
+  // check parameters
+  if (pstr_color == nullptr) return;
+  if (!RtcTime.valid) return;
+
+  // detect color
+  level = TeleinfoContractDetectPeriodLevel (pstr_color);
+  if (level == TIC_LEVEL_NONE) return;
+
+  // check if contract is compatible, calculate period accordingly
+  if (teleinfo_contract_db.type == TIC_C_HIS_TEMPO) period = 2 * level - 2;
+    else if (teleinfo_contract_db.type == TIC_C_HIS_EJP) period = level / 3;
+    else return;
+
+  // set period
+  TeleinfoCalendarSetDailyCalendar (TIC_DAY_TMROW, period);
+}
+
+// calendar midnight shift
+void TeleinfoEnergyCalendarMidnight ()
+{
+  char str_text[16];
+
+  // shift tomorrow and day after tomorrow
+  teleinfo_calendar[TIC_DAY_TODAY] = teleinfo_calendar[TIC_DAY_TMROW];
+  teleinfo_calendar[TIC_DAY_TMROW] = teleinfo_calendar[TIC_DAY_AFTER];
+
+  // init day after
+  TeleinfoCalendarReset (TIC_DAY_AFTER);
+  teleinfo_calendar[TIC_DAY_AFTER].date = TeleinfoCalendarGetNextDay (teleinfo_calendar[TIC_DAY_TMROW].date);
+  TeleinfoDriverCalendarGetDate (TIC_DAY_AFTER, str_text, sizeof (str_text));
+  AddLog (LOG_LEVEL_INFO, PSTR ("CAL: %u %s"), teleinfo_calendar[TIC_DAY_AFTER].date / 100, str_text);
+}
+
+// set calendar current pointe start
+void TeleinfoCalendarPointeBegin (const uint8_t index, const char *pstr_horodatage)
+{
+  // check parameter
+  if (!RtcTime.valid) return;
+  if (index >= TIC_POINTE_MAX) return;
+  if (pstr_horodatage == nullptr) return;
+  if (strlen (pstr_horodatage) < 12) return;
+
+  // set index, day and slot
+  teleinfo_message.arr_pointe[index].start = TeleinfoCalendarGetDay (pstr_horodatage, true);
+}
+
+// set calendar current pointe stop
+void TeleinfoCalendarPointeEnd (const uint8_t index, const char *pstr_horodatage)
+{
+  // check parameter
+  if (!RtcTime.valid) return;
+  if (index >= TIC_POINTE_MAX) return;
+  if (pstr_horodatage == nullptr) return;
+  if (strlen (pstr_horodatage) < 12) return;
+
+  // check if date is within known days
+  teleinfo_message.arr_pointe[index].stop = TeleinfoCalendarGetDay (pstr_horodatage, true);
+}
+
+// set default profile if not defined
+void TeleinfoCalendarDefaultProfile (char *pstr_donnee)
+{
+  bool    update;
+  uint8_t day, start, slot, period, level;
+  uint8_t arr_slot[TIC_DAY_SLOT_MAX];
+  char    str_text[16];
+
+  // check parameters
+  if (!RtcTime.valid) return;
+  if (pstr_donnee == nullptr) return;
+  if (strlen (pstr_donnee) < 8) return;
+
+  // check if a day calendar needs to be updated
+  update = false;
+  for (day = TIC_DAY_TODAY; day < TIC_DAY_MAX; day ++) update |= (teleinfo_calendar[day].level == TIC_LEVEL_NONE);
+  if (!update) return;
+
+  // loop thru segments to load daily calendar
+  level = TIC_LEVEL_NONE;
+  for (slot = 0; slot < TIC_DAY_SLOT_MAX; slot ++) arr_slot[slot] = UINT8_MAX;
+  while ((strlen (pstr_donnee) >= 8) && isdigit (pstr_donnee[0]))
+  {
+    // extract data and populate slot
+    strlcpy (str_text, pstr_donnee, 5);
+    start = TeleinfoCalendarGetSlot (str_text, teleinfo_config.cal_hexa);
+    strlcpy (str_text, pstr_donnee + 7, 2);
+    period = (uint8_t)atoi (str_text) - 1;
+    level = max (level, teleinfo_contract_db.arr_period[period].level);
+    for (slot = start; slot < TIC_DAY_SLOT_MAX; slot ++) arr_slot[slot] = period;
 
-  // loop thru days to save in settings
+    // increment to next segment
+    pstr_donnee += 8;
+    if (pstr_donnee[0] == ' ') pstr_donnee ++;
+  }
+
+  // loop thru days : if day's calendar not set, set default one
   for (day = TIC_DAY_TODAY; day < TIC_DAY_MAX; day ++)
+    if ((teleinfo_calendar[day].level == TIC_LEVEL_NONE) && (level != TIC_LEVEL_NONE))
+    {
+      teleinfo_calendar[day].level = level;
+      for (slot = 0; slot < TIC_DAY_SLOT_MAX; slot ++) 
+        if (teleinfo_calendar[day].arr_slot[slot] < arr_slot[slot]) teleinfo_calendar[day].arr_slot[slot] = arr_slot[slot];
+      TeleinfoDriverCalendarGetDate (day, str_text, sizeof (str_text));
+      AddLog (LOG_LEVEL_INFO, PSTR ("CAL: default calendar applied to %s"), str_text);
+    }
+}
+
+// set pointe profile
+void TeleinfoCalendarPointeProfile (const char *pstr_donnee)
+{
+  uint8_t  day, start, slot, period, index, pointe;
+  uint32_t date;
+  uint8_t  arr_slot[TIC_DAY_SLOT_MAX];
+  char     str_value[8];
+
+  // check parameters
+  if (!RtcTime.valid) return;
+  if (pstr_donnee == nullptr) return;
+  if (strlen (pstr_donnee) < 8) return;
+
+  // detect pointe to apply
+  pointe = UINT8_MAX;
+  date   = UINT32_MAX;
+  for (index = 0; index < TIC_POINTE_MAX; index ++) 
+    if ((teleinfo_message.arr_pointe[index].start > teleinfo_meter.date) && (teleinfo_message.arr_pointe[index].start < date))
+    {
+      date   = teleinfo_message.arr_pointe[index].start;
+      pointe = index;
+    }
+  if (pointe >= TIC_POINTE_MAX) return;
+  if (teleinfo_message.arr_pointe[pointe].stop == 0) return;
+
+  // loop thru segments to load daily calendar
+  for (slot = 0; slot < TIC_DAY_SLOT_MAX; slot ++) arr_slot[slot] = UINT8_MAX;
+  while ((strlen (pstr_donnee) >= 8) && isdigit (pstr_donnee[0]))
   {
-    // date
-    ultoa ((ulong)teleinfo_calendar[day].date, str_value, 16);
-    str_setting = str_value;
+    // extract data and populate slot
+    strlcpy (str_value, pstr_donnee, 5);
+    start = TeleinfoCalendarGetSlot (str_value, teleinfo_config.cal_hexa);
+    strlcpy (str_value, pstr_donnee + 7, 2);
+    period = (uint8_t)atoi (str_value) - 1;
+    for (slot = start; slot < TIC_DAY_SLOT_MAX; slot ++) arr_slot[slot] = period;
 
-    // loop thru slots
-    count = 0;
-    period = teleinfo_calendar[day].arr_slot[0];
+    // increment to next segment
+    pstr_donnee += 8;
+    if (pstr_donnee[0] == ' ') pstr_donnee ++;
+  }
+
+  // loop thru days to update their slots with current pointe period
+  for (day = TIC_DAY_TODAY; day < TIC_DAY_MAX; day ++)
     for (slot = 0; slot < TIC_DAY_SLOT_MAX; slot ++)
     {
-      // if period has not changed, increase counter
-      if (teleinfo_calendar[day].arr_slot[slot] == period) count ++;
+      date = teleinfo_calendar[day].date + slot;
+      if ((date >= teleinfo_message.arr_pointe[pointe].start) && (date < teleinfo_message.arr_pointe[pointe].stop) && (arr_slot[slot] != UINT8_MAX)) teleinfo_calendar[day].arr_slot[slot] = arr_slot[slot];
+    }
+}
 
-      // else save previous one
-      else
-      {
-        // append previous period
-        str_setting += period;
-        sprintf_P (str_value, PSTR ("%02u"), count);
-        str_setting += str_value;
+/***************************************\
+ *         JSON stream parser
+\***************************************/
 
-        // set new period
-        period = teleinfo_calendar[day].arr_slot[slot];
-        count = 1;
-      }
+// init parser, callback is called for each scalar value
+void TeleinfoJsonInit (tic_json_parser &parser, TeleinfoJsonCallback callback)
+{
+  parser.state     = TIC_JSON_STATE_VALUE;
+  parser.level     = 0;
+  parser.length    = 0;
+  parser.skip      = 0;
+  parser.is_key    = false;
+  parser.is_string = false;
+  parser.nb_value  = 0;
+  parser.callback  = callback;
+}
+
+// check if parser has reached end of root value without error
+bool TeleinfoJsonIsComplete (const tic_json_parser &parser)
+{
+  return ((parser.state == TIC_JSON_STATE_NEXT) && (parser.level == 0) && (parser.nb_value > 0));
+}
+
+// get index of open array at given level (UINT16_MAX if not an array)
+uint16_t TeleinfoJsonIndex (const tic_json_parser &parser, const uint8_t level)
+{
+  if ((level >= parser.level) || (parser.arr_type[level] != '[')) return UINT16_MAX;
+  return parser.arr_index[level];
+}
+
+// get current key of open object at given level (empty if not an object)
+const char* TeleinfoJsonKey (const tic_json_parser &parser, const uint8_t level)
+{
+  if ((level >= parser.level) || (parser.arr_type[level] != '{')) return "";
+  return parser.arr_key[level];
+}
+
+// check if current value path matches a pattern like signals[*].values[2].hvalue (* matches any key or index)
+bool TeleinfoJsonMatch (const tic_json_parser &parser, const char *pstr_path)
+{
+  uint8_t level;
+  size_t  length;
+  char   *pstr_pattern, *pstr_end;
+  char    str_path[TIC_JSON_PATH_SIZE];
+
+  // copy pattern from flash
+  strlcpy_P (str_path, pstr_path, sizeof (str_path));
+
+  // loop thru pattern segments
+  level = 0;
+  pstr_pattern = str_path;
+  while (*pstr_pattern != 0)
+  {
+    // check depth
+    if (level >= parser.level) return false;
+
+    // skip key separator
+    if (*pstr_pattern == '.') pstr_pattern++;
+
+    // array index segment
+    if (*pstr_pattern == '[')
+    {
+      if (parser.arr_type[level] != '[') return false;
+      pstr_pattern++;
+      if (*pstr_pattern == '*') pstr_pattern++;
+      else if (strtoul (pstr_pattern, &pstr_end, 10) == parser.arr_index[level]) pstr_pattern = pstr_end;
+      else return false;
+      if (*pstr_pattern != ']') return false;
+      pstr_pattern++;
     }
 
-    // append last period
-    str_setting += period;
-    sprintf_P (str_value, PSTR ("%02u"), count);
-    str_setting += str_value;    
+    // object key segment
+    else
+    {
+      if (parser.arr_type[level] != '{') return false;
+      length = strcspn (pstr_pattern, ".[");
+      if ((length != 1) || (*pstr_pattern != '*'))
+        if ((strlen (parser.arr_key[level]) != length) || (strncmp (parser.arr_key[level], pstr_pattern, length) != 0)) return false;
+      pstr_pattern += length;
+    }
 
-    // update string
-    SettingsUpdateText (SET_TIC_CAL_TODAY + day, str_setting.c_str ());
+    level++;
   }
+
+  return (level == parser.level);
 }
 
-// load current calendar from settings
-bool TeleinfoCalendarLoadFromSettings (const uint8_t day)
+// end of current token
+void TeleinfoJsonTokenEnd (tic_json_parser &parser)
 {
-  bool     done = false;
-  uint8_t  index, period, slot, start, stop, length;
-  uint16_t value;
-  uint32_t date;
-  char    *pstr_setting;
-  char     str_text[8];
+  parser.str_token[parser.length] = 0;
 
-  // check parameters
-  if (day >= TIC_DAY_MAX) return done;
+  // object key
+  if (parser.is_key)
+  {
+    strlcpy (parser.arr_key[parser.level - 1], parser.str_token, TIC_JSON_KEY_SIZE);
+    parser.state = TIC_JSON_STATE_COLON;
+  }
 
-  // loop thru setting strings
-  for (index = SET_TIC_CAL_TODAY; index <= SET_TIC_CAL_AFTER; index ++)
+  // scalar value
+  else
   {
-    // retrieve date of current day setting
-    pstr_setting = SettingsText (index);
-    strlcpy (str_text, pstr_setting, 5);
-    date = (uint32_t)strtoul (str_text, nullptr, 16);
+    parser.nb_value++;
+    if (parser.callback != nullptr) parser.callback (parser, parser.str_token);
+    parser.state = TIC_JSON_STATE_NEXT;
+  }
 
-    // if date is matching, populate slots
-    if (date == teleinfo_calendar[day].date)
-    {
-      // init
-      done  = true;
-      index = UINT8_MAX;
-      start = 0;
-      pstr_setting += 4;
+  parser.length = 0;
+}
 
-      // loop thru slots
-      while (strlen (pstr_setting) >= 3)
+// append character to current token, truncating if needed
+void TeleinfoJsonTokenAppend (tic_json_parser &parser, const char character)
+{
+  if (parser.length < TIC_JSON_VALUE_SIZE - 1) parser.str_token[parser.length++] = character;
+}
+
+// feed parser with one character of the stream
+void TeleinfoJsonFeed (tic_json_parser &parser, const char character)
+{
+  // handle token states
+  switch (parser.state)
+  {
+    case TIC_JSON_STATE_ERROR:
+      return;
+
+    case TIC_JSON_STATE_STRING:
+      if (character == '\\') parser.state = TIC_JSON_STATE_ESCAPE;
+        else if (character == '"') TeleinfoJsonTokenEnd (parser);
+        else TeleinfoJsonTokenAppend (parser, character);
+      return;
+
+    case TIC_JSON_STATE_ESCAPE:
+      parser.state = TIC_JSON_STATE_STRING;
+      switch (character)
       {
-        // get current slot description
-        strlcpy (str_text, pstr_setting, 4);
-        value = atoi (str_text);
-        period = (uint8_t)(value / 100); 
-        length = (uint8_t)(value % 100);
+        case 'n': TeleinfoJsonTokenAppend (parser, '\n'); break;
+        case 'r': TeleinfoJsonTokenAppend (parser, '\r'); break;
+        case 't': TeleinfoJsonTokenAppend (parser, '\t'); break;
+        case 'b': case 'f': break;
+        case 'u': TeleinfoJsonTokenAppend (parser, '?'); parser.skip = 4; parser.state = TIC_JSON_STATE_UNICODE; break;
+        default:  TeleinfoJsonTokenAppend (parser, character); break;
+      }
+      return;
 
-        // update daily slot
-        stop = min (start + length, TIC_DAY_SLOT_MAX);
-        for (slot = start; slot < stop; slot ++) teleinfo_calendar[day].arr_slot[slot] = period;
+    case TIC_JSON_STATE_UNICODE:
+      parser.skip--;
+      if (parser.skip == 0) parser.state = TIC_JSON_STATE_STRING;
+      return;
 
-        // go to next slot
-        pstr_setting += 3;
-        start += length;
+    case TIC_JSON_STATE_LITERAL:
+      if (isalnum (character) || (character == '.') || (character == '-') || (character == '+'))
+      {
+        TeleinfoJsonTokenAppend (parser, character);
+        return;
       }
-    }
+      TeleinfoJsonTokenEnd (parser);
+      break;
   }
 
-  return done;
+  // handle structural characters
+  switch (character)
+  {
+    case ' ': case '\t': case '\r': case '\n':
+      break;
+
+    case '{':
+    case '[':
+      if ((parser.state != TIC_JSON_STATE_VALUE) || (parser.level >= TIC_JSON_DEPTH)) { parser.state = TIC_JSON_STATE_ERROR; break; }
+      parser.arr_type[parser.level]   = character;
+      parser.arr_index[parser.level]  = 0;
+      parser.arr_key[parser.level][0] = 0;
+      parser.level++;
+      if (character == '{') parser.state = TIC_JSON_STATE_KEY;
+        else parser.state = TIC_JSON_STATE_VALUE;
+      break;
+
+    case '}':
+    case ']':
+      if ((parser.level == 0) || (parser.state == TIC_JSON_STATE_COLON)) { parser.state = TIC_JSON_STATE_ERROR; break; }
+      parser.level--;
+      parser.state = TIC_JSON_STATE_NEXT;
+      break;
+
+    case ':':
+      if (parser.state == TIC_JSON_STATE_COLON) parser.state = TIC_JSON_STATE_VALUE;
+        else parser.state = TIC_JSON_STATE_ERROR;
+      break;
+
+    case ',':
+      if ((parser.state != TIC_JSON_STATE_NEXT) || (parser.level == 0)) { parser.state = TIC_JSON_STATE_ERROR; break; }
+      if (parser.arr_type[parser.level - 1] == '[')
+      {
+        parser.arr_index[parser.level - 1]++;
+        parser.state = TIC_JSON_STATE_VALUE;
+      }
+      else parser.state = TIC_JSON_STATE_KEY;
+      break;
+
+    case '"':
+      if (parser.state == TIC_JSON_STATE_KEY) parser.is_key = true;
+        else if (parser.state == TIC_JSON_STATE_VALUE) parser.is_key = false;
+        else { parser.state = TIC_JSON_STATE_ERROR; break; }
+      parser.is_string = true;
+      parser.length    = 0;
+      parser.state     = TIC_JSON_STATE_STRING;
+      break;
+
+    default:
+      if (parser.state != TIC_JSON_STATE_VALUE) { parser.state = TIC_JSON_STATE_ERROR; break; }
+      parser.is_key    = false;
+      parser.is_string = false;
+      parser.length    = 0;
+      parser.state     = TIC_JSON_STATE_LITERAL;
+      TeleinfoJsonTokenAppend (parser, character);
+      break;
+  }
 }
 
-// set current date (year has offset from 2000 : 24 is 2024)
-void TeleinfoCalendarSetDate (const uint16_t year, const uint8_t month, const uint8_t day_of_month, const uint8_t hour, const uint8_t minute)
+/***************************************\
+ *        HTTPS requests (ESP32)
+\***************************************/
+
+#ifdef ESP32
+
+// stream class feeding received HTTPS body to JSON parser (worker task)
+class TeleinfoJsonStream : public Stream
 {
-  uint8_t day;
+public:
+  TeleinfoJsonStream (tic_json_parser &json_parser);
+  size_t write (uint8_t data) override;
+  size_t write (const uint8_t *buffer, size_t size) override;
+  int    available () override { return 0; }
+  int    read () override { return -1; }
+  int    peek () override { return -1; }
+  void   flush () override {}
+
+private:
+  tic_json_parser &parser;                  // target parser
+};
+
+TeleinfoJsonStream::TeleinfoJsonStream (tic_json_parser &json_parser) : parser (json_parser)
+{
+}
 
-  // update current slot
-  teleinfo_meter.date = TeleinfoCalendarGetDay (year, month, day_of_month, hour, minute);
-  teleinfo_meter.slot = TeleinfoCalendarGetSlot (hour, minute);
-  
-  // if today is set, nothing else
-  if (teleinfo_calendar[TIC_DAY_TODAY].date > 0) return;
-  
-  // reset all calendar days
-  for (day = TIC_DAY_TODAY; day < TIC_DAY_MAX; day ++) TeleinfoCalendarReset (day);
+size_t TeleinfoJsonStream::write (uint8_t data)
+{
+  TeleinfoJsonFeed (parser, (char)data);
+  return 1;
+}
 
-  // set today, tomorrow and day after tomorrow
-  teleinfo_calendar[TIC_DAY_TODAY].date = TeleinfoCalendarGetDay (year, month, day_of_month, 0, 0);
-  teleinfo_calendar[TIC_DAY_TMROW].date = TeleinfoCalendarGetNextDay (teleinfo_calendar[TIC_DAY_TODAY].date);
-  teleinfo_calendar[TIC_DAY_AFTER].date = TeleinfoCalendarGetNextDay (teleinfo_calendar[TIC_DAY_TMROW].date);
+size_t TeleinfoJsonStream::write (const uint8_t *buffer, size_t size)
+{
+  size_t index;
+
+  for (index = 0; index < size; index ++) TeleinfoJsonFeed (parser, (char)buffer[index]);
+  return size;
 }
 
-// set period on current slot
-void TeleinfoCalendarSetDailyCalendar (const uint8_t day, const uint8_t period)
+// FNV-1a hash of an URL (dated URLs get their own validators)
+uint32_t TeleinfoHttpsHash (const char *pstr_url)
 {
-  uint8_t index, period_hc, period_hp;
+  uint32_t hash = 2166136261UL;
 
-  // check parameters
-  if (day >= TIC_DAY_AFTER) return;
-  if (period >= TIC_PERIOD_MAX) return;
-  
-  // if dealing with EJP calendar and announcing pointe
-  if (((teleinfo_contract_db.type == TIC_C_HIS_EJP) || (teleinfo_contract_db.type == TIC_C_STD_EJP)) && (period == 1))
+  while (*pstr_url != 0) hash = (hash ^ (uint8_t)*pstr_url++) * 16777619UL;
+
+  return hash;
+}
+
+// resolve host part of an URL (worker task)
+bool TeleinfoHttpsResolve (const char *pstr_url)
+{
+  char       *pstr_stop;
+  const char *pstr_host;
+  char        str_host[64];
+  IPAddress   ip_address;
+
+  // extract host from URL
+  pstr_host = strstr_P (pstr_url, PSTR ("://"));
+  if (pstr_host == nullptr) return false;
+  strlcpy (str_host, pstr_host + 3, sizeof (str_host));
+  pstr_stop = strpbrk (str_host, ":/?");
+  if (pstr_stop != nullptr) *pstr_stop = 0;
+
+  return (WiFi.hostByName (str_host, ip_address) == 1);
+}
+
+// run a request, timing each stage (worker task)
+void TeleinfoHttpsRun (tic_https_request &request)
+{
+  bool     is_ok;
+  uint8_t  index, flag;
+  int      size;
+  uint32_t time_start;
+  TeleinfoHttpClient *phttp = nullptr;
+  TeleinfoJsonStream json_stream (teleinfo_https.json);
+  const char *arr_header[] = { "ETag", "Last-Modified" };
+
+  // init result
+  request.valid     = false;
+  request.size      = 0;
+  request.http_code = HTTPC_ERROR_CONNECTION_REFUSED;
+  for (index = 0; index < TIC_HTTPS_STAGE_MAX; index ++) request.arr_stage[index] = 0;
+
+  // get kept-alive connexion
+  flag = arrTeleinfoHttpsFlag[request.endpoint];
+  if (flag & TIC_HTTPS_FLAG_KEEPALIVE) phttp = teleinfo_https.arr_client[request.endpoint];
+
+  // stage 1 : name resolution, skipped if connexion is still alive
+  if ((phttp == nullptr) || !phttp->connected ())
   {
-    // if today before 1h -> set period today 0h-1h
-    if ((day == TIC_DAY_TODAY) && (teleinfo_meter.slot < 2)) for (index = 0; index < 2; index ++) teleinfo_calendar[TIC_DAY_TODAY].arr_slot[index] = period;
+    time_start = millis ();
+    is_ok = TeleinfoHttpsResolve (request.str_url);
+    request.arr_stage[TIC_HTTPS_STAGE_DNS] = TimePassedSince (time_start);
+    if (!is_ok) return;
+  }
 
-    // else if today after 7h -> set period today 7h-24h and tomorrow 0h-1h
-    else if ((day == TIC_DAY_TODAY) && (teleinfo_meter.slot >= 14))
+  // create connexion
+  if (phttp == nullptr) phttp = new TeleinfoHttpClient ();
+  if (phttp == nullptr) return;
+  phttp->setReuse (flag & TIC_HTTPS_FLAG_KEEPALIVE);
+  if (phttp->begin (request.str_url))
+  {
+    // set endpoint timeout and headers
+    phttp->setConnectTimeout (arrTeleinfoHttpsConnect[request.endpoint]);
+    phttp->setTimeout (arrTeleinfoHttpsTimeout[request.endpoint]);
+    if (request.str_auth[0] != 0) phttp->addHeader (F ("Authorization"), request.str_auth, false, true);
+    if (request.parser != nullptr) phttp->addHeader (F ("Accept"), F ("application/json"), false, true);
+      else if (flag & TIC_HTTPS_FLAG_TEXT) phttp->addHeader (F ("Content-Type"), F ("text/plain; charset=utf-8"), false, true);
+      else phttp->addHeader (F ("Content-Type"), F ("application/json"), false, true);
+
+    // conditional GET : send validators of last answer and collect new ones
+    if (!request.post)
     {
-      for (index = 14; index < TIC_DAY_SLOT_MAX; index ++) teleinfo_calendar[TIC_DAY_TODAY].arr_slot[index] = period;
-      for (index = 0; index < 2; index ++) teleinfo_calendar[TIC_DAY_TMROW].arr_slot[index] = period;
-      teleinfo_calendar[TIC_DAY_TODAY].level = teleinfo_contract_db.arr_period[period].level;
+      if (request.str_etag[0] != 0) phttp->addHeader (F ("If-None-Match"), request.str_etag, false, true);
+      if (request.str_modified[0] != 0) phttp->addHeader (F ("If-Modified-Since"), request.str_modified, false, true);
+      phttp->collectHeaders (arr_header, 2);
     }
 
-    // else if tomorrow before 1h -> set period today 0h-1h
-    else if ((day == TIC_DAY_TMROW) && (teleinfo_meter.slot < 2)) for (index = 0; index < 2; index ++) teleinfo_calendar[TIC_DAY_TODAY].arr_slot[index] = period;
+    // stage 2 : TCP connexion and TLS handshake (immediate if connexion is kept alive)
+    time_start = millis ();
+    is_ok = phttp->Connect ();
+    request.arr_stage[TIC_HTTPS_STAGE_CONNECT] = TimePassedSince (time_start);
 
-    // else if tomorrow after 8h -> set period tomorrow 7h-24h and day after 0h-1h
-    else if ((day == TIC_DAY_TMROW) && (teleinfo_meter.slot >= 16))
-    {
-      for (index = 14; index < TIC_DAY_SLOT_MAX; index ++) teleinfo_calendar[TIC_DAY_TMROW].arr_slot[index] = period;
-      for (index = 0; index < 2; index ++) teleinfo_calendar[TIC_DAY_AFTER].arr_slot[index] = period;
-      teleinfo_calendar[TIC_DAY_TMROW].level = teleinfo_contract_db.arr_period[period].level;
-    }
-  }
+    // stage 3 : request and headers
+    time_start = millis ();
+    if (!is_ok) request.http_code = HTTPC_ERROR_CONNECTION_REFUSED;
+      else if (request.post && (request.pstr_body != nullptr)) request.http_code = phttp->POST ((uint8_t*)request.pstr_body, strlen (request.pstr_body));
+      else if (request.post) request.http_code = phttp->POST (nullptr, 0);
+      else request.http_code = phttp->GET ();
+    request.arr_stage[TIC_HTTPS_STAGE_REQUEST] = TimePassedSince (time_start);
 
-  // check if default Tempo calendar should be applied
-  else if (((teleinfo_contract_db.type == TIC_C_HIS_TEMPO) || (teleinfo_contract_db.type == TIC_C_STD_TEMPO)) && (period >= 2))
-  {
-    // calculate HC and HP periods
-    period_hc = period - (period % 2);
-    period_hp = period_hc + 1;
+    // data unchanged since last answer : validators are kept
+    if (request.http_code == HTTP_CODE_NOT_MODIFIED) request.valid = true;
 
-    // if today before 6h -> set period today 0h-6h hc
-    if ((day == TIC_DAY_TODAY) &&  (teleinfo_meter.slot < 12)) for (index = 0; index < 12; index ++) teleinfo_calendar[TIC_DAY_TODAY].arr_slot[index] = period_hc;
+    // answer without parser : any 2xx code is a success
+    else if (request.parser == nullptr) request.valid = (request.http_code >= HTTP_CODE_OK) && (request.http_code < HTTP_CODE_MULTIPLE_CHOICES);
 
-    // else if today after 6h -> set period today 6h-22h hp, today 22h-24h hc and tomorrow 0h-6h hc
-    else if ((day == TIC_DAY_TODAY) &&  (teleinfo_meter.slot >= 12))
+    // stage 4 : body reception, streamed thru JSON parser without buffering
+    else if ((request.http_code == HTTP_CODE_OK) || (request.http_code == HTTP_CODE_MOVED_PERMANENTLY))
     {
-      for (index = 12; index < 44; index ++) teleinfo_calendar[TIC_DAY_TODAY].arr_slot[index] = period_hp;
-      for (index = 44; index < TIC_DAY_SLOT_MAX; index ++) teleinfo_calendar[TIC_DAY_TODAY].arr_slot[index] = period_hc;
-      for (index = 0; index < 12; index ++) teleinfo_calendar[TIC_DAY_TMROW].arr_slot[index] = period_hc;
-      teleinfo_calendar[TIC_DAY_TODAY].level = teleinfo_contract_db.arr_period[period].level;
+      TeleinfoJsonInit (teleinfo_https.json, request.parser);
+      time_start = millis ();
+      size = phttp->writeToStream (&json_stream);
+      request.arr_stage[TIC_HTTPS_STAGE_BODY] = TimePassedSince (time_start);
+      if (size > 0) request.size = (uint32_t)size;
+      request.valid = (size > 0) && TeleinfoJsonIsComplete (teleinfo_https.json);
+
+      // update validators
+      strlcpy (request.str_etag, phttp->header ("ETag").c_str (), TIC_HTTPS_VALIDATOR_SIZE);
+      strlcpy (request.str_modified, phttp->header ("Last-Modified").c_str (), TIC_HTTPS_VALIDATOR_SIZE);
     }
 
-    // else if tomorrow before 6h -> set period today 0h-6h hc
-    else if ((day == TIC_DAY_TMROW) &&  (teleinfo_meter.slot < 12)) for (index = 0; index < 12; index ++) teleinfo_calendar[TIC_DAY_TODAY].arr_slot[index] = period_hc;
+    // end request (connexion stays open if kept alive)
+    phttp->end ();
+  }
 
-    // else if tomorrow after 8h -> set period tomorrow 6h-22h hp, tomorrow 22h-24h hc and day after 0h-6h hc
-    else if ((day == TIC_DAY_TMROW) &&  (teleinfo_meter.slot >= 16))
+  // keep connexion for next request, unless it failed
+  if ((flag & TIC_HTTPS_FLAG_KEEPALIVE) && (request.http_code > 0)) teleinfo_https.arr_client[request.endpoint] = phttp;
+  else
+  {
+    teleinfo_https.arr_client[request.endpoint] = nullptr;
+    delete phttp;
+  }
+}
+
+// worker task, running queued LAN requests first, then others in arrival order
+void TeleinfoHttpsTask (void *pvParameters)
+{
+  bool    is_lan, oldest_lan;
+  uint8_t index, oldest;
+
+  while (true)
+  {
+    // wait for a request to be queued
+    ulTaskNotifyTake (pdTRUE, portMAX_DELAY);
+
+    // loop till all queued requests are done
+    do
     {
-      for (index = 12; index < 44; index ++) teleinfo_calendar[TIC_DAY_TMROW].arr_slot[index] = period_hp;
-      for (index = 44; index < TIC_DAY_SLOT_MAX; index ++) teleinfo_calendar[TIC_DAY_TMROW].arr_slot[index] = period_hc;
-      for (index = 0; index < 12; index ++) teleinfo_calendar[TIC_DAY_AFTER].arr_slot[index] = period_hc;
-      teleinfo_calendar[TIC_DAY_TMROW].level = teleinfo_contract_db.arr_period[period].level;
-    }
+      // look for oldest queued request, LAN requests first so they do not wait behind TLS requests
+      oldest = UINT8_MAX;
+      oldest_lan = false;
+      for (index = 0; index < TIC_HTTPS_QUEUE; index ++)
+        if (__atomic_load_n (&teleinfo_https.arr_request[index].state, __ATOMIC_ACQUIRE) == TIC_HTTPS_QUEUED)
+        {
+          is_lan = (arrTeleinfoHttpsFlag[teleinfo_https.arr_request[index].endpoint] & TIC_HTTPS_FLAG_LAN);
+          if ((oldest == UINT8_MAX) || (is_lan && !oldest_lan) || ((is_lan == oldest_lan) && (TimeDifference (teleinfo_https.arr_request[index].time_queued, teleinfo_https.arr_request[oldest].time_queued) > 0)))
+          {
+            oldest = index;
+            oldest_lan = is_lan;
+          }
+        }
+
+      // run it and hand it back to main loop
+      if (oldest != UINT8_MAX)
+      {
+        __atomic_store_n (&teleinfo_https.arr_request[oldest].state, TIC_HTTPS_RUNNING, __ATOMIC_RELEASE);
+        TeleinfoHttpsRun (teleinfo_https.arr_request[oldest]);
+        __atomic_store_n (&teleinfo_https.arr_request[oldest].state, TIC_HTTPS_DONE, __ATOMIC_RELEASE);
+      }
+    } while (oldest != UINT8_MAX);
   }
 }
 
-void TeleinfoCalendarSetDemain (const char* pstr_color)
+// start worker task
+bool TeleinfoHttpsStart ()
 {
-  uint8_t level, period;
+  BaseType_t core;
 
-  // check parameters
-  if (pstr_color == nullptr) return;
-  if (!RtcTime.valid) return;
+  // if worker task already running, ignore
+  if (teleinfo_https.task != nullptr) return true;
 
-  // detect color
-  level = TeleinfoContractDetectPeriodLevel (pstr_color);
-  if (level == TIC_LEVEL_NONE) return;
+  // on dual core, pin worker task on the core not running main loop
+#ifdef CONFIG_FREERTOS_UNICORE
+  core = tskNO_AFFINITY;
+#else
+  core = (xPortGetCoreID () == 0) ? 1 : 0;
+#endif    // CONFIG_FREERTOS_UNICORE
 
-  // check if contract is compatible, calculate period accordingly
-  if (teleinfo_contract_db.type == TIC_C_HIS_TEMPO) period = 2 * level - 2;
-    else if (teleinfo_contract_db.type == TIC_C_HIS_EJP) period = level / 3;
-    else return;
+  // create worker task
+  if (xTaskCreatePinnedToCore (TeleinfoHttpsTask, "TICS", TIC_HTTPS_TASK_STACK, nullptr, 1, &teleinfo_https.task, core) == pdPASS) AddLog (LOG_LEVEL_INFO, PSTR ("TIC: HTTPS task started (queue %u)"), TIC_HTTPS_QUEUE);
+    else teleinfo_https.task = nullptr;
 
-  // set period
-  TeleinfoCalendarSetDailyCalendar (TIC_DAY_TMROW, period);
+  return (teleinfo_https.task != nullptr);
 }
 
-// calendar midnight shift
-void TeleinfoEnergyCalendarMidnight ()
+// check if a request is queued or running for an endpoint
+bool TeleinfoHttpsIsPending (const uint8_t endpoint)
 {
-  char str_text[16];
+  uint8_t index;
 
-  // shift tomorrow and day after tomorrow
-  teleinfo_calendar[TIC_DAY_TODAY] = teleinfo_calendar[TIC_DAY_TMROW];
-  teleinfo_calendar[TIC_DAY_TMROW] = teleinfo_calendar[TIC_DAY_AFTER];
+  for (index = 0; index < TIC_HTTPS_QUEUE; index ++)
+    if ((teleinfo_https.arr_request[index].endpoint == endpoint) && (__atomic_load_n (&teleinfo_https.arr_request[index].state, __ATOMIC_ACQUIRE) != TIC_HTTPS_IDLE)) return true;
 
-  // init day after
-  TeleinfoCalendarReset (TIC_DAY_AFTER);
-  teleinfo_calendar[TIC_DAY_AFTER].date = TeleinfoCalendarGetNextDay (teleinfo_calendar[TIC_DAY_TMROW].date);
-  TeleinfoDriverCalendarGetDate (TIC_DAY_AFTER, str_text, sizeof (str_text));
-  AddLog (LOG_LEVEL_INFO, PSTR ("CAL: %u %s"), teleinfo_calendar[TIC_DAY_AFTER].date / 100, str_text);
+  return false;
 }
 
-// set calendar current pointe start
-void TeleinfoCalendarPointeBegin (const uint8_t index, const char *pstr_horodatage)
+// retry delay of an endpoint : exponential backoff on consecutive failures, with +/-25% jitter (sec.)
+uint32_t TeleinfoHttpsRetryDelay (const uint8_t endpoint, const uint32_t delay)
 {
+  uint8_t  level;
+  uint32_t result, jitter;
+
   // check parameter
-  if (!RtcTime.valid) return;
-  if (index >= TIC_POINTE_MAX) return;
-  if (pstr_horodatage == nullptr) return;
-  if (strlen (pstr_horodatage) < 12) return;
+  if (endpoint >= TIC_HTTPS_EP_MAX) return delay;
 
-  // set index, day and slot
-  teleinfo_message.arr_pointe[index].start = TeleinfoCalendarGetDay (pstr_horodatage, true);
+  // double delay for each consecutive failure
+  level = teleinfo_https.arr_endpoint[endpoint].failure;
+  if (level > 0) level--;
+  result = delay << min (level, (uint8_t)TIC_HTTPS_BACKOFF_MAX);
+
+  // spread retries to avoid simultaneous requests
+  jitter = result / 4;
+  if (jitter > 0) result = result - jitter + esp_random () % (2 * jitter + 1);
+
+  return result;
 }
 
-// set calendar current pointe stop
-void TeleinfoCalendarPointeEnd (const uint8_t index, const char *pstr_horodatage)
+// set quota announced by an endpoint
+void TeleinfoHttpsSetQuota (const uint8_t endpoint, const uint16_t left, const uint16_t total)
 {
-  // check parameter
-  if (!RtcTime.valid) return;
-  if (index >= TIC_POINTE_MAX) return;
-  if (pstr_horodatage == nullptr) return;
-  if (strlen (pstr_horodatage) < 12) return;
+  if (endpoint >= TIC_HTTPS_EP_MAX) return;
 
-  // check if date is within known days
-  teleinfo_message.arr_pointe[index].stop = TeleinfoCalendarGetDay (pstr_horodatage, true);
+  teleinfo_https.arr_endpoint[endpoint].quota_left  = left;
+  teleinfo_https.arr_endpoint[endpoint].quota_total = total;
 }
 
-// set default profile if not defined
-void TeleinfoCalendarDefaultProfile (char *pstr_donnee)
+// queue a request : parser is called for each JSON value from worker task, callback is called from main loop once done
+bool TeleinfoHttpsQueue (const uint8_t endpoint, const char *pstr_url, const char *pstr_auth, const bool post, const char *pstr_body, TeleinfoJsonCallback parser, TeleinfoHttpsCallback callback)
 {
-  bool    update;
-  uint8_t day, start, slot, period, level;
-  uint8_t arr_slot[TIC_DAY_SLOT_MAX];
-  char    str_text[16];
+  uint8_t index;
+  tic_https_request  *prequest;
+  tic_https_endpoint *pendpoint;
 
   // check parameters
-  if (!RtcTime.valid) return;
-  if (pstr_donnee == nullptr) return;
-  if (strlen (pstr_donnee) < 8) return;
+  if ((endpoint >= TIC_HTTPS_EP_MAX) || (pstr_url == nullptr)) return false;
+  if (strlen (pstr_url) >= TIC_HTTPS_URL_SIZE) return false;
 
-  // check if a day calendar needs to be updated
-  update = false;
-  for (day = TIC_DAY_TODAY; day < TIC_DAY_MAX; day ++) update |= (teleinfo_calendar[day].level == TIC_LEVEL_NONE);
-  if (!update) return;
+  // check worker task
+  if (!TeleinfoHttpsStart ()) return false;
 
-  // loop thru segments to load daily calendar
-  level = TIC_LEVEL_NONE;
-  for (slot = 0; slot < TIC_DAY_SLOT_MAX; slot ++) arr_slot[slot] = UINT8_MAX;
-  while ((strlen (pstr_donnee) >= 8) && isdigit (pstr_donnee[0]))
+  // look for a free slot
+  for (index = 0; index < TIC_HTTPS_QUEUE; index ++) if (__atomic_load_n (&teleinfo_https.arr_request[index].state, __ATOMIC_ACQUIRE) == TIC_HTTPS_IDLE) break;
+  if (index == TIC_HTTPS_QUEUE)
   {
-    // extract data and populate slot
-    strlcpy (str_text, pstr_donnee, 5);
-    start = TeleinfoCalendarGetSlot (str_text, teleinfo_config.cal_hexa);
-    strlcpy (str_text, pstr_donnee + 7, 2);
-    period = (uint8_t)atoi (str_text) - 1;
-    level = max (level, teleinfo_contract_db.arr_period[period].level);
-    for (slot = start; slot < TIC_DAY_SLOT_MAX; slot ++) arr_slot[slot] = period;
-
-    // increment to next segment
-    pstr_donnee += 8;
-    if (pstr_donnee[0] == ' ') pstr_donnee ++;
+    AddLog (LOG_LEVEL_INFO, PSTR ("TIC: HTTPS queue full"));
+    return false;
+  }
+  prequest  = &teleinfo_https.arr_request[index];
+  pendpoint = &teleinfo_https.arr_endpoint[endpoint];
+
+  // set request
+  prequest->endpoint    = endpoint;
+  prequest->post        = post;
+  prequest->parser      = parser;
+  prequest->callback    = callback;
+  prequest->time_queued = millis ();
+  prequest->url_hash    = TeleinfoHttpsHash (pstr_url);
+  strlcpy (prequest->str_url, pstr_url, TIC_HTTPS_URL_SIZE);
+  if (pstr_auth != nullptr) strlcpy (prequest->str_auth, pstr_auth, TIC_HTTPS_AUTH_SIZE);
+    else prequest->str_auth[0] = 0;
+
+  // set POST body
+  prequest->pstr_body = nullptr;
+  if (post && (pstr_body != nullptr)) prequest->pstr_body = strdup (pstr_body);
+
+  // set validators if they belong to same URL
+  if (prequest->url_hash == pendpoint->url_hash)
+  {
+    strcpy (prequest->str_etag, pendpoint->str_etag);
+    strcpy (prequest->str_modified, pendpoint->str_modified);
   }
+  else prequest->str_etag[0] = prequest->str_modified[0] = 0;
 
-  // loop thru days : if day's calendar not set, set default one
-  for (day = TIC_DAY_TODAY; day < TIC_DAY_MAX; day ++)
-    if ((teleinfo_calendar[day].level == TIC_LEVEL_NONE) && (level != TIC_LEVEL_NONE))
-    {
-      teleinfo_calendar[day].level = level;
-      for (slot = 0; slot < TIC_DAY_SLOT_MAX; slot ++) 
-        if (teleinfo_calendar[day].arr_slot[slot] < arr_slot[slot]) teleinfo_calendar[day].arr_slot[slot] = arr_slot[slot];
-      TeleinfoDriverCalendarGetDate (day, str_text, sizeof (str_text));
-      AddLog (LOG_LEVEL_INFO, PSTR ("CAL: default calendar applied to %s"), str_text);
-    }
+  // hand it to worker task
+  __atomic_store_n (&prequest->state, TIC_HTTPS_QUEUED, __ATOMIC_RELEASE);
+  xTaskNotifyGive (teleinfo_https.task);
+
+  return true;
 }
 
-// set pointe profile
-void TeleinfoCalendarPointeProfile (const char *pstr_donnee)
+// dispatch completed requests to their callback (main loop)
+void TeleinfoHttpsDispatch ()
 {
-  uint8_t  day, start, slot, period, index, pointe;
-  uint32_t date;
-  uint8_t  arr_slot[TIC_DAY_SLOT_MAX];
-  char     str_value[8];
+  uint8_t  index, stage;
+  uint32_t latency;
+  char     str_name[16];
+  tic_https_request  *prequest;
+  tic_https_endpoint *pendpoint;
+
+  // loop thru done requests
+  for (index = 0; index < TIC_HTTPS_QUEUE; index ++)
+  {
+    prequest = &teleinfo_https.arr_request[index];
+    if (__atomic_load_n (&prequest->state, __ATOMIC_ACQUIRE) != TIC_HTTPS_DONE) continue;
+    pendpoint = &teleinfo_https.arr_endpoint[prequest->endpoint];
 
-  // check parameters
-  if (!RtcTime.valid) return;
-  if (pstr_donnee == nullptr) return;
-  if (strlen (pstr_donnee) < 8) return;
+    // update stage statistics
+    latency = 0;
+    for (stage = 0; stage < TIC_HTTPS_STAGE_MAX; stage ++)
+    {
+      teleinfo_https.arr_max[stage] = max (teleinfo_https.arr_max[stage], prequest->arr_stage[stage]);
+      latency += prequest->arr_stage[stage];
+    }
 
-  // detect pointe to apply
-  pointe = UINT8_MAX;
-  date   = UINT32_MAX;
-  for (index = 0; index < TIC_POINTE_MAX; index ++) 
-    if ((teleinfo_message.arr_pointe[index].start > teleinfo_meter.date) && (teleinfo_message.arr_pointe[index].start < date))
+    // update endpoint statistics
+    pendpoint->nb_request++;
+    pendpoint->latency_last   = latency;
+    pendpoint->latency_peak   = max (pendpoint->latency_peak, latency);
+    pendpoint->latency_total += latency;
+    if (!prequest->valid)
     {
-      date   = teleinfo_message.arr_pointe[index].start;
-      pointe = index;
+      pendpoint->nb_error++;
+      if (pendpoint->failure < UINT8_MAX) pendpoint->failure++;
     }
-  if (pointe >= TIC_POINTE_MAX) return;
-  if (teleinfo_message.arr_pointe[pointe].stop == 0) return;
+    else pendpoint->failure = 0;
 
-  // loop thru segments to load daily calendar
-  for (slot = 0; slot < TIC_DAY_SLOT_MAX; slot ++) arr_slot[slot] = UINT8_MAX;
-  while ((strlen (pstr_donnee) >= 8) && isdigit (pstr_donnee[0]))
+    // update endpoint validators
+    if (prequest->http_code == HTTP_CODE_NOT_MODIFIED) pendpoint->nb_unchanged++;
+    else if (prequest->valid && !prequest->post)
+    {
+      pendpoint->url_hash = prequest->url_hash;
+      strcpy (pendpoint->str_etag, prequest->str_etag);
+      strcpy (pendpoint->str_modified, prequest->str_modified);
+    }
+
+    // log
+    AddLog (LOG_LEVEL_DEBUG, PSTR ("TIC: HTTPS %s [%d] %u bytes, dns %u ms, connect+tls %u ms, request %u ms, body %u ms, total %d ms"), GetTextIndexed (str_name, sizeof (str_name), prequest->endpoint, kTeleinfoHttpsEndpoint), prequest->http_code, prequest->size, prequest->arr_stage[TIC_HTTPS_STAGE_DNS], prequest->arr_stage[TIC_HTTPS_STAGE_CONNECT], prequest->arr_stage[TIC_HTTPS_STAGE_REQUEST], prequest->arr_stage[TIC_HTTPS_STAGE_BODY], TimePassedSince (prequest->time_queued));
+
+    // declare web access and call owner
+    TeleinfoDriverWebDeclare (arrTeleinfoHttpsWebType[prequest->endpoint]);
+    if (prequest->callback != nullptr) prequest->callback (*prequest);
+
+    // free POST body and release slot
+    free (prequest->pstr_body);
+    prequest->pstr_body = nullptr;
+    __atomic_store_n (&prequest->state, TIC_HTTPS_IDLE, __ATOMIC_RELEASE);
+  }
+}
+
+// reset endpoint statistics
+void TeleinfoHttpsResetStats ()
+{
+  uint8_t index;
+
+  for (index = 0; index < TIC_HTTPS_STAGE_MAX; index ++) teleinfo_https.arr_max[index] = 0;
+  for (index = 0; index < TIC_HTTPS_EP_MAX; index ++)
   {
-    // extract data and populate slot
-    strlcpy (str_value, pstr_donnee, 5);
-    start = TeleinfoCalendarGetSlot (str_value, teleinfo_config.cal_hexa);
-    strlcpy (str_value, pstr_donnee + 7, 2);
-    period = (uint8_t)atoi (str_value) - 1;
-    for (slot = start; slot < TIC_DAY_SLOT_MAX; slot ++) arr_slot[slot] = period;
+    teleinfo_https.arr_endpoint[index].nb_request    = 0;
+    teleinfo_https.arr_endpoint[index].nb_error      = 0;
+    teleinfo_https.arr_endpoint[index].nb_unchanged  = 0;
+    teleinfo_https.arr_endpoint[index].latency_peak  = 0;
+    teleinfo_https.arr_endpoint[index].latency_total = 0;
+  }
+}
 
-    // increment to next segment
-    pstr_donnee += 8;
-    if (pstr_donnee[0] == ' ') pstr_donnee ++;
+// append endpoint statistics to JSON : ,"Https":{"token":{...},...}
+void TeleinfoHttpsAppendJSON ()
+{
+  uint8_t  index, stage;
+  uint32_t average;
+  char     str_name[16];
+  tic_https_endpoint *pendpoint;
+
+  // stage maximum durations
+  ResponseAppend_P (PSTR (",\"Https\":{\"max\":{"));
+  for (stage = 0; stage < TIC_HTTPS_STAGE_MAX; stage ++)
+  {
+    if (stage > 0) ResponseAppend_P (PSTR (","));
+    ResponseAppend_P (PSTR ("\"%s\":%u"), GetTextIndexed (str_name, sizeof (str_name), stage, kTeleinfoHttpsStage), teleinfo_https.arr_max[stage]);
   }
+  ResponseAppend_P (PSTR ("}"));
 
-  // loop thru days to update their slots with current pointe period
-  for (day = TIC_DAY_TODAY; day < TIC_DAY_MAX; day ++)
-    for (slot = 0; slot < TIC_DAY_SLOT_MAX; slot ++)
-    {
-      date = teleinfo_calendar[day].date + slot;
-      if ((date >= teleinfo_message.arr_pointe[pointe].start) && (date < teleinfo_message.arr_pointe[pointe].stop) && (arr_slot[slot] != UINT8_MAX)) teleinfo_calendar[day].arr_slot[slot] = arr_slot[slot];
-    }
+  // used endpoints
+  for (index = 0; index < TIC_HTTPS_EP_MAX; index ++)
+  {
+    pendpoint = &teleinfo_https.arr_endpoint[index];
+    if (pendpoint->nb_request == 0) continue;
+
+    average = pendpoint->latency_total / pendpoint->nb_request;
+    GetTextIndexed (str_name, sizeof (str_name), index, kTeleinfoHttpsEndpoint);
+    ResponseAppend_P (PSTR (",\"%s\":{\"req\":%u,\"err\":%u,\"304\":%u,\"fail\":%u,\"last\":%u,\"avg\":%u,\"peak\":%u"), str_name, pendpoint->nb_request, pendpoint->nb_error, pendpoint->nb_unchanged, pendpoint->failure, pendpoint->latency_last, average, pendpoint->latency_peak);
+    if (pendpoint->quota_total > 0) ResponseAppend_P (PSTR (",\"quota\":%u,\"total\":%u"), pendpoint->quota_left, pendpoint->quota_total);
+    ResponseAppend_P (PSTR ("}"));
+  }
+  ResponseAppend_P (PSTR ("}"));
 }
 
+#endif    // ESP32
+
 /***************************************\
  *              Callback
 \***************************************/
@@ -1422,9 +3304,10 @@ void TeleinfoDriverInit ()
   if (Settings->web_refresh == HTTP_REFRESH_TIME) Settings->web_refresh = TIC_WEB_REFRESH;
 
   // init publication flags
-  teleinfo_meter.json.data = false;
-  teleinfo_meter.json.live = false;
-  teleinfo_meter.json.tic  = false;
+  teleinfo_meter.json.data  = false;
+  teleinfo_meter.json.live  = false;
+  teleinfo_meter.json.tic   = false;
+  teleinfo_meter.json.delta = false;
 
   // meter timestamps
   for (index = 0; index < TIC_WEB_MAX; index ++) teleinfo_meter.arr_web_ts[index] = 0;
@@ -1432,9 +3315,15 @@ void TeleinfoDriverInit ()
   // reset contract data
   TeleinfoContractInit ();
 
-  // load configuration and data
+  // load configuration and data (on Winky wake-up, data are resumed from RTC memory)
   TeleinfoDriverLoadSettings ();
+#ifdef USE_TELEINFO_WINKY
+  if (!TeleinfoWinkyResumeLoad ()) TeleinfoDriverLoadData ();
+#else
   TeleinfoDriverLoadData ();
+#endif    // USE_TELEINFO_WINKY
+  TeleinfoMqttQueueLoad ();
+  TeleinfoSchedulerRegister (TIC_PRODUCER_DRIVER, TeleinfoDriverPubPending, TeleinfoDriverPubPublish);
   AddLog (LOG_LEVEL_DEBUG, PSTR ("TIC: Configuration loaded, contract %s, %u periods"), teleinfo_contract_db.str_code, teleinfo_contract_db.period_qty);
 
 #ifdef USE_LIGHT
@@ -1452,62 +3341,146 @@ void TeleinfoDriverSaveBeforeRestart ()
   // if graph unit have been changed, save configuration
   TeleinfoDriverSaveData ();
   TeleinfoDriverSaveSettings ();
+
+#ifdef USE_UFILESYS
+  // write MQTT records batch and ring header
+  TeleinfoMqttBatchWrite ();
+  TeleinfoMqttQueueFlush (true);
+#endif    // USE_UFILESYS
 //  SettingsSave (0);
 
   // update energy counters
   EnergyUpdateToday ();
 }
 
-// Handling of received teleinfo data, called 20x / second
+// Handling of received characters
 //     Message :    0x02 = start      Ox03 = stop        0x04 = reset 
 //     Line    :    0x0A = start      0x0D = stop        0x09 = separator
-void TeleinfoDriverEvery50ms ()
+void TeleinfoDriverReceive (const char* pstr_data, const uint16_t size, const uint16_t position)
 {
   char     character;
-  size_t   index, buffer;
-  char     str_character[2];
-  char     str_buffer[TIC_RX_BUFFER];
-
-  // check serial port
-  if (!TeleinfoEnergySerialIsStarted ()) return;
+  uint16_t index;
+#ifdef ESP32
+  uint32_t time_stop;
+#endif    // ESP32
 
-  // read pending data
-  buffer = 0;
-  if (teleinfo_serial->available ()) buffer = teleinfo_serial->read (str_buffer, TIC_RX_BUFFER);
+  // check parameters
+  if ((pstr_data == nullptr) || (size == 0)) return;
 
-  // for ESP8266, wait for network to be up before handling reception
-  if (TasmotaGlobal.global_state.network_down) return;
+#ifdef USE_TELEINFO_TCP
+  // hand received data to TCP stream in one block
+  TeleinfoTCPSend (pstr_data, size);
+#endif  // USE_TELEINFO_TCP
 
-  // loop thru reception buffer
-  for (index = 0; index < buffer; index++)
+  // loop thru received data
+  for (index = 0; index < size; index++)
   {
     // read character
-    character = str_buffer[index];
+    character = pstr_data[index];
 
-#ifdef USE_TELEINFO_TCP
-    // send character thru TCP stream
-    TeleinfoTCPSend (character);
-#endif  // USE_TELEINFO_TCP
+    // while speed is not confirmed, character is only used for detection
+    if (teleinfo_detect.active)
+    {
+      TeleinfoDetectCharacter (character);
+      continue;
+    }
 
     // analyse character
     switch (character)
     {
       case 0x04: TeleinfoReceptionMessageReset (); break;       // reset
       case 0x02: TeleinfoReceptionMessageStart (); break;       // message start
-      case 0x03: TeleinfoReceptionMessageStop ();  break;       // message stop
+      case 0x03: TeleinfoReceptionMessageStop ();               // message stop
+#ifdef ESP32
+                 // latency between stop reception by reader task and end of message handling
+                 time_stop = TeleinfoRingStopTime (position + index);
+                 if (time_stop != 0) TeleinfoStatsUpdate (TIC_STAGE_LATENCY, time_stop);
+#endif    // ESP32
+                 break;
       case 0x0A: TeleinfoReceptionLineStart ();    break;       // line start
       case 0x0D: TeleinfoReceptionLineStop ();     break;       // line stop
       default:
         // if needed, set line separator
         if ((teleinfo_meter.nb_message == 0) && (character == 0x09)) teleinfo_meter.sep_line = 0x09;
 
-        // append separator to line
-        str_character[0] = character;
-        str_character[1] = 0;
-        strlcat (teleinfo_message.str_line, str_character, sizeof (teleinfo_message.str_line));
+        // append character to line
+        TeleinfoReceptionLineAppend (character);
         break;
     }
   }
+}
+
+// Handling of received teleinfo data, called 20x / second
+//   on ESP32, data are read from reception ring fed by reader task
+//   on ESP8266, data are read directly from serial port
+// Parsing stays in main loop : parsed data are read without lock by web, MQTT and JSON callbacks
+//   running in main loop, reader task only needs to keep UART drained (parsing is under 1µs per line)
+void TeleinfoDriverEvery50ms ()
+{
+  uint16_t buffer;
+  uint32_t time_start;
+#ifdef ESP32
+  uint16_t head, tail, index, size;
+#else
+  char     str_buffer[TIC_RX_BUFFER];
+#endif    // ESP32
+
+  // check serial port
+  if (!TeleinfoEnergySerialIsStarted ()) return;
+
+#ifdef ESP32
+  // if speed change is waiting for reader task pause, apply it once acknowledged
+  if (TeleinfoEnergySerialPendingSpeed ()) return;
+
+  // if reader task could not be started, feed reception ring from main loop
+  if (teleinfo_ring.task == nullptr) TeleinfoRingFeed ();
+
+  // get pending data from reception ring
+  head = __atomic_load_n (&teleinfo_ring.head, __ATOMIC_ACQUIRE);
+  tail = teleinfo_ring.tail;
+  buffer = head - tail;
+
+  // wait for network to be up before handling reception
+  if (TasmotaGlobal.global_state.network_down)
+  {
+    __atomic_store_n (&teleinfo_ring.tail, head, __ATOMIC_RELEASE);
+    return;
+  }
+
+  // handle received data (ring may wrap once)
+  time_start = micros ();
+  index = tail & (TIC_RING_SIZE - 1);
+  size  = min (buffer, (uint16_t)(TIC_RING_SIZE - index));
+  TeleinfoDriverReceive (teleinfo_ring.arr_data + index, size, tail);
+  TeleinfoDriverReceive (teleinfo_ring.arr_data, buffer - size, tail + size);
+
+  // release ring space
+  __atomic_store_n (&teleinfo_ring.tail, head, __ATOMIC_RELEASE);
+
+#else       // ESP8266
+  // read pending data
+  buffer = 0;
+  if (teleinfo_serial->available ()) buffer = teleinfo_serial->read (str_buffer, TIC_RX_BUFFER);
+
+  // account UART buffer overrun (received data lost)
+  if (teleinfo_serial->overflow ()) teleinfo_stats.nb_overrun++;
+
+  // wait for network to be up before handling reception
+  if (TasmotaGlobal.global_state.network_down) return;
+
+  // handle received data
+  time_start = micros ();
+  TeleinfoDriverReceive (str_buffer, buffer, 0);
+#endif      // ESP32 & ESP8266
+
+  // account received bytes
+  teleinfo_stats.nb_byte += buffer;
+
+  // if speed under test is rejected, switch to next one
+  TeleinfoDetectNextSpeed ();
+
+  // update reception statistics
+  if (buffer > 0) TeleinfoStatsUpdate (TIC_STAGE_RX, time_start);
 
 #ifdef USE_LIGHT
   // update LED status
@@ -1518,29 +3491,24 @@ void TeleinfoDriverEvery50ms ()
 // called 4 times per second
 void TeleinfoDriverEvery250ms ()
 {
-  // if meter not ready, ignore
-  if (!TeleinfoDriverMeterReady ()) return;
+#ifdef ESP32
+  // dispatch completed HTTPS requests
+  TeleinfoHttpsDispatch ();
+#endif    // ESP32
+
+  // replay MQTT messages queued during broker outage
+  TeleinfoMqttQueueEvery250ms ();
 
   // check if TIC or LIVE topic should be published (according to frame skip ratio)
-  if ((teleinfo_config.tic || teleinfo_config.live) && (teleinfo_meter.nb_message >= teleinfo_meter.nb_skip + (long)teleinfo_config.skip))
+  if (TeleinfoDriverMeterReady () && (teleinfo_config.tic || teleinfo_config.live) && (teleinfo_meter.nb_message >= teleinfo_meter.nb_skip + (long)teleinfo_config.skip))
   {
     teleinfo_meter.nb_skip = teleinfo_meter.nb_message;
     if (teleinfo_config.live) teleinfo_meter.json.live = true;
     if (teleinfo_config.tic)  teleinfo_meter.json.tic  = true;
   }
 
-  // if minimum delay between 2 publications is reached
-  if (TeleinfoDriverWebAllow (TIC_WEB_MQTT))
-  {
-    // if something to publish
-    if (teleinfo_meter.json.live) TeleinfoDriverPublishLive ();
-      else if (teleinfo_meter.json.tic) TeleinfoDriverPublishTic ();
-      else if (teleinfo_meter.json.data) 
-      {
-        TeleinfoDriverTriggerExtension ();
-        TeleinfoDriverJsonPublish ();
-      }
-  }
+  // publish next messages of driver and integrations
+  TeleinfoSchedulerEvery250ms ();
 }
 
 // Handle MQTT teleperiod
@@ -1568,6 +3536,30 @@ void TeleinfoDriverTriggerExtension ()
 #endif  // USE_TELEINFO_INFLUXDB
 }
 
+// contract has changed on the fly : rebuild modules depending on contract
+void TeleinfoDriverContractChange ()
+{
+  // reload history display from new contract files (contract code is only known on next complete message)
+#ifdef USE_TELEINFO_HISTO
+#ifdef USE_UFILESYS
+  TeleinfoHistoContractChange ();
+#endif  // USE_UFILESYS
+#endif  // USE_TELEINFO_HISTO
+
+  // restart homie declaration
+#ifdef USE_TELEINFO_HOMIE
+  TeleinfoHomieRestart ();
+#endif    // USE_TELEINFO_HOMIE
+
+  // restart home assistant auto-discovery
+#ifdef USE_TELEINFO_HASS
+  TeleinfoHomeAssistantRestart ();
+#endif    // USE_TELEINFO_HASS
+
+  // publish new contract
+  teleinfo_meter.json.data = true;
+}
+
 // Handle MQTT teleperiod
 void TeleinfoDriverRemoveEnergySensor ()
 {
@@ -1614,6 +3606,14 @@ void TeleinfoDriverJsonAppend ()
   if (teleinfo_winky.suspend) TeleinfoWinkyAppendSensor ();
 #endif    // USE_TELEINFO_WINKY
 
+  // full publication : every field is published, reset report-by-exception references
+  if (teleinfo_config.policy == TIC_POLICY_DELTA)
+  {
+    teleinfo_delta.nb_full ++;
+    TeleinfoDeltaCommit ((1UL << TIC_DELTA_MAX) - 1);
+    teleinfo_meter.json.delta = false;
+  }
+
   // reset flag and declare publication
   teleinfo_meter.json.data = false;
   TeleinfoDriverWebDeclare (TIC_WEB_MQTT);
@@ -2400,10 +4400,12 @@ void TeleinfoDriverWebSensor ()
 // TIC raw message data
 void TeleinfoDriverWebTicUpdate ()
 {
-  int  index;
+  int  index, count;
   char checksum;
   char str_class[4];
   char str_line[TIC_LINE_SIZE];
+  char str_etiquette[TIC_ETIQUETTE_SIZE];
+  char str_donnee[TIC_DONNEE_SIZE];
 
   // start of data page
   WSContentBegin (200, CT_PLAIN);
@@ -2413,12 +4415,13 @@ void TeleinfoDriverWebTicUpdate ()
   WSContentSend_P (PSTR ("%s"), str_line); 
 
   // loop thru TIC message lines to publish if defined
-  for (index = 0; index < teleinfo_message.index_last; index ++)
+  count = TeleinfoEnergyMessageLineCount ();
+  for (index = 0; index < count; index ++)
   {
-    checksum = teleinfo_message.arr_last[index].checksum;
+    checksum = TeleinfoEnergyMessageGetLine (index, str_etiquette, sizeof (str_etiquette), str_donnee, sizeof (str_donnee));
     if (checksum == 0) strcpy_P (str_class, PSTR ("ko")); else strcpy_P (str_class, PSTR ("ok"));
     if (checksum == 0) checksum = 0x20;
-    sprintf_P (str_line, PSTR ("%s|%s|%s|%c\n"), str_class, teleinfo_message.arr_last[index].str_etiquette, teleinfo_message.arr_last[index].str_donnee, checksum);
+    snprintf_P (str_line, sizeof (str_line), PSTR ("%s|%s|%s|%c\n"), str_class, str_etiquette, str_donnee, checksum);
     WSContentSend_P (PSTR ("%s"), str_line); 
   }
 
@@ -119,6 +119,22 @@
                           Rework of ALERT section to separate volt, load and period
     17/03/2026 - v15.2  - Estimate production excess for CACSI contract
                           Disable baudrate auto-detect, set to 1200 by default (mode Historique)
+    16/10/2026 - v15.6  - Add reception statistics per stage (stats command, JSON answer)
+                          Add HTTPS request statistics per endpoint (ESP32)
+                          Refresh Prometheus cache at message stop
+                          Single pass line tokenizer (running checksum, separators and views in reception buffer)
+                          Perfect hash etiquette lookup per meter mode (one string compare per line)
+                          Lock-free reception ring fed by a reader task on ESP32 (high water, overrun, latency in stats)
+                          Double buffered messages with packed line storage (no more copy of last message)
+                          Add queue command for MQTT store-and-forward queue status
+                          Add MQTT publication statistics per producer
+                          Packed lines store etiquette index and numeric donnee as number
+                          Switch contract on the fly without restart (detection latency in stats)
+                          Delta policy publishes per field deadband changes only (sparse SENSOR)
+                          Non blocking speed detection on first lines (framing and checksum statistics)
+                          Cosphi update in constant time (running sum per power page), debug log only if enabled
+    16/10/2026 - v15.7  - Serial speed change applied on next 50ms tick once reader task pause is acknowledged (no wait)
+                          Larger UART buffer on ESP8266, UART overruns in stats
 
   Configuration :
       Settings->rf_code[15][8] : connexion speed
@@ -163,13 +179,14 @@ bool TeleinfoEnergyHandleCommand ()
     if (XdrvMailbox.data_len == 0) 
     {
       AddLog (LOG_LEVEL_INFO, PSTR ("Paramètres EnergyConfig :"));
-      AddLog (LOG_LEVEL_INFO, PSTR ("  reset          raz des donnees du contrat (nécessite un redémarrage)"));
-      AddLog (LOG_LEVEL_INFO, PSTR ("  historique     mode historique (redémarrage)"));
-      AddLog (LOG_LEVEL_INFO, PSTR ("  standard       mode standard (redémarrage)"));
-      AddLog (LOG_LEVEL_INFO, PSTR ("  speed=%u     vitesse série spécifique (redémarrage)"), teleinfo_config.baudrate);
-      AddLog (LOG_LEVEL_INFO, PSTR ("  detect         detection de la vitesse (redémarrage)"));
+      AddLog (LOG_LEVEL_INFO, PSTR ("  reset          raz des donnees du contrat"));
+      AddLog (LOG_LEVEL_INFO, PSTR ("  historique     mode historique"));
+      AddLog (LOG_LEVEL_INFO, PSTR ("  standard       mode standard"));
+      AddLog (LOG_LEVEL_INFO, PSTR ("  speed=%u     vitesse série spécifique"), teleinfo_config.baudrate);
+      AddLog (LOG_LEVEL_INFO, PSTR ("  detect         detection de la vitesse et du mode"));
       AddLog (LOG_LEVEL_INFO, PSTR ("  display=%u      affichage sur page acceuil [0/1]"), teleinfo_config.display);
-      AddLog (LOG_LEVEL_INFO, PSTR ("  stats          statistiques de reception"));
+      AddLog (LOG_LEVEL_INFO, PSTR ("  stats          statistiques de reception et requetes (stats=0 pour remise a zero)"));
+      AddLog (LOG_LEVEL_INFO, PSTR ("  queue          file d'attente MQTT hors connexion (queue=0 pour la vider)"));
       AddLog (LOG_LEVEL_INFO, PSTR ("  calraz         remise a 0 des plages du calendrier"));
       AddLog (LOG_LEVEL_INFO, PSTR ("  calhexa=%u      format plages horaires Linky [0:decimal/1:hexa]"), teleinfo_config.cal_hexa);
       AddLog (LOG_LEVEL_INFO, PSTR ("  error=%u        affichage compteurs d'erreurs [0/1]"), teleinfo_config.error);
@@ -246,13 +263,15 @@ bool TeleinfoEnergyExecuteCommand (const int command, const long value)
   bool     status;
   bool     to_save   = false;
   uint8_t  day;
-  uint32_t baudrate;
   long     counter;
 
   // handle command
   switch (command)
   {
     case TIC_CMND_STATS:
+      // if asked, reset reception statistics
+      if (value == 0) TeleinfoStatsReset ();
+
       if (teleinfo_meter.nb_line > 0) counter = (long)(teleinfo_meter.nb_error * 10000 / teleinfo_meter.nb_line);
         else counter = 0;
 
@@ -261,40 +280,41 @@ bool TeleinfoEnergyExecuteCommand (const int command, const long value)
       AddLog (LOG_LEVEL_INFO, PSTR (" - Reset      : %d"), teleinfo_meter.nb_reset);
       AddLog (LOG_LEVEL_INFO, PSTR (" - Cosφ conso : %d"), teleinfo_conso.cosphi.quantity);
       AddLog (LOG_LEVEL_INFO, PSTR (" - Cosφ prod  : %d"), teleinfo_prod.cosphi.quantity);
+
+      // publish reception statistics as JSON
+      TeleinfoStatsPublish ();
       break;
 
     case TIC_CMND_HISTORIQUE:
       to_save = true;
       TeleinfoContractChange ();
       TeleinfoSetSpeed (1200);
+      TeleinfoEnergySerialUpdateSpeed (teleinfo_config.baudrate);
       break;
 
     case TIC_CMND_STANDARD:
       to_save = true;
       TeleinfoContractChange ();
       TeleinfoSetSpeed (9600);
+      TeleinfoEnergySerialUpdateSpeed (teleinfo_config.baudrate);
       break;
 
     case TIC_CMND_SPEED:
       to_save = true;
       TeleinfoContractChange ();
       TeleinfoSetSpeed ((uint16_t)value);
+      TeleinfoEnergySerialUpdateSpeed (teleinfo_config.baudrate);
       break;
 
     case TIC_CMND_DETECT:
-      to_save = true;
-      baudrate = TeleinfoEnergyDetectBaudRate ();
-      if (teleinfo_config.baudrate != baudrate)
-      {
-        TeleinfoContractChange ();
-        TeleinfoSetSpeed (baudrate);
-      }
+      TeleinfoDetectStart ();
       break;
 
     case TIC_CMND_RESET:
       to_save = true;
       TeleinfoContractChange ();
       TeleinfoSetSpeed (TIC_DEFAULT_SPEED);
+      TeleinfoEnergySerialUpdateSpeed (teleinfo_config.baudrate);
       break;
 
       case TIC_CMND_NORAW:
@@ -401,6 +421,20 @@ bool TeleinfoEnergyExecuteCommand (const int command, const long value)
       AddLog (LOG_LEVEL_INFO, PSTR ("TIC: relay=%u"), teleinfo_config.relay);
       break;
 
+    case TIC_CMND_QUEUE:
+      // if asked, purge waiting messages
+      if (value == 0) TeleinfoMqttQueuePurge ();
+
+      AddLog (LOG_LEVEL_INFO, PSTR (" - En attente : %u (%u octets / %u)"), teleinfo_mqtt.header.count, teleinfo_mqtt.header.used, TIC_MQTT_QUEUE_SIZE);
+      AddLog (LOG_LEVEL_INFO, PSTR (" - Stockés    : %u"), teleinfo_mqtt.nb_queued);
+      AddLog (LOG_LEVEL_INFO, PSTR (" - Remplacés  : %u"), teleinfo_mqtt.nb_coalesced);
+      AddLog (LOG_LEVEL_INFO, PSTR (" - Perdus     : %u"), teleinfo_mqtt.nb_dropped);
+      AddLog (LOG_LEVEL_INFO, PSTR (" - Rejoués    : %u"), teleinfo_mqtt.nb_replayed);
+
+      // publish queue status as JSON
+      TeleinfoMqttQueuePublish ();
+      break;
+
     case TIC_CMND_DISPLAY:
       status = (value != 0);
       to_save = (teleinfo_config.display != status);
@@ -413,6 +447,139 @@ bool TeleinfoEnergyExecuteCommand (const int command, const long value)
   return to_save;
 }
 
+/*********************************************\
+ *         Reception ring
+\*********************************************/
+
+#ifdef ESP32
+
+// Serial reader task (producer) pushes received bytes in a single producer single consumer ring,
+//   parser (consumer) pops them in main loop. Indexes are free running, head and reader statistics
+//   are only written by reader and tail only by parser, so no lock is needed.
+// On ESP8266 there is no reader task, serial port is read directly by the parser.
+
+// number of bytes waiting in reception ring
+uint16_t TeleinfoRingCount ()
+{
+  return (uint16_t)(__atomic_load_n (&teleinfo_ring.head, __ATOMIC_ACQUIRE) - teleinfo_ring.tail);
+}
+
+// read serial port and push received bytes in reception ring (reader side)
+void TeleinfoRingFeed ()
+{
+  uint8_t  stop_head, stop_tail;
+  uint16_t head, tail, count;
+  size_t   index, size;
+  uint32_t time_now;
+  char     str_buffer[256];
+
+  // check serial port
+  if (teleinfo_serial == nullptr) return;
+
+  // if asked by parser, reset reader statistics
+  if (teleinfo_ring.reset)
+  {
+    teleinfo_ring.high       = TeleinfoRingCount ();
+    teleinfo_ring.nb_overrun = 0;
+    teleinfo_ring.reset      = false;
+  }
+
+  // loop thru pending serial data
+  while (teleinfo_serial->available ())
+  {
+    size = teleinfo_serial->read (str_buffer, sizeof (str_buffer));
+    time_now  = micros ();
+    head      = teleinfo_ring.head;
+    tail      = __atomic_load_n (&teleinfo_ring.tail, __ATOMIC_ACQUIRE);
+    stop_head = teleinfo_ring.stop_head;
+    stop_tail = __atomic_load_n (&teleinfo_ring.stop_tail, __ATOMIC_ACQUIRE);
+
+    // push bytes, dropping the rest if ring is full
+    for (index = 0; index < size; index++)
+    {
+      if ((uint16_t)(head - tail) >= TIC_RING_SIZE)
+      {
+        teleinfo_ring.nb_overrun += size - index;
+        break;
+      }
+
+      // keep message stop timestamp (no latency sample if queue is full)
+      if ((str_buffer[index] == 0x03) && ((uint8_t)(stop_head - stop_tail) < TIC_RING_STOP))
+      {
+        teleinfo_ring.arr_stop[stop_head & (TIC_RING_STOP - 1)].position = head;
+        teleinfo_ring.arr_stop[stop_head & (TIC_RING_STOP - 1)].time     = time_now;
+        stop_head++;
+      }
+
+      teleinfo_ring.arr_data[head & (TIC_RING_SIZE - 1)] = str_buffer[index];
+      head++;
+    }
+
+    // update high water mark and publish new heads
+    count = head - tail;
+    if (count > teleinfo_ring.high) teleinfo_ring.high = count;
+    __atomic_store_n (&teleinfo_ring.stop_head, stop_head, __ATOMIC_RELEASE);
+    __atomic_store_n (&teleinfo_ring.head, head, __ATOMIC_RELEASE);
+  }
+}
+
+// get reception timestamp of message stop at given ring position (parser side), 0 if unknown
+uint32_t TeleinfoRingStopTime (const uint16_t position)
+{
+  uint8_t  stop_head, stop_tail;
+  uint32_t result = 0;
+
+  stop_head = __atomic_load_n (&teleinfo_ring.stop_head, __ATOMIC_ACQUIRE);
+  stop_tail = teleinfo_ring.stop_tail;
+
+  // drop timestamps of older stops (ring flushed), stop at a later one (timestamp not queued)
+  while ((stop_tail != stop_head) && ((int16_t)(teleinfo_ring.arr_stop[stop_tail & (TIC_RING_STOP - 1)].position - position) <= 0))
+  {
+    if (teleinfo_ring.arr_stop[stop_tail & (TIC_RING_STOP - 1)].position == position) result = teleinfo_ring.arr_stop[stop_tail & (TIC_RING_STOP - 1)].time;
+    stop_tail++;
+    if (result != 0) break;
+  }
+
+  // release timestamps queue space
+  __atomic_store_n (&teleinfo_ring.stop_tail, stop_tail, __ATOMIC_RELEASE);
+
+  return result;
+}
+
+// reader task, polling serial port independently of main loop
+void TeleinfoRingTask (void *pvParameters)
+{
+  while (true)
+  {
+    // while serial speed is changed, stop polling UART
+    teleinfo_ring.paused = teleinfo_ring.pause;
+    if (!teleinfo_ring.paused) TeleinfoRingFeed ();
+    vTaskDelay (pdMS_TO_TICKS (TIC_RING_TASK_DELAY));
+  }
+}
+
+// start serial reader task
+void TeleinfoRingStart ()
+{
+  BaseType_t core;
+
+  // if reader task already running, ignore
+  if (teleinfo_ring.task != nullptr) return;
+
+  // on dual core, pin reader task on the core not running main loop
+#ifdef CONFIG_FREERTOS_UNICORE
+  core = tskNO_AFFINITY;
+#else
+  core = (xPortGetCoreID () == 0) ? 1 : 0;
+#endif    // CONFIG_FREERTOS_UNICORE
+
+  // create reader task (if it fails, ring is fed from main loop)
+  if (xTaskCreatePinnedToCore (TeleinfoRingTask, "TIC", TIC_RING_TASK_STACK, nullptr, 1, &teleinfo_ring.task, core) == pdPASS) AddLog (LOG_LEVEL_INFO, PSTR ("TIC: Reader task started (ring %u)"), TIC_RING_SIZE);
+    else teleinfo_ring.task = nullptr;
+}
+
+#endif    // ESP32
+
 /*********************************************\
  *         Serial port management
 \*********************************************/
@@ -457,7 +624,7 @@ void TeleinfoEnergySerialStart ()
   // create and initialise serial port
 #ifdef ESP8266
   // on esp8266, allow GPIO3 AND GPIO13 with hardware fallback to 2
-  teleinfo_serial = new TasmotaSerial (Pin (GPIO_TELEINFO_RX), -1, 2, 0);
+  teleinfo_serial = new TasmotaSerial (Pin (GPIO_TELEINFO_RX), -1, 2, 0, TIC_SERIAL_BUFFER);
 #else
   // on ESP32, hardware serial in native
   teleinfo_serial = new TasmotaSerial (Pin (GPIO_TELEINFO_RX), -1, 1, 0);
@@ -489,8 +656,16 @@ void TeleinfoEnergySerialStart ()
     // flush serial data
     teleinfo_serial->flush();
 
+#ifdef ESP32
+    // start serial reader task
+    TeleinfoRingStart ();
+#endif    // ESP32
+
     // serial init succeeded
     teleinfo_meter.serial = TIC_SERIAL_ACTIVE;
+
+    // check speed on first received lines
+    TeleinfoDetectStart ();
   }
 
   // serial init failed
@@ -500,85 +675,237 @@ void TeleinfoEnergySerialStart ()
   if (!is_ready) AddLog (LOG_LEVEL_INFO, PSTR ("TIC: Serial port init failed"));
 }
 
-uint32_t TeleinfoEnergyDetectBaudRate ()
+// apply serial speed (pending data received at previous speed is dropped)
+void TeleinfoEnergySerialApplySpeed (const uint32_t baudrate)
 {
-  bool     detect = true;
-  uint8_t  pin_rx, level_now, level_prev;
-  uint16_t win_count, win_level;
-  uint32_t baudrate, time_stop;
-  int64_t  ts_low, ts_length, ts_mini, ts_window;
+  // reconfigure serial port
+  teleinfo_serial->begin (baudrate, SERIAL_7E1);
+  teleinfo_serial->flush ();
 
-  // if TinfoRx pin not set, return current baud rate
-  if (!PinUsed (GPIO_TELEINFO_RX)) return teleinfo_config.baudrate;
+  // drop data received at previous speed and wait for next message
+#ifdef ESP32
+  __atomic_store_n (&teleinfo_ring.tail, __atomic_load_n (&teleinfo_ring.head, __ATOMIC_ACQUIRE), __ATOMIC_RELEASE);
+#endif    // ESP32
+  TeleinfoReceptionMessageReset ();
 
-  // set TinfoRx as input
-  pinMode (Pin (GPIO_TELEINFO_RX), INPUT);
+  // meter mode will be identified again from first etiquette
+  teleinfo_contract.mode = TIC_MODE_UNKNOWN;
 
-  // init levels
-  pin_rx     = Pin (GPIO_TELEINFO_RX);
-  level_now  = digitalRead (pin_rx);
-  level_prev = level_now;
+  // log
+  AddLog (LOG_LEVEL_DEBUG, PSTR ("TIC: Port série passé à %u bauds"), baudrate);
+}
 
-  // set maximum detection time to 500ms
-  time_stop = millis () + 500;
+// change serial speed on the fly
+//   on ESP32 with reader task, reader is asked to pause and speed is applied on next 50ms tick once pause is acknowledged
+void TeleinfoEnergySerialUpdateSpeed (const uint32_t baudrate)
+{
+  // check serial port
+  if (!TeleinfoEnergySerialIsStarted ()) return;
 
-  // loop to detect speed
-  ts_low = ts_mini = 0;
-  while (detect)
+#ifdef ESP32
+  // ask reader task to pause, UART is reconfigured once pause is acknowledged
+  //   acknowledge is cleared first, so that only a pause read after this request is taken into account
+  if (teleinfo_ring.task != nullptr)
   {
-    // collect data on a 34 µs window (1/3 of 9600bps bit length)
-    win_count = win_level = 0;
-    ts_window = esp_timer_get_time () + 34;
-    while (ts_window > esp_timer_get_time ())
-    {
-      if (digitalRead (pin_rx) == LOW) win_level++;
-      win_count++;
-    }
+    teleinfo_ring.baudrate = baudrate;
+    teleinfo_ring.paused   = false;
+    teleinfo_ring.pause    = true;
+    return;
+  }
+#endif    // ESP32
 
-    // average data collected on the xindow (to avoid spikes)
-    if (win_level > win_count / 2) level_now = LOW;
-      else level_now = HIGH;
+  // reconfigure serial port now
+  TeleinfoEnergySerialApplySpeed (baudrate);
+}
 
-    // handle switch to low state
-    if ((level_now == LOW) && (level_prev == HIGH)) ts_low = esp_timer_get_time ();
+#ifdef ESP32
 
-    // handle switch to high state
-    else if ((level_now == HIGH) && (level_prev == LOW) && (ts_low > 0))
-    {
-      // calculate low level duration
-      ts_length = esp_timer_get_time () - ts_low;
+// apply speed change waiting for reader task pause (called from parser side)
+//   return true if speed change is still pending
+bool TeleinfoEnergySerialPendingSpeed ()
+{
+  // if no speed change or reader task still running, nothing to do
+  if (teleinfo_ring.baudrate == 0) return false;
+  if (!teleinfo_ring.paused) return true;
 
-      // update duration, dropping first one
-      if (ts_mini == 0) ts_mini = ts_length;
-        else ts_mini = min (ts_mini, ts_length);
+  // reconfigure serial port under paused reader
+  TeleinfoEnergySerialApplySpeed (teleinfo_ring.baudrate);
+  teleinfo_ring.baudrate = 0;
 
-      // update data
-      ts_low = 0;
-    }
+  // resume reader task
+  teleinfo_ring.pause = false;
+
+  return false;
+}
+
+#endif    // ESP32
+
+/*********************************************\
+ *         Speed auto-detection
+\*********************************************/
+
+// Detection is based on framing statistics of received characters :
+//   - at wrong speed, UART delivers characters out of TIC charset
+//   - at right speed, lines checksum are valid (historique or standard method)
+// It is fed by main loop with raw ring characters, so it never blocks
+// and TinfoRx pin stays owned by the UART.
+
+// reset counters of speed under test
+void TeleinfoDetectReset ()
+{
+  teleinfo_detect.next       = false;
+  teleinfo_detect.in_line    = false;
+  teleinfo_detect.nb_invalid = 0;
+  teleinfo_detect.nb_line    = 0;
+  teleinfo_detect.nb_byte    = 0;
+  teleinfo_detect.length     = 0;
+  teleinfo_detect.sum        = 0;
+}
+
+// start speed detection, beginning with current speed
+void TeleinfoDetectStart ()
+{
+  uint8_t index;
+
+  // check serial port
+  if (!TeleinfoEnergySerialIsStarted ()) return;
+
+  // look for current speed in detection list
+  for (index = 0; index < TIC_DETECT_SPEED_MAX; index ++) if (arrTeleinfoDetectSpeed[index] == teleinfo_config.baudrate) break;
+  if (index == TIC_DETECT_SPEED_MAX)
+  {
+    index = 0;
+    TeleinfoEnergySerialUpdateSpeed (arrTeleinfoDetectSpeed[index]);
+  }
+
+  // init detection
+  teleinfo_detect.active     = true;
+  teleinfo_detect.index      = index;
+  teleinfo_detect.nb_try     = 0;
+  teleinfo_detect.time_start = millis ();
+  TeleinfoDetectReset ();
 
-    // else if no capture running, check if time to exit or to yield 
-    else if (ts_low == 0)
+  // log
+  AddLog (LOG_LEVEL_DEBUG, PSTR ("TIC: Détection de la vitesse, essai à %u bauds"), arrTeleinfoDetectSpeed[index]);
+}
+
+// speed under test is confirmed
+void TeleinfoDetectConfirm (const char separator)
+{
+  uint32_t baudrate;
+
+  // end of detection
+  baudrate = arrTeleinfoDetectSpeed[teleinfo_detect.index];
+  teleinfo_detect.active   = false;
+  teleinfo_detect.duration = millis () - teleinfo_detect.time_start;
+
+  // line separator is known from checksum method
+  teleinfo_meter.sep_line = separator;
+
+  // if speed has changed, save it and force contract switch as contract belongs to previous meter mode
+  if (baudrate != teleinfo_config.baudrate)
+  {
+    TeleinfoSetSpeed (baudrate);
+    if (strlen (teleinfo_contract_db.str_code) > 0)
     {
-      if (millis () >= time_stop) detect = false;
+      teleinfo_contract.time_change = teleinfo_detect.time_start;
+      teleinfo_sleep.nb_change      = TIC_NEW_CONTRACT_TRIGGER + 1;
     }
+  }
+
+  // log
+  AddLog (LOG_LEVEL_INFO, PSTR ("TIC: Vitesse détectée %u bauds en %u ms"), baudrate, teleinfo_detect.duration);
+}
+
+// switch to next speed (called once received characters have been handled)
+void TeleinfoDetectNextSpeed ()
+{
+  // check if next speed is needed
+  if (!teleinfo_detect.active || !teleinfo_detect.next) return;
 
-    // update previous level
-    level_prev = level_now;
+  // if all rounds done, give up and go back to configured speed
+  teleinfo_detect.nb_try++;
+  if (teleinfo_detect.nb_try >= TIC_DETECT_ROUND * TIC_DETECT_SPEED_MAX)
+  {
+    teleinfo_detect.active = false;
+    TeleinfoEnergySerialUpdateSpeed (teleinfo_config.baudrate);
+    AddLog (LOG_LEVEL_INFO, PSTR ("TIC: Vitesse non détectée, conservation de %u bauds"), teleinfo_config.baudrate);
+    return;
   }
 
-  // calculate baud rate according to low level signal length (19200 = 52 µs, 9600 = 104 µs, 4800 = 208 µs, 2400 = 416 µs and 1200 = 833 µs)
-  if (ts_mini == 0) baudrate = teleinfo_config.baudrate;
-    else if (ts_mini <= 60)  baudrate = 19200;
-    else if (ts_mini <= 120) baudrate = 9600;
-    else if (ts_mini <= 240) baudrate = 4800;
-    else if (ts_mini <= 450) baudrate = 2400;
-    else baudrate = 1200;
+  // switch to next speed
+  teleinfo_detect.index = (teleinfo_detect.index + 1) % TIC_DETECT_SPEED_MAX;
+  TeleinfoDetectReset ();
+  TeleinfoEnergySerialUpdateSpeed (arrTeleinfoDetectSpeed[teleinfo_detect.index]);
 
   // log
-  if (ts_mini == 0) AddLog (LOG_LEVEL_INFO, PSTR ("TIC: No data received, keeping %u bauds"), baudrate);
-    else AddLog (LOG_LEVEL_INFO, PSTR ("TIC: Speed detected at %u bauds (%u µs)"), baudrate, (uint32_t)ts_mini);
+  AddLog (LOG_LEVEL_DEBUG, PSTR ("TIC: Détection de la vitesse, essai à %u bauds"), arrTeleinfoDetectSpeed[teleinfo_detect.index]);
+}
+
+// handle received character during detection
+void TeleinfoDetectCharacter (const char character)
+{
+  char     checksum;
+  uint16_t sum_std, sum_his;
+
+  // check if current speed is still under test
+  if (!teleinfo_detect.active || teleinfo_detect.next) return;
+#ifdef ESP32
+  if (teleinfo_ring.baudrate != 0) return;        // speed under test not applied yet
+#endif    // ESP32
+  teleinfo_detect.nb_byte++;
+
+  switch (character)
+  {
+    // message control characters
+    case 0x02:
+    case 0x03:
+    case 0x04:
+      teleinfo_detect.in_line = false;
+      break;
+
+    // line start
+    case 0x0A:
+      teleinfo_detect.in_line = true;
+      teleinfo_detect.length  = 0;
+      teleinfo_detect.sum     = 0;
+      teleinfo_detect.prev[0] = teleinfo_detect.prev[1] = 0;
+      break;
+
+    // line stop : check checksum with standard method (last separator included) then historique method
+    case 0x0D:
+      if (teleinfo_detect.in_line && (teleinfo_detect.length >= 5))
+      {
+        checksum = teleinfo_detect.prev[1];
+        sum_std  = teleinfo_detect.sum - (uint8_t)checksum;
+        sum_his  = sum_std - (uint8_t)teleinfo_detect.prev[0];
+        if (((char)((sum_std & 0x3F) + 0x20) == checksum) || ((char)((sum_his & 0x3F) + 0x20) == checksum)) teleinfo_detect.nb_line++;
+
+        // if enough valid lines, speed is confirmed
+        if (teleinfo_detect.nb_line >= TIC_DETECT_LINE) TeleinfoDetectConfirm (teleinfo_detect.prev[0]);
+      }
+      teleinfo_detect.in_line = false;
+      break;
+
+    // line content
+    default:
+      if ((character != 0x09) && ((character < 0x20) || (character > 0x7E)))
+      {
+        teleinfo_detect.nb_invalid++;
+        teleinfo_detect.in_line = false;
+      }
+      else if (teleinfo_detect.in_line)
+      {
+        teleinfo_detect.sum += (uint8_t)character;
+        teleinfo_detect.prev[0] = teleinfo_detect.prev[1];
+        teleinfo_detect.prev[1] = character;
+        if (teleinfo_detect.length < UINT8_MAX) teleinfo_detect.length++;
+      }
+      break;
+  }
 
-  return baudrate;
+  // if too many invalid characters or no valid line, speed is rejected
+  if (teleinfo_detect.active && ((teleinfo_detect.nb_invalid >= TIC_DETECT_INVALID) || (teleinfo_detect.nb_byte >= TIC_DETECT_SAMPLE))) teleinfo_detect.next = true;
 }
 
 /*********************************************\
@@ -643,38 +970,341 @@ long long llsqrt (const long long value)
 	return result;
 }
 
-// calculate line checksum
-char TeleinfoEnergyCalculateChecksum (const char* pstr_line, char* pstr_etiquette, const size_t size_etiquette, char* pstr_donnee, const size_t size_donnee) 
+/*********************************************\
+ *           Etiquette perfect hash
+\*********************************************/
+
+// case insensitive FNV-1a hash of an etiquette, size is updated with etiquette length
+uint32_t TeleinfoEtiquetteHash (const char* pstr_etiquette, uint8_t &size)
 {
-  bool     prev_space;
-  uint8_t  line_checksum, given_checksum;
-  uint32_t index;
-  size_t   size_line, size_checksum;
-  char     *pstr_token, *pstr_data;
-  char     str_line[TIC_LINE_SIZE];
+  uint32_t hash = 2166136261UL;
 
-  // check parameters
-  if ((pstr_line == nullptr) || (pstr_etiquette == nullptr) || (pstr_donnee == nullptr)) return 0;
+  for (size = 0; pstr_etiquette[size] != 0; size++)
+  {
+    hash ^= (uint8_t)(pstr_etiquette[size] | 0x20);
+    hash *= 16777619UL;
+  }
+
+  return hash;
+}
+
+// bucket of an etiquette hash
+uint8_t TeleinfoEtiquetteHashBucket (const uint32_t hash)
+{
+  return (uint8_t)(hash >> (32 - TIC_HASH_BUCKET_BITS));
+}
+
+// slot of an etiquette hash, displaced by bucket seed (murmur3 finalizer)
+uint8_t TeleinfoEtiquetteHashSlot (const uint32_t hash, const uint8_t seed)
+{
+  uint32_t value;
+
+  value  = hash ^ ((uint32_t)seed * 0x9E3779B1UL);
+  value ^= value >> 16;
+  value *= 0x85EBCA6BUL;
+  value ^= value >> 13;
+  value *= 0xC2B2AE35UL;
+  value ^= value >> 16;
+
+  return (uint8_t)(value & (TIC_HASH_SLOT - 1));
+}
+
+// build perfect hash table of etiquette list for a meter mode (hash and displace)
+bool TeleinfoEtiquetteHashBuild (const uint8_t mode)
+{
+  bool     placed;
+  uint8_t  index, count, bucket, size, seed, slot, loop;
+  uint16_t offset;
+  uint32_t time_start;
+  char     character;
+  const char *pstr_list;
+  uint8_t  arr_bucket[TIC_HASH_ENTRY_MAX];
+  uint8_t  arr_count[TIC_HASH_BUCKET];
+  uint32_t arr_hash[TIC_HASH_ENTRY_MAX];
+  char     str_entry[TIC_ETIQUETTE_SIZE];
+
+  // check parameter
+  if (mode >= TIC_MODE_MAX) return false;
+
+  // init hash table
+  time_start = micros ();
+  teleinfo_hash.mode  = mode;
+  teleinfo_hash.ready = false;
+  memset (teleinfo_hash.arr_seed, 0, sizeof (teleinfo_hash.arr_seed));
+  memset (teleinfo_hash.arr_slot, TIC_HASH_EMPTY, sizeof (teleinfo_hash.arr_slot));
+  memset (arr_count, 0, sizeof (arr_count));
+
+  // split etiquette list (first entry is empty) and hash every etiquette
+  pstr_list = arr_kTicEtiquette[mode];
+  offset = 0;
+  count  = 0;
+  do
+  {
+    // check list size
+    if (count >= TIC_HASH_ENTRY_MAX) return false;
+
+    // read etiquette
+    size = 0;
+    teleinfo_hash.arr_offset[count] = offset;
+    character = (char)pgm_read_byte (pstr_list + offset++);
+    while ((character != 0) && (character != '|'))
+    {
+      if (size < TIC_ETIQUETTE_SIZE - 1) str_entry[size++] = character;
+      character = (char)pgm_read_byte (pstr_list + offset++);
+    }
+    str_entry[size] = 0;
+
+    // hash etiquette and set its bucket
+    arr_hash[count]   = TeleinfoEtiquetteHash (str_entry, teleinfo_hash.arr_size[count]);
+    arr_bucket[count] = TeleinfoEtiquetteHashBucket (arr_hash[count]);
+    arr_count[arr_bucket[count]]++;
+    count++;
+  }
+  while (character != 0);
+
+  // place buckets, largest first
+  for (loop = 0; loop < TIC_HASH_BUCKET; loop++)
+  {
+    // look for largest remaining bucket
+    bucket = 0;
+    for (index = 1; index < TIC_HASH_BUCKET; index++) if (arr_count[index] > arr_count[bucket]) bucket = index;
+    if (arr_count[bucket] == 0) break;
+    arr_count[bucket] = 0;
+
+    // look for a seed placing all bucket etiquettes in free slots
+    placed = false;
+    seed   = 0;
+    while (!placed && (seed < UINT8_MAX))
+    {
+      placed = true;
+      for (index = 0; placed && (index < count); index++)
+      {
+        if (arr_bucket[index] != bucket) continue;
+        slot = TeleinfoEtiquetteHashSlot (arr_hash[index], seed);
+        if (teleinfo_hash.arr_slot[slot] == TIC_HASH_EMPTY) teleinfo_hash.arr_slot[slot] = index;
+          else placed = false;
+      }
+
+      // on collision, free slots taken by current bucket and try next seed
+      if (!placed)
+      {
+        for (slot = 0; slot < TIC_HASH_SLOT; slot++)
+          if ((teleinfo_hash.arr_slot[slot] != TIC_HASH_EMPTY) && (arr_bucket[teleinfo_hash.arr_slot[slot]] == bucket)) teleinfo_hash.arr_slot[slot] = TIC_HASH_EMPTY;
+        seed++;
+      }
+    }
+
+    // if no seed found, hash table can't be used
+    if (!placed) return false;
+    teleinfo_hash.arr_seed[bucket] = seed;
+  }
+
+  // hash table is ready
+  teleinfo_hash.ready = true;
+  AddLog (LOG_LEVEL_DEBUG, PSTR ("TIC: Etiquette hash for mode %u, %u etiquettes in %u us"), mode, count, micros () - time_start);
+
+  return true;
+}
+
+// get etiquette text from its global index
+void TeleinfoEtiquetteGetText (const uint8_t index, char* pstr_etiquette, const size_t size)
+{
+  uint8_t mode;
+
+  // look for meter mode owning the index
+  for (mode = TIC_MODE_MAX - 1; (mode > 0) && (arrTicEtiquetteDelta[mode] > index); mode--);
+
+  // get etiquette from list
+  GetTextIndexed (pstr_etiquette, size, index - arrTicEtiquetteDelta[mode], arr_kTicEtiquette[mode]);
+}
+
+// get global etiquette index from etiquette of current meter mode (-1 if not found)
+int TeleinfoEtiquetteSearch (const char* pstr_etiquette)
+{
+  int      result;
+  uint8_t  mode, size, index;
+  uint32_t hash;
+  char     str_text[TIC_ETIQUETTE_SIZE];
+
+  // check meter mode
+  mode = teleinfo_contract.mode;
+  if (mode >= TIC_MODE_MAX) return -1;
+
+  // if meter mode has changed, build hash table
+  if (teleinfo_hash.mode != mode) TeleinfoEtiquetteHashBuild (mode);
+
+  // if hash table can't be used, linear search in etiquette list
+  if (!teleinfo_hash.ready)
+  {
+    result = GetCommandCode (str_text, sizeof (str_text), pstr_etiquette, arr_kTicEtiquette[mode]);
+    if (result != -1) result += arrTicEtiquetteDelta[mode];
+    return result;
+  }
+
+  // get slot candidate
+  hash  = TeleinfoEtiquetteHash (pstr_etiquette, size);
+  index = teleinfo_hash.arr_slot[TeleinfoEtiquetteHashSlot (hash, teleinfo_hash.arr_seed[TeleinfoEtiquetteHashBucket (hash)])];
+  if (index == TIC_HASH_EMPTY) return -1;
+
+  // check candidate with one string compare
+  if (size != teleinfo_hash.arr_size[index]) return -1;
+  if (strncasecmp_P (pstr_etiquette, arr_kTicEtiquette[mode] + teleinfo_hash.arr_offset[index], size) != 0) return -1;
+
+  return (int)index + arrTicEtiquetteDelta[mode];
+}
+
+// check if etiquette has the same case as its text in lists (index is a global etiquette index)
+bool TeleinfoEtiquetteSameCase (const char* pstr_etiquette, const uint8_t index)
+{
+  uint8_t mode, entry;
+  char    str_text[TIC_ETIQUETTE_SIZE];
+
+  // look for meter mode owning the index
+  for (mode = TIC_MODE_MAX - 1; (mode > 0) && (arrTicEtiquetteDelta[mode] > index); mode--);
+  entry = index - arrTicEtiquetteDelta[mode];
+
+  // if hash table of this mode is ready, compare with list entry
+  if (teleinfo_hash.ready && (teleinfo_hash.mode == mode) && (entry < TIC_HASH_ENTRY_MAX))
+    return (strncmp_P (pstr_etiquette, arr_kTicEtiquette[mode] + teleinfo_hash.arr_offset[entry], teleinfo_hash.arr_size[entry]) == 0);
+
+  // else compare with etiquette text
+  GetTextIndexed (str_text, sizeof (str_text), entry, arr_kTicEtiquette[mode]);
+  return (strcmp (pstr_etiquette, str_text) == 0);
+}
+
+/*********************************************\
+ *           Reception statistics
+\*********************************************/
+
+// reset reception statistics
+void TeleinfoStatsReset ()
+{
+  uint8_t index;
+
+  teleinfo_stats.time_start = millis ();
+  teleinfo_stats.nb_byte    = 0;
+  teleinfo_stats.nb_message = teleinfo_meter.nb_message;
+  teleinfo_stats.nb_reset   = teleinfo_meter.nb_reset;
+  teleinfo_stats.nb_line    = teleinfo_meter.nb_line;
+  teleinfo_stats.nb_error   = teleinfo_meter.nb_error;
+  teleinfo_stats.nb_overrun = 0;
+  for (index = 0; index < TIC_STAGE_MAX; index ++)
+  {
+    teleinfo_stats.arr_stage[index].count = 0;
+    teleinfo_stats.arr_stage[index].peak  = 0;
+    teleinfo_stats.arr_stage[index].total = 0;
+  }
+
+#ifdef ESP32
+  // reception ring statistics are reset by reader side
+  teleinfo_ring.reset = true;
+
+  TeleinfoHttpsResetStats ();
+#endif    // ESP32
+
+  // MQTT publications
+  TeleinfoSchedulerResetStats ();
+  TeleinfoDeltaResetStats ();
+}
+
+// account processing time of a reception stage (start is given in µs)
+void TeleinfoStatsUpdate (const uint8_t stage, const uint32_t start)
+{
+  uint32_t duration;
+
+  // check parameter
+  if (stage >= TIC_STAGE_MAX) return;
+
+  // update stage counters
+  duration = micros () - start;
+  teleinfo_stats.arr_stage[stage].count++;
+  teleinfo_stats.arr_stage[stage].total += duration;
+  if (duration > teleinfo_stats.arr_stage[stage].peak) teleinfo_stats.arr_stage[stage].peak = duration;
+}
+
+// publish reception statistics as JSON answer
+void TeleinfoStatsPublish ()
+{
+  uint8_t  index;
+  uint32_t duration, average;
+  long     nb_message, nb_line, nb_error;
+  char     str_stage[12];
+
+  // calculate counters since statistics start
+  duration   = max ((uint32_t)1, (uint32_t)(millis () - teleinfo_stats.time_start));
+  nb_message = teleinfo_meter.nb_message - teleinfo_stats.nb_message;
+  nb_line    = (long)(teleinfo_meter.nb_line  - teleinfo_stats.nb_line);
+  nb_error   = (long)(teleinfo_meter.nb_error - teleinfo_stats.nb_error);
+
+  // global counters
+  Response_P (PSTR ("{\"Stats\":{\"ms\":%u,\"speed\":%u,\"bytes\":%u,\"lines\":%d,\"messages\":%d,\"errors\":%d,\"resets\":%d"), duration, teleinfo_config.baudrate, teleinfo_stats.nb_byte, nb_line, nb_message, nb_error, teleinfo_meter.nb_reset - teleinfo_stats.nb_reset);
+  ResponseAppend_P (PSTR (",\"lps\":%u,\"mps\":%u.%02u"), (uint32_t)((uint64_t)nb_line * 1000 / duration), (uint32_t)((uint64_t)nb_message * 1000 / duration), (uint32_t)((uint64_t)nb_message * 100000 / duration % 100));
+
+  // processing time per stage (µs)
+  for (index = 0; index < TIC_STAGE_MAX; index ++)
+  {
+    if (teleinfo_stats.arr_stage[index].count > 0) average = (uint32_t)(teleinfo_stats.arr_stage[index].total / teleinfo_stats.arr_stage[index].count);
+      else average = 0;
+    GetTextIndexed (str_stage, sizeof (str_stage), index, kTeleinfoStatStage);
+    ResponseAppend_P (PSTR (",\"%s\":{\"count\":%u,\"avg\":%u,\"peak\":%u,\"total\":%u}"), str_stage, teleinfo_stats.arr_stage[index].count, average, teleinfo_stats.arr_stage[index].peak, (uint32_t)(teleinfo_stats.arr_stage[index].total / 1000));
+  }
+
+  // contract switches on the fly
+  ResponseAppend_P (PSTR (",\"contract\":{\"switch\":%u,\"latency\":%u}"), teleinfo_contract.nb_switch, teleinfo_contract.switch_ms);
+
+  // speed detection
+  ResponseAppend_P (PSTR (",\"detect\":{\"active\":%u,\"speed\":%u,\"ms\":%u,\"tries\":%u}"), teleinfo_detect.active, arrTeleinfoDetectSpeed[teleinfo_detect.index], teleinfo_detect.duration, teleinfo_detect.nb_try);
+
+#ifdef ESP32
+  // reception ring
+  ResponseAppend_P (PSTR (",\"ring\":{\"size\":%u,\"used\":%u,\"high\":%u,\"overrun\":%u}"), TIC_RING_SIZE, TeleinfoRingCount (), teleinfo_ring.high, teleinfo_ring.nb_overrun);
+#else       // ESP8266
+  // UART reception buffer
+  ResponseAppend_P (PSTR (",\"uart\":{\"size\":%u,\"overrun\":%u}"), TIC_SERIAL_BUFFER, teleinfo_stats.nb_overrun);
+#endif    // ESP32 & ESP8266
+
+  // CPU per message (µs)
+  if (nb_message > 0) average = (uint32_t)((teleinfo_stats.arr_stage[TIC_STAGE_RX].total) / nb_message);
+    else average = 0;
+  ResponseAppend_P (PSTR (",\"cpu_msg\":%u"), average);
+
+#ifdef ESP32
+  // outbound requests per endpoint
+  TeleinfoHttpsAppendJSON ();
+#endif    // ESP32
+
+  // MQTT publications per producer
+  TeleinfoSchedulerAppendJSON ();
+  TeleinfoDeltaAppendJSON ();
+
+  ResponseAppend_P (PSTR ("}}"));
+}
+
+// calculate line checksum and split line thru tokenizer views
+//   return checksum (0 if error), etiquette and donnee point into reception buffer
+char TeleinfoEnergyCalculateChecksum (char* &pstr_etiquette, char* &pstr_donnee) 
+{
+  uint8_t line_checksum, given_checksum;
+  uint8_t size;
 
   // init result
-  strcpy (pstr_etiquette, PSTR (""));
-  strcpy (pstr_donnee, PSTR (""));
-  strcpy (str_line, PSTR (""));
+  pstr_etiquette = teleinfo_message.str_line;
+  pstr_donnee    = teleinfo_message.str_line + teleinfo_message.token.size;
+  teleinfo_message.str_line[teleinfo_message.token.size] = 0;
 
-  // if line is less than 5 char, no handling
-  size_line = strlen (pstr_line);
-  if ((size_line < 5) || (size_line > TIC_LINE_SIZE)) return 0;
+  // if line is less than 5 char or has overflowed, no handling
+  if ((teleinfo_message.token.size_raw < 5) || (teleinfo_message.token.size_raw >= TIC_LINE_SIZE))
+  {
+    pstr_etiquette = pstr_donnee;
+    return 0;
+  }
   
-  // get given checksum
-  size_checksum  = size_line - 1;
-  given_checksum = (uint8_t)pstr_line[size_checksum];
-
-  // adjust checksum calculation according to mode
-  if (teleinfo_meter.sep_line == ' ') size_checksum = size_checksum - 1;
+  // get given checksum and remove it from running sum (with its separator in historique mode)
+  given_checksum = teleinfo_message.token.last;
+  line_checksum  = teleinfo_message.token.checksum - given_checksum;
+  if (teleinfo_meter.sep_line == ' ') line_checksum -= teleinfo_message.token.prev;
 
-  // loop to calculate checksum, keeping 6 lower bits and adding Ox20 and compare to given checksum
-  line_checksum = 0;
-  for (index = 0; index < size_checksum; index ++) line_checksum += (uint8_t)pstr_line[index];
+  // keep 6 lower bits and add Ox20 and compare to given checksum
   line_checksum = (line_checksum & 0x3F) + 0x20;
 
   // if checksum difference
@@ -688,53 +1318,32 @@ char TeleinfoEnergyCalculateChecksum (const char* pstr_line, char* pstr_etiquett
     if (!TasmotaGlobal.global_state.network_down)
     {
       teleinfo_meter.nb_error++;
-      AddLog (LOG_LEVEL_DEBUG, PSTR ("TIC: Error [%s]"), pstr_line);
-    }
-  }
-
-  // replace all TABS and SPACE by single SPACE
-  prev_space = true;
-  for (index = 0; index < size_line; index ++)
-  {
-    // if current caracter is TAB or SPACE, keep only ONE
-    if ((pstr_line[index] == 0x09) || (pstr_line[index] == ' '))
-    {
-      if (!prev_space) strcat (str_line, " ");
-      prev_space = true;
-    }
-
-    // else keep current caracter
-    else
-    {
-      strncat (str_line, &pstr_line[index], 1);
-      prev_space = false;
+      AddLog (LOG_LEVEL_DEBUG, PSTR ("TIC: Error [%s]"), teleinfo_message.str_line);
     }
   }
 
-  // remove checksum from string
-  pstr_token = strrchr (str_line, ' ');
-  if (pstr_token != nullptr) *pstr_token = 0;
-
-  // look for data
-  pstr_data = strchr (str_line, ' ');
-  if (pstr_data != nullptr)
+  // if no separator between etiquette and checksum, no data
+  if ((teleinfo_message.token.sep_first == 0) || (teleinfo_message.token.sep_first == teleinfo_message.token.sep_last))
   {
-    *pstr_data = 0;
-    strlcpy (pstr_donnee, pstr_data + 1, size_donnee);
+    if (teleinfo_message.token.sep_last > 0) teleinfo_message.str_line[teleinfo_message.token.sep_last] = 0;
+    line_checksum = 0;
+    teleinfo_message.error = 1;
+    AddLog (LOG_LEVEL_DEBUG, PSTR ("TIC: No data [%s]"), teleinfo_message.str_line);
   }
 
-  // else, no data
+  // else set donnee view, removing checksum and limiting size
   else
   {
-    line_checksum = 0;
-    teleinfo_message.error = 1;
-    AddLog (LOG_LEVEL_DEBUG, PSTR ("TIC: No data [%s]"), str_line);
+    size = min (teleinfo_message.token.sep_last - teleinfo_message.token.sep_first - 1, TIC_DONNEE_SIZE - 1);
+    pstr_donnee = teleinfo_message.str_line + teleinfo_message.token.sep_first + 1;
+    pstr_donnee[size] = 0;
+    teleinfo_message.str_line[teleinfo_message.token.sep_first] = 0;
   }
 
-  // extract etiquette
-  strlcpy (pstr_etiquette, str_line, size_etiquette);
+  // limit etiquette size
+  if (strlen (pstr_etiquette) >= TIC_ETIQUETTE_SIZE) pstr_etiquette[TIC_ETIQUETTE_SIZE - 1] = 0;
 
-  return line_checksum;
+  return (char)line_checksum;
 }
 
 // get meter manufacturer
@@ -875,30 +1484,150 @@ void TeleinfoEnergyProdReset ()
   teleinfo_prod_wh.total     = 0;
 }
 
+// empty current message
 void TeleinfoEnergyMessageReset ()
 {
-  uint8_t index;
+  tic_msg *pmsg = &teleinfo_message.arr_msg[teleinfo_message.last ^ 1];
+
+  pmsg->nb_line = 0;
+  pmsg->size    = 0;
+}
+
+// current message becomes last message (buffers are swapped, no copy)
+void TeleinfoEnergyMessageSaveLast ()
+{
+  teleinfo_message.last ^= 1;
+}
+
+// parse a donnee made only of digits, return number of digits (0 and number set to 0 if donnee is not a number)
+uint8_t TeleinfoEnergyParseNumber (const char* pstr_donnee, unsigned long long &number)
+{
+  uint8_t digits;
 
-  teleinfo_message.index_line = 0;
-  for (index = 0; index < TIC_LINE_QTY; index ++)
+  number = 0;
+  for (digits = 0; pstr_donnee[digits] != 0; digits++)
   {
-    strcpy_P (teleinfo_message.arr_line[index].str_etiquette, PSTR(""));
-    strcpy_P (teleinfo_message.arr_line[index].str_donnee, PSTR (""));
-    teleinfo_message.arr_line[index].checksum = 0;
+    if ((digits >= 19) || (pstr_donnee[digits] < '0') || (pstr_donnee[digits] > '9')) { number = 0; return 0; }
+    number = number * 10 + (uint8_t)(pstr_donnee[digits] - '0');
   }
+
+  return digits;
 }
 
-void TeleinfoEnergyMessageSaveLast ()
+// append a line to current message packed storage (line is ignored if message is full)
+void TeleinfoEnergyMessageAddLine (const int index, const char* pstr_etiquette, const char* pstr_donnee, const uint8_t digits, const unsigned long long number, const char checksum)
 {
-  uint8_t index;
+  uint8_t  id, type;
+  uint32_t number32;
+  size_t   size_etiquette, size_donnee, size_line;
+  uint8_t *pdata;
+  tic_msg *pmsg = &teleinfo_message.arr_msg[teleinfo_message.last ^ 1];
+
+  // donnee is stored as a number if made only of digits, else as text
+  if (digits == 0) { type = TIC_VALUE_TEXT; size_donnee = strlen (pstr_donnee); }
+  else if (number <= UINT32_MAX) { type = TIC_VALUE_UINT32; size_donnee = sizeof (uint32_t); }
+  else { type = TIC_VALUE_UINT64; size_donnee = sizeof (unsigned long long); }
+
+  // etiquette is stored as its index if known, with its received text if unknown or if case differs from lists
+  if ((index < 0) || (index >= TIC_ETIQUETTE_NONE)) id = TIC_ETIQUETTE_NONE;
+    else id = (uint8_t)index;
+  if ((id != TIC_ETIQUETTE_NONE) && !TeleinfoEtiquetteSameCase (pstr_etiquette, id)) type |= TIC_VALUE_RAW_ETIQUETTE;
+  if ((id == TIC_ETIQUETTE_NONE) || (type & TIC_VALUE_RAW_ETIQUETTE)) size_etiquette = 1 + strlen (pstr_etiquette);
+    else size_etiquette = 0;
+
+  // check available space
+  size_line = 4 + size_etiquette + size_donnee;
+  if (pmsg->nb_line >= TIC_LINE_QTY) return;
+  if (pmsg->size + size_line > TIC_MESSAGE_ARENA) return;
+
+  // line header
+  pmsg->arr_offset[pmsg->nb_line++] = pmsg->size;
+  pdata = pmsg->arr_data + pmsg->size;
+  pmsg->size += size_line;
+  *pdata++ = (uint8_t)checksum;
+  *pdata++ = id;
+  *pdata++ = type;
+  if ((type & TIC_VALUE_TYPE_MASK) == TIC_VALUE_TEXT) *pdata++ = (uint8_t)size_donnee;
+    else *pdata++ = digits;
+
+  // received etiquette text
+  if (size_etiquette > 0)
+  {
+    *pdata++ = (uint8_t)(size_etiquette - 1);
+    memcpy (pdata, pstr_etiquette, size_etiquette - 1);
+    pdata += size_etiquette - 1;
+  }
+
+  // donnee
+  switch (type & TIC_VALUE_TYPE_MASK)
+  {
+    case TIC_VALUE_TEXT:   memcpy (pdata, pstr_donnee, size_donnee); break;
+    case TIC_VALUE_UINT32: number32 = (uint32_t)number; memcpy (pdata, &number32, sizeof (number32)); break;
+    case TIC_VALUE_UINT64: memcpy (pdata, &number, sizeof (number)); break;
+  }
+}
+
+// number of lines in last received message
+uint8_t TeleinfoEnergyMessageLineCount ()
+{
+  return teleinfo_message.arr_msg[teleinfo_message.last].nb_line;
+}
+
+// get a line of last received message, etiquette and donnee are copied in given buffers
+//   return checksum (0 if line is in error or doesn't exist)
+char TeleinfoEnergyMessageGetLine (const uint8_t index, char* pstr_etiquette, const size_t size_etiquette, char* pstr_donnee, const size_t size_donnee)
+{
+  uint8_t  id, type, size, position;
+  size_t   length;
+  uint32_t number32;
+  unsigned long long number;
+  const uint8_t *pdata;
+  const tic_msg *pmsg = &teleinfo_message.arr_msg[teleinfo_message.last];
+
+  // check parameters
+  if ((size_etiquette == 0) || (size_donnee == 0)) return 0;
+  pstr_etiquette[0] = 0;
+  pstr_donnee[0]    = 0;
+  if (index >= pmsg->nb_line) return 0;
+
+  // line header
+  pdata = pmsg->arr_data + pmsg->arr_offset[index];
+  id    = pdata[1];
+  type  = pdata[2];
+  size  = pdata[3];
+
+  // etiquette from lists if known with same case, else stored text
+  if ((id != TIC_ETIQUETTE_NONE) && !(type & TIC_VALUE_RAW_ETIQUETTE)) TeleinfoEtiquetteGetText (id, pstr_etiquette, size_etiquette);
+  else
+  {
+    length = min ((size_t)pdata[4], size_etiquette - 1);
+    memcpy (pstr_etiquette, pdata + 5, length);
+    pstr_etiquette[length] = 0;
+    pdata += 1 + pdata[4];
+  }
+  type &= TIC_VALUE_TYPE_MASK;
 
-  teleinfo_message.index_last = teleinfo_message.index_line;
-  for (index = 0; index < TIC_LINE_QTY; index ++)
+  // donnee as text or number with its leading zeros
+  pdata += 4;
+  if (type == TIC_VALUE_TEXT)
+  {
+    length = min ((size_t)size, size_donnee - 1);
+    memcpy (pstr_donnee, pdata, length);
+    pstr_donnee[length] = 0;
+  }
+  else if (size < size_donnee)
   {
-    strcpy (teleinfo_message.arr_last[index].str_etiquette, teleinfo_message.arr_line[index].str_etiquette);
-    strcpy (teleinfo_message.arr_last[index].str_donnee,    teleinfo_message.arr_line[index].str_donnee);
-    teleinfo_message.arr_last[index].checksum = teleinfo_message.arr_line[index].checksum;
+    if (type == TIC_VALUE_UINT32) { memcpy (&number32, pdata, sizeof (number32)); number = number32; }
+      else memcpy (&number, pdata, sizeof (number));
+    pstr_donnee[size] = 0;
+    for (position = size; position > 0; position--)
+    {
+      pstr_donnee[position - 1] = '0' + (char)(number % 10);
+      number /= 10;
+    }
   }
+
+  return (char)pmsg->arr_data[pmsg->arr_offset[index]];
 }
 
 void TeleinfoMessagePointeReset ()
@@ -959,16 +1688,18 @@ void TeleinfoEnergyConsoGlobalCounterUpdate ()
   }
 }
 
-// update global consommation counter (avoid any decrease)
-void TeleinfoEnergyProdGlobalCounterUpdate (const char* pstr_value)
+// update global production counter (avoid any decrease)
+//   number is the parsed donnee when made only of digits (digits > 0)
+void TeleinfoEnergyProdGlobalCounterUpdate (const char* pstr_value, const uint8_t digits, const unsigned long long number)
 {
   long long total;
 
   // check parameter
   if (pstr_value == nullptr) return;
 
-  // convert string and update counter
-  total = atoll (pstr_value);
+  // get counter from parsed donnee, else convert string
+  if (digits > 0) total = (long long)number;
+    else total = atoll (pstr_value);
   if (total == LONG_LONG_MAX) return;
 
   // production is enabled
@@ -1002,7 +1733,8 @@ void TeleinfoEnergyProdGlobalCounterUpdate (const char* pstr_value)
 }
 
 // update indexed consommation counter
-void TeleinfoEnergyConsoIndexCounterUpdate (const char* pstr_value, const uint8_t index)
+//   number is the parsed donnee when made only of digits (digits > 0)
+void TeleinfoEnergyConsoIndexCounterUpdate (const char* pstr_value, const uint8_t digits, const unsigned long long number, const uint8_t index)
 {
   long long value;
   char     *pstr_kilo;
@@ -1012,15 +1744,21 @@ void TeleinfoEnergyConsoIndexCounterUpdate (const char* pstr_value, const uint8_
   if (pstr_value == nullptr) return;
   if (index >= TIC_PERIOD_MAX) return;
 
-  // check if value is in kWh
-  strlcpy (str_value, pstr_value, sizeof (str_value));
-  pstr_kilo = strchr (str_value, 'k');
-  if (pstr_kilo != nullptr)
+  // counter already parsed
+  if (digits > 0) value = (long long)number;
+
+  // else check if value is in kWh
+  else
   {
-    *pstr_kilo = 0;
-    value = 1000 * atoll (str_value);
+    strlcpy (str_value, pstr_value, sizeof (str_value));
+    pstr_kilo = strchr (str_value, 'k');
+    if (pstr_kilo != nullptr)
+    {
+      *pstr_kilo = 0;
+      value = 1000 * atoll (str_value);
+    }
+    else value = atoll (str_value);
   }
-  else value = atoll (str_value);
 
   // check validity
   if (value == LONG_LONG_MAX) return;
@@ -1037,7 +1775,8 @@ void TeleinfoEnergyConsoIndexCounterUpdate (const char* pstr_value, const uint8_
 }
 
 // update phase voltage
-void TeleinfoEnergyVoltageUpdate (const char* pstr_value, const uint8_t phase, const bool is_rms)
+//   number is the parsed donnee when made only of digits (digits > 0)
+void TeleinfoEnergyVoltageUpdate (const char* pstr_value, const uint8_t digits, const unsigned long long number, const uint8_t phase, const bool is_rms)
 {
   bool  alert;
   long  value;
@@ -1048,21 +1787,29 @@ void TeleinfoEnergyVoltageUpdate (const char* pstr_value, const uint8_t phase, c
   if (pstr_value == nullptr) return;
   if (phase >= TIC_PHASE_MAX) return;
 
-  // remove V unit
-  strlcpy (str_value, pstr_value, sizeof (str_value));
-  pstr_unit = strchr (str_value, 'V');
-  if (pstr_unit != nullptr) *pstr_unit = 0;
+  // voltage already parsed (5 digits values are handled as text for emeraude bug)
+  if ((digits > 0) && (digits != 5)) value = (long)number;
 
-  // correct emeraude meter bug
-  if (strlen (str_value) == 5)
+  // else convert text
+  else
   {
-    str_value[1] = str_value[2];
-    str_value[2] = str_value[4];
-    str_value[3] = 0;
+    // remove V unit
+    strlcpy (str_value, pstr_value, sizeof (str_value));
+    pstr_unit = strchr (str_value, 'V');
+    if (pstr_unit != nullptr) *pstr_unit = 0;
+
+    // correct emeraude meter bug
+    if (strlen (str_value) == 5)
+    {
+      str_value[1] = str_value[2];
+      str_value[2] = str_value[4];
+      str_value[3] = 0;
+    }
+
+    value = atol (str_value);
   }
 
-  // calculate and check validity
-  value = atol (str_value);
+  // check validity
   if (value > TIC_VOLTAGE_MAXIMUM) return;
 
   // if value is valid
@@ -1082,12 +1829,17 @@ void TeleinfoEnergyVoltageUpdate (const char* pstr_value, const uint8_t phase, c
     alert = false;
     alert |= (value < TIC_VOLTAGE_DEFAULT * 90  / 100);
     alert |= (value > TIC_VOLTAGE_DEFAULT * 110 / 100);
-    if (alert) TeleinfoDriverAlertTrigger (TIC_ALERT_OVERVOLT, str_value);
+    if (alert)
+    {
+      ltoa (value, str_value, 10);
+      TeleinfoDriverAlertTrigger (TIC_ALERT_OVERVOLT, str_value);
+    }
   }
 }
 
 // update phase current ("67" or "67,243A")
-void TeleinfoenergyCurrentUpdate (const char* pstr_value, const uint8_t phase)
+//   number is the parsed donnee when made only of digits (digits > 0)
+void TeleinfoenergyCurrentUpdate (const char* pstr_value, const uint8_t digits, const unsigned long long number, const uint8_t phase)
 {
   long value;
   char *pstr_token;
@@ -1097,6 +1849,14 @@ void TeleinfoenergyCurrentUpdate (const char* pstr_value, const uint8_t phase)
   // check parameter
   if (pstr_value == nullptr) return;
   if (phase >= TIC_PHASE_MAX) return;
+
+  // format 67 already parsed
+  if (digits > 0)
+  {
+    value = (long)number * 1000;
+    if (value >= 0) teleinfo_conso.phase[phase].current = value;
+    return;
+  }
   
   // remove A unit
   strlcpy (str_text, pstr_value, sizeof (str_text));
@@ -1126,7 +1886,7 @@ void TeleinfoenergyCurrentUpdate (const char* pstr_value, const uint8_t phase)
   if ((value >= 0) && (value < LONG_MAX)) teleinfo_conso.phase[phase].current = value; 
 }
 
-void TeleinfoEnergyProdApparentPowerUpdate (const char* pstr_value)
+void TeleinfoEnergyProdApparentPowerUpdate (const char* pstr_value, const uint8_t digits, const unsigned long long number)
 {
   long value;
 
@@ -1134,11 +1894,12 @@ void TeleinfoEnergyProdApparentPowerUpdate (const char* pstr_value)
   if (pstr_value == nullptr) return;
 
   // calculate and update
-  value = atol (pstr_value);
+  if (digits > 0) value = (long)number;
+    else value = atol (pstr_value);
   if ((value >= 0) && (value < LONG_MAX)) teleinfo_prod.papp = value;
 }
 
-void TeleinfoEnergyConsoApparentPowerUpdate (const char* pstr_value)
+void TeleinfoEnergyConsoApparentPowerUpdate (const char* pstr_value, const uint8_t digits, const unsigned long long number)
 {
   long value;
 
@@ -1146,7 +1907,8 @@ void TeleinfoEnergyConsoApparentPowerUpdate (const char* pstr_value)
   if (pstr_value == nullptr) return;
 
   // calculate and update
-  value = atol (pstr_value);
+  if (digits > 0) value = (long)number;
+    else value = atol (pstr_value);
   if ((value >= 0) && (value < LONG_MAX))
   {
     // update total apprent power
@@ -1158,7 +1920,7 @@ void TeleinfoEnergyConsoApparentPowerUpdate (const char* pstr_value)
 }
 
 // update phase apparent power
-void TeleinfoEnergyConsoApparentPowerUpdate (const char* pstr_value, const uint8_t phase)
+void TeleinfoEnergyConsoApparentPowerUpdate (const char* pstr_value, const uint8_t digits, const unsigned long long number, const uint8_t phase)
 {
   long value;
 
@@ -1167,7 +1929,8 @@ void TeleinfoEnergyConsoApparentPowerUpdate (const char* pstr_value, const uint8
   if (phase >= TIC_PHASE_MAX) return;
   
   // calculate and update phase apparent power
-  value = atol (pstr_value);
+  if (digits > 0) value = (long)number;
+    else value = atol (pstr_value);
   if ((value >= 0) && (value < LONG_MAX)) teleinfo_conso.phase[phase].sinsts = value; 
 }
 
@@ -1338,29 +2101,62 @@ void TeleinfoSetSpeed (const uint32_t baudrate)
 
   // log
   if (teleinfo_config.baudrate == 1200) strcpy_P (str_mode, PSTR ("Historique"));
-    else if (teleinfo_config.baudrate == 1200) strcpy_P (str_mode, PSTR ("Standard"));
+    else if (teleinfo_config.baudrate == 9600) strcpy_P (str_mode, PSTR ("Standard"));
     else strcpy_P (str_mode, PSTR ("Spécifique"));
   AddLog (LOG_LEVEL_INFO, PSTR ("TIC: Bascule en mode %s (%u bauds)"), str_mode, teleinfo_config.baudrate);
-  AddLog (LOG_LEVEL_INFO, PSTR ("TIC: Redémarrage nécessaire"));
 
   // save settings
   Settings->rf_code[15][8] = (uint8_t)setting;
   SettingsSave (0);
 }
 
-// handle contract change
+// handle contract change on the fly (no restart, current message, totals and graph are kept)
 void TeleinfoContractChange ()
 {
-  // reset contract data
-  TeleinfoContractInit ();
+  uint8_t index;
+
+  // calculate detection latency (no latency if switch is asked by command)
+  if (teleinfo_sleep.nb_change > 0) teleinfo_contract.switch_ms = millis () - teleinfo_contract.time_change;
+    else teleinfo_contract.switch_ms = 0;
+  teleinfo_contract.nb_switch++;
+
+  // reset contract database and current period
+  teleinfo_sleep.nb_change = 0;
+  teleinfo_contract.period = UINT8_MAX;
+  strcpy_P (teleinfo_contract.str_period, PSTR (""));
+  TeleinfoContractDbInit ();
+
+  // reset calendar days
+  for (index = 0; index < TIC_DAY_MAX; index ++) TeleinfoCalendarReset (index);
+
+  // reset period indexes, today's conso is kept as new indexes will be added to midnight total
+  teleinfo_conso_wh.midnight = -(long long)teleinfo_conso_wh.today;
+  teleinfo_conso_wh.total    = 0;
+  for (index = 0; index < TIC_PERIOD_MAX; index ++) teleinfo_conso_wh.index[index] = 0;
+
+  // rebuild modules depending on contract
+  TeleinfoDriverContractChange ();
+
+  // log
+  AddLog (LOG_LEVEL_INFO, PSTR ("TIC: Changement de contrat détecté en %u ms, reconfiguration sans redémarrage"), teleinfo_contract.switch_ms);
+}
 
-  // reset graph data
-#ifdef USE_TELEINFO_GRAPH
-  TeleinfoGraphDataInit ();
-#endif    // USE_TELEINFO_GRAPH
+// init contract database
+void TeleinfoContractDbInit ()
+{
+  uint8_t index;
 
-// log
-  AddLog (LOG_LEVEL_INFO, PSTR ("TIC: Type de contrat réinitialisé"));
+  teleinfo_contract_db.type       = UINT8_MAX;
+  teleinfo_contract_db.period_qty = 0;
+  strcpy_P (teleinfo_contract_db.str_code, PSTR (""));
+  for (index = 0; index < TIC_PERIOD_MAX; index ++)
+  {
+    teleinfo_contract_db.arr_period[index].valid = false;
+    teleinfo_contract_db.arr_period[index].level = TIC_LEVEL_NONE;
+    teleinfo_contract_db.arr_period[index].hchp  = 1;
+    strcpy_P (teleinfo_contract_db.arr_period[index].str_code,  PSTR (""));
+    strcpy_P (teleinfo_contract_db.arr_period[index].str_label, PSTR (""));
+  }
 }
 
 // init contract management data
@@ -1382,18 +2178,8 @@ void TeleinfoContractInit ()
   teleinfo_contract.ssousc  = 0;                       // contract max power per phase
   strcpy_P (teleinfo_contract.str_period, PSTR (""));
 
-
-  teleinfo_contract_db.type       = UINT8_MAX;
-  teleinfo_contract_db.period_qty = 0;
-  strcpy_P (teleinfo_contract_db.str_code, PSTR (""));
-  for (index = 0; index < TIC_PERIOD_MAX; index ++)
-  {
-    teleinfo_contract_db.arr_period[index].valid = false;
-    teleinfo_contract_db.arr_period[index].level = TIC_LEVEL_NONE;
-    teleinfo_contract_db.arr_period[index].hchp  = 1;
-    strcpy_P (teleinfo_contract_db.arr_period[index].str_code,  PSTR (""));
-    strcpy_P (teleinfo_contract_db.arr_period[index].str_label, PSTR (""));
-  }
+  // contract database
+  TeleinfoContractDbInit ();
 
   // init calendar days
   for (index = 0; index < TIC_DAY_MAX; index ++) TeleinfoCalendarReset (index);
@@ -1436,6 +2222,7 @@ bool TeleinfoContractUpdate ()
   // if contract code defined and different than message contract, contract has changed
   else if (strlen (teleinfo_contract_db.str_code) > 0)
   {
+    if (teleinfo_sleep.nb_change == 0) teleinfo_contract.time_change = millis ();
     teleinfo_sleep.nb_change ++;
     result = false;
   }
@@ -1661,7 +2448,8 @@ bool TeleinfoContractPeriod2String (char *pstr_description, const size_t size_de
 }
 
 // set contract max power par phase
-void TeleinfoContractPowerUpdate (const char *pstr_donnee)
+//   number is the parsed donnee when made only of digits (digits > 0)
+void TeleinfoContractPowerUpdate (const char *pstr_donnee, const uint8_t digits, const unsigned long long number)
 {
   long value;
   char *pstr_match;
@@ -1671,11 +2459,15 @@ void TeleinfoContractPowerUpdate (const char *pstr_donnee)
   if (pstr_donnee == nullptr) return;
   if (teleinfo_contract.phase == 0) return;
   
-  // convert value
-  strlcpy (str_value, pstr_donnee, sizeof (str_value));
-  pstr_match = strchr (str_value, 'k');
-  if (pstr_match != nullptr) *pstr_match = 0; 
-  value = atol (str_value);
+  // get parsed value, else convert text
+  if (digits > 0) value = (long)number;
+  else
+  {
+    strlcpy (str_value, pstr_donnee, sizeof (str_value));
+    pstr_match = strchr (str_value, 'k');
+    if (pstr_match != nullptr) *pstr_match = 0; 
+    value = atol (str_value);
+  }
 
   // update contrat max values
   if (value > 0)
@@ -1801,11 +2593,14 @@ uint16_t TeleinfoCalculateCRC (const char *pstr_donnee)
   return result;
 }
 
+// update cosphi with a running sum over the last TIC_COSPHI_SAMPLE samples of current power page :
+//   - sum is updated with new sample and the one it replaces in the circular array (no array scan)
+//   - average is the same as the one calculated over all the samples of the array
 void TeleinfoUpdateCosphi (long cosphi, struct tic_cosphi &struct_cosphi, const long papp)
 {
   uint8_t index;
   long    page, page_size, page_low, page_high;
-  long    result, sample;
+  long    result;
 
   // ignore first measure as duration was not good
   struct_cosphi.quantity++;
@@ -1834,40 +2629,40 @@ void TeleinfoUpdateCosphi (long cosphi, struct tic_cosphi &struct_cosphi, const
     if (page >= TIC_COSPHI_PAGE) page = TIC_COSPHI_PAGE - 1;
   }
 
-  // log for debug
-  AddLog (LOG_LEVEL_DEBUG, PSTR ("TIC: [upd] %d msg, %d ms, %d mwah, %d mwh"), result, teleinfo_message.duration, teleinfo_conso.delta_mvah, teleinfo_conso.delta_mwh);
-  AddLog (LOG_LEVEL_DEBUG, PSTR ("TIC: [cos] %d VA, %d page, new %d, avg %d"), papp, page, cosphi, struct_cosphi.value);
-
+  // log for debug (formatting only if debug level is enabled)
+  if (HighestLogLevel () >= LOG_LEVEL_DEBUG)
+  {
+    AddLog (LOG_LEVEL_DEBUG, PSTR ("TIC: [upd] %d msg, %d ms, %d mwah, %d mwh"), result, teleinfo_message.duration, teleinfo_conso.delta_mvah, teleinfo_conso.delta_mwh);
+    AddLog (LOG_LEVEL_DEBUG, PSTR ("TIC: [cos] %d VA, %d page, new %d, avg %d"), papp, page, cosphi, struct_cosphi.value);
+  }
 
-  // if page has changed, load array of values for new page (current cosphi is ignored as it is a transition one)
+  // if page has changed, seed half of the samples with page average (current cosphi is ignored as it is a transition one)
   if (struct_cosphi.page != page)
   {
-    struct_cosphi.index = TIC_COSPHI_SAMPLE / 2;
+    struct_cosphi.index     = TIC_COSPHI_SAMPLE / 2;
+    struct_cosphi.nb_sample = struct_cosphi.index;
+    struct_cosphi.sum       = (long)struct_cosphi.arr_page[page] * struct_cosphi.nb_sample;
     for (index = 0; index < struct_cosphi.index; index++) struct_cosphi.arr_value[index] = struct_cosphi.arr_page[page];
-    for (index = struct_cosphi.index; index < TIC_COSPHI_SAMPLE; index++) struct_cosphi.arr_value[index] = LONG_MAX;
   }
 
-  // if page has not changed, update array of values
+  // else add new sample in place of oldest one
   else
   {
+    if (cosphi > INT16_MAX) cosphi = INT16_MAX;
     if (struct_cosphi.index >= TIC_COSPHI_SAMPLE) struct_cosphi.index = 0;
-    struct_cosphi.arr_value[struct_cosphi.index] = cosphi;
+    if (struct_cosphi.nb_sample < TIC_COSPHI_SAMPLE) struct_cosphi.nb_sample++;
+    else struct_cosphi.sum -= struct_cosphi.arr_value[struct_cosphi.index];
+    struct_cosphi.sum += cosphi;
+    struct_cosphi.arr_value[struct_cosphi.index] = (int16_t)cosphi;
     struct_cosphi.index++;
   }
 
   // calculate current cosphi average
-  result = 0;
-  sample = 0;
-  for (index = 0; index < TIC_COSPHI_SAMPLE; index++) if (struct_cosphi.arr_value[index] != LONG_MAX)
-  {
-    result += struct_cosphi.arr_value[index];
-    sample++;
-  }
-  if (sample > 0) struct_cosphi.value = min (1000L, result / sample);
+  if (struct_cosphi.nb_sample > 0) struct_cosphi.value = min (1000L, struct_cosphi.sum / struct_cosphi.nb_sample);
 
   // update current page and value
-  struct_cosphi.page           = page;
-  struct_cosphi.arr_page[page] = struct_cosphi.value;
+  struct_cosphi.page           = (uint8_t)page;
+  struct_cosphi.arr_page[page] = (int16_t)struct_cosphi.value;
 }
 
 /*********************************************\
@@ -2250,7 +3045,7 @@ void TeleinfoReceptionMessageReset ()
   teleinfo_meter.reception = TIC_RECEPTION_NONE;
 
   // reset line content
-  strcpy (teleinfo_message.str_line, PSTR (""));
+  TeleinfoReceptionLineReset ();
 
   // log and increment reset counter
   AddLog (LOG_LEVEL_DEBUG, PSTR ("TIC: Message reset"));
@@ -2265,13 +3060,13 @@ void TeleinfoReceptionMessageStart ()
   // set next stage
   teleinfo_meter.reception = TIC_RECEPTION_MESSAGE;
 
-  // reset error flag, line index
+  // reset error flag and current message lines
   teleinfo_message.error      = 0;
-  teleinfo_message.index_line = 0;
   teleinfo_message.injection  = 0;
+  TeleinfoEnergyMessageReset ();
 
   // reset line and total
-  strcpy_P (teleinfo_message.str_line,  PSTR(""));
+  TeleinfoReceptionLineReset ();
   strcpy_P (teleinfo_message.str_total, PSTR (""));
 
   // init calendar data
@@ -2289,22 +3084,21 @@ void TeleinfoReceptionMessageStart ()
 // handle end of message
 void TeleinfoReceptionMessageStop ()
 {
-  bool     delta_va;
   uint8_t  phase;
-  uint32_t timestamp;
-  long     value;
+  uint32_t timestamp, time_start;
   int32_t  duration, average, delta, quantity;
   char     str_text[8];
 
   // set next stage and get current timestamp
   teleinfo_meter.reception = TIC_RECEPTION_NONE;
   timestamp = millis ();
+  time_start = micros ();
 
   // handle contract type and period update
   if (TeleinfoContractUpdate ()) TeleinfoContractUpdatePeriod ();
 
   // if needed, apply message index according to new period
-  if (teleinfo_message.str_total[0] != 0) TeleinfoEnergyConsoIndexCounterUpdate (teleinfo_message.str_total, teleinfo_contract.period);
+  if (teleinfo_message.str_total[0] != 0) TeleinfoEnergyConsoIndexCounterUpdate (teleinfo_message.str_total, 0, 0, teleinfo_contract.period);
 
   // increment messages counter
   teleinfo_meter.nb_message++;
@@ -2342,10 +3136,10 @@ void TeleinfoReceptionMessageStop ()
   TeleinfoEnergyMessageReset ();
 
   // save max number of lines
-  teleinfo_message.index_max = max (teleinfo_message.index_last, teleinfo_message.index_max);
+  teleinfo_message.index_max = max ((int)TeleinfoEnergyMessageLineCount (), teleinfo_message.index_max);
 
   // reset line and total
-  strcpy_P (teleinfo_message.str_line,  PSTR(""));
+  TeleinfoReceptionLineReset ();
   strcpy_P (teleinfo_message.str_total, PSTR(""));
 
   // counter global indexes
@@ -2423,30 +3217,13 @@ void TeleinfoReceptionMessageStop ()
       if (teleinfo_config.meter || teleinfo_config.calendar || teleinfo_config.relay) teleinfo_meter.json.data = true;
     }
 
-    // else if % power change detected
-    else if ((teleinfo_config.policy == TIC_POLICY_DELTA) && (Settings->energy_power_delta[0] > 0))
+    // else if report by exception, detect fields out of their deadband
+    else if (teleinfo_config.policy == TIC_POLICY_DELTA)
     {
-      // get delta power for dynamic publication
-      delta_va = false;
-      value    = (long)Settings->energy_power_delta[0];
-
-      // conso : detect % power change thru phases (works with increase and decrease)
-      for (phase = 0; phase < teleinfo_contract.phase; phase++) 
-        if (abs (teleinfo_conso.phase[phase].pact_last - teleinfo_conso.phase[phase].pact) >= value) delta_va = true;
-
-      // prod : detect % power change (works with increase and decrease)
-      if (abs (teleinfo_prod.pact_last - teleinfo_prod.pact) >= value) delta_va = true;
+      TeleinfoDeltaUpdate ();
 
-      // if energy has changed more than the trigger
-      if (delta_va)
-      {
-        // update phases reference
-        for (phase = 0; phase < teleinfo_contract.phase; phase++) teleinfo_conso.phase[phase].pact_last = teleinfo_conso.phase[phase].pact;
-        teleinfo_prod.pact_last = teleinfo_prod.pact;
-
-        // if deepsleep not enabled, ask for data publication
-        if (Settings->deepsleep == 0) teleinfo_meter.json.data = true;
-      }
+      // if deepsleep not enabled, ask for sparse publication of changed fields
+      if ((teleinfo_delta.mask != 0) && (Settings->deepsleep == 0)) teleinfo_meter.json.delta = true;
     }
   }
 
@@ -2473,6 +3250,16 @@ void TeleinfoReceptionMessageStop ()
     if (teleinfo_conso.phase[phase].preact != 0) Energy->reactive_power[phase] = (float)teleinfo_conso.phase[phase].preact;
   }
 
+  // update message processing statistics
+  TeleinfoStatsUpdate (TIC_STAGE_MESSAGE, time_start);
+
+#ifdef USE_TELEINFO_PROMETHEUS
+#ifdef USE_WEBSERVER
+  // refresh Prometheus exposition cache
+  TeleinfoPrometheusMessageStop ();
+#endif    // USE_WEBSERVER
+#endif    // USE_TELEINFO_PROMETHEUS
+
   /*
   // -------------------
   //  update LED state
@@ -2485,6 +3272,59 @@ void TeleinfoReceptionMessageStop ()
 */
 }
 
+// reset line reception buffer and tokenizer
+void TeleinfoReceptionLineReset ()
+{
+  teleinfo_message.str_line[0]      = 0;
+  teleinfo_message.token.space      = true;
+  teleinfo_message.token.checksum   = 0;
+  teleinfo_message.token.last       = 0;
+  teleinfo_message.token.prev       = 0;
+  teleinfo_message.token.size_raw   = 0;
+  teleinfo_message.token.size       = 0;
+  teleinfo_message.token.sep_first  = 0;
+  teleinfo_message.token.sep_last   = 0;
+}
+
+// append received character to current line
+//   running checksum is updated, TAB and SPACE are collapsed to a single SPACE
+//   and separators positions are recorded as characters arrive
+void TeleinfoReceptionLineAppend (const char character)
+{
+  uint8_t size;
+
+  // update raw line data (size saturates to detect overflow)
+  if (teleinfo_message.token.size_raw < UINT8_MAX) teleinfo_message.token.size_raw++;
+  teleinfo_message.token.checksum += (uint8_t)character;
+  teleinfo_message.token.prev = teleinfo_message.token.last;
+  teleinfo_message.token.last = (uint8_t)character;
+
+  // if line buffer is full, ignore character
+  size = teleinfo_message.token.size;
+  if (size >= TIC_LINE_SIZE - 1) return;
+
+  // separator : keep only one SPACE and record its position
+  if ((character == 0x09) || (character == ' '))
+  {
+    if (!teleinfo_message.token.space)
+    {
+      if (teleinfo_message.token.sep_first == 0) teleinfo_message.token.sep_first = size;
+      teleinfo_message.token.sep_last = size;
+      teleinfo_message.str_line[size] = ' ';
+      teleinfo_message.token.size++;
+    }
+    teleinfo_message.token.space = true;
+  }
+
+  // else keep current character
+  else
+  {
+    teleinfo_message.str_line[size] = character;
+    teleinfo_message.token.size++;
+    teleinfo_message.token.space = false;
+  }
+}
+
 // handle start of line
 void TeleinfoReceptionLineStart ()
 {
@@ -2492,37 +3332,41 @@ void TeleinfoReceptionLineStart ()
   teleinfo_meter.reception = TIC_RECEPTION_LINE;
 
   // reset line content
-  strcpy_P (teleinfo_message.str_line, PSTR (""));
+  TeleinfoReceptionLineReset ();
 }
 
 // handle end of line
 void TeleinfoReceptionLineStop ()
 {
-  uint8_t phase, relay;
-  int     index = -1;
-  long    value;
-  char    checksum;
-  char*   pstr_match;
-  char    str_etiquette[TIC_ETIQUETTE_SIZE];
-  char    str_donnee[TIC_DONNEE_SIZE];
-  char    str_text[TIC_DONNEE_SIZE];
+  uint8_t  phase, relay;
+  uint8_t  digits = 0;
+  int      index  = -1;
+  long     value;
+  unsigned long long number = 0;
+  uint32_t time_start, time_checksum;
+  char     checksum;
+  char    *pstr_match;
+  char    *pstr_etiquette, *pstr_donnee;
+  char     str_text[TIC_DONNEE_SIZE];
 
   // ignore if not in line reception stage
   if (teleinfo_meter.reception != TIC_RECEPTION_LINE) return;
 
   // increment line counter
   teleinfo_meter.nb_line++;
+  time_start = micros ();
 
   // if checksum is ok, handle the line
-  checksum = TeleinfoEnergyCalculateChecksum (teleinfo_message.str_line, str_etiquette, sizeof (str_etiquette), str_donnee, sizeof (str_donnee));
+  time_checksum = micros ();
+  checksum = TeleinfoEnergyCalculateChecksum (pstr_etiquette, pstr_donnee);
+  TeleinfoStatsUpdate (TIC_STAGE_CHECKSUM, time_checksum);
   if (checksum != 0)
   {
-    // select etiquette list according to contract
-    if (teleinfo_contract.mode < TIC_MODE_MAX)
-    {
-      index = GetCommandCode (str_text, sizeof (str_text), str_etiquette, arr_kTicEtiquette[teleinfo_contract.mode]);
-      if (index != -1) index += arrTicEtiquetteDelta[teleinfo_contract.mode];
-    }
+    // get etiquette index in list of current meter mode
+    index = TeleinfoEtiquetteSearch (pstr_etiquette);
+
+    // parse numeric donnee once (number is 0 if donnee is not only digits)
+    digits = TeleinfoEnergyParseNumber (pstr_donnee, number);
 
     // update data according to etiquette
     switch (index)
@@ -2562,7 +3406,7 @@ void TeleinfoReceptionLineStop ()
       case TIC_STD_DATE:
       case TIC_PME_DATE:
       case TIC_EME_DATECOUR:
-        TeleinfoTimestampFromDate (str_donnee);
+        TeleinfoTimestampFromDate (pstr_donnee);
         break;
 
       //   Identifiant compteur
@@ -2570,7 +3414,7 @@ void TeleinfoReceptionLineStop ()
       case TIC_HIS_ADCO:
       case TIC_STD_ADSC:
       case TIC_PME_ADS:
-        TeleinfoEnergyMeterSetModel (str_donnee);
+        TeleinfoEnergyMeterSetModel (pstr_donnee);
         break;
 
       //   Contract period
@@ -2578,8 +3422,8 @@ void TeleinfoReceptionLineStop ()
 
       case TIC_HIS_OPTARIF:
         // handle specificity of Historique Tempo where last char is dynamic (BBRx)
-        strlcpy (teleinfo_message.str_contract, str_donnee, 4);
-        if (strcmp_P (teleinfo_message.str_contract, PSTR ("BBR")) != 0) strlcpy (teleinfo_message.str_contract, str_donnee, sizeof (teleinfo_message.str_contract));
+        strlcpy (teleinfo_message.str_contract, pstr_donnee, 4);
+        if (strcmp_P (teleinfo_message.str_contract, PSTR ("BBR")) != 0) strlcpy (teleinfo_message.str_contract, pstr_donnee, sizeof (teleinfo_message.str_contract));
 
         // set date according to RTC time as there is no timestamp in historic mode
         if (RtcTime.valid) TeleinfoCalendarSetDate (RtcTime.year % 100, RtcTime.month, RtcTime.day_of_month, RtcTime.hour, RtcTime.minute);
@@ -2588,7 +3432,7 @@ void TeleinfoReceptionLineStop ()
       case TIC_STD_NGTF:
       case TIC_PME_MESURES1:
       case TIC_EME_CONTRAT:
-        strlcpy (teleinfo_message.str_contract, str_donnee, sizeof (teleinfo_message.str_contract));
+        strlcpy (teleinfo_message.str_contract, pstr_donnee, sizeof (teleinfo_message.str_contract));
         break;
 
       //   Period
@@ -2601,7 +3445,7 @@ void TeleinfoReceptionLineStop ()
 
       // period index
       case TIC_STD_NTARF:
-        value = atol (str_donnee);
+        value = (long)number;
         if (value > 0) teleinfo_message.period = (uint8_t)value - 1;
         break;
 
@@ -2610,7 +3454,7 @@ void TeleinfoReceptionLineStop ()
       case TIC_STD_LTARF:
       case TIC_PME_PTCOUR1:
       case TIC_EME_PTCOUR:
-        strlcpy (teleinfo_message.str_period, str_donnee, sizeof (teleinfo_message.str_period));
+        strlcpy (teleinfo_message.str_period, pstr_donnee, sizeof (teleinfo_message.str_period));
         break;
 
       //   Current
@@ -2619,17 +3463,17 @@ void TeleinfoReceptionLineStop ()
       case TIC_HIS_IINST:
       case TIC_HIS_IINST1:
       case TIC_STD_IRMS1:
-        TeleinfoenergyCurrentUpdate (str_donnee, 0);
+        TeleinfoenergyCurrentUpdate (pstr_donnee, digits, number, 0);
         break;
 
       case TIC_HIS_IINST2:
       case TIC_STD_IRMS2:
-        TeleinfoenergyCurrentUpdate (str_donnee, 1);
+        TeleinfoenergyCurrentUpdate (pstr_donnee, digits, number, 1);
         break;
 
       case TIC_HIS_IINST3:
       case TIC_STD_IRMS3:
-        TeleinfoenergyCurrentUpdate (str_donnee, 2);
+        TeleinfoenergyCurrentUpdate (pstr_donnee, digits, number, 2);
         teleinfo_contract.phase = 3; 
         break;
 
@@ -2639,29 +3483,29 @@ void TeleinfoReceptionLineStop ()
       // instant apparent power, 
       case TIC_HIS_PAPP:
       case TIC_STD_SINSTS:
-        TeleinfoEnergyConsoApparentPowerUpdate (str_donnee);
+        TeleinfoEnergyConsoApparentPowerUpdate (pstr_donnee, digits, number);
         break;
 
       case TIC_STD_SINSTS1:
-        TeleinfoEnergyConsoApparentPowerUpdate (str_donnee, 0);
+        TeleinfoEnergyConsoApparentPowerUpdate (pstr_donnee, digits, number, 0);
         break;
 
       case TIC_STD_SINSTS2:
-        TeleinfoEnergyConsoApparentPowerUpdate (str_donnee, 1);
+        TeleinfoEnergyConsoApparentPowerUpdate (pstr_donnee, digits, number, 1);
         break;
 
       case TIC_STD_SINSTS3:
-        TeleinfoEnergyConsoApparentPowerUpdate (str_donnee, 2);
+        TeleinfoEnergyConsoApparentPowerUpdate (pstr_donnee, digits, number, 2);
         break;
 
       // if in prod mode, instant apparent power, 
       case TIC_STD_SINSTI:
-        TeleinfoEnergyProdApparentPowerUpdate (str_donnee);
+        TeleinfoEnergyProdApparentPowerUpdate (pstr_donnee, digits, number);
         break;
 
       // apparent power counter since last period
       case TIC_PME_EAPPS:
-        strcpy (str_text, str_donnee);
+        strcpy (str_text, pstr_donnee);
         pstr_match = strchr (str_text, 'V');
         if (pstr_match != nullptr) *pstr_match = 0;
         teleinfo_conso.papp_now = atol (str_text);
@@ -2670,7 +3514,7 @@ void TeleinfoReceptionLineStop ()
       // active power counter since last period
       case TIC_PME_EAS:
       case TIC_EME_EA:
-        strcpy (str_text, str_donnee);
+        strcpy (str_text, pstr_donnee);
         pstr_match = strchr (str_text, 'W');
         if (pstr_match != nullptr) *pstr_match = 0;
         teleinfo_conso.pact_now = atol (str_text);
@@ -2678,7 +3522,7 @@ void TeleinfoReceptionLineStop ()
 
       // reactive power counter since last period
       case TIC_EME_ERP:
-        strcpy (str_text, str_donnee);
+        strcpy (str_text, pstr_donnee);
         pstr_match = strchr (str_text, 'v');
         if (pstr_match != nullptr) *pstr_match = 0;
         teleinfo_conso.preact_now = atol (str_text);
@@ -2689,34 +3533,34 @@ void TeleinfoReceptionLineStop ()
 
       // RMS voltage
       case TIC_STD_URMS1:
-        TeleinfoEnergyVoltageUpdate (str_donnee, 0, true);
+        TeleinfoEnergyVoltageUpdate (pstr_donnee, digits, number, 0, true);
         break;
 
       case TIC_STD_URMS2:
-        TeleinfoEnergyVoltageUpdate (str_donnee, 1, true);
+        TeleinfoEnergyVoltageUpdate (pstr_donnee, digits, number, 1, true);
         break;
 
       case TIC_STD_URMS3:
-        TeleinfoEnergyVoltageUpdate (str_donnee, 2, true);
+        TeleinfoEnergyVoltageUpdate (pstr_donnee, digits, number, 2, true);
         teleinfo_contract.phase = 3; 
         break;
 
       // average voltage
       case TIC_STD_UMOY1:
-        TeleinfoEnergyVoltageUpdate (str_donnee, 0, false);
+        TeleinfoEnergyVoltageUpdate (pstr_donnee, digits, number, 0, false);
         break;
 
       case TIC_STD_UMOY2:
-        TeleinfoEnergyVoltageUpdate (str_donnee, 1, false);
+        TeleinfoEnergyVoltageUpdate (pstr_donnee, digits, number, 1, false);
         break;
 
       case TIC_STD_UMOY3:
-        TeleinfoEnergyVoltageUpdate (str_donnee, 2, false);
+        TeleinfoEnergyVoltageUpdate (pstr_donnee, digits, number, 2, false);
         teleinfo_contract.phase = 3; 
         break;
 
       case TIC_EME_U10MN:         // for the last 10 mn
-        for (phase = 0; phase < teleinfo_contract.phase; phase ++) TeleinfoEnergyVoltageUpdate (str_donnee, phase, false);
+        for (phase = 0; phase < teleinfo_contract.phase; phase ++) TeleinfoEnergyVoltageUpdate (pstr_donnee, digits, number, phase, false);
         break;
 
       //   Contract max values
@@ -2724,7 +3568,7 @@ void TeleinfoReceptionLineStop ()
 
       // Maximum Current
       case TIC_HIS_ISOUSC:
-        value = atol (str_donnee);
+        value = (long)number;
         if ((value > 0) && (teleinfo_contract.isousc != value))
         {
           teleinfo_contract.isousc = value;
@@ -2736,63 +3580,63 @@ void TeleinfoReceptionLineStop ()
       case TIC_STD_PREF:
       case TIC_STD_PCOUP:
       case TIC_PME_PS:
-        TeleinfoContractPowerUpdate (str_donnee);
+        TeleinfoContractPowerUpdate (pstr_donnee, digits, number);
         break;
 
       case TIC_EME_PSP:
-        if (teleinfo_contract.period == 0) TeleinfoContractPowerUpdate (str_donnee);
+        if (teleinfo_contract.period == 0) TeleinfoContractPowerUpdate (pstr_donnee, digits, number);
         break;
 
       case TIC_EME_PSPM:
-        if (teleinfo_contract.period == 1) TeleinfoContractPowerUpdate (str_donnee);
+        if (teleinfo_contract.period == 1) TeleinfoContractPowerUpdate (pstr_donnee, digits, number);
         break;
 
       case TIC_EME_PSHPH:
-        if (teleinfo_contract.period == 2) TeleinfoContractPowerUpdate (str_donnee);
+        if (teleinfo_contract.period == 2) TeleinfoContractPowerUpdate (pstr_donnee, digits, number);
         break;
 
       case TIC_EME_PSHPD:
-        if (teleinfo_contract.period == 3) TeleinfoContractPowerUpdate (str_donnee);
+        if (teleinfo_contract.period == 3) TeleinfoContractPowerUpdate (pstr_donnee, digits, number);
         break;
 
       case TIC_EME_PSHCH:
-        if (teleinfo_contract.period == 4) TeleinfoContractPowerUpdate (str_donnee);
+        if (teleinfo_contract.period == 4) TeleinfoContractPowerUpdate (pstr_donnee, digits, number);
         break;
 
       case TIC_EME_PSHCD:
-        if (teleinfo_contract.period == 5) TeleinfoContractPowerUpdate (str_donnee);
+        if (teleinfo_contract.period == 5) TeleinfoContractPowerUpdate (pstr_donnee, digits, number);
         break;
 
       case TIC_EME_PSHPE:
-        if (teleinfo_contract.period == 6) TeleinfoContractPowerUpdate (str_donnee);
+        if (teleinfo_contract.period == 6) TeleinfoContractPowerUpdate (pstr_donnee, digits, number);
         break;
 
       case TIC_EME_PSHCE:
-        if (teleinfo_contract.period == 7) TeleinfoContractPowerUpdate (str_donnee);
+        if (teleinfo_contract.period == 7) TeleinfoContractPowerUpdate (pstr_donnee, digits, number);
         break;
 
       case TIC_EME_PSJA:
-        if (teleinfo_contract.period == 8) TeleinfoContractPowerUpdate (str_donnee);
+        if (teleinfo_contract.period == 8) TeleinfoContractPowerUpdate (pstr_donnee, digits, number);
         break;
 
       case TIC_EME_PSHH:
-        if (teleinfo_contract.period == 9) TeleinfoContractPowerUpdate (str_donnee);
+        if (teleinfo_contract.period == 9) TeleinfoContractPowerUpdate (pstr_donnee, digits, number);
         break;
 
       case TIC_EME_PSHD:
-        if (teleinfo_contract.period == 10) TeleinfoContractPowerUpdate (str_donnee);
+        if (teleinfo_contract.period == 10) TeleinfoContractPowerUpdate (pstr_donnee, digits, number);
         break;
 
       case TIC_EME_PSHM:
-        if (teleinfo_contract.period == 11) TeleinfoContractPowerUpdate (str_donnee);
+        if (teleinfo_contract.period == 11) TeleinfoContractPowerUpdate (pstr_donnee, digits, number);
         break;
 
       case TIC_EME_PSDSM:
-        if (teleinfo_contract.period == 12) TeleinfoContractPowerUpdate (str_donnee);
+        if (teleinfo_contract.period == 12) TeleinfoContractPowerUpdate (pstr_donnee, digits, number);
         break;
 
       case TIC_EME_PSSCM:
-        if (teleinfo_contract.period == 13) TeleinfoContractPowerUpdate (str_donnee);
+        if (teleinfo_contract.period == 13) TeleinfoContractPowerUpdate (pstr_donnee, digits, number);
         break;
 
       //   Counters
@@ -2800,11 +3644,11 @@ void TeleinfoReceptionLineStop ()
 
       // counter according to current period
       case TIC_PME_EAPS:
-        strlcpy (teleinfo_message.str_total, str_donnee, sizeof (teleinfo_message.str_total));
+        strlcpy (teleinfo_message.str_total, pstr_donnee, sizeof (teleinfo_message.str_total));
         break;
 
       case TIC_STD_EAIT:
-        TeleinfoEnergyProdGlobalCounterUpdate (str_donnee);
+        TeleinfoEnergyProdGlobalCounterUpdate (pstr_donnee, digits, number);
         break;
 
       case TIC_HIS_BASE:
@@ -2813,7 +3657,7 @@ void TeleinfoReceptionLineStop ()
       case TIC_HIS_BBRHCJB:
       case TIC_STD_EASF01:
       case TIC_EME_EAPP:
-        TeleinfoEnergyConsoIndexCounterUpdate (str_donnee, 0);
+        TeleinfoEnergyConsoIndexCounterUpdate (pstr_donnee, digits, number, 0);
         break;
 
       case TIC_HIS_HCHP:
@@ -2821,67 +3665,67 @@ void TeleinfoReceptionLineStop ()
       case TIC_HIS_BBRHPJB:
       case TIC_STD_EASF02:
       case TIC_EME_EAPPM:
-        TeleinfoEnergyConsoIndexCounterUpdate (str_donnee, 1);
+        TeleinfoEnergyConsoIndexCounterUpdate (pstr_donnee, digits, number, 1);
         break;
 
       case TIC_HIS_BBRHCJW:
       case TIC_STD_EASF03:
       case TIC_EME_EAPHPH:
-        TeleinfoEnergyConsoIndexCounterUpdate (str_donnee, 2);
+        TeleinfoEnergyConsoIndexCounterUpdate (pstr_donnee, digits, number, 2);
         break;
 
       case TIC_HIS_BBRHPJW:
       case TIC_STD_EASF04:
       case TIC_EME_EAPHPD:
-        TeleinfoEnergyConsoIndexCounterUpdate (str_donnee, 3);
+        TeleinfoEnergyConsoIndexCounterUpdate (pstr_donnee, digits, number, 3);
         break;
 
       case TIC_HIS_BBRHCJR:
       case TIC_STD_EASF05:
       case TIC_EME_EAPHCH:
-        TeleinfoEnergyConsoIndexCounterUpdate (str_donnee, 4);
+        TeleinfoEnergyConsoIndexCounterUpdate (pstr_donnee, digits, number, 4);
         break;
 
       case TIC_HIS_BBRHPJR:
       case TIC_STD_EASF06:
       case TIC_EME_EAPHCD:
-        TeleinfoEnergyConsoIndexCounterUpdate (str_donnee, 5);
+        TeleinfoEnergyConsoIndexCounterUpdate (pstr_donnee, digits, number, 5);
         break;
 
       case TIC_STD_EASF07:
       case TIC_EME_EAPHPE:
-        TeleinfoEnergyConsoIndexCounterUpdate (str_donnee, 6);
+        TeleinfoEnergyConsoIndexCounterUpdate (pstr_donnee, digits, number, 6);
         break;
 
       case TIC_STD_EASF08:
       case TIC_EME_EAPHCE:
-        TeleinfoEnergyConsoIndexCounterUpdate (str_donnee, 7);
+        TeleinfoEnergyConsoIndexCounterUpdate (pstr_donnee, digits, number, 7);
         break;
 
       case TIC_STD_EASF09:
       case TIC_EME_EAPJA:
-        TeleinfoEnergyConsoIndexCounterUpdate (str_donnee, 8);
+        TeleinfoEnergyConsoIndexCounterUpdate (pstr_donnee, digits, number, 8);
       break;
 
       case TIC_STD_EASF10:
       case TIC_EME_EAPHH:
-        TeleinfoEnergyConsoIndexCounterUpdate (str_donnee, 9);
+        TeleinfoEnergyConsoIndexCounterUpdate (pstr_donnee, digits, number, 9);
         break;
 
       case TIC_EME_EAPHD:
-        TeleinfoEnergyConsoIndexCounterUpdate (str_donnee, 10);
+        TeleinfoEnergyConsoIndexCounterUpdate (pstr_donnee, digits, number, 10);
         break;
 
       case TIC_EME_EAPHM:
-        TeleinfoEnergyConsoIndexCounterUpdate (str_donnee, 11);
+        TeleinfoEnergyConsoIndexCounterUpdate (pstr_donnee, digits, number, 11);
         break;
 
       case TIC_EME_EAPDSM:
-        TeleinfoEnergyConsoIndexCounterUpdate (str_donnee, 12);
+        TeleinfoEnergyConsoIndexCounterUpdate (pstr_donnee, digits, number, 12);
         break;
 
       case TIC_EME_EAPSCM:
-        TeleinfoEnergyConsoIndexCounterUpdate (str_donnee, 13);
+        TeleinfoEnergyConsoIndexCounterUpdate (pstr_donnee, digits, number, 13);
         break;
 
       //   Flags
@@ -2912,73 +3756,70 @@ void TeleinfoReceptionLineStop ()
         break;
 
       case TIC_HIS_DEMAIN:
-        TeleinfoCalendarSetDemain (str_donnee);
+        TeleinfoCalendarSetDemain (pstr_donnee);
         break;
 
       case TIC_PME_PREAVIS:
       case TIC_EME_PREAVIS:
-        TeleinfoDriverAlertTrigger (TIC_ALERT_OVERLOAD, str_donnee);
+        TeleinfoDriverAlertTrigger (TIC_ALERT_OVERLOAD, pstr_donnee);
         break;
 
       // begin of next pointe period
       case TIC_STD_DPM1:
-        TeleinfoCalendarPointeBegin (0, str_donnee);
+        TeleinfoCalendarPointeBegin (0, pstr_donnee);
         break;
       case TIC_STD_DPM2:
-        TeleinfoCalendarPointeBegin (1, str_donnee);
+        TeleinfoCalendarPointeBegin (1, pstr_donnee);
         break;
       case TIC_STD_DPM3:
-        TeleinfoCalendarPointeBegin (2, str_donnee);
+        TeleinfoCalendarPointeBegin (2, pstr_donnee);
         break;
 
       // end of next pointe period
       case TIC_STD_FPM1:
-        TeleinfoCalendarPointeEnd (0, str_donnee);
+        TeleinfoCalendarPointeEnd (0, pstr_donnee);
         break;
       case TIC_STD_FPM2:
-        TeleinfoCalendarPointeEnd (1, str_donnee);
+        TeleinfoCalendarPointeEnd (1, pstr_donnee);
         break;
       case TIC_STD_FPM3:
-        TeleinfoCalendarPointeEnd (2, str_donnee);
+        TeleinfoCalendarPointeEnd (2, pstr_donnee);
         break;
         
       // day standard profile
       case TIC_STD_PJOURF1:
-        TeleinfoCalendarDefaultProfile (str_donnee);
+        TeleinfoCalendarDefaultProfile (pstr_donnee);
         break;
         
       // next pointe profile
       case TIC_STD_PPOINTE:
-        TeleinfoCalendarPointeProfile (str_donnee);
+        TeleinfoCalendarPointeProfile (pstr_donnee);
         break;
         
       // STGE flags
       case TIC_STD_STGE:
-        TeleinfoEnergyAnalyseSTGE (str_donnee);
+        TeleinfoEnergyAnalyseSTGE (pstr_donnee);
         break;
 
       case TIC_STD_RELAIS:
-        relay = (uint8_t)atoi (str_donnee);
+        relay = (uint8_t)number;
         if ((relay != teleinfo_conso.relay) && TeleinfoDriverMeterReady ()) teleinfo_meter.json.data = true;
         teleinfo_conso.relay = relay;
         break;
     }
   }
 
-  // if maximum number of lines not reached, save new line
-  index = teleinfo_message.index_line;
-  teleinfo_message.arr_line[index].checksum = checksum;
-  strlcpy (teleinfo_message.arr_line[index].str_etiquette, str_etiquette, TIC_ETIQUETTE_SIZE);
-  strlcpy (teleinfo_message.arr_line[index].str_donnee, str_donnee, TIC_DONNEE_SIZE);
-
-  // increment line index and stay on last line if reached
-  teleinfo_message.index_line = min (teleinfo_message.index_line + 1, TIC_LINE_QTY - 1);
+  // if message storage not full, save new line
+  TeleinfoEnergyMessageAddLine (index, pstr_etiquette, pstr_donnee, digits, number, checksum);
 
   // set next stage
   teleinfo_meter.reception = TIC_RECEPTION_MESSAGE;
 
   // reset line content
-  strcpy_P (teleinfo_message.str_line, PSTR (""));
+  TeleinfoReceptionLineReset ();
+
+  // update line processing statistics
+  TeleinfoStatsUpdate (TIC_STAGE_LINE, time_start);
 }
 
 // get relay status
@@ -3063,32 +3904,37 @@ void TeleinfoEnergyInit ()
   // init calendar slots to 0
   for (index = TIC_DAY_TODAY; index < TIC_DAY_MAX; index ++) teleinfo_calendar[index].level = TIC_LEVEL_NONE;
 
+  // init reception statistics
+  TeleinfoStatsReset ();
+
   // init message data
   teleinfo_message.timestamp_last = UINT32_MAX;
   strcpy_P (teleinfo_message.str_total, PSTR (""));
-  strcpy_P (teleinfo_message.str_line,  PSTR (""));
+  TeleinfoReceptionLineReset ();
   TeleinfoEnergyMessageReset ();
   TeleinfoEnergyMessageSaveLast ();
 
   // conso data
   teleinfo_conso.cosphi.quantity   = 0;
   teleinfo_conso.cosphi.index      = 0;
+  teleinfo_conso.cosphi.nb_sample  = 0;
+  teleinfo_conso.cosphi.sum        = 0;
   teleinfo_conso.cosphi.page       = 0;
   teleinfo_conso.cosphi.nb_message = 0;
   teleinfo_conso.cosphi.value      = TIC_COSPHI_DEFAULT;     
-  for (index = 0; index < TIC_COSPHI_PAGE;   index++) teleinfo_conso.cosphi.arr_page[index]  = TIC_COSPHI_DEFAULT;
-  for (index = 0; index < TIC_COSPHI_SAMPLE; index++) teleinfo_conso.cosphi.arr_value[index] = LONG_MAX;
+  for (index = 0; index < TIC_COSPHI_PAGE; index++) teleinfo_conso.cosphi.arr_page[index] = TIC_COSPHI_DEFAULT;
 
   // prod data
   teleinfo_prod.enabled           = false;
   teleinfo_prod.cacsi             = false;
   teleinfo_prod.cosphi.quantity   = 0;
   teleinfo_prod.cosphi.index      = 0;
+  teleinfo_prod.cosphi.nb_sample  = 0;
+  teleinfo_prod.cosphi.sum        = 0;
   teleinfo_prod.cosphi.page       = 0;
   teleinfo_prod.cosphi.nb_message = 0;
   teleinfo_prod.cosphi.value      = TIC_COSPHI_DEFAULT;
-  for (index = 0; index < TIC_COSPHI_PAGE;   index++) teleinfo_prod.cosphi.arr_page[index]  = TIC_COSPHI_DEFAULT;
-  for (index = 0; index < TIC_COSPHI_SAMPLE; index++) teleinfo_prod.cosphi.arr_value[index] = LONG_MAX;
+  for (index = 0; index < TIC_COSPHI_PAGE; index++) teleinfo_prod.cosphi.arr_page[index] = TIC_COSPHI_DEFAULT;
 
   // conso data per phase
   for (phase = 0; phase < TIC_PHASE_MAX; phase++)
@@ -3107,7 +3953,6 @@ void TeleinfoEnergyInit ()
     teleinfo_conso.phase[phase].sinsts    = 0;
     teleinfo_conso.phase[phase].pact      = 0;
     teleinfo_conso.phase[phase].preact    = 0;
-    teleinfo_conso.phase[phase].pact_last = 0;
     teleinfo_conso.phase[phase].cosphi    = 1000;
   }
 
@@ -3120,13 +3965,8 @@ void TeleinfoEnergyEverySecond ()
 {
   uint8_t phase, index;
 
-  // if needed, set contract change
-  if (teleinfo_sleep.nb_change > TIC_NEW_CONTRACT_TRIGGER)
-  {
-    TeleinfoSetSpeed (TIC_DEFAULT_SPEED);
-    TeleinfoContractChange ();
-    TasmotaGlobal.restart_flag = 2;
-  }
+  // if needed, switch contract on the fly (messages are received, so speed is right)
+  if (teleinfo_sleep.nb_change > TIC_NEW_CONTRACT_TRIGGER) TeleinfoContractChange ();
 
   // else, if not done, try to enable reception
   else if (!TeleinfoEnergySerialIsStarted ()) TeleinfoEnergySerialStart ();